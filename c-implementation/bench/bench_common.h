@@ -0,0 +1,162 @@
+/**
+ * @file bench_common.h
+ * @brief Shared helpers for the SAV IPFIX benchmarks
+ *
+ * Each benchmark is a single translation unit that includes this header.
+ * Define BENCH_COUNT_ALLOCS before including it to interpose malloc() and
+ * friends and count heap allocations (this also catches allocations made
+ * inside GLib and libfixbuf, since both allocate through malloc()).
+ */
+
+#ifndef SAV_BENCH_COMMON_H
+#define SAV_BENCH_COMMON_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include "sav_exporter.h"
+
+/* Monotonic clock in nanoseconds */
+static inline uint64_t bench_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * Number of write-type syscalls made by this process so far
+ *
+ * Reads "syscw" from /proc/self/io, which counts write(), writev(),
+ * send() and friends regardless of whether they are issued by this
+ * program, libfixbuf or stdio.
+ *
+ * @return Syscall count, or UINT64_MAX if task I/O accounting is unavailable
+ */
+static inline uint64_t bench_write_syscalls(void)
+{
+    FILE *fp = fopen("/proc/self/io", "r");
+    char line[128];
+    uint64_t count = UINT64_MAX;
+
+    if (!fp) {
+        return UINT64_MAX;
+    }
+    while (fgets(line, sizeof(line), fp)) {
+        unsigned long long v;
+        if (sscanf(line, "syscw: %llu", &v) == 1) {
+            count = (uint64_t)v;
+            break;
+        }
+    }
+    fclose(fp);
+    return count;
+}
+
+#ifdef BENCH_COUNT_ALLOCS
+/* glibc entry points behind the public allocator symbols */
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void  __libc_free(void *ptr);
+
+static uint64_t bench_alloc_count = 0;
+
+void *malloc(size_t size)
+{
+    bench_alloc_count++;
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+    bench_alloc_count++;
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    if (!ptr) bench_alloc_count++;
+    return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr)
+{
+    __libc_free(ptr);
+}
+#endif /* BENCH_COUNT_ALLOCS */
+
+/**
+ * Write a synthetic SAV IPFIX file for benchmarking
+ *
+ * Records alternate between interface-based (901) and prefix-based (903)
+ * IPv4 lists.
+ *
+ * @param path                 Output file
+ * @param record_count         Number of template-400 records
+ * @param mappings_per_record  List entries per record
+ * @param err                  Error structure
+ *
+ * @return TRUE on success, FALSE on error
+ */
+static inline gboolean bench_write_sample_file(
+    const char *path,
+    uint32_t   record_count,
+    uint32_t   mappings_per_record,
+    GError     **err)
+{
+    fbInfoModel_t *model = fbInfoModelAlloc();
+    sav_init_info_model(model);
+    fbSession_t *session = fbSessionAlloc(model);
+    if (!sav_add_templates(session, err)) {
+        fbSessionFree(session);
+        fbInfoModelFree(model);
+        return FALSE;
+    }
+
+    fBuf_t *fbuf = sav_create_file_exporter(model, session, path, err);
+    if (!fbuf) {
+        fbSessionFree(session);
+        fbInfoModelFree(model);
+        return FALSE;
+    }
+
+    sav_record_ctx_t rctx;
+    gboolean ok = sav_record_ctx_init(&rctx, model, session, SAV_RULE_TYPE_ALLOWLIST,
+                                      SAV_TARGET_TYPE_INTERFACE_BASED, err);
+    for (uint32_t r = 0; r < record_count && ok; r++) {
+        uint8_t target = (uint8_t)(r & 1);
+
+        if (!sav_record_ctx_reset(&rctx, SAV_RULE_TYPE_ALLOWLIST, target, err)) {
+            ok = FALSE;
+            break;
+        }
+
+        for (uint32_t m = 0; m < mappings_per_record && ok; m++) {
+            uint32_t iface = 1 + (m % 48);
+            uint32_t v4 = htonl(0x0A000000u | ((r * mappings_per_record + m) << 8));
+
+            if (target == SAV_TARGET_TYPE_INTERFACE_BASED) {
+                ok = sav_add_ipv4_interface_prefix(&rctx, iface, v4, 24, err);
+            } else {
+                ok = sav_add_ipv4_prefix_interface(&rctx, v4, 24, iface, err);
+            }
+        }
+
+        if (ok) {
+            ok = sav_export_record(&rctx, fbuf, 1700000000000ULL + r,
+                                   SAV_RULE_TYPE_ALLOWLIST, target,
+                                   SAV_POLICY_ACTION_PERMIT, err);
+        }
+    }
+    sav_record_ctx_cleanup(&rctx);
+
+    /* Frees the session and exporter as well */
+    sav_close_exporter(fbuf);
+    fbInfoModelFree(model);
+    return ok;
+}
+
+#endif /* SAV_BENCH_COMMON_H */
@@ -0,0 +1,123 @@
+/**
+ * @file bench_export_list_size.c
+ * @brief Exporter throughput as SubTemplateList size grows
+ *
+ * Usage: bench_export_list_size [total_mappings] [record_budget]
+ *
+ * Exports the same number of IPv4 mappings to a file with list sizes from
+ * 10 to 100000 entries per sav_export_record() call, letting the exporter
+ * grow its buffer and split long lists into records within record_budget
+ * bytes (default SAV_DEFAULT_MSG_BUDGET). Reports mappings/sec and the
+ * number of template-400 records written; mappings/sec should stay flat
+ * as lists get longer.
+ *
+ * Each size runs twice: "fresh" initializes a record context per list, so
+ * every list gets a new staging buffer and SubTemplateList; "reuse" keeps
+ * one context and calls sav_record_ctx_reset() between lists, so both are
+ * allocated once.
+ */
+
+#define _GNU_SOURCE
+#include "bench_common.h"
+
+#define BENCH_FILE "bench_export_list_size.ipfix"
+
+static const uint32_t list_sizes[] = { 10, 100, 1000, 10000, 100000 };
+
+/* Export `lists` lists of `per_list` mappings; returns seconds, or < 0 on error */
+static double run(uint32_t per_list, uint32_t lists, size_t budget, gboolean reuse,
+                  uint64_t *records)
+{
+    GError *err = NULL;
+    fbInfoModel_t *model = fbInfoModelAlloc();
+    sav_init_info_model(model);
+    fbSession_t *session = fbSessionAlloc(model);
+    if (!sav_add_templates(session, &err)) {
+        fprintf(stderr, "sav_add_templates: %s\n", err->message);
+        return -1.0;
+    }
+    fBuf_t *fbuf = sav_create_file_exporter(model, session, BENCH_FILE, &err);
+    if (!fbuf) {
+        fprintf(stderr, "sav_create_file_exporter: %s\n", err->message);
+        return -1.0;
+    }
+
+    sav_record_ctx_t rctx;
+    gboolean have_ctx = FALSE;
+    *records = 0;
+    uint64_t start = bench_now_ns();
+
+    for (uint32_t l = 0; l < lists; l++) {
+        if (!have_ctx) {
+            if (!sav_record_ctx_init(&rctx, model, session, SAV_RULE_TYPE_ALLOWLIST,
+                                     SAV_TARGET_TYPE_INTERFACE_BASED, &err) ||
+                !sav_record_ctx_set_msg_budget(&rctx, budget, &err)) {
+                fprintf(stderr, "record context: %s\n", err->message);
+                return -1.0;
+            }
+            have_ctx = TRUE;
+        }
+        for (uint32_t m = 0; m < per_list; m++) {
+            uint32_t v4 = htonl(0x0A000000u | ((l * per_list + m) << 8));
+            sav_add_ipv4_interface_prefix(&rctx, 1 + (m % 48), v4, 24, NULL);
+        }
+        if (!sav_export_record(&rctx, fbuf, 1700000000000ULL + l,
+                               SAV_RULE_TYPE_ALLOWLIST, SAV_TARGET_TYPE_INTERFACE_BASED,
+                               SAV_POLICY_ACTION_PERMIT, &err)) {
+            fprintf(stderr, "sav_export_record: %s\n", err->message);
+            return -1.0;
+        }
+        *records += rctx.records_exported;
+        if (reuse) {
+            sav_record_ctx_reset(&rctx, SAV_RULE_TYPE_ALLOWLIST,
+                                 SAV_TARGET_TYPE_INTERFACE_BASED, NULL);
+        } else {
+            sav_record_ctx_cleanup(&rctx);
+            have_ctx = FALSE;
+        }
+    }
+    if (have_ctx) {
+        sav_record_ctx_cleanup(&rctx);
+    }
+
+    sav_close_exporter(fbuf);
+    double secs = (double)(bench_now_ns() - start) / 1e9;
+    fbInfoModelFree(model);
+    return secs;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t total = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 2000000;
+    size_t budget = argc > 2 ? (size_t)strtoul(argv[2], NULL, 10) : SAV_DEFAULT_MSG_BUDGET;
+
+    printf("Exporting %u IPv4 mappings per run, record budget %zu bytes\n\n",
+           total, budget);
+    printf("%12s %10s %12s %14s %14s\n", "list size", "lists", "records",
+           "fresh M/s", "reuse M/s");
+
+    for (size_t s = 0; s < sizeof(list_sizes) / sizeof(list_sizes[0]); s++) {
+        uint32_t per_list = list_sizes[s];
+        uint32_t lists = total / per_list ? total / per_list : 1;
+        uint64_t records = 0, reuse_records = 0;
+
+        double fresh_secs = run(per_list, lists, budget, FALSE, &records);
+        double reuse_secs = run(per_list, lists, budget, TRUE, &reuse_records);
+        if (fresh_secs < 0.0 || reuse_secs < 0.0) {
+            return 1;
+        }
+        if (records != reuse_records) {
+            fprintf(stderr, "record count differs: fresh %lu, reuse %lu\n",
+                    (unsigned long)records, (unsigned long)reuse_records);
+            return 1;
+        }
+
+        double mappings = (double)lists * per_list;
+        printf("%12u %10u %12lu %14.2f %14.2f\n", per_list, lists, (unsigned long)records,
+               fresh_secs > 0.0 ? mappings / fresh_secs / 1e6 : 0.0,
+               reuse_secs > 0.0 ? mappings / reuse_secs / 1e6 : 0.0);
+    }
+
+    remove(BENCH_FILE);
+    return 0;
+}
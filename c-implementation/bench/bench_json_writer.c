@@ -0,0 +1,206 @@
+/**
+ * @file bench_json_writer.c
+ * @brief JSON export throughput: fprintf() versus the buffered writer
+ *
+ * Usage: bench_json_writer [records] [mappings_per_record]
+ *
+ * Formats the same in-memory records (alternating IPv4 and IPv6 lists) as
+ * a sav_dump -j style JSON array three ways: with the original
+ * fprintf()/inet_ntop() code, with sav_json_writer_t in SAV_JSON_PRETTY
+ * style, and in SAV_JSON_COMPACT style. Reports MB/s of JSON produced,
+ * records/sec and write syscalls. The pretty runs must produce the same
+ * number of bytes.
+ */
+
+#define _GNU_SOURCE
+#include "bench_common.h"
+#include "sav_json.h"
+
+#define BENCH_FILE  "bench_json_writer.json"
+#define BATCH       256
+
+/* The fprintf()-based sav_export_record_json() this writer replaced, reading
+ * the mappings in host byte order */
+static void legacy_export_json(const sav_parsed_record_t *record, FILE *output)
+{
+    fprintf(output, "{\n");
+    fprintf(output, "  \"timestamp_ms\": %lu,\n", (unsigned long)record->timestamp_ms);
+    fprintf(output, "  \"rule_type\": %u,\n", record->rule_type);
+    fprintf(output, "  \"rule_type_name\": \"%s\",\n", sav_rule_type_name(record->rule_type));
+    fprintf(output, "  \"target_type\": %u,\n", record->target_type);
+    fprintf(output, "  \"target_type_name\": \"%s\",\n", sav_target_type_name(record->target_type));
+    fprintf(output, "  \"policy_action\": %u,\n", record->policy_action);
+    fprintf(output, "  \"policy_action_name\": \"%s\",\n", sav_policy_action_name(record->policy_action));
+    fprintf(output, "  \"sub_template_id\": %u,\n", record->sub_template_id);
+    fprintf(output, "  \"mapping_count\": %u,\n", record->mapping_count);
+    fprintf(output, "  \"mappings\": [\n");
+
+    gboolean is_ipv4 = (record->sub_template_id == SAV_TMPL_IPV4_INTERFACE_PREFIX ||
+                        record->sub_template_id == SAV_TMPL_IPV4_PREFIX_INTERFACE);
+
+    for (uint32_t i = 0; i < record->mapping_count; i++) {
+        char ip_str[INET6_ADDRSTRLEN];
+        uint32_t iface;
+        uint8_t plen;
+
+        fprintf(output, "    {\n");
+        if (is_ipv4) {
+            sav_ipv4_mapping_t *m = &record->mappings.ipv4_mappings[i];
+            uint32_t prefix = htonl(m->sourceIPv4Prefix);
+            inet_ntop(AF_INET, &prefix, ip_str, sizeof(ip_str));
+            iface = m->ingressInterface;
+            plen = m->sourceIPv4PrefixLength;
+        } else {
+            sav_ipv6_mapping_t *m = &record->mappings.ipv6_mappings[i];
+            inet_ntop(AF_INET6, m->sourceIPv6Prefix, ip_str, sizeof(ip_str));
+            iface = m->ingressInterface;
+            plen = m->sourceIPv6PrefixLength;
+        }
+        fprintf(output, "      \"interface\": %u,\n", iface);
+        fprintf(output, "      \"prefix\": \"%s\",\n", ip_str);
+        fprintf(output, "      \"prefix_length\": %u\n", plen);
+        fprintf(output, "    }%s\n", (i < record->mapping_count - 1) ? "," : "");
+    }
+    fprintf(output, "  ]\n");
+    fprintf(output, "}\n");
+}
+
+typedef enum { MODE_FPRINTF, MODE_PRETTY, MODE_COMPACT } bench_mode_t;
+
+static const char *mode_names[] = { "fprintf", "pretty", "compact" };
+
+/* One batch of records, reused for every round */
+static void build_batch(sav_parsed_record_t *batch, uint32_t per_record)
+{
+    for (uint32_t r = 0; r < BATCH; r++) {
+        sav_parsed_record_t *rec = &batch[r];
+        gboolean v6 = (r & 1);
+
+        rec->timestamp_ms = 1700000000000ULL + r;
+        rec->rule_type = SAV_RULE_TYPE_ALLOWLIST;
+        rec->target_type = SAV_TARGET_TYPE_INTERFACE_BASED;
+        rec->policy_action = SAV_POLICY_ACTION_PERMIT;
+        rec->sub_template_id = v6 ? SAV_TMPL_IPV6_INTERFACE_PREFIX
+                                  : SAV_TMPL_IPV4_INTERFACE_PREFIX;
+        rec->mapping_count = per_record;
+
+        if (v6) {
+            sav_ipv6_mapping_t *m = g_new0(sav_ipv6_mapping_t, per_record);
+            for (uint32_t i = 0; i < per_record; i++) {
+                m[i].ingressInterface = 1 + (i % 48);
+                m[i].sourceIPv6Prefix[0] = 0x20;
+                m[i].sourceIPv6Prefix[1] = 0x01;
+                m[i].sourceIPv6Prefix[2] = 0x0d;
+                m[i].sourceIPv6Prefix[3] = 0xb8;
+                m[i].sourceIPv6Prefix[4] = (uint8_t)(r >> 8);
+                m[i].sourceIPv6Prefix[5] = (uint8_t)r;
+                m[i].sourceIPv6Prefix[6] = (uint8_t)(i >> 8);
+                m[i].sourceIPv6Prefix[7] = (uint8_t)i;
+                m[i].sourceIPv6PrefixLength = 64;
+            }
+            rec->mappings.ipv6_mappings = m;
+        } else {
+            sav_ipv4_mapping_t *m = g_new0(sav_ipv4_mapping_t, per_record);
+            for (uint32_t i = 0; i < per_record; i++) {
+                m[i].ingressInterface = 1 + (i % 48);
+                m[i].sourceIPv4Prefix = 0x0A000000u | ((r * per_record + i) << 8);
+                m[i].sourceIPv4PrefixLength = 24;
+            }
+            rec->mappings.ipv4_mappings = m;
+        }
+    }
+}
+
+/* Write `records` records as one JSON array; returns seconds, or < 0 on error */
+static double run(bench_mode_t mode, const sav_parsed_record_t *batch, uint32_t records,
+                  uint64_t *bytes, uint64_t *syscalls)
+{
+    GError *err = NULL;
+    FILE *fp = fopen(BENCH_FILE, "w");
+    if (!fp) {
+        perror(BENCH_FILE);
+        return -1.0;
+    }
+
+    sav_json_writer_t writer;
+    uint64_t sys_start = bench_write_syscalls();
+    uint64_t start = bench_now_ns();
+
+    if (mode == MODE_FPRINTF) {
+        fprintf(fp, "[\n");
+        for (uint32_t r = 0; r < records; r++) {
+            if (r) fprintf(fp, ",\n");
+            legacy_export_json(&batch[r % BATCH], fp);
+        }
+        fprintf(fp, "\n]\n");
+    } else {
+        sav_json_writer_init(&writer, fp, mode == MODE_COMPACT ? SAV_JSON_COMPACT
+                                                               : SAV_JSON_PRETTY, 0);
+        sav_json_begin_array(&writer);
+        for (uint32_t r = 0; r < records; r++) {
+            sav_json_write_record(&writer, &batch[r % BATCH]);
+        }
+        sav_json_end_array(&writer);
+        if (!sav_json_writer_flush(&writer, &err)) {
+            fprintf(stderr, "sav_json_writer_flush: %s\n", err->message);
+            fclose(fp);
+            return -1.0;
+        }
+        sav_json_writer_destroy(&writer);
+    }
+
+    long size = ftell(fp);
+    fclose(fp);
+    double secs = (double)(bench_now_ns() - start) / 1e9;
+    uint64_t sys_end = bench_write_syscalls();
+
+    *bytes = size > 0 ? (uint64_t)size : 0;
+    *syscalls = (sys_start == UINT64_MAX || sys_end == UINT64_MAX) ? UINT64_MAX
+                                                                   : sys_end - sys_start;
+    return secs;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t records = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 10) : 200000;
+    uint32_t per_record = argc > 2 ? (uint32_t)strtoul(argv[2], NULL, 10) : 16;
+    sav_parsed_record_t batch[BATCH];
+    uint64_t pretty_bytes[2] = { 0, 0 };
+
+    build_batch(batch, per_record);
+
+    printf("JSON export of %u records x %u mappings\n\n", records, per_record);
+    printf("%-10s %12s %12s %14s %14s\n", "mode", "MB", "MB/s", "records/s", "write calls");
+
+    for (int mode = MODE_FPRINTF; mode <= MODE_COMPACT; mode++) {
+        uint64_t bytes = 0, syscalls = 0;
+        double secs = run((bench_mode_t)mode, batch, records, &bytes, &syscalls);
+        if (secs < 0.0) {
+            return 1;
+        }
+        if (mode != MODE_COMPACT) {
+            pretty_bytes[mode] = bytes;
+        }
+
+        printf("%-10s %12.1f %12.1f %14.0f ", mode_names[mode], bytes / 1e6,
+               secs > 0.0 ? bytes / secs / 1e6 : 0.0, secs > 0.0 ? records / secs : 0.0);
+        if (syscalls == UINT64_MAX) {
+            printf("%14s\n", "n/a");
+        } else {
+            printf("%14lu\n", (unsigned long)syscalls);
+        }
+    }
+
+    if (pretty_bytes[MODE_FPRINTF] != pretty_bytes[MODE_PRETTY]) {
+        fprintf(stderr, "pretty output size differs: fprintf %lu, writer %lu\n",
+                (unsigned long)pretty_bytes[MODE_FPRINTF],
+                (unsigned long)pretty_bytes[MODE_PRETTY]);
+        return 1;
+    }
+
+    for (uint32_t r = 0; r < BATCH; r++) {
+        sav_free_parsed_record(&batch[r]);
+    }
+    remove(BENCH_FILE);
+    return 0;
+}
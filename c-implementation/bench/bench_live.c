@@ -0,0 +1,240 @@
+/**
+ * @file bench_live.c
+ * @brief Lookup latency of published snapshots while the table changes
+ *
+ * Usage: bench_live [prefixes] [seconds] [batch]
+ *
+ * Loads an IPv4 table (default 500000 prefixes, lengths as in bench_urpf,
+ * over 4096 interfaces) into a sav_live_t and publishes it, timing the
+ * first publish against a full sav_lpm4_build() of the same rules. A
+ * reader thread then runs read sections of 64 feasible checks for
+ * addresses inside the prefixes, first with a quiet writer, then while
+ * the writer replaces batches of mappings (default 64: half removals and
+ * new prefixes, half rule changes) and publishes after each batch.
+ * Reports the p50/p99/p99.9 latency of a read section in both phases and
+ * the publish rate and time under churn. On a host with fewer than two
+ * CPUs the two threads share one and the tail shows scheduler slices.
+ */
+
+#define _GNU_SOURCE
+#include "bench_common.h"
+#include "sav_live.h"
+
+#define SECTION      64
+#define MAX_SAMPLES  (1u << 23)
+
+static uint64_t rng = 0x9E3779B97F4A7C15ULL;
+
+static uint32_t rnd32(void)
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return (uint32_t)(rng >> 32);
+}
+
+static uint8_t pick_len(void)
+{
+    uint32_t r = rnd32() % 100;
+    if (r < 55) return 24;
+    if (r < 85) return (uint8_t)(16 + rnd32() % 8);
+    if (r < 95) return (uint8_t)(8 + rnd32() % 8);
+    return (uint8_t)(25 + rnd32() % 8);
+}
+
+static void random_entry(sav_state_entry_t *e)
+{
+    uint8_t len = pick_len();
+    uint32_t prefix = len ? rnd32() & (0xFFFFFFFFu << (32 - len)) : 0;
+    uint32_t be = htonl(prefix);
+
+    memset(e, 0, sizeof(*e));
+    e->family = 4;
+    e->prefix_len = len;
+    e->interface = 1 + rnd32() % 4096;
+    e->target_type = SAV_TARGET_TYPE_INTERFACE_BASED;
+    e->rule_type = rnd32() % 10 ? SAV_RULE_TYPE_ALLOWLIST : SAV_RULE_TYPE_BLOCKLIST;
+    e->policy_action = SAV_POLICY_ACTION_PERMIT;
+    memcpy(e->prefix, &be, 4);
+}
+
+typedef struct {
+    sav_live_t      *live;
+    const uint32_t  *addrs;
+    const uint32_t  *ifaces;
+    uint32_t        n_addrs;
+    int             stop;
+    uint32_t        *samples;         /* ns per read section */
+    uint32_t        n_samples;
+    uint64_t        valid;
+} reader_ctx_t;
+
+static void *reader_main(void *data)
+{
+    reader_ctx_t *ctx = data;
+    sav_live_reader_t *reader = sav_live_reader_new(ctx->live);
+    uint32_t pos = 0;
+
+    while (!__atomic_load_n(&ctx->stop, __ATOMIC_ACQUIRE)) {
+        uint64_t start = bench_now_ns();
+        const sav_live_snapshot_t *snap = sav_live_read_begin(reader);
+        for (uint32_t i = 0; i < SECTION; i++) {
+            ctx->valid += sav_live_check4(snap, ctx->addrs[pos + i], ctx->ifaces[pos + i],
+                                          SAV_URPF_FEASIBLE);
+        }
+        sav_live_read_end(reader);
+        uint64_t ns = bench_now_ns() - start;
+
+        if (ctx->n_samples < MAX_SAMPLES) ctx->samples[ctx->n_samples++] = (uint32_t)MIN(ns, UINT32_MAX);
+        pos += SECTION;
+        if (pos + SECTION > ctx->n_addrs) pos = 0;
+    }
+    sav_live_reader_free(reader);
+    return NULL;
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void print_latency(const char *phase, uint32_t *samples, uint32_t n)
+{
+    if (n == 0) {
+        printf("%-8s no read sections completed\n", phase);
+        return;
+    }
+    qsort(samples, n, sizeof(uint32_t), cmp_u32);
+    printf("%-8s %9u sections of %u checks: p50 %6.0f ns  p99 %8.0f ns  p99.9 %9.0f ns\n",
+           phase, n, SECTION, (double)samples[n / 2], (double)samples[(uint64_t)n * 99 / 100],
+           (double)samples[(uint64_t)n * 999 / 1000]);
+}
+
+/* Run the reader alone or against a churning writer for the given time */
+static void run_phase(const char *phase, reader_ctx_t *ctx, double seconds, uint32_t batch,
+                      sav_state_entry_t *entries, uint32_t n_entries)
+{
+    uint64_t publishes = 0, publish_ns = 0, publish_max = 0, changes = 0;
+    GThread *thread;
+
+    ctx->stop = 0;
+    ctx->n_samples = 0;
+    thread = g_thread_new("live-reader", reader_main, ctx);
+
+    uint64_t start = bench_now_ns();
+    uint64_t end = start + (uint64_t)(seconds * 1e9);
+    while (bench_now_ns() < end) {
+        if (batch == 0) {
+            g_usleep(10000);
+            continue;
+        }
+        for (uint32_t k = 0; k < batch; k++) {
+            sav_state_entry_t *e = &entries[rnd32() % n_entries];
+            if (k % 2) {
+                sav_live_remove(ctx->live, e);
+                random_entry(e);
+            } else {
+                e->rule_type ^= 1;
+            }
+            sav_live_upsert(ctx->live, e);
+        }
+        uint64_t t = bench_now_ns();
+        sav_live_publish(ctx->live);
+        t = bench_now_ns() - t;
+        publish_ns += t;
+        publish_max = MAX(publish_max, t);
+        publishes++;
+        changes += batch;
+    }
+    double elapsed = (bench_now_ns() - start) / 1e9;
+
+    __atomic_store_n(&ctx->stop, 1, __ATOMIC_RELEASE);
+    g_thread_join(thread);
+
+    print_latency(phase, ctx->samples, ctx->n_samples);
+    if (publishes) {
+        printf("         %.0f publishes/sec, %.0f changes/sec, publish avg %.1f us, max %.1f us\n",
+               publishes / elapsed, changes / elapsed, publish_ns / 1e3 / publishes,
+               publish_max / 1e3);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t prefixes = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 10) : 500000;
+    double seconds = (argc > 2) ? strtod(argv[2], NULL) : 3.0;
+    uint32_t batch = (argc > 3) ? (uint32_t)strtoul(argv[3], NULL, 10) : 64;
+    uint32_t n_addrs = 1u << 20;
+    sav_live_t *live = sav_live_new();
+    sav_state_entry_t *entries = g_new(sav_state_entry_t, prefixes);
+    sav_live_stats_t stats;
+    GError *err = NULL;
+
+    printf("Live snapshots: %u prefixes, %.1f s per phase, batches of %u changes\n",
+           prefixes, seconds, batch);
+
+    for (uint32_t i = 0; i < prefixes; i++) {
+        random_entry(&entries[i]);
+        sav_live_upsert(live, &entries[i]);
+    }
+    uint64_t start = bench_now_ns();
+    sav_live_publish(live);
+    uint64_t publish_ns = bench_now_ns() - start;
+
+    sav_lpm4_t *lpm = sav_lpm4_new();
+    sav_lpm4_set_feasible(lpm, TRUE);
+    sav_lpm4_add_state(lpm, sav_live_state(live));
+    start = bench_now_ns();
+    if (!sav_lpm4_build(lpm, &err)) {
+        fprintf(stderr, "ERROR: %s\n", err ? err->message : "unknown");
+        return 1;
+    }
+    uint64_t build_ns = bench_now_ns() - start;
+
+    sav_live_get_stats(live, &stats);
+    printf("first publish   %8.1f ms (%lu partitions, %.1f MB)\n", publish_ns / 1e6,
+           (unsigned long)stats.partitions, stats.memory_bytes / 1e6);
+    printf("sav_lpm4_build  %8.1f ms\n", build_ns / 1e6);
+
+    reader_ctx_t ctx = { 0 };
+    ctx.live = live;
+    ctx.n_addrs = n_addrs;
+    ctx.samples = g_new(uint32_t, MAX_SAMPLES);
+    uint32_t *addrs = g_new(uint32_t, n_addrs);
+    uint32_t *ifaces = g_new(uint32_t, n_addrs);
+    for (uint32_t i = 0; i < n_addrs; i++) {
+        const sav_state_entry_t *e = &entries[rnd32() % prefixes];
+        uint32_t be, host = e->prefix_len ? 0xFFFFFFFFu >> e->prefix_len : 0xFFFFFFFFu;
+        memcpy(&be, e->prefix, 4);
+        addrs[i] = ntohl(be) | (rnd32() & host);
+        ifaces[i] = rnd32() % 2 ? e->interface : 1 + rnd32() % 4096;
+    }
+    ctx.addrs = addrs;
+    ctx.ifaces = ifaces;
+
+    /* Same checks on the full build, one thread */
+    uint64_t valid = 0;
+    start = bench_now_ns();
+    for (uint32_t i = 0; i < n_addrs; i++) {
+        valid += sav_lpm4_check(lpm, addrs[i], ifaces[i], SAV_URPF_FEASIBLE);
+    }
+    printf("sav_lpm4_check  %8.1f ns per check (%.1f%% valid)\n",
+           (double)(bench_now_ns() - start) / n_addrs, 100.0 * valid / n_addrs);
+    sav_lpm4_free(lpm);
+
+    run_phase("quiet", &ctx, seconds, 0, entries, prefixes);
+    run_phase("churn", &ctx, seconds, batch, entries, prefixes);
+
+    sav_live_get_stats(live, &stats);
+    printf("version %lu, %lu partitions rebuilt in all, %lu snapshots reclaimed, %lu waiting\n",
+           (unsigned long)stats.version, (unsigned long)stats.rebuilt,
+           (unsigned long)stats.reclaimed, (unsigned long)stats.retired);
+
+    g_free(addrs);
+    g_free(ifaces);
+    g_free(ctx.samples);
+    g_free(entries);
+    sav_live_free(live);
+    return 0;
+}
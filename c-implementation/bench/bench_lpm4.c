@@ -0,0 +1,132 @@
+/**
+ * @file bench_lpm4.c
+ * @brief IPv4 DIR-24-8 table: build time, lookup rate and memory
+ *
+ * Usage: bench_lpm4 [prefixes] [lookups]
+ *
+ * Adds a synthetic table of prefixes (default one million) with a length
+ * mix resembling a full routing table: mostly /24, then /16-/23, some
+ * /8-/15 and a few percent longer than /24. Each prefix is allowlisted
+ * on one of 256 interfaces; every tenth one is also blocklisted on
+ * another. Reports the build time, then Mlookups/sec for one address at a
+ * time and for sav_lpm4_lookup_n(), both over uniformly random addresses
+ * and over addresses inside the added prefixes, and the table's memory.
+ */
+
+#define _GNU_SOURCE
+#include "bench_common.h"
+#include "sav_lpm.h"
+
+#define ROUNDS 3
+
+static uint64_t rng = 0x9E3779B97F4A7C15ULL;
+
+static uint32_t rnd32(void)
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return (uint32_t)(rng >> 32);
+}
+
+static uint8_t pick_len(void)
+{
+    uint32_t r = rnd32() % 100;
+    if (r < 55) return 24;
+    if (r < 85) return (uint8_t)(16 + rnd32() % 8);
+    if (r < 95) return (uint8_t)(8 + rnd32() % 8);
+    return (uint8_t)(25 + rnd32() % 8);
+}
+
+/* Best of ROUNDS: ns per lookup, including fetching the leaf */
+static double time_lookups(const sav_lpm4_t *lpm, const uint32_t *addrs, uint32_t n,
+                           uint32_t *leaves, int batched, uint64_t *checksum)
+{
+    double best = 0;
+
+    for (int round = 0; round < ROUNDS; round++) {
+        uint64_t sum = 0;
+        uint64_t start = bench_now_ns();
+        if (batched) {
+            sav_lpm4_lookup_n(lpm, addrs, n, leaves);
+        } else {
+            for (uint32_t i = 0; i < n; i++) leaves[i] = sav_lpm4_lookup(lpm, addrs[i]);
+        }
+        for (uint32_t i = 0; i < n; i++) sum += sav_lpm4_leaf(lpm, leaves[i])->n_allow;
+        double ns = (double)(bench_now_ns() - start) / n;
+        if (round == 0 || ns < best) best = ns;
+        *checksum = sum;
+    }
+    return best;
+}
+
+static int report(const char *label, const sav_lpm4_t *lpm, const uint32_t *addrs,
+                  uint32_t n, uint32_t *leaves)
+{
+    uint64_t single_sum, batch_sum;
+    double single = time_lookups(lpm, addrs, n, leaves, 0, &single_sum);
+    double batch = time_lookups(lpm, addrs, n, leaves, 1, &batch_sum);
+
+    printf("%-10s lookup   %7.1f Mlookups/sec (%.1f ns)\n", label, 1e3 / single, single);
+    printf("%-10s lookup_n %7.1f Mlookups/sec (%.1f ns)\n", "", 1e3 / batch, batch);
+    return single_sum == batch_sum ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t prefixes = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 10) : 1000000;
+    uint32_t lookups = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 10) : 10000000;
+    sav_lpm4_t *lpm = sav_lpm4_new();
+    sav_lpm_stats_t stats;
+    GError *err = NULL;
+
+    uint32_t *added = g_new(uint32_t, prefixes);
+    uint8_t *added_len = g_new(uint8_t, prefixes);
+    for (uint32_t i = 0; i < prefixes; i++) {
+        added[i] = rnd32();
+        added_len[i] = pick_len();
+        sav_lpm4_add(lpm, added[i], added_len[i], 1 + rnd32() % 256,
+                     SAV_RULE_TYPE_ALLOWLIST, SAV_POLICY_ACTION_PERMIT);
+        if (i % 10 == 0) {
+            sav_lpm4_add(lpm, added[i], added_len[i], 1 + rnd32() % 256,
+                         SAV_RULE_TYPE_BLOCKLIST, SAV_POLICY_ACTION_DISCARD);
+        }
+    }
+
+    uint64_t start = bench_now_ns();
+    if (!sav_lpm4_build(lpm, &err)) {
+        fprintf(stderr, "ERROR: %s\n", err ? err->message : "unknown");
+        return 1;
+    }
+    uint64_t build_ns = bench_now_ns() - start;
+
+    sav_lpm4_get_stats(lpm, &stats);
+    printf("IPv4 DIR-24-8: %u prefixes added, %lu distinct, %lu leaves, %lu tbl8 groups\n",
+           prefixes, (unsigned long)stats.prefixes, (unsigned long)stats.leaves,
+           (unsigned long)stats.groups);
+    printf("build      %10.1f ms\n", build_ns / 1e6);
+    printf("memory     %10.1f MB (%.1f bytes/prefix)\n", stats.memory_bytes / 1e6,
+           stats.prefixes ? (double)stats.memory_bytes / stats.prefixes : 0.0);
+
+    uint32_t *addrs = g_new(uint32_t, lookups);
+    uint32_t *leaves = g_new(uint32_t, lookups);
+    int rc = 0;
+
+    for (uint32_t i = 0; i < lookups; i++) addrs[i] = rnd32();
+    rc |= report("random", lpm, addrs, lookups, leaves);
+
+    for (uint32_t i = 0; i < lookups; i++) {
+        uint32_t k = rnd32() % prefixes;
+        uint32_t mask = 0xFFFFFFFFu << (32 - added_len[k]);
+        addrs[i] = (added[k] & mask) | (rnd32() & ~mask);
+    }
+    rc |= report("in-prefix", lpm, addrs, lookups, leaves);
+
+    g_free(addrs);
+    g_free(leaves);
+    g_free(added);
+    g_free(added_len);
+    sav_lpm4_free(lpm);
+    if (rc) fprintf(stderr, "ERROR: lookup_n and lookup disagree\n");
+    return rc;
+}
@@ -0,0 +1,161 @@
+/**
+ * @file bench_lpm6.c
+ * @brief IPv6 poptrie: build time, lookup rate and bytes per prefix
+ *
+ * Usage: bench_lpm6 [prefixes ...]
+ *
+ * For each table size (default 100000 and 1000000) adds synthetic
+ * prefixes shaped like a global IPv6 table: clustered under 8192 random
+ * /24 allocations in 2000::/4, with mostly /48s, then /32-/47, /56, /64
+ * and a few shorter ones. Reports build time, memory and bytes per
+ * prefix, then Mlookups/sec for sav_lpm6_lookup() one at a time and for
+ * sav_lpm6_lookup_n(), over addresses inside the added prefixes and over
+ * uniformly random addresses in 2000::/4.
+ */
+
+#define _GNU_SOURCE
+#include "bench_common.h"
+#include "sav_lpm.h"
+
+#define ALLOCATIONS 8192
+#define LOOKUPS     4000000
+#define ROUNDS      3
+
+static uint64_t rng = 0x2545F4914F6CDD1DULL;
+
+static uint64_t rnd64(void)
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return rng;
+}
+
+static uint8_t pick_len(void)
+{
+    uint32_t r = (uint32_t)(rnd64() % 100);
+    if (r < 50) return 48;
+    if (r < 75) return (uint8_t)(32 + rnd64() % 16);
+    if (r < 83) return 56;
+    if (r < 93) return 64;
+    return (uint8_t)(24 + rnd64() % 8);
+}
+
+static void put_be64(uint8_t *p, uint64_t v)
+{
+    for (int i = 7; i >= 0; i--, v >>= 8) p[i] = (uint8_t)v;
+}
+
+static double time_lookups(const sav_lpm6_t *lpm, const uint8_t *addrs, uint32_t n,
+                           uint32_t *leaves, int batched, uint64_t *checksum)
+{
+    double best = 0;
+
+    for (int round = 0; round < ROUNDS; round++) {
+        uint64_t sum = 0;
+        uint64_t start = bench_now_ns();
+        if (batched) {
+            sav_lpm6_lookup_n(lpm, addrs, n, leaves);
+        } else {
+            for (uint32_t i = 0; i < n; i++) leaves[i] = sav_lpm6_lookup(lpm, addrs + (size_t)i * 16);
+        }
+        for (uint32_t i = 0; i < n; i++) sum += sav_lpm6_leaf(lpm, leaves[i])->n_allow;
+        double ns = (double)(bench_now_ns() - start) / n;
+        if (round == 0 || ns < best) best = ns;
+        *checksum = sum;
+    }
+    return best;
+}
+
+static int report(const char *label, const sav_lpm6_t *lpm, const uint8_t *addrs,
+                  uint32_t n, uint32_t *leaves)
+{
+    uint64_t single_sum, batch_sum;
+    double single = time_lookups(lpm, addrs, n, leaves, 0, &single_sum);
+    double batch = time_lookups(lpm, addrs, n, leaves, 1, &batch_sum);
+
+    printf("%-10s lookup   %7.1f Mlookups/sec (%.1f ns)\n", label, 1e3 / single, single);
+    printf("%-10s lookup_n %7.1f Mlookups/sec (%.1f ns)\n", "", 1e3 / batch, batch);
+    return single_sum == batch_sum ? 0 : 1;
+}
+
+static int bench_size(uint32_t prefixes, const uint64_t *alloc)
+{
+    sav_lpm6_t *lpm = sav_lpm6_new();
+    sav_lpm_stats_t stats;
+    GError *err = NULL;
+    uint64_t *added = g_new(uint64_t, prefixes);
+    uint8_t *added_len = g_new(uint8_t, prefixes);
+    uint8_t p[16];
+
+    memset(p, 0, sizeof(p));
+    for (uint32_t i = 0; i < prefixes; i++) {
+        /* Allocation's top 24 bits, random below; only the top 64 bits matter */
+        added[i] = alloc[rnd64() % ALLOCATIONS] | (rnd64() >> 24);
+        added_len[i] = pick_len();
+        put_be64(p, added[i]);
+        sav_lpm6_add(lpm, p, added_len[i], 1 + (uint32_t)(rnd64() % 256),
+                     SAV_RULE_TYPE_ALLOWLIST, SAV_POLICY_ACTION_PERMIT);
+    }
+
+    uint64_t start = bench_now_ns();
+    if (!sav_lpm6_build(lpm, &err)) {
+        fprintf(stderr, "ERROR: %s\n", err ? err->message : "unknown");
+        return 1;
+    }
+    uint64_t build_ns = bench_now_ns() - start;
+
+    sav_lpm6_get_stats(lpm, &stats);
+    printf("\nIPv6 poptrie: %u prefixes added, %lu distinct, %lu leaves, %lu nodes\n",
+           prefixes, (unsigned long)stats.prefixes, (unsigned long)stats.leaves,
+           (unsigned long)stats.groups);
+    printf("build      %10.1f ms\n", build_ns / 1e6);
+    printf("memory     %10.1f MB (%.1f bytes/prefix)\n", stats.memory_bytes / 1e6,
+           stats.prefixes ? (double)stats.memory_bytes / stats.prefixes : 0.0);
+
+    uint8_t *addrs = g_new(uint8_t, (size_t)LOOKUPS * 16);
+    uint32_t *leaves = g_new(uint32_t, LOOKUPS);
+    int rc = 0;
+
+    for (uint32_t i = 0; i < LOOKUPS; i++) {
+        uint32_t k = (uint32_t)(rnd64() % prefixes);
+        uint64_t mask = ~0ULL << (64 - added_len[k]);
+        put_be64(addrs + (size_t)i * 16, (added[k] & mask) | (rnd64() & ~mask));
+        put_be64(addrs + (size_t)i * 16 + 8, rnd64());
+    }
+    rc |= report("in-prefix", lpm, addrs, LOOKUPS, leaves);
+
+    for (uint32_t i = 0; i < LOOKUPS; i++) {
+        put_be64(addrs + (size_t)i * 16, 0x2000000000000000ULL | (rnd64() >> 4));
+        put_be64(addrs + (size_t)i * 16 + 8, rnd64());
+    }
+    rc |= report("random", lpm, addrs, LOOKUPS, leaves);
+
+    g_free(addrs);
+    g_free(leaves);
+    g_free(added);
+    g_free(added_len);
+    sav_lpm6_free(lpm);
+    return rc;
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t alloc[ALLOCATIONS];
+    int rc = 0;
+
+    for (int i = 0; i < ALLOCATIONS; i++) {
+        alloc[i] = (0x2000000000000000ULL | (rnd64() >> 4)) & 0xFFFFFF0000000000ULL;
+    }
+
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++) {
+            rc |= bench_size((uint32_t)strtoul(argv[i], NULL, 10), alloc);
+        }
+    } else {
+        rc |= bench_size(100000, alloc);
+        rc |= bench_size(1000000, alloc);
+    }
+    if (rc) fprintf(stderr, "ERROR: lookup_n and lookup disagree\n");
+    return rc;
+}
@@ -0,0 +1,121 @@
+/**
+ * @file bench_record_view.c
+ * @brief Compare the owning and zero-copy collector read paths
+ *
+ * Usage: bench_record_view [records] [mappings_per_record]
+ *
+ * Writes a synthetic SAV IPFIX file, then reads it back once with
+ * sav_read_record() (owning copy) and once with sav_read_record_view()
+ * (borrowed view). Reports heap allocations per record and records/sec.
+ */
+
+#define _GNU_SOURCE
+#define BENCH_COUNT_ALLOCS
+#include "bench_common.h"
+#include "sav_collector.h"
+
+#define BENCH_FILE "bench_record_view.ipfix"
+
+typedef struct {
+    uint64_t records;
+    uint64_t mappings;
+    uint64_t allocs;
+    uint64_t elapsed_ns;
+    uint64_t checksum;
+} bench_result_t;
+
+static gboolean run_owning(const char *path, bench_result_t *res, GError **err)
+{
+    sav_collector_ctx_t *ctx = sav_create_file_collector(path, err);
+    if (!ctx) return FALSE;
+
+    sav_parsed_record_t record;
+    uint64_t allocs_start = bench_alloc_count;
+    uint64_t start = bench_now_ns();
+
+    while (sav_read_record(ctx, &record, err)) {
+        res->records++;
+        res->mappings += record.mapping_count;
+        for (uint32_t i = 0; i < record.mapping_count; i++) {
+            res->checksum += record.mappings.ipv4_mappings[i].sourceIPv4PrefixLength;
+        }
+        sav_free_parsed_record(&record);
+    }
+
+    res->elapsed_ns = bench_now_ns() - start;
+    res->allocs = bench_alloc_count - allocs_start;
+    sav_collector_ctx_destroy(ctx);
+    return (err == NULL || *err == NULL);
+}
+
+static gboolean run_view(const char *path, bench_result_t *res, GError **err)
+{
+    sav_collector_ctx_t *ctx = sav_create_file_collector(path, err);
+    if (!ctx) return FALSE;
+
+    sav_record_view_t view;
+    sav_ipv4_mapping_t m;
+    uint64_t allocs_start = bench_alloc_count;
+    uint64_t start = bench_now_ns();
+
+    while (sav_read_record_view(ctx, &view, err)) {
+        res->records++;
+        res->mappings += view.mapping_count;
+        for (uint32_t i = 0; i < view.mapping_count; i++) {
+            if (sav_record_view_get_ipv4(&view, i, &m)) {
+                res->checksum += m.sourceIPv4PrefixLength;
+            }
+        }
+    }
+
+    res->elapsed_ns = bench_now_ns() - start;
+    res->allocs = bench_alloc_count - allocs_start;
+    sav_collector_ctx_destroy(ctx);
+    return (err == NULL || *err == NULL);
+}
+
+static void print_result(const char *name, const bench_result_t *res)
+{
+    double secs = res->elapsed_ns / 1e9;
+    printf("%-10s records=%-9lu mappings=%-10lu allocs/record=%6.2f "
+           "records/sec=%12.0f mappings/sec=%12.0f\n",
+           name, (unsigned long)res->records, (unsigned long)res->mappings,
+           res->records ? (double)res->allocs / res->records : 0.0,
+           secs > 0 ? res->records / secs : 0.0,
+           secs > 0 ? res->mappings / secs : 0.0);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t records = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 10) : 200000;
+    uint32_t per_record = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 10) : 16;
+    GError *err = NULL;
+
+    printf("Generating %u records x %u mappings -> %s\n", records, per_record, BENCH_FILE);
+    if (!bench_write_sample_file(BENCH_FILE, records, per_record, &err)) {
+        fprintf(stderr, "ERROR: %s\n", err ? err->message : "unknown");
+        return 1;
+    }
+
+    bench_result_t owning, view;
+    memset(&owning, 0, sizeof(owning));
+    memset(&view, 0, sizeof(view));
+
+    if (!run_owning(BENCH_FILE, &owning, &err) || !run_view(BENCH_FILE, &view, &err)) {
+        fprintf(stderr, "ERROR: %s\n", err ? err->message : "unknown");
+        return 1;
+    }
+
+    print_result("owning", &owning);
+    print_result("view", &view);
+
+    if (owning.records != view.records || owning.checksum != view.checksum) {
+        fprintf(stderr, "ERROR: paths disagree (records %lu/%lu, checksum %lu/%lu)\n",
+                (unsigned long)owning.records, (unsigned long)view.records,
+                (unsigned long)owning.checksum, (unsigned long)view.checksum);
+        return 1;
+    }
+
+    remove(BENCH_FILE);
+    return 0;
+}
@@ -0,0 +1,172 @@
+/**
+ * @file bench_snapshot.c
+ * @brief Restart from a snapshot file against replaying IPFIX
+ *
+ * Usage: bench_snapshot [records] [mappings_per_record] [ipfix_file]
+ *
+ * Replays an IPFIX file (a generated one unless ipfix_file is given) into
+ * a sav_state_t, which is what a restart costs without a snapshot, then
+ * writes the table to a snapshot file. Asks the kernel to drop the file
+ * from the page cache (POSIX_FADV_DONTNEED; dirty or shared pages may
+ * stay) and times sav_snapshot_open() and the first thousand lookups,
+ * then the lookup rate with the file cached and sav_snapshot_load() into
+ * a new table for a collector that continues updating.
+ */
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <unistd.h>
+#include "bench_common.h"
+#include "sav_collector.h"
+#include "sav_snapshot.h"
+
+#define BENCH_FILE     "bench_snapshot.ipfix"
+#define SNAPSHOT_FILE  "bench_snapshot.savs"
+#define BATCH          256
+#define LOOKUPS        1000000
+#define COLD_LOOKUPS   1000
+
+typedef struct {
+    sav_state_entry_t *keys;
+    size_t            count;
+} key_list_t;
+
+static void collect_key(const sav_state_entry_t *entry, void *user)
+{
+    key_list_t *list = user;
+    list->keys[list->count++] = *entry;
+}
+
+/* Apply every record of path; returns elapsed ns including decoding, 0 on error */
+static uint64_t replay(sav_state_t *state, const char *path, GError **err)
+{
+    uint64_t start = bench_now_ns();
+    sav_collector_ctx_t *ctx = sav_create_file_collector(path, err);
+    if (!ctx) return 0;
+
+    sav_parsed_record_t batch[BATCH];
+    sav_arena_t arena;
+    uint32_t n;
+
+    sav_arena_init(&arena, 0);
+    while ((n = sav_read_batch(ctx, batch, BATCH, &arena, err)) > 0) {
+        for (uint32_t i = 0; i < n; i++) {
+            sav_state_apply_record(state, &batch[i], NULL);
+        }
+        sav_arena_reset(&arena);
+    }
+    sav_arena_destroy(&arena);
+    sav_collector_ctx_destroy(ctx);
+
+    if (*err && (*err)->code != FB_ERROR_EOF) return 0;
+    g_clear_error(err);
+    return bench_now_ns() - start;
+}
+
+static void drop_cache(const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd >= 0) {
+        fdatasync(fd);
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+}
+
+static uint64_t lookups(const sav_snapshot_t *snap, const key_list_t *list, uint32_t n,
+                        uint64_t *found)
+{
+    uint64_t start = bench_now_ns();
+    *found = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        *found += sav_snapshot_find(snap, &list->keys[(i * 2654435761u) % list->count]) != NULL;
+    }
+    return bench_now_ns() - start;
+}
+
+static int bench_file(const char *path, GError **err)
+{
+    sav_state_t *state = sav_state_new();
+    sav_state_stats_t stats;
+    uint64_t found;
+
+    uint64_t replay_ns = replay(state, path, err);
+    if (!replay_ns) {
+        sav_state_free(state);
+        return 1;
+    }
+    sav_state_get_stats(state, &stats);
+    uint64_t entries = stats.ipv4_entries + stats.ipv6_entries;
+    printf("replay IPFIX        %10.1f ms (%lu entries)\n", replay_ns / 1e6,
+           (unsigned long)entries);
+
+    uint64_t start = bench_now_ns();
+    if (!sav_snapshot_write(state, SNAPSHOT_FILE, 1, err)) {
+        sav_state_free(state);
+        return 1;
+    }
+    uint64_t write_ns = bench_now_ns() - start;
+
+    key_list_t list;
+    list.keys = g_new(sav_state_entry_t, entries + 1);
+    list.count = 0;
+    sav_state_foreach(state, collect_key, &list);
+    sav_state_free(state);
+
+    drop_cache(SNAPSHOT_FILE);
+    start = bench_now_ns();
+    sav_snapshot_t *snap = sav_snapshot_open(SNAPSHOT_FILE, err);
+    if (!snap) {
+        g_free(list.keys);
+        return 1;
+    }
+    uint64_t open_ns = bench_now_ns() - start;
+    uint64_t cold_ns = lookups(snap, &list, COLD_LOOKUPS, &found);
+    int rc = found == COLD_LOOKUPS ? 0 : 1;
+
+    printf("write snapshot      %10.1f ms (%.1f MB)\n", write_ns / 1e6, snap->len / 1e6);
+    printf("open snapshot       %10.3f ms\n", open_ns / 1e6);
+    printf("first %u lookups  %10.3f ms (uncached)\n", COLD_LOOKUPS, cold_ns / 1e6);
+
+    uint64_t lookup_ns = lookups(snap, &list, LOOKUPS, &found);
+    rc |= found == LOOKUPS ? 0 : 1;
+    printf("lookup              %10.0f lookups/sec (cached)\n", LOOKUPS / (lookup_ns / 1e9));
+
+    sav_state_t *loaded = sav_state_new();
+    start = bench_now_ns();
+    sav_snapshot_load(snap, loaded);
+    uint64_t load_ns = bench_now_ns() - start;
+    printf("load into table     %10.1f ms (%.1fx faster than replay)\n", load_ns / 1e6,
+           (double)replay_ns / load_ns);
+
+    sav_state_free(loaded);
+    sav_snapshot_close(snap);
+    g_free(list.keys);
+    remove(SNAPSHOT_FILE);
+    return rc;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t records = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 10) : 20000;
+    uint32_t per_record = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 10) : 256;
+    const char *path = (argc > 3) ? argv[3] : BENCH_FILE;
+    GError *err = NULL;
+
+    if (argc <= 3) {
+        printf("Generating %u records x %u mappings -> %s\n", records, per_record, BENCH_FILE);
+        if (!bench_write_sample_file(BENCH_FILE, records, per_record, &err)) {
+            fprintf(stderr, "ERROR: %s\n", err ? err->message : "unknown");
+            return 1;
+        }
+    }
+
+    printf("Restarting from %s\n", path);
+    if (bench_file(path, &err) != 0) {
+        fprintf(stderr, "ERROR: %s\n", err ? err->message : "lookups missed entries");
+        return 1;
+    }
+
+    if (argc <= 3) remove(BENCH_FILE);
+    return 0;
+}
@@ -0,0 +1,194 @@
+/**
+ * @file bench_state.c
+ * @brief Live rule table: replay throughput, lookup rate and memory
+ *
+ * Usage: bench_state [records] [mappings_per_record] [ipfix_file]
+ *
+ * Replays an IPFIX file (a generated one unless ipfix_file is given) into
+ * a sav_state_t twice: the first pass inserts every mapping, the second
+ * replaces them all. Then looks every entry up in random order. Reports
+ * mappings/sec for each pass, lookups/sec and memory per million entries.
+ * Finally repeats insert and lookup for one million synthetic IPv6
+ * entries, since the generated file only holds IPv4 lists.
+ */
+
+#define _GNU_SOURCE
+#include "bench_common.h"
+#include "sav_collector.h"
+#include "sav_state.h"
+
+#define BENCH_FILE "bench_state.ipfix"
+#define BATCH      256
+#define V6_ENTRIES 1000000
+
+typedef struct {
+    sav_state_entry_t *entries;
+    size_t            count;
+} entry_list_t;
+
+static void collect_entry(const sav_state_entry_t *entry, void *user)
+{
+    entry_list_t *list = user;
+    list->entries[list->count++] = *entry;
+}
+
+/* Apply every record of path; returns elapsed ns, 0 on error */
+static uint64_t replay(sav_state_t *state, const char *path, uint64_t *mappings, GError **err)
+{
+    sav_collector_ctx_t *ctx = sav_create_file_collector(path, err);
+    if (!ctx) return 0;
+
+    sav_parsed_record_t batch[BATCH];
+    sav_arena_t arena;
+    uint64_t elapsed = 0;
+    uint32_t n;
+
+    *mappings = 0;
+    sav_arena_init(&arena, 0);
+    while ((n = sav_read_batch(ctx, batch, BATCH, &arena, err)) > 0) {
+        uint64_t start = bench_now_ns();
+        for (uint32_t i = 0; i < n; i++) {
+            if (sav_state_apply_record(state, &batch[i], NULL)) {
+                *mappings += batch[i].mapping_count;
+            }
+        }
+        elapsed += bench_now_ns() - start;
+        sav_arena_reset(&arena);
+    }
+    sav_arena_destroy(&arena);
+    sav_collector_ctx_destroy(ctx);
+
+    if (*err && (*err)->code != FB_ERROR_EOF) return 0;
+    g_clear_error(err);
+    return elapsed ? elapsed : 1;
+}
+
+/* Look every entry up in random order; returns elapsed ns */
+static uint64_t lookup_all(const sav_state_t *state, uint64_t *found)
+{
+    sav_state_stats_t stats;
+    entry_list_t list;
+
+    sav_state_get_stats(state, &stats);
+    list.entries = g_new(sav_state_entry_t, stats.ipv4_entries + stats.ipv6_entries + 1);
+    list.count = 0;
+    sav_state_foreach(state, collect_entry, &list);
+
+    srand(42);
+    for (size_t i = list.count; i > 1; i--) {
+        size_t j = ((size_t)rand() * ((size_t)RAND_MAX + 1) + (size_t)rand()) % i;
+        sav_state_entry_t tmp = list.entries[i - 1];
+        list.entries[i - 1] = list.entries[j];
+        list.entries[j] = tmp;
+    }
+
+    uint64_t start = bench_now_ns();
+    *found = 0;
+    for (size_t i = 0; i < list.count; i++) {
+        *found += sav_state_lookup(state, &list.entries[i], NULL);
+    }
+    uint64_t elapsed = bench_now_ns() - start;
+
+    g_free(list.entries);
+    return elapsed;
+}
+
+static void print_memory(const char *label, const sav_state_t *state, uint64_t entries)
+{
+    sav_state_stats_t stats;
+    sav_state_get_stats(state, &stats);
+    printf("%-10s %lu entries, %.1f MB, %.1f bytes/entry, %.1f MB per million mappings\n",
+           label, (unsigned long)entries, stats.memory_bytes / 1e6,
+           entries ? (double)stats.memory_bytes / entries : 0.0,
+           entries ? stats.memory_bytes / 1e6 / (entries / 1e6) : 0.0);
+}
+
+static int bench_file(const char *path, GError **err)
+{
+    sav_state_t *state = sav_state_new();
+    sav_state_stats_t stats;
+    uint64_t mappings, found;
+
+    uint64_t insert_ns = replay(state, path, &mappings, err);
+    if (!insert_ns) goto fail;
+    printf("insert     %10.0f mappings/sec (%lu mappings)\n",
+           mappings / (insert_ns / 1e9), (unsigned long)mappings);
+
+    uint64_t replace_ns = replay(state, path, &mappings, err);
+    if (!replace_ns) goto fail;
+    printf("replace    %10.0f mappings/sec\n", mappings / (replace_ns / 1e9));
+
+    sav_state_get_stats(state, &stats);
+    uint64_t lookup_ns = lookup_all(state, &found);
+    printf("lookup     %10.0f lookups/sec  (%lu of %lu found)\n",
+           found / (lookup_ns / 1e9), (unsigned long)found,
+           (unsigned long)(stats.ipv4_entries + stats.ipv6_entries));
+    print_memory("memory", state, stats.ipv4_entries + stats.ipv6_entries);
+    printf("           %lu inserts, %lu replaces, %lu rejected\n",
+           (unsigned long)stats.inserts, (unsigned long)stats.replaces,
+           (unsigned long)stats.rejected);
+
+    sav_state_free(state);
+    return found == stats.ipv4_entries + stats.ipv6_entries ? 0 : 1;
+fail:
+    sav_state_free(state);
+    return 1;
+}
+
+static int bench_ipv6(void)
+{
+    sav_state_t *state = sav_state_new();
+    sav_state_entry_t e;
+    uint64_t found;
+
+    memset(&e, 0, sizeof(e));
+    e.family = 6;
+    e.prefix_len = 64;
+    e.prefix[0] = 0x20;
+    e.prefix[1] = 0x01;
+
+    uint64_t start = bench_now_ns();
+    for (uint32_t i = 0; i < V6_ENTRIES; i++) {
+        e.interface = 1 + i % 1024;
+        e.prefix[4] = (uint8_t)(i >> 24);
+        e.prefix[5] = (uint8_t)(i >> 16);
+        e.prefix[6] = (uint8_t)(i >> 8);
+        e.prefix[7] = (uint8_t)i;
+        sav_state_upsert(state, &e);
+    }
+    uint64_t insert_ns = bench_now_ns() - start;
+    uint64_t lookup_ns = lookup_all(state, &found);
+
+    printf("\nIPv6 (synthetic /64s)\n");
+    printf("insert     %10.0f entries/sec\n", V6_ENTRIES / (insert_ns / 1e9));
+    printf("lookup     %10.0f lookups/sec\n", found / (lookup_ns / 1e9));
+    print_memory("memory", state, V6_ENTRIES);
+
+    sav_state_free(state);
+    return found == V6_ENTRIES ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t records = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 10) : 20000;
+    uint32_t per_record = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 10) : 256;
+    const char *path = (argc > 3) ? argv[3] : BENCH_FILE;
+    GError *err = NULL;
+
+    if (argc <= 3) {
+        printf("Generating %u records x %u mappings -> %s\n", records, per_record, BENCH_FILE);
+        if (!bench_write_sample_file(BENCH_FILE, records, per_record, &err)) {
+            fprintf(stderr, "ERROR: %s\n", err ? err->message : "unknown");
+            return 1;
+        }
+    }
+
+    printf("Replaying %s\n", path);
+    if (bench_file(path, &err) != 0 || bench_ipv6() != 0) {
+        fprintf(stderr, "ERROR: %s\n", err ? err->message : "lookups missed entries");
+        return 1;
+    }
+
+    if (argc <= 3) remove(BENCH_FILE);
+    return 0;
+}
@@ -0,0 +1,158 @@
+/**
+ * @file bench_udp_loadgen.h
+ * @brief Localhost IPFIX-over-UDP load generator for the collector benchmarks
+ *
+ * A sender pre-encodes a ring of MTU-sized messages with sav_wire_writer
+ * and replays it to 127.0.0.1 with sendmmsg(), rewriting only the sequence
+ * numbers and resending the templates every BENCH_UDP_TEMPLATE_REFRESH
+ * messages. Each sender uses its own socket, i.e. its own source port, so
+ * it appears as a separate exporter. Requires _GNU_SOURCE.
+ */
+
+#ifndef SAV_BENCH_UDP_LOADGEN_H
+#define SAV_BENCH_UDP_LOADGEN_H
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include "bench_common.h"
+#include "sav_fast_decoder.h"
+#include "sav_wire_writer.h"
+
+#define BENCH_UDP_MSG_LEN           1400   /* Fits a 1500-byte Ethernet MTU */
+#define BENCH_UDP_PREBUILT_MSGS     64
+#define BENCH_UDP_TEMPLATE_REFRESH  4096
+
+typedef struct bench_udp_sender {
+    uint16_t  port;                   /* Collector port on 127.0.0.1 */
+    uint32_t  domain_id;              /* Observation domain */
+    uint64_t  messages;               /* Data messages to send */
+    uint64_t  rate;                   /* Messages per second, 0 = unpaced */
+    uint32_t  mappings;               /* IPv4 mappings per record */
+    uint32_t  records_per_msg;        /* Filled in by the sender */
+    uint64_t  sent;                   /* Data messages sent */
+    gint      done;                   /* Set when the sender has finished */
+} bench_udp_sender_t;
+
+/* Largest -m value that still fits one record into a message */
+#define BENCH_UDP_MAX_MAPPINGS ((BENCH_UDP_MSG_LEN - 40) / 9)
+
+/* Sender thread body; data is a bench_udp_sender_t */
+static gpointer bench_udp_sender_main(gpointer data)
+{
+    bench_udp_sender_t *s = data;
+    uint8_t (*bufs)[BENCH_UDP_MSG_LEN] = g_malloc(BENCH_UDP_PREBUILT_MSGS * BENCH_UDP_MSG_LEN);
+    uint8_t tmpl_buf[BENCH_UDP_MSG_LEN];
+    struct iovec iov[BENCH_UDP_PREBUILT_MSGS];
+    struct mmsghdr msgs[BENCH_UDP_PREBUILT_MSGS];
+    size_t lens[BENCH_UDP_PREBUILT_MSGS];
+    sav_wire_writer_t w;
+
+    /* Pre-encode a ring of data messages; only sequence numbers change */
+    sav_ipv4_mapping_t *maps = g_new0(sav_ipv4_mapping_t, s->mappings);
+    sav_parsed_record_t rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.rule_type = SAV_RULE_TYPE_ALLOWLIST;
+    rec.policy_action = SAV_POLICY_ACTION_PERMIT;
+    rec.mapping_count = s->mappings;
+    rec.mappings.ipv4_mappings = maps;
+
+    for (uint32_t i = 0; i < BENCH_UDP_PREBUILT_MSGS; i++) {
+        sav_wire_writer_init(&w, bufs[i], BENCH_UDP_MSG_LEN, s->domain_id);
+        sav_wire_begin_message(&w, (uint32_t)time(NULL));
+        for (uint32_t n = 0; ; n++) {
+            rec.timestamp_ms = 1700000000000ULL + i * 64 + n;
+            rec.target_type = (uint8_t)(n & 1);
+            rec.sub_template_id = rec.target_type ? SAV_TMPL_IPV4_PREFIX_INTERFACE
+                                                  : SAV_TMPL_IPV4_INTERFACE_PREFIX;
+            for (uint32_t m = 0; m < s->mappings; m++) {
+                maps[m].ingressInterface = 1 + (m % 48);
+                maps[m].sourceIPv4Prefix = 0x0A000000u | ((i * 4096 + n * 256 + m) << 8);
+                maps[m].sourceIPv4PrefixLength = 24;
+            }
+            if (!sav_wire_add_record(&w, &rec)) {
+                break;
+            }
+        }
+        s->records_per_msg = w.msg_records;
+        lens[i] = sav_wire_finish_message(&w);
+    }
+    g_free(maps);
+
+    sav_wire_writer_init(&w, tmpl_buf, BENCH_UDP_MSG_LEN, s->domain_id);
+    sav_wire_begin_message(&w, (uint32_t)time(NULL));
+    sav_wire_add_templates(&w);
+    size_t tmpl_len = sav_wire_finish_message(&w);
+
+    struct sockaddr_in sin;
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons(s->port);
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&sin, sizeof(sin)) != 0) {
+        perror("sender socket");
+        g_free(bufs);
+        g_atomic_int_set(&s->done, 1);
+        return NULL;
+    }
+
+    uint32_t seq = 0;
+    uint64_t start = bench_now_ns();
+
+    while (s->sent < s->messages) {
+        if (s->sent % BENCH_UDP_TEMPLATE_REFRESH == 0) {
+            /* Template-only messages carry no records; seq is unchanged */
+            sav_write_be32(tmpl_buf + 8, seq);
+            send(fd, tmpl_buf, tmpl_len, 0);
+        }
+
+        uint32_t batch = BENCH_UDP_PREBUILT_MSGS;
+        if (s->messages - s->sent < batch) {
+            batch = (uint32_t)(s->messages - s->sent);
+        }
+        uint32_t to_refresh = BENCH_UDP_TEMPLATE_REFRESH -
+                              (uint32_t)(s->sent % BENCH_UDP_TEMPLATE_REFRESH);
+        if (to_refresh < batch) {
+            batch = to_refresh;
+        }
+
+        memset(msgs, 0, sizeof(msgs));
+        for (uint32_t i = 0; i < batch; i++) {
+            sav_write_be32(bufs[i] + 8, seq);
+            seq += s->records_per_msg;
+            iov[i].iov_base = bufs[i];
+            iov[i].iov_len = lens[i];
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        uint32_t off = 0;
+        while (off < batch) {
+            int n = sendmmsg(fd, msgs + off, batch - off, 0);
+            if (n <= 0) {
+                perror("sendmmsg");
+                s->messages = s->sent;
+                break;
+            }
+            off += (uint32_t)n;
+        }
+        s->sent += off;
+
+        if (s->rate) {
+            /* Pace to the requested message rate */
+            uint64_t due = start + s->sent * 1000000000ULL / s->rate;
+            uint64_t now = bench_now_ns();
+            if (due > now) {
+                usleep((useconds_t)((due - now) / 1000));
+            }
+        }
+    }
+
+    close(fd);
+    g_free(bufs);
+    g_atomic_int_set(&s->done, 1);
+    return NULL;
+}
+
+#endif /* SAV_BENCH_UDP_LOADGEN_H */
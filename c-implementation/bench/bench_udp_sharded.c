@@ -0,0 +1,125 @@
+/**
+ * @file bench_udp_sharded.c
+ * @brief Throughput scaling of the SO_REUSEPORT sharded UDP collector
+ *
+ * Usage: bench_udp_sharded [-w max_workers] [-s senders] [-n messages_per_sender]
+ *                          [-m mappings_per_record]
+ *
+ * For 1 .. max_workers workers, starts a sav_create_udp_sharded_collector()
+ * on 127.0.0.1 and replays pre-encoded messages from `senders` load
+ * generator threads (bench_udp_loadgen.h), each with its own source port so
+ * the kernel spreads them over the sockets. Reports mappings/sec, speedup
+ * over one worker, and kernel drops. The senders share the machine with the
+ * workers, so run with more cores than max_workers + senders for clean
+ * numbers.
+ */
+
+#define _GNU_SOURCE
+#include "bench_udp_loadgen.h"
+#include "sav_collector.h"
+
+/* Idle time that ends a run once the senders are done */
+#define IDLE_MS 300
+
+/* Per-worker counter on its own cache line */
+typedef struct bench_worker_count {
+    uint64_t  mappings;
+    uint8_t   pad[56];
+} bench_worker_count_t;
+
+static gboolean count_view(const sav_record_view_t *view, uint32_t worker, gpointer user_data)
+{
+    bench_worker_count_t *counts = user_data;
+    counts[worker].mappings += view->mapping_count;
+    return TRUE;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t max_workers = 4;
+    uint32_t sender_count = 8;
+    uint64_t messages = 50000;
+    uint32_t mappings = 64;
+    double base_rate = 0.0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "w:s:n:m:")) != -1) {
+        switch (opt) {
+        case 'w': max_workers = (uint32_t)strtoul(optarg, NULL, 10); break;
+        case 's': sender_count = (uint32_t)strtoul(optarg, NULL, 10); break;
+        case 'n': messages = strtoull(optarg, NULL, 10); break;
+        case 'm': mappings = (uint32_t)strtoul(optarg, NULL, 10); break;
+        default:
+            fprintf(stderr, "Usage: %s [-w max_workers] [-s senders] "
+                            "[-n messages_per_sender] [-m mappings_per_record]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (max_workers == 0 || sender_count == 0 ||
+        mappings == 0 || mappings > BENCH_UDP_MAX_MAPPINGS) {
+        fprintf(stderr, "Invalid arguments (mappings must be 1..%u)\n",
+                BENCH_UDP_MAX_MAPPINGS);
+        return 1;
+    }
+
+    printf("Sharded UDP collector: %u senders x %lu messages, %u mappings/record\n\n",
+           sender_count, (unsigned long)messages, mappings);
+    printf("%8s %14s %9s %12s %10s\n", "workers", "M mappings/s", "speedup",
+           "socket drops", "seq gaps");
+
+    for (uint32_t workers = 1; workers <= max_workers; workers++) {
+        GError *err = NULL;
+        sav_collector_ctx_t *ctx = sav_create_udp_sharded_collector(
+            "127.0.0.1", 0, workers, IDLE_MS, &err);
+        if (!ctx) {
+            fprintf(stderr, "sav_create_udp_sharded_collector: %s\n", err->message);
+            return 1;
+        }
+
+        bench_udp_sender_t *senders = g_new0(bench_udp_sender_t, sender_count);
+        GThread **threads = g_new0(GThread *, sender_count);
+        bench_worker_count_t *counts = g_new0(bench_worker_count_t, workers);
+
+        for (uint32_t i = 0; i < sender_count; i++) {
+            senders[i].port = sav_udp_collector_get_port(ctx);
+            senders[i].domain_id = i + 1;
+            senders[i].messages = messages;
+            senders[i].mappings = mappings;
+            threads[i] = g_thread_new("sav-loadgen", bench_udp_sender_main, &senders[i]);
+        }
+
+        uint64_t start = bench_now_ns();
+        if (!sav_udp_collector_run(ctx, count_view, counts, &err)) {
+            fprintf(stderr, "sav_udp_collector_run: %s\n", err->message);
+            g_clear_error(&err);
+        }
+        /* The run ends IDLE_MS after the last record */
+        double secs = (double)(bench_now_ns() - start) / 1e9 - IDLE_MS / 1000.0;
+
+        for (uint32_t i = 0; i < sender_count; i++) {
+            g_thread_join(threads[i]);
+        }
+
+        uint64_t total = 0;
+        for (uint32_t i = 0; i < workers; i++) {
+            total += counts[i].mappings;
+        }
+        sav_udp_stats_t stats;
+        sav_udp_collector_get_stats(ctx, &stats);
+
+        double rate = secs > 0.0 ? (double)total / secs : 0.0;
+        if (workers == 1) {
+            base_rate = rate;
+        }
+        printf("%8u %14.2f %8.2fx %12lu %10lu\n", workers, rate / 1e6,
+               base_rate > 0.0 ? rate / base_rate : 0.0,
+               (unsigned long)stats.socket_drops, (unsigned long)stats.sequence_gaps);
+
+        g_free(counts);
+        g_free(threads);
+        g_free(senders);
+        sav_collector_ctx_destroy(ctx);
+    }
+
+    return 0;
+}
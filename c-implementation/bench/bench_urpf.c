@@ -0,0 +1,149 @@
+/**
+ * @file bench_urpf.c
+ * @brief uRPF check rate against the number of interfaces
+ *
+ * Usage: bench_urpf [prefixes] [checks]
+ *
+ * Builds the same IPv4 table (default 500000 prefixes, lengths as in
+ * bench_lpm4) over 16 interfaces and over 4096, each without and with
+ * feasible checks enabled. Each prefix is allowlisted on one to three
+ * interfaces; every tenth one is blocklisted on another. Reports leaves,
+ * interfaces and memory, then
+ * Mchecks/sec of sav_lpm4_check_n() in each mode next to the rate of
+ * sav_lpm4_lookup_n() plus reading each leaf, for addresses inside the
+ * prefixes arriving on a random interface. A check costs the same few
+ * reads whatever the interface count; what differs between the two runs
+ * is how many distinct leaves the lookups land on.
+ */
+
+#define _GNU_SOURCE
+#include "bench_common.h"
+#include "sav_lpm.h"
+
+#define ROUNDS 3
+
+static uint64_t rng = 0x9E3779B97F4A7C15ULL;
+
+static uint32_t rnd32(void)
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return (uint32_t)(rng >> 32);
+}
+
+static uint8_t pick_len(void)
+{
+    uint32_t r = rnd32() % 100;
+    if (r < 55) return 24;
+    if (r < 85) return (uint8_t)(16 + rnd32() % 8);
+    if (r < 95) return (uint8_t)(8 + rnd32() % 8);
+    return (uint8_t)(25 + rnd32() % 8);
+}
+
+/* Best of ROUNDS: ns per address; mode < 0 times lookup_n and reading the leaf */
+static double time_checks(const sav_lpm4_t *lpm, const uint32_t *addrs, const uint32_t *ifaces,
+                          uint32_t n, int mode, uint8_t *valid, uint32_t *leaves,
+                          uint64_t *n_valid)
+{
+    double best = 0;
+
+    for (int round = 0; round < ROUNDS; round++) {
+        uint64_t sum = 0;
+        uint64_t start = bench_now_ns();
+        if (mode < 0) {
+            sav_lpm4_lookup_n(lpm, addrs, n, leaves);
+            for (uint32_t i = 0; i < n; i++) sum += sav_lpm4_leaf(lpm, leaves[i])->n_allow != 0;
+        } else {
+            sav_lpm4_check_n(lpm, addrs, ifaces, n, (sav_urpf_mode_t)mode, valid);
+            for (uint32_t i = 0; i < n; i++) sum += valid[i];
+        }
+        double ns = (double)(bench_now_ns() - start) / n;
+        if (round == 0 || ns < best) best = ns;
+        *n_valid = sum;
+    }
+    return best;
+}
+
+static void bench_ifaces(uint32_t prefixes, uint32_t checks, uint32_t n_ifaces, gboolean feasible)
+{
+    static const char *names[] = { "strict", "feasible", "loose" };
+    sav_lpm4_t *lpm = sav_lpm4_new();
+    sav_lpm_stats_t stats;
+    GError *err = NULL;
+    uint32_t *added = g_new(uint32_t, prefixes);
+    uint8_t *added_len = g_new(uint8_t, prefixes);
+
+    sav_lpm4_set_feasible(lpm, feasible);
+    rng = 0x9E3779B97F4A7C15ULL;
+    for (uint32_t i = 0; i < prefixes; i++) {
+        added[i] = rnd32();
+        added_len[i] = pick_len();
+        uint32_t copies = 1 + rnd32() % 3;
+        for (uint32_t k = 0; k < copies; k++) {
+            sav_lpm4_add(lpm, added[i], added_len[i], 1 + rnd32() % n_ifaces,
+                         SAV_RULE_TYPE_ALLOWLIST, SAV_POLICY_ACTION_PERMIT);
+        }
+        if (i % 10 == 0) {
+            sav_lpm4_add(lpm, added[i], added_len[i], 1 + rnd32() % n_ifaces,
+                         SAV_RULE_TYPE_BLOCKLIST, SAV_POLICY_ACTION_DISCARD);
+        }
+    }
+
+    uint64_t start = bench_now_ns();
+    if (!sav_lpm4_build(lpm, &err)) {
+        fprintf(stderr, "ERROR: %s\n", err ? err->message : "unknown");
+        exit(1);
+    }
+    uint64_t build_ns = bench_now_ns() - start;
+
+    sav_lpm4_get_stats(lpm, &stats);
+    printf("\n%u interfaces, feasible %s: %lu prefixes, %lu leaves, %lu interfaces seen\n",
+           n_ifaces, feasible ? "on" : "off", (unsigned long)stats.prefixes,
+           (unsigned long)stats.leaves,
+           (unsigned long)stats.interfaces);
+    printf("build      %10.1f ms\n", build_ns / 1e6);
+    printf("memory     %10.1f MB\n", stats.memory_bytes / 1e6);
+
+    uint32_t *addrs = g_new(uint32_t, checks);
+    uint32_t *ifaces = g_new(uint32_t, checks);
+    uint32_t *leaves = g_new(uint32_t, checks);
+    uint8_t *valid = g_new(uint8_t, checks);
+    for (uint32_t i = 0; i < checks; i++) {
+        uint32_t k = rnd32() % prefixes;
+        uint32_t host = added_len[k] ? 0xFFFFFFFFu >> added_len[k] : 0xFFFFFFFFu;
+        addrs[i] = (added[k] & ~host) | (rnd32() & host);
+        ifaces[i] = 1 + rnd32() % n_ifaces;
+    }
+
+    uint64_t n_valid;
+    double ns = time_checks(lpm, addrs, ifaces, checks, -1, valid, leaves, &n_valid);
+    printf("%-10s %7.1f Mlookups/sec (%.1f ns)\n", "lookup_n", 1e3 / ns, ns);
+    for (int mode = SAV_URPF_STRICT; mode <= SAV_URPF_LOOSE; mode++) {
+        if ((mode == SAV_URPF_FEASIBLE) != feasible) continue;
+        ns = time_checks(lpm, addrs, ifaces, checks, mode, valid, leaves, &n_valid);
+        printf("%-10s %7.1f Mchecks/sec (%.1f ns), %.1f%% valid\n", names[mode], 1e3 / ns, ns,
+               100.0 * n_valid / checks);
+    }
+
+    g_free(addrs);
+    g_free(ifaces);
+    g_free(leaves);
+    g_free(valid);
+    g_free(added);
+    g_free(added_len);
+    sav_lpm4_free(lpm);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t prefixes = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 10) : 500000;
+    uint32_t checks = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 10) : 10000000;
+
+    printf("uRPF checks: %u prefixes, %u checks\n", prefixes, checks);
+    bench_ifaces(prefixes, checks, 16, FALSE);
+    bench_ifaces(prefixes, checks, 16, TRUE);
+    bench_ifaces(prefixes, checks, 4096, FALSE);
+    bench_ifaces(prefixes, checks, 4096, TRUE);
+    return 0;
+}
@@ -0,0 +1,185 @@
+/**
+ * @file bench_validate.c
+ * @brief Batch mapping validation: kernel throughput and cost versus decode
+ *
+ * Usage: bench_validate [mappings] [records] [mappings_per_record]
+ *
+ * 1. Validates in-memory arrays of IPv4 and IPv6 mappings with every
+ *    kernel the CPU supports and with the per-record sav_validate_record()
+ *    loop (length checks only, stops at the first error). Reports ns per
+ *    mapping.
+ * 2. Writes a synthetic SAV IPFIX file and reads it back with
+ *    sav_read_batch(), validating every record as sav_dump -v does.
+ *    Reports decode and validation time separately and validation as a
+ *    share of decode.
+ */
+
+#define _GNU_SOURCE
+#include "bench_common.h"
+#include "sav_collector.h"
+#include "sav_validate.h"
+
+#define BENCH_FILE "bench_validate.ipfix"
+#define BATCH      256
+#define REPEAT     20
+
+static uint32_t rng_state = 0x2545F491u;
+static uint32_t rnd(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+/* Valid random prefixes: lengths 8-32 / 16-128 with host bits cleared */
+static void build(sav_ipv4_mapping_t *v4, sav_ipv6_mapping_t *v6, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++) {
+        uint8_t len4 = (uint8_t)(8 + rnd() % 25);
+        uint8_t len6 = (uint8_t)(16 + rnd() % 113);
+
+        v4[i].ingressInterface = 1 + i % 48;
+        v4[i].sourceIPv4Prefix = rnd() & (uint32_t)~(0xFFFFFFFFULL >> len4);
+        v4[i].sourceIPv4PrefixLength = len4;
+
+        memset(&v6[i], 0, sizeof(v6[i]));
+        v6[i].ingressInterface = 1 + i % 48;
+        for (uint32_t b = 0; b < len6; b += 8) {
+            uint8_t byte = (uint8_t)rnd();
+            v6[i].sourceIPv6Prefix[b / 8] = (len6 - b >= 8) ? byte
+                : (uint8_t)(byte & (0xFF00 >> (len6 - b)));
+        }
+        v6[i].sourceIPv6PrefixLength = len6;
+    }
+}
+
+static double per_mapping_ns(uint64_t elapsed, uint32_t n)
+{
+    return n ? (double)elapsed / ((double)n * REPEAT) : 0.0;
+}
+
+static int bench_kernels(uint32_t n)
+{
+    sav_ipv4_mapping_t *v4 = g_new(sav_ipv4_mapping_t, n);
+    sav_ipv6_mapping_t *v6 = g_new(sav_ipv6_mapping_t, n);
+    uint64_t *bad = g_new(uint64_t, SAV_VALIDATE_BITMAP_WORDS(n) + 1);
+    sav_validate_impl_t best = sav_validate_get_impl();
+    int rc = 0;
+
+    build(v4, v6, n);
+    printf("Kernels: %u mappings x %d passes\n", n, REPEAT);
+    printf("%-22s %12s %12s\n", "", "IPv4 ns/map", "IPv6 ns/map");
+
+    /* The first-error loop behind sav_validate_record() */
+    sav_parsed_record_t rec4, rec6;
+    memset(&rec4, 0, sizeof(rec4));
+    rec4.sub_template_id = SAV_TMPL_IPV4_INTERFACE_PREFIX;
+    rec4.mapping_count = n;
+    rec4.mappings.ipv4_mappings = v4;
+    rec6 = rec4;
+    rec6.sub_template_id = SAV_TMPL_IPV6_INTERFACE_PREFIX;
+    rec6.mappings.ipv6_mappings = v6;
+
+    uint64_t t0 = bench_now_ns();
+    for (int r = 0; r < REPEAT; r++) rc |= !sav_validate_record(&rec4, NULL);
+    uint64_t t1 = bench_now_ns();
+    for (int r = 0; r < REPEAT; r++) rc |= !sav_validate_record(&rec6, NULL);
+    uint64_t t2 = bench_now_ns();
+    printf("%-22s %12.3f %12.3f\n", "sav_validate_record",
+           per_mapping_ns(t1 - t0, n), per_mapping_ns(t2 - t1, n));
+
+    for (int impl = SAV_VALIDATE_IMPL_SCALAR; impl <= SAV_VALIDATE_IMPL_AVX2; impl++) {
+        if (!sav_validate_set_impl((sav_validate_impl_t)impl)) continue;
+
+        uint32_t n_bad = 0;
+        t0 = bench_now_ns();
+        for (int r = 0; r < REPEAT; r++) n_bad += sav_validate_ipv4_mappings(v4, n, bad);
+        t1 = bench_now_ns();
+        for (int r = 0; r < REPEAT; r++) n_bad += sav_validate_ipv6_mappings(v6, n, bad);
+        t2 = bench_now_ns();
+        printf("batch %-16s %12.3f %12.3f\n", sav_validate_impl_name((sav_validate_impl_t)impl),
+               per_mapping_ns(t1 - t0, n), per_mapping_ns(t2 - t1, n));
+        rc |= (n_bad != 0);
+    }
+    sav_validate_set_impl(best);
+
+    if (rc) fprintf(stderr, "ERROR: valid mappings were rejected\n");
+    g_free(v4);
+    g_free(v6);
+    g_free(bad);
+    return rc;
+}
+
+static int bench_decode(const char *path, GError **err)
+{
+    sav_collector_ctx_t *ctx = sav_create_file_collector(path, err);
+    if (!ctx) return 1;
+
+    sav_parsed_record_t batch[BATCH];
+    sav_arena_t arena;
+    uint64_t *bad = NULL;
+    size_t bad_words = 0;
+    uint64_t decode_ns = 0, validate_ns = 0, records = 0, mappings = 0, n_bad = 0;
+    uint32_t n;
+
+    sav_arena_init(&arena, 0);
+    for (;;) {
+        uint64_t t0 = bench_now_ns();
+        n = sav_read_batch(ctx, batch, BATCH, &arena, err);
+        uint64_t t1 = bench_now_ns();
+        decode_ns += t1 - t0;
+        if (n == 0) break;
+
+        for (uint32_t i = 0; i < n; i++) {
+            size_t words = SAV_VALIDATE_BITMAP_WORDS(batch[i].mapping_count);
+            if (words > bad_words || bad == NULL) {
+                bad_words = words ? words : 1;
+                bad = g_renew(uint64_t, bad, bad_words);
+            }
+            if (sav_validate_record_header(&batch[i], NULL)) {
+                n_bad += sav_validate_record_mappings(&batch[i], bad);
+            }
+            mappings += batch[i].mapping_count;
+        }
+        validate_ns += bench_now_ns() - t1;
+        records += n;
+        sav_arena_reset(&arena);
+    }
+    sav_arena_destroy(&arena);
+    sav_collector_ctx_destroy(ctx);
+    g_free(bad);
+
+    if (*err && (*err)->code != FB_ERROR_EOF) return 1;
+    g_clear_error(err);
+
+    printf("\nDecode + validate (%s): %lu records, %lu mappings\n",
+           sav_validate_impl_name(sav_validate_get_impl()),
+           (unsigned long)records, (unsigned long)mappings);
+    printf("  decode    %10.1f ms  %8.2f ns/mapping\n", decode_ns / 1e6,
+           mappings ? (double)decode_ns / mappings : 0.0);
+    printf("  validate  %10.1f ms  %8.2f ns/mapping  (%.1f%% of decode)\n", validate_ns / 1e6,
+           mappings ? (double)validate_ns / mappings : 0.0,
+           decode_ns ? 100.0 * validate_ns / decode_ns : 0.0);
+    return n_bad != 0;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t n = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 10) : 1000000;
+    uint32_t records = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 10) : 20000;
+    uint32_t per_record = (argc > 3) ? (uint32_t)strtoul(argv[3], NULL, 10) : 256;
+    GError *err = NULL;
+
+    if (bench_kernels(n) != 0) return 1;
+
+    printf("\nGenerating %u records x %u mappings -> %s\n", records, per_record, BENCH_FILE);
+    if (!bench_write_sample_file(BENCH_FILE, records, per_record, &err) ||
+        bench_decode(BENCH_FILE, &err) != 0) {
+        fprintf(stderr, "ERROR: %s\n", err ? err->message : "invalid mappings in sample file");
+        return 1;
+    }
+
+    remove(BENCH_FILE);
+    return 0;
+}
@@ -0,0 +1,79 @@
+/**
+ * @file sav_arena.h
+ * @brief Bump (arena) allocator for batch record storage
+ * 
+ * An arena hands out memory by advancing a pointer inside large chunks.
+ * Individual allocations are never freed; sav_arena_reset() releases
+ * everything at once while keeping the chunks for reuse, so a steady-state
+ * batch loop performs no heap allocation at all.
+ */
+
+#ifndef SAV_ARENA_H
+#define SAV_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <glib.h>
+
+/* Default chunk size used when 0 is passed to sav_arena_init() */
+#define SAV_ARENA_DEFAULT_CHUNK_SIZE (256 * 1024)
+
+/* Alignment of every pointer returned by sav_arena_alloc() */
+#define SAV_ARENA_ALIGNMENT 16
+
+typedef struct sav_arena_chunk sav_arena_chunk_t;
+
+/**
+ * SAV Arena
+ * 
+ * Caller-owned arena state. Initialise with sav_arena_init() and release
+ * with sav_arena_destroy().
+ */
+typedef struct sav_arena {
+    sav_arena_chunk_t *head;          /* First chunk (kept across resets) */
+    sav_arena_chunk_t *current;       /* Chunk currently being filled */
+    size_t            chunk_size;     /* Size of regular chunks in bytes */
+    size_t            bytes_used;     /* Bytes handed out since last reset */
+    size_t            bytes_reserved; /* Bytes held in chunks */
+} sav_arena_t;
+
+/**
+ * Initialize an arena
+ * 
+ * No memory is allocated until the first sav_arena_alloc() call.
+ * 
+ * @param arena       Arena to initialize
+ * @param chunk_size  Chunk size in bytes (0 = SAV_ARENA_DEFAULT_CHUNK_SIZE)
+ */
+void sav_arena_init(sav_arena_t *arena, size_t chunk_size);
+
+/**
+ * Allocate memory from an arena
+ * 
+ * The returned memory is aligned to SAV_ARENA_ALIGNMENT and is NOT zeroed.
+ * Requests larger than the chunk size get a dedicated chunk.
+ * 
+ * @param arena  Arena
+ * @param size   Number of bytes
+ * 
+ * @return Pointer valid until the next sav_arena_reset()/sav_arena_destroy()
+ */
+void* sav_arena_alloc(sav_arena_t *arena, size_t size);
+
+/**
+ * Release every allocation at once
+ * 
+ * Chunks are kept and reused by subsequent allocations.
+ * 
+ * @param arena  Arena to reset
+ */
+void sav_arena_reset(sav_arena_t *arena);
+
+/**
+ * Free all chunks held by an arena
+ * 
+ * @param arena  Arena to destroy (may be re-initialized afterwards)
+ */
+void sav_arena_destroy(sav_arena_t *arena);
+
+#endif /* SAV_ARENA_H */
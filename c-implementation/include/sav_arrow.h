@@ -0,0 +1,103 @@
+/**
+ * @file sav_arrow.h
+ * @brief Dependency-free Arrow IPC stream writer for SAV mappings
+ *
+ * Writes one row per mapping in the Arrow IPC streaming format (the
+ * ".arrows" format read by pyarrow.ipc.open_stream(), polars.read_ipc_stream()
+ * and friends). The schema is fixed; every column is fixed-width:
+ *
+ *   timestamp          timestamp[ms, tz=UTC]   record observation time
+ *   rule_type          uint8
+ *   target_type        uint8
+ *   policy_action      uint8
+ *   ingress_interface  uint32
+ *   prefix_v4          fixed_size_binary[4]    null for IPv6 rows
+ *   prefix_v6          fixed_size_binary[16]   null for IPv4 rows
+ *   prefix_length      uint8
+ *
+ * Prefixes are in network byte order. Rows are buffered column by column
+ * and written as a record batch every batch_rows rows, so memory stays
+ * bounded (about 40 bytes per buffered row) however large the input is.
+ * The Flatbuffers metadata is encoded by hand; no Arrow or Flatbuffers
+ * library is needed.
+ */
+
+#ifndef SAV_ARROW_H
+#define SAV_ARROW_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <glib.h>
+#include "sav_collector.h"
+
+/* Rows per record batch used when 0 is passed to sav_arrow_writer_new() */
+#define SAV_ARROW_DEFAULT_BATCH_ROWS 65536
+
+typedef struct sav_arrow_writer sav_arrow_writer_t;
+
+/**
+ * Create an Arrow IPC stream writer
+ *
+ * Nothing is written until the first batch or sav_arrow_writer_finish().
+ *
+ * @param output      Destination stream (not closed by the writer)
+ * @param batch_rows  Rows per record batch (0 = SAV_ARROW_DEFAULT_BATCH_ROWS)
+ * @param err         Error structure
+ *
+ * @return New writer, or NULL on error
+ */
+sav_arrow_writer_t* sav_arrow_writer_new(
+    FILE     *output,
+    uint32_t batch_rows,
+    GError   **err);
+
+/**
+ * Append every mapping of a record as a row
+ *
+ * Records without mappings (or with an unknown sub-template) add no rows.
+ *
+ * @param writer  Writer
+ * @param record  Record to append
+ * @param err     Error structure
+ *
+ * @return TRUE on success, FALSE on write error
+ */
+gboolean sav_arrow_write_record(
+    sav_arrow_writer_t        *writer,
+    const sav_parsed_record_t *record,
+    GError                    **err);
+
+/**
+ * Write the last partial batch and the end-of-stream marker
+ *
+ * @param writer  Writer
+ * @param err     Error structure
+ *
+ * @return TRUE on success, FALSE if any write failed
+ */
+gboolean sav_arrow_writer_finish(
+    sav_arrow_writer_t *writer,
+    GError             **err);
+
+/**
+ * Writer statistics
+ *
+ * @param writer   Writer
+ * @param rows     Output: rows written or buffered (may be NULL)
+ * @param batches  Output: record batches written (may be NULL)
+ */
+void sav_arrow_writer_get_stats(
+    const sav_arrow_writer_t *writer,
+    uint64_t                 *rows,
+    uint64_t                 *batches);
+
+/**
+ * Free a writer
+ *
+ * Rows not yet written by sav_arrow_writer_finish() are discarded.
+ *
+ * @param writer  Writer to free (may be NULL)
+ */
+void sav_arrow_writer_free(sav_arrow_writer_t *writer);
+
+#endif /* SAV_ARROW_H */
@@ -13,6 +13,7 @@
 #include <stdbool.h>
 #include <fixbuf/public.h>
 #include "sav_ie_definitions.h"
+#include "sav_arena.h"
 
 /**
  * SAV Parsed Record
@@ -34,6 +35,28 @@ typedef struct sav_parsed_record {
     } mappings;
 } sav_parsed_record_t;
 
+/**
+ * SAV Record View
+ * 
+ * Borrowed (zero-copy) view of a SAV record. The mapping entries are not
+ * copied: `entries` points straight into the SubTemplateList memory decoded
+ * by libfixbuf and stays valid until the next read on the same collector or
+ * until the collector is destroyed. Use sav_record_view_get_ipv4() and
+ * sav_record_view_get_ipv6() to access individual mappings.
+ */
+typedef struct sav_record_view {
+    uint64_t       timestamp_ms;      /* Observation time in milliseconds */
+    uint8_t        rule_type;         /* SAV rule type (allowlist/blocklist) */
+    uint8_t        target_type;       /* SAV target type (interface/prefix based) */
+    uint8_t        policy_action;     /* Policy action */
+    uint16_t       sub_template_id;   /* SubTemplateList template ID used */
+    uint32_t       mapping_count;     /* Number of mappings in the list */
+    const uint8_t  *entries;          /* First list entry (borrowed, may be NULL) */
+    size_t         entry_stride;      /* Distance in bytes between entries */
+    gboolean       wire_order;        /* Entries still in network byte order */
+    gboolean       legacy_order;      /* Integers byte-swapped by a legacy exporter */
+} sav_record_view_t;
+
 /**
  * SAV Collector Context
  * 
@@ -45,8 +68,73 @@ typedef struct sav_collector_ctx {
     fBuf_t          *fbuf;            /* Collection buffer */
     uint64_t        records_read;     /* Statistics: total records */
     uint64_t        parse_errors;     /* Statistics: parse errors */
+    gboolean        legacy_order;     /* See sav_collector_set_legacy_byte_order() */
+    sav_data_record_t view_record;    /* Decoded record backing the current view */
+    gboolean        view_active;      /* view_record holds a live SubTemplateList */
+    
+    /* Native fast path (sav_create_fast_file_collector only) */
+    struct sav_fast_decoder *fast;    /* Native decoder, NULL = libfixbuf only */
+    gboolean        fast_fallback;    /* Current message is being read by libfixbuf */
+    FILE            *fast_fp;         /* Input file (stdio source) */
+    struct sav_mmap_file *map;        /* Input file (mmap source) */
+    uint8_t         *msg_buf;         /* Current IPFIX message */
+    size_t          msg_cap;          /* Capacity of msg_buf */
+    
+    /* Multi-threaded decoding (sav_create_parallel_file_collector only) */
+    struct sav_parallel *par;         /* Worker pool and reorder buffer */
+    
+    /* Network input (sav_create_udp_collector only) */
+    struct sav_udp  *udp;             /* Socket, receive batch and exporter state */
+    
+    /* Stream input (sav_create_stream_collector only) */
+    struct sav_stream *stream;        /* Listener, epoll workers and connections */
 } sav_collector_ctx_t;
 
+/**
+ * SAV UDP Collector Statistics
+ * 
+ * Transport counters of a UDP collector, in addition to records_read and
+ * parse_errors. Sequence numbers are tracked per exporter, i.e. per
+ * (source address, source port, observation domain).
+ */
+typedef struct sav_udp_stats {
+    uint64_t  datagrams;              /* Datagrams received */
+    uint64_t  bytes;                  /* Payload bytes received */
+    uint64_t  socket_drops;           /* Datagrams dropped by the kernel (receive buffer full) */
+    uint64_t  truncated;              /* Datagrams longer than the receive buffer */
+    uint64_t  sequence_gaps;          /* Messages whose sequence number was not the expected one */
+    uint64_t  lost_records;           /* Data records skipped according to sequence numbers */
+    uint64_t  expired_exporters;      /* Exporters dropped after the template lifetime */
+    uint64_t  table_full_drops;       /* Datagrams of new exporters dropped at the table limit */
+    uint32_t  exporters;              /* Distinct exporters seen */
+} sav_udp_stats_t;
+
+/**
+ * SAV Stream Transport
+ * 
+ * Connection-oriented IPFIX transports (RFC 7011, sections 10.2 and 10.4).
+ */
+typedef enum {
+    SAV_TRANSPORT_TCP  = 0,
+    SAV_TRANSPORT_SCTP = 1
+} sav_stream_transport_t;
+
+/**
+ * SAV Stream Collector Statistics
+ * 
+ * Transport counters of a TCP/SCTP collector, in addition to records_read
+ * and parse_errors. Template state is scoped per connection, SCTP stream
+ * and observation domain.
+ */
+typedef struct sav_stream_stats {
+    uint64_t  connections_accepted;   /* Exporter connections accepted */
+    uint64_t  connections_closed;     /* Connections closed by either side */
+    uint64_t  bytes;                  /* Payload bytes received */
+    uint64_t  messages;               /* Complete IPFIX messages reassembled */
+    uint64_t  framing_errors;         /* Connections dropped for a bad or truncated message */
+    uint64_t  template_scopes;        /* (connection, stream, domain) scopes created */
+} sav_stream_stats_t;
+
 /**
  * Create a file-based SAV collector
  * 
@@ -59,6 +147,342 @@ sav_collector_ctx_t* sav_create_file_collector(
     const char *filename,
     GError     **err);
 
+/**
+ * Create a file-based SAV collector with the native fast-path decoder
+ * 
+ * Messages containing only template-400 data records with sub-templates
+ * 901-904 are decoded directly from the wire bytes (see
+ * sav_fast_decoder.h). Any other message, including those carrying
+ * template sets or templates with an unexpected layout, is handed to
+ * libfixbuf. All read functions work unchanged on the returned context.
+ * 
+ * @param filename     Path to IPFIX file to read
+ * @param err          Error structure
+ * 
+ * @return Collector context on success, NULL on error
+ */
+sav_collector_ctx_t* sav_create_fast_file_collector(
+    const char *filename,
+    GError     **err);
+
+/**
+ * Create a memory-mapped SAV file collector
+ * 
+ * Like sav_create_fast_file_collector(), but the file is mmap()ed and
+ * messages are decoded in place instead of being read into a buffer.
+ * madvise(MADV_SEQUENTIAL) is always applied; flags select additional
+ * readahead, huge-page and drop-behind hints (see sav_mmap.h).
+ * 
+ * @param filename     Path to IPFIX file to read
+ * @param flags        Combination of sav_mmap_flags_t
+ * @param err          Error structure
+ * 
+ * @return Collector context on success, NULL on error
+ */
+sav_collector_ctx_t* sav_create_mmap_file_collector(
+    const char *filename,
+    unsigned   flags,
+    GError     **err);
+
+/* Target size of the message-aligned chunks handed to decoder threads */
+#define SAV_PARALLEL_CHUNK_BYTES (1024 * 1024)
+
+/**
+ * Create a multi-threaded SAV file collector
+ * 
+ * The file is mmap()ed and pre-scanned once for template sets. It is then
+ * cut into chunks of whole IPFIX messages which a pool of worker threads
+ * decodes concurrently, each with its own session primed with the
+ * pre-scanned templates. Records are delivered in original file order
+ * through a bounded reorder buffer, so all read functions behave exactly
+ * as on a single-threaded collector.
+ * 
+ * Files that redefine or withdraw a template, carry data sets ahead of
+ * their template, or whose template sets do not fit into one IPFIX
+ * message, cannot be split safely; for those (and when threads <= 1) a
+ * single-threaded mmap collector is returned instead.
+ * 
+ * @param filename     Path to IPFIX file to read
+ * @param threads      Number of decoder threads
+ * @param err          Error structure
+ * 
+ * @return Collector context on success, NULL on error
+ */
+sav_collector_ctx_t* sav_create_parallel_file_collector(
+    const char *filename,
+    uint32_t   threads,
+    GError     **err);
+
+/* Datagrams received per recvmmsg() call */
+#define SAV_UDP_BATCH_SIZE 64
+
+/* Requested socket receive buffer; the kernel may grant less */
+#define SAV_UDP_RCVBUF_BYTES (32 * 1024 * 1024)
+
+/* Default lifetime of the templates of a silent UDP exporter (RFC 7011,
+ * section 8.4); see sav_udp_collector_set_exporter_limits() */
+#define SAV_UDP_TEMPLATE_LIFETIME_SEC 1800
+
+/* Default limit on the exporters tracked per socket */
+#define SAV_UDP_MAX_EXPORTERS 65536
+
+/**
+ * Create a UDP SAV collector
+ * 
+ * Binds a UDP socket and receives IPFIX messages in batches of
+ * SAV_UDP_BATCH_SIZE datagrams with recvmmsg(). Each datagram is decoded
+ * with the same native fast path / libfixbuf fallback as
+ * sav_create_fast_file_collector(), using template state private to the
+ * exporter, identified by source address, source port and observation
+ * domain. All read functions work unchanged on the returned context.
+ * 
+ * Exporter state (templates and sequence number) is dropped once the
+ * exporter has been silent for SAV_UDP_TEMPLATE_LIFETIME_SEC, so later data
+ * needs fresh templates. The sequence number is advanced by the data
+ * records of each message, decodable or not.
+ * 
+ * A malformed datagram makes one read fail with a parse error; the next
+ * read continues with the following datagram. When no datagram arrives
+ * within timeout_ms, the read returns FALSE with FB_ERROR_NLREAD, which is
+ * not counted as a parse error.
+ * 
+ * @param host         Local address to bind, or NULL for any address
+ * @param port         Local UDP port (0 = ephemeral, see sav_udp_collector_get_port())
+ * @param timeout_ms   Receive timeout in milliseconds (0 = wait forever)
+ * @param err          Error structure
+ * 
+ * @return Collector context on success, NULL on error
+ */
+sav_collector_ctx_t* sav_create_udp_collector(
+    const char *host,
+    uint16_t   port,
+    uint32_t   timeout_ms,
+    GError     **err);
+
+/**
+ * Get the local port a UDP collector is bound to
+ * 
+ * @param ctx  UDP collector context
+ * 
+ * @return Port number, 0 if ctx is not a UDP collector
+ */
+uint16_t sav_udp_collector_get_port(sav_collector_ctx_t *ctx);
+
+/* Longest time a sharded worker blocks before it checks for a stop request */
+#define SAV_UDP_STOP_POLL_MS 100
+
+/**
+ * Create a sharded multi-core UDP SAV collector
+ * 
+ * Opens `workers` sockets bound to the same address with SO_REUSEPORT, so
+ * the kernel spreads exporters across them by flow hash; all datagrams of
+ * one exporter reach the same socket. Each socket is a complete UDP
+ * collector with its own receive batch, template cache and statistics,
+ * served by a worker thread pinned to its own CPU while
+ * sav_udp_collector_run() executes. Records are delivered only through
+ * sav_udp_collector_run(); the read functions fail on a sharded collector.
+ * 
+ * sav_collector_get_stats() and sav_udp_collector_get_stats() merge the
+ * per-worker counters without locking and may be called at any time.
+ * 
+ * @param host         Local address to bind, or NULL for any address
+ * @param port         Local UDP port (0 = ephemeral, shared by all workers)
+ * @param workers      Number of sockets and worker threads
+ * @param timeout_ms   Idle time after which sav_udp_collector_run() returns
+ *                     (0 = run until sav_udp_collector_stop())
+ * @param err          Error structure
+ * 
+ * @return Collector context on success, NULL on error
+ */
+sav_collector_ctx_t* sav_create_udp_sharded_collector(
+    const char *host,
+    uint16_t   port,
+    uint32_t   workers,
+    uint32_t   timeout_ms,
+    GError     **err);
+
+/**
+ * Callback receiving records from sav_udp_collector_run() and
+ * sav_stream_collector_run()
+ * 
+ * On a sharded UDP or multi-worker stream collector it is called concurrently
+ * from all workers; the worker index can be used to keep per-worker state
+ * without locking.
+ * 
+ * @param view       Borrowed record view, valid only during the call
+ * @param worker     Index of the worker delivering the record (0-based)
+ * @param user_data  User data passed to the run function
+ * 
+ * @return TRUE to continue, FALSE to stop the collector
+ */
+typedef gboolean (*sav_record_view_func_t)(
+    const sav_record_view_t *view,
+    uint32_t                worker,
+    gpointer                user_data);
+
+/**
+ * Receive records from a UDP collector until stopped
+ * 
+ * A single-socket collector receives on the calling thread; a sharded
+ * collector runs one pinned worker per socket and returns once all have
+ * finished. Parse errors are counted and skipped. The run ends when the
+ * callback returns FALSE, sav_udp_collector_stop() is called, no record
+ * arrived for the collector's timeout, or a socket error occurs.
+ * 
+ * @param ctx        UDP collector context
+ * @param func       Record callback
+ * @param user_data  Passed to func
+ * @param err        Error structure
+ * 
+ * @return TRUE when stopped or idle, FALSE on socket error
+ */
+gboolean sav_udp_collector_run(
+    sav_collector_ctx_t    *ctx,
+    sav_record_view_func_t func,
+    gpointer               user_data,
+    GError                 **err);
+
+/**
+ * Ask a running sav_udp_collector_run() to return
+ * 
+ * Safe to call from any thread, including the callback. Workers notice the
+ * request after their current record, or within SAV_UDP_STOP_POLL_MS on a
+ * sharded collector (a single-socket collector waits up to its timeout).
+ * 
+ * @param ctx  UDP collector context
+ */
+void sav_udp_collector_stop(sav_collector_ctx_t *ctx);
+
+/**
+ * Set the template lifetime and exporter limit of a UDP collector
+ * 
+ * An exporter silent for longer than lifetime_sec is forgotten together
+ * with its templates, as UDP offers no template withdrawal (RFC 7011,
+ * section 8.4). While max_exporters exporters are tracked, datagrams from
+ * new exporters fail with a parse error. Applies to all workers of a
+ * sharded collector; call it before reading or running.
+ * 
+ * @param ctx            UDP collector context
+ * @param lifetime_sec   Template lifetime in seconds (> 0)
+ * @param max_exporters  Exporters tracked per socket (> 0)
+ * @param err            Error structure
+ * 
+ * @return TRUE on success, FALSE on invalid parameters
+ */
+gboolean sav_udp_collector_set_exporter_limits(
+    sav_collector_ctx_t *ctx,
+    uint32_t            lifetime_sec,
+    uint32_t            max_exporters,
+    GError              **err);
+
+/**
+ * Get UDP transport statistics
+ * 
+ * Sums the counters of all workers on a sharded collector.
+ * 
+ * @param ctx    UDP collector context
+ * @param stats  Output: transport counters
+ * 
+ * @return TRUE on success, FALSE if ctx is not a UDP collector
+ */
+gboolean sav_udp_collector_get_stats(
+    sav_collector_ctx_t *ctx,
+    sav_udp_stats_t     *stats);
+
+/* Longest time a stream worker blocks before it checks for a stop request */
+#define SAV_STREAM_STOP_POLL_MS 100
+
+/**
+ * Create a TCP or SCTP SAV collector
+ * 
+ * Listens on one socket and serves any number of exporter connections from
+ * a pool of `workers` threads, each running its own epoll loop over
+ * non-blocking sockets. New connections go to whichever worker accepts
+ * them first and stay with it. Every connection reassembles IPFIX messages
+ * from partial reads (TCP, framed by the message length) or SCTP message
+ * fragments, and decodes them with the native fast path / libfixbuf
+ * fallback, using template state private to the connection, SCTP stream
+ * and observation domain.
+ * 
+ * Records are delivered only through sav_stream_collector_run(); the read
+ * functions fail on a stream collector. A malformed message header closes
+ * its connection; malformed records are counted as parse errors.
+ * 
+ * @param transport    SAV_TRANSPORT_TCP or SAV_TRANSPORT_SCTP (one-to-one
+ *                     style; fails with FB_ERROR_CONN if the kernel has no SCTP)
+ * @param host         Local address to bind, or NULL for any address
+ * @param port         Local port (0 = ephemeral, see sav_stream_collector_get_port())
+ * @param workers      Number of worker threads
+ * @param timeout_ms   Idle time after which sav_stream_collector_run() returns
+ *                     (0 = run until sav_stream_collector_stop())
+ * @param err          Error structure
+ * 
+ * @return Collector context on success, NULL on error
+ */
+sav_collector_ctx_t* sav_create_stream_collector(
+    sav_stream_transport_t transport,
+    const char             *host,
+    uint16_t               port,
+    uint32_t               workers,
+    uint32_t               timeout_ms,
+    GError                 **err);
+
+/**
+ * Get the local port a stream collector listens on
+ * 
+ * @param ctx  Stream collector context
+ * 
+ * @return Port number, 0 if ctx is not a stream collector
+ */
+uint16_t sav_stream_collector_get_port(sav_collector_ctx_t *ctx);
+
+/**
+ * Serve exporter connections until stopped
+ * 
+ * Runs the worker loops (on the calling thread when there is one worker)
+ * and returns once all have finished. The run ends when the callback
+ * returns FALSE, sav_stream_collector_stop() is called, no record arrived
+ * for the collector's timeout, or a listener error occurs. Connections
+ * stay open across runs; records of a message left undelivered when the
+ * callback stops the run are discarded.
+ * 
+ * @param ctx        Stream collector context
+ * @param func       Record callback, called concurrently from all workers
+ * @param user_data  Passed to func
+ * @param err        Error structure
+ * 
+ * @return TRUE when stopped or idle, FALSE on error
+ */
+gboolean sav_stream_collector_run(
+    sav_collector_ctx_t    *ctx,
+    sav_record_view_func_t func,
+    gpointer               user_data,
+    GError                 **err);
+
+/**
+ * Ask a running sav_stream_collector_run() to return
+ * 
+ * Safe to call from any thread, including the callback. Workers notice the
+ * request after their current message, or within SAV_STREAM_STOP_POLL_MS.
+ * 
+ * @param ctx  Stream collector context
+ */
+void sav_stream_collector_stop(sav_collector_ctx_t *ctx);
+
+/**
+ * Get TCP/SCTP transport statistics
+ * 
+ * Sums the counters of all workers; may be called at any time.
+ * 
+ * @param ctx    Stream collector context
+ * @param stats  Output: transport counters
+ * 
+ * @return TRUE on success, FALSE if ctx is not a stream collector
+ */
+gboolean sav_stream_collector_get_stats(
+    sav_collector_ctx_t *ctx,
+    sav_stream_stats_t  *stats);
+
 /**
  * Read next SAV record from collector
  * 
@@ -73,6 +497,82 @@ gboolean sav_read_record(
     sav_parsed_record_t *record,
     GError              **err);
 
+/**
+ * Read next SAV record from collector without copying its mappings
+ * 
+ * Zero-copy variant of sav_read_record(). No per-record heap allocation
+ * or copy is made by this library; the view borrows the list decoded by
+ * libfixbuf. The view is invalidated by the next sav_read_record() or
+ * sav_read_record_view() call on the same collector. Do NOT call
+ * sav_free_parsed_record() on a view.
+ * 
+ * @param ctx          Collector context
+ * @param view         Output: borrowed record view
+ * @param err          Error structure
+ * 
+ * @return TRUE if record was read, FALSE on EOF or error
+ */
+gboolean sav_read_record_view(
+    sav_collector_ctx_t *ctx,
+    sav_record_view_t   *view,
+    GError              **err);
+
+/**
+ * Decode one IPv4 mapping (template 901/903) from a record view
+ * 
+ * @param view     Record view
+ * @param index    Mapping index (0 .. mapping_count-1)
+ * @param mapping  Output: decoded mapping
+ * 
+ * @return TRUE on success, FALSE if index is out of range or the view
+ *         does not carry IPv4 mappings
+ */
+gboolean sav_record_view_get_ipv4(
+    const sav_record_view_t *view,
+    uint32_t                index,
+    sav_ipv4_mapping_t      *mapping);
+
+/**
+ * Decode one IPv6 mapping (template 902/904) from a record view
+ * 
+ * @param view     Record view
+ * @param index    Mapping index (0 .. mapping_count-1)
+ * @param mapping  Output: decoded mapping
+ * 
+ * @return TRUE on success, FALSE if index is out of range or the view
+ *         does not carry IPv6 mappings
+ */
+gboolean sav_record_view_get_ipv6(
+    const sav_record_view_t *view,
+    uint32_t                index,
+    sav_ipv6_mapping_t      *mapping);
+
+/**
+ * Read a batch of SAV records into arena-backed storage
+ * 
+ * Decodes up to max_records records into records[0..n-1]. Mapping arrays
+ * are allocated from the caller-owned arena rather than the heap, so the
+ * whole batch is released with a single sav_arena_reset(). Do NOT call
+ * sav_free_parsed_record() on records returned by this function.
+ * 
+ * Reading stops at EOF or at the first error; records decoded before an
+ * error are still returned and err is set.
+ * 
+ * @param ctx          Collector context
+ * @param records      Output: array of at least max_records entries
+ * @param max_records  Maximum number of records to decode
+ * @param arena        Arena for mapping storage
+ * @param err          Error structure
+ * 
+ * @return Number of records decoded (0 on EOF or immediate error)
+ */
+uint32_t sav_read_batch(
+    sav_collector_ctx_t *ctx,
+    sav_parsed_record_t *records,
+    uint32_t            max_records,
+    sav_arena_t         *arena,
+    GError              **err);
+
 /**
  * Free a parsed record's internal memory
  * 
@@ -89,6 +589,37 @@ void sav_free_parsed_record(sav_parsed_record_t *record);
  */
 void sav_collector_ctx_destroy(sav_collector_ctx_t *ctx);
 
+/**
+ * Close and free a collector context (alias of sav_collector_ctx_destroy())
+ * 
+ * @param ctx  Collector context to free
+ */
+void sav_close_collector(sav_collector_ctx_t *ctx);
+
+/**
+ * Read files written before the host byte order convention
+ * 
+ * Exporters built before mapping fields were settled on host byte order
+ * (see sav_ipv4_mapping_t) stored ingressInterface and sourceIPv4Prefix
+ * byte-swapped in the libfixbuf record, so files they wrote on
+ * little-endian hosts carry those values reversed on the wire and read
+ * back swapped. With legacy set, records returned by sav_read_record(),
+ * sav_read_record_view() and sav_read_batch() have the two fields swapped
+ * back; IPv6 prefixes were never affected. Views delivered to
+ * sav_udp_collector_run() and sav_stream_collector_run() callbacks are
+ * not converted.
+ * 
+ * @param ctx     Collector context
+ * @param legacy  TRUE for files of a legacy exporter, FALSE (default) otherwise
+ * @param err     Error structure
+ * 
+ * @return TRUE on success, FALSE if ctx is NULL
+ */
+gboolean sav_collector_set_legacy_byte_order(
+    sav_collector_ctx_t *ctx,
+    gboolean            legacy,
+    GError              **err);
+
 /**
  * Get collector statistics
  * 
@@ -114,6 +645,9 @@ void sav_print_record(
 /**
  * Export a parsed SAV record to JSON format
  * 
+ * Writes one pretty-printed object. To stream many records, use the
+ * buffered writer in sav_json.h instead.
+ * 
  * @param record  Record to export
  * @param output  File stream for JSON output
  */
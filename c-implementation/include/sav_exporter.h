@@ -14,14 +14,44 @@
 #include <fixbuf/public.h>
 #include "sav_ie_definitions.h"
 
-/* Maximum number of entries in a single SubTemplateList */
+/* Initial SubTemplateList buffer capacity in entries; it doubles when full */
+#define SAV_STL_INITIAL_ENTRIES 64
+
+/* Former per-record entry limit. No longer enforced; kept for source
+ * compatibility as a typical list size. */
 #define SAV_MAX_LIST_ENTRIES 100
 
+/* Number of SAV sub-templates (901-904), cached per record context */
+#define SAV_SUB_TEMPLATE_COUNT 4
+
+/* Default size budget of one template-400 record, counted as if it were
+ * alone in an IPFIX message (the largest message IPFIX allows) */
+#define SAV_DEFAULT_MSG_BUDGET 65535
+
+/* Bytes of a template-400 record and its message besides the list entries:
+ * message header (16) + set header (4) + time, rule, target and policy (11)
+ * + varlen length (3) + STL semantic and template ID (3) */
+#define SAV_RECORD_FIXED_BYTES (16 + 4 + 11 + 3 + 3)
+
+/**
+ * Staging list of one sub-template other than the context's own
+ */
+typedef struct sav_record_lane {
+    uint8_t         *buffer;          /* Entries in the sub-template's layout */
+    size_t          capacity;         /* Buffer capacity in bytes */
+    uint32_t        entry_count;      /* Number of entries */
+} sav_record_lane_t;
+
 /**
  * SAV Record Context
  * 
  * This structure manages the state needed to build a complete SAV IPFIX record.
  * It handles the SubTemplateList buffer and ensures proper memory management.
+ * 
+ * Entries go to the list of the sub-template that matches the add function
+ * (901-904). The sub-template chosen at init/reset uses the fields below
+ * (stl_buffer, entry_count, ...); entries for the other sub-templates, such
+ * as the IPv6 half of a dual-stack table, are staged in lanes[].
  */
 typedef struct sav_record_ctx {
     fbInfoModel_t   *model;           /* Info model with SAV IEs */
@@ -29,10 +59,16 @@ typedef struct sav_record_ctx {
     fbTemplate_t    *main_tmpl;       /* Main template (400) */
     fbTemplate_t    *sub_tmpl;        /* Current sub-template (901-904) */
     uint16_t        sub_tmpl_id;      /* Sub-template ID for convenience */
+    fbTemplate_t    *sub_tmpls[SAV_SUB_TEMPLATE_COUNT]; /* Internal templates 901-904 (NULL if not registered) */
     uint8_t         *stl_buffer;      /* Buffer for SubTemplateList entries */
     size_t          stl_capacity;     /* Buffer capacity in bytes */
     size_t          entry_size;       /* Size of one entry in current sub-template */
     uint32_t        entry_count;      /* Number of entries in list */
+    size_t          msg_budget;       /* Size limit of each exported record (see sav_record_ctx_set_msg_budget) */
+    uint32_t        records_exported; /* Records written by the last sav_export_record() */
+    uint16_t        list_tmpl_id;     /* Sub-template record.savMatchedContentList is set up for, 0 if none */
+    sav_data_record_t record;         /* Template-400 record reused by every export */
+    sav_record_lane_t lanes[SAV_SUB_TEMPLATE_COUNT]; /* Other sub-templates' entries, by ID - 901 */
 } sav_record_ctx_t;
 
 /**
@@ -55,6 +91,75 @@ gboolean sav_record_ctx_init(
     uint8_t          target_type,
     GError           **err);
 
+/**
+ * Start a new record on an initialized context
+ * 
+ * Empties all lists and selects the sub-template for rule_type and
+ * target_type from the templates cached by sav_record_ctx_init(). The
+ * list buffers, exported list and record budget are kept, so a long-lived
+ * context produces any number of records without allocating or looking up
+ * templates; use it instead of a cleanup/init pair per record.
+ * 
+ * @param ctx          Initialized record context
+ * @param rule_type    SAV rule type (allowlist=1, blocklist=2)
+ * @param target_type  SAV target type (interface-prefix=1, prefix-interface=2)
+ * @param err          Error structure
+ * 
+ * @return TRUE on success, FALSE on invalid types or an uninitialized ctx
+ */
+gboolean sav_record_ctx_reset(
+    sav_record_ctx_t *ctx,
+    uint8_t          rule_type,
+    uint8_t          target_type,
+    GError           **err);
+
+/**
+ * Set the size budget for exported records
+ * 
+ * sav_export_record() splits a list into as many template-400 records as
+ * needed for each record, counted together with the message and set
+ * headers (SAV_RECORD_FIXED_BYTES), to stay within msg_budget bytes.
+ * 
+ * This is a per-record limit, not a message limit: libfixbuf still packs
+ * consecutive records into one message, up to the exporter's own maximum
+ * message size. A budget such as the path MTU minus IP and UDP headers
+ * guarantees that every record fits into a datagram on its own; whether
+ * messages do depends on the MTU the exporter was created with.
+ * 
+ * @param ctx         Initialized record context
+ * @param msg_budget  Record size limit in bytes (large enough for one IPv6
+ *                    entry, at most SAV_DEFAULT_MSG_BUDGET)
+ * @param err         Error structure
+ * 
+ * @return TRUE on success, FALSE if the budget is out of range
+ */
+gboolean sav_record_ctx_set_msg_budget(
+    sav_record_ctx_t *ctx,
+    size_t           msg_budget,
+    GError           **err);
+
+/**
+ * Former switch for exporting entries in place
+ * 
+ * Every export now reuses the context's SubTemplateList: it is initialized
+ * once per sub-template and resized with fbSubTemplateListRealloc(), which
+ * keeps the allocation while records have the same number of entries, so
+ * there is no list allocation or free per record in either mode. Entries
+ * are copied into the list through the libfixbuf API only. Direct mode no
+ * longer changes anything, including the lists, which stay staged after an
+ * export as in the default mode; kept for source compatibility.
+ * 
+ * @param ctx     Initialized record context
+ * @param direct  Ignored
+ * @param err     Error structure
+ * 
+ * @return TRUE on success, FALSE if ctx is not initialized
+ */
+gboolean sav_record_ctx_set_direct(
+    sav_record_ctx_t *ctx,
+    gboolean         direct,
+    GError           **err);
+
 /**
  * Clean up SAV record context
  * 
@@ -67,6 +172,9 @@ void sav_record_ctx_cleanup(sav_record_ctx_t *ctx);
 /**
  * Add an IPv4 Interface-to-Prefix entry to the SubTemplateList
  * 
+ * The entry goes to the template 901 list whatever sub-template the context
+ * was initialized for.
+ * 
  * @param ctx              Record context
  * @param interface_id     Ingress interface ID
  * @param prefix           IPv4 prefix (network byte order)
@@ -85,6 +193,9 @@ gboolean sav_add_ipv4_interface_prefix(
 /**
  * Add an IPv6 Interface-to-Prefix entry to the SubTemplateList
  * 
+ * The entry goes to the template 902 list whatever sub-template the context
+ * was initialized for.
+ * 
  * @param ctx              Record context
  * @param interface_id     Ingress interface ID
  * @param prefix           IPv6 prefix (16 bytes, network byte order)
@@ -103,6 +214,9 @@ gboolean sav_add_ipv6_interface_prefix(
 /**
  * Add an IPv4 Prefix-to-Interface entry to the SubTemplateList
  * 
+ * The entry goes to the template 903 list whatever sub-template the context
+ * was initialized for.
+ * 
  * @param ctx              Record context
  * @param prefix           IPv4 prefix (network byte order)
  * @param prefix_len       Prefix length (0-32)
@@ -121,6 +235,9 @@ gboolean sav_add_ipv4_prefix_interface(
 /**
  * Add an IPv6 Prefix-to-Interface entry to the SubTemplateList
  * 
+ * The entry goes to the template 904 list whatever sub-template the context
+ * was initialized for.
+ * 
  * @param ctx              Record context
  * @param prefix           IPv6 prefix (16 bytes, network byte order)
  * @param prefix_len       Prefix length (0-128)
@@ -142,6 +259,19 @@ gboolean sav_add_ipv6_prefix_interface(
  * This function writes a complete SAV record (template 400) with its SubTemplateList
  * to an IPFIX exporter/file buffer.
  * 
+ * The context's own list is written first, followed by one record for each
+ * other sub-template with staged entries (e.g. 901 then 902 for a mixed
+ * IPv4/IPv6 table). An empty context still writes one record with an empty
+ * list.
+ * 
+ * Lists too long for one record of ctx->msg_budget bytes are split into
+ * several consecutive template-400 records with the same timestamp, rule,
+ * target and action; the union of their lists is the complete list.
+ * ctx->records_exported tells how many records were written.
+ * 
+ * The entries stay staged; call sav_record_ctx_reset() before adding the
+ * entries of the next record to the same context.
+ * 
  * @param ctx                Context with populated SubTemplateList
  * @param exporter           IPFIX exporter/fbuf
  * @param timestamp_ms       Observation timestamp in milliseconds
@@ -161,6 +291,54 @@ gboolean sav_export_record(
     uint8_t          policy_action,
     GError           **err);
 
+/**
+ * One record of a batch export
+ * 
+ * The record's list is the slice [first_entry, first_entry + entry_count)
+ * of the entries added to the record context, so one context can hold the
+ * lists of many records back-to-back.
+ */
+typedef struct sav_record_desc {
+    uint64_t  timestamp_ms;     /* Observation timestamp in milliseconds */
+    uint8_t   rule_type;        /* SAV rule type */
+    uint8_t   target_type;      /* SAV target type */
+    uint8_t   policy_action;    /* Policy action */
+    uint32_t  first_entry;      /* Index of the first list entry in the context */
+    uint32_t  entry_count;      /* Number of list entries (may be 0) */
+} sav_record_desc_t;
+
+/**
+ * Export many SAV records in one call
+ * 
+ * Equivalent to one sav_export_record() per descriptor, but the export
+ * templates are selected once and the records are appended back-to-back,
+ * so libfixbuf fills each message before writing it. All records use the
+ * context's sub-template; entries staged for another sub-template are an
+ * error. Lists longer than the record budget are split
+ * as in sav_export_record(); ctx->records_exported tells how many records
+ * were written in total.
+ * 
+ * All descriptors are validated before anything is written; a descriptor
+ * whose rule_type and target_type select another sub-template than the
+ * context's is an error. The entries
+ * stay staged afterwards; sav_record_ctx_reset() empties the context for
+ * the next batch.
+ * 
+ * @param ctx        Context holding the entries of all records
+ * @param exporter   IPFIX exporter/fbuf
+ * @param records    Record descriptors
+ * @param n_records  Number of descriptors
+ * @param err        Error structure
+ * 
+ * @return TRUE on success, FALSE on error
+ */
+gboolean sav_export_records_batch(
+    sav_record_ctx_t        *ctx,
+    fBuf_t                  *exporter,
+    const sav_record_desc_t *records,
+    size_t                  n_records,
+    GError                  **err);
+
 /**
  * Create an IPFIX exporter writing to a file
  * 
@@ -0,0 +1,174 @@
+/**
+ * @file sav_fast_decoder.h
+ * @brief Native fast-path decoder for SAV IPFIX messages
+ * 
+ * The SAV wire layouts (template 400 and sub-templates 901-904) are fixed,
+ * so records can be decoded straight from the message bytes without going
+ * through libfixbuf's generic transcoder. The decoder works one complete
+ * IPFIX message at a time:
+ * 
+ * - Template sets are parsed to verify that 400 and 901-904 carry exactly
+ *   the layouts defined in sav_ie_definitions.c. A withdrawal of one of
+ *   them, or of all templates, unverifies it until it is defined again.
+ * - A message is decoded natively only if it holds nothing but data sets
+ *   for a verified template 400 whose lists all use verified sub-templates.
+ *   Every other message (including any message with a template set) must
+ *   be handed to libfixbuf by the caller, which keeps libfixbuf's own
+ *   template state complete.
+ */
+
+#ifndef SAV_FAST_DECODER_H
+#define SAV_FAST_DECODER_H
+
+#include <stdint.h>
+#include "sav_collector.h"
+
+/* IPFIX framing constants (RFC 7011) */
+#define SAV_IPFIX_VERSION           10
+#define SAV_IPFIX_MSG_HEADER_LEN    16
+#define SAV_IPFIX_SET_HEADER_LEN    4
+#define SAV_IPFIX_TEMPLATE_SET_ID   2
+#define SAV_IPFIX_OPTIONS_SET_ID    3
+#define SAV_IPFIX_MIN_DATA_SET_ID   256
+#define SAV_IPFIX_MAX_MSG_LEN       65535
+
+/* Templates the fast path knows: 400, 901, 902, 903, 904 */
+#define SAV_FAST_TMPL_COUNT 5
+
+/**
+ * SAV Fast Decoder
+ * 
+ * Decoder state for one template scope (one exporter/observation domain).
+ */
+typedef struct sav_fast_decoder {
+    gboolean       layout_ok[SAV_FAST_TMPL_COUNT]; /* Template seen with expected layout */
+    const uint8_t  *msg;              /* Current message (borrowed) */
+    const uint8_t  *msg_end;          /* End of current message */
+    const uint8_t  *set_end;          /* End of current data set (NULL = none) */
+    const uint8_t  *cur;              /* Next record within the current set */
+    uint32_t       domain_id;         /* Observation domain of current message */
+    uint32_t       sequence;          /* Sequence number of current message */
+    uint32_t       data_records;      /* Data records in the last loaded message */
+    gboolean       records_known;     /* data_records is exact (see below) */
+    uint64_t       native_messages;   /* Statistics: messages decoded natively */
+    uint64_t       fallback_messages; /* Statistics: messages left to libfixbuf */
+} sav_fast_decoder_t;
+
+/**
+ * Initialize a fast decoder (no templates known yet)
+ * 
+ * @param dec  Decoder to initialize
+ */
+void sav_fast_decoder_init(sav_fast_decoder_t *dec);
+
+/**
+ * Load a complete IPFIX message into the decoder
+ * 
+ * Learns template layouts from any template sets and decides whether the
+ * message can be decoded natively. The message buffer must stay valid and
+ * unchanged until all its records have been read.
+ * 
+ * The data records of the message are counted into dec->data_records,
+ * whether or not they decode, as sequence number accounting requires
+ * (RFC 7011, section 3.1). Only template-400 records with a verified
+ * layout can be delimited; data of any other template leaves
+ * dec->records_known FALSE.
+ * 
+ * @param dec     Decoder
+ * @param msg     Message bytes, starting at the IPFIX message header
+ * @param len     Message length in bytes
+ * @param native  Output: TRUE if records must be read with
+ *                sav_fast_decoder_next(), FALSE if the message has to be
+ *                decoded by libfixbuf instead
+ * @param err     Error structure
+ * 
+ * @return TRUE on success, FALSE if the message framing is malformed
+ */
+gboolean sav_fast_decoder_load_message(
+    sav_fast_decoder_t *dec,
+    const uint8_t      *msg,
+    size_t             len,
+    gboolean           *native,
+    GError             **err);
+
+/**
+ * Decode the next record of a natively loaded message
+ * 
+ * The view's entries point into the message buffer in wire (network)
+ * byte order; sav_record_view_get_ipv4()/_ipv6() handle the conversion.
+ * 
+ * @param dec   Decoder
+ * @param view  Output: record view
+ * 
+ * @return TRUE if a record was decoded, FALSE at end of message
+ */
+gboolean sav_fast_decoder_next(
+    sav_fast_decoder_t *dec,
+    sav_record_view_t  *view);
+
+/**
+ * Encode a template set defining 400 and 901-904 with exactly the layouts
+ * the fast path verifies
+ * 
+ * @param buf  Output buffer (set header included)
+ * @param cap  Capacity of buf
+ * 
+ * @return Bytes written, 0 if cap is too small
+ */
+size_t sav_fast_encode_template_set(uint8_t *buf, size_t cap);
+
+/**
+ * Read a 16-bit big-endian value from an unaligned pointer
+ */
+static inline uint16_t sav_read_be16(const uint8_t *p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+/**
+ * Read a 32-bit big-endian value from an unaligned pointer
+ */
+static inline uint32_t sav_read_be32(const uint8_t *p)
+{
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+           ((uint32_t)p[2] << 8)  |  (uint32_t)p[3];
+}
+
+/**
+ * Read a 64-bit big-endian value from an unaligned pointer
+ */
+static inline uint64_t sav_read_be64(const uint8_t *p)
+{
+    return ((uint64_t)sav_read_be32(p) << 32) | sav_read_be32(p + 4);
+}
+
+/**
+ * Write a 16-bit big-endian value to an unaligned pointer
+ */
+static inline void sav_write_be16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+/**
+ * Write a 32-bit big-endian value to an unaligned pointer
+ */
+static inline void sav_write_be32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+/**
+ * Write a 64-bit big-endian value to an unaligned pointer
+ */
+static inline void sav_write_be64(uint8_t *p, uint64_t v)
+{
+    sav_write_be32(p, (uint32_t)(v >> 32));
+    sav_write_be32(p + 4, (uint32_t)v);
+}
+
+#endif /* SAV_FAST_DECODER_H */
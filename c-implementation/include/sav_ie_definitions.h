@@ -56,6 +56,9 @@ typedef enum {
 
 /**
  * Structure for IPv4 Interface-to-Prefix mapping (Template 901/903)
+ *
+ * ingressInterface and sourceIPv4Prefix are in host byte order, whichever
+ * collector path decoded them.
  */
 typedef struct sav_ipv4_mapping_st {
     uint32_t ingressInterface;
@@ -65,6 +68,9 @@ typedef struct sav_ipv4_mapping_st {
 
 /**
  * Structure for IPv6 Interface-to-Prefix mapping (Template 902/904)
+ *
+ * ingressInterface is in host byte order; the prefix bytes are in network
+ * order.
  */
 typedef struct sav_ipv6_mapping_st {
     uint32_t ingressInterface;
@@ -143,10 +149,24 @@ gboolean sav_validate_policy_action(uint8_t action);
 
 /**
  * Get appropriate template ID based on rule type and target type
+ * 
+ * Always the IPv4 template of the target type (901 or 903); use
+ * sav_get_template_id_for_family() for IPv6.
+ * 
  * @param rule_type SAV rule type (allowlist=1, blocklist=2)
  * @param target_type SAV target type (interface-prefix=1, prefix-interface=2)
- * @return Template ID (901-904)
+ * @return Template ID (901 or 903)
  */
 uint16_t sav_get_template_id(uint8_t rule_type, uint8_t target_type);
 
+/**
+ * Get the template ID for a target type and address family
+ * @param rule_type SAV rule type (allowlist=1, blocklist=2)
+ * @param target_type SAV target type (interface-prefix=1, prefix-interface=2)
+ * @param ipv6 TRUE for the IPv6 template
+ * @return Template ID (901-904)
+ */
+uint16_t sav_get_template_id_for_family(uint8_t rule_type, uint8_t target_type,
+                                        gboolean ipv6);
+
 #endif /* SAV_IE_DEFINITIONS_H */
@@ -0,0 +1,162 @@
+/**
+ * @file sav_json.h
+ * @brief Buffered streaming JSON writer for parsed SAV records
+ *
+ * The writer formats records into one large reusable buffer with
+ * hand-rolled integer and address formatters, and hands the buffer to
+ * stdio with a single fwrite() whenever it fills up. Nothing is allocated
+ * per record.
+ *
+ * Three styles are supported: SAV_JSON_PRETTY produces exactly the output
+ * of the original fprintf()-based sav_export_record_json(),
+ * SAV_JSON_COMPACT drops all optional whitespace, and SAV_JSON_NDJSON
+ * writes one compact object per line with no enclosing array.
+ */
+
+#ifndef SAV_JSON_H
+#define SAV_JSON_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <glib.h>
+#include "sav_collector.h"
+
+/* Default buffer size used when 0 is passed to sav_json_writer_init() */
+#define SAV_JSON_DEFAULT_BUFFER_SIZE (256 * 1024)
+
+/* Smallest accepted buffer; larger than any single formatted piece */
+#define SAV_JSON_MIN_BUFFER_SIZE 4096
+
+/**
+ * Output style
+ */
+typedef enum sav_json_style {
+    SAV_JSON_PRETTY = 0,              /* Indented, byte-identical to legacy output */
+    SAV_JSON_COMPACT = 1,             /* No optional whitespace */
+    SAV_JSON_NDJSON = 2               /* One compact object per line */
+} sav_json_style_t;
+
+/**
+ * SAV JSON Writer
+ *
+ * Caller-owned writer state. Initialise with sav_json_writer_init(),
+ * flush with sav_json_writer_flush() and release with
+ * sav_json_writer_destroy().
+ */
+typedef struct sav_json_writer {
+    FILE             *output;         /* Destination stream */
+    char             *buf;            /* Pending output */
+    size_t           len;             /* Bytes pending in buf */
+    size_t           cap;             /* Capacity of buf */
+    gboolean         owns_buf;        /* buf was allocated by the writer */
+    sav_json_style_t style;           /* Output style */
+    gboolean         in_array;        /* Inside begin_array/end_array */
+    uint64_t         records_in_array; /* Records written since begin_array */
+    uint64_t         bytes_written;   /* Bytes handed to the stream */
+    int              error;           /* errno of the first failed write, 0 = none */
+} sav_json_writer_t;
+
+/**
+ * Initialize a JSON writer
+ *
+ * @param writer    Writer to initialize
+ * @param output    Destination stream
+ * @param style     SAV_JSON_PRETTY, SAV_JSON_COMPACT or SAV_JSON_NDJSON
+ * @param buf_size  Buffer size in bytes (0 = SAV_JSON_DEFAULT_BUFFER_SIZE,
+ *                  raised to SAV_JSON_MIN_BUFFER_SIZE if smaller)
+ */
+void sav_json_writer_init(
+    sav_json_writer_t *writer,
+    FILE              *output,
+    sav_json_style_t  style,
+    size_t            buf_size);
+
+/**
+ * Start a JSON array of records
+ *
+ * Records written until sav_json_end_array() are separated by commas.
+ * Does nothing in SAV_JSON_NDJSON style.
+ *
+ * @param writer  Writer
+ */
+void sav_json_begin_array(sav_json_writer_t *writer);
+
+/**
+ * Close the array started by sav_json_begin_array()
+ *
+ * @param writer  Writer
+ */
+void sav_json_end_array(sav_json_writer_t *writer);
+
+/**
+ * Append one record as a JSON object
+ *
+ * Inside an array the record is preceded by a separator when needed.
+ * Output may stay buffered until the buffer fills up or
+ * sav_json_writer_flush() is called.
+ *
+ * @param writer  Writer
+ * @param record  Record to write
+ */
+void sav_json_write_record(
+    sav_json_writer_t         *writer,
+    const sav_parsed_record_t *record);
+
+/**
+ * Hand all buffered output to the stream
+ *
+ * The stream itself is not fflush()ed.
+ *
+ * @param writer  Writer
+ * @param err     Error structure
+ *
+ * @return TRUE on success, FALSE if any write since init has failed
+ */
+gboolean sav_json_writer_flush(
+    sav_json_writer_t *writer,
+    GError            **err);
+
+/**
+ * Free the writer's buffer
+ *
+ * Pending output is discarded; call sav_json_writer_flush() first.
+ *
+ * @param writer  Writer to destroy
+ */
+void sav_json_writer_destroy(sav_json_writer_t *writer);
+
+/**
+ * Format an unsigned integer in decimal
+ *
+ * @param dst    Destination, at least 20 bytes
+ * @param value  Value
+ *
+ * @return Pointer past the last character written (not NUL-terminated)
+ */
+char* sav_json_format_u64(char *dst, uint64_t value);
+
+/**
+ * Format an IPv4 address in dotted-quad form, as inet_ntop() does
+ *
+ * @param dst   Destination, at least INET_ADDRSTRLEN - 1 bytes
+ * @param addr  Address bytes in network order
+ *
+ * @return Pointer past the last character written (not NUL-terminated)
+ */
+char* sav_json_format_ipv4(char *dst, const uint8_t addr[4]);
+
+/**
+ * Format an IPv6 address, as glibc's inet_ntop() does
+ *
+ * Leading zeros are dropped, the first longest run of two or more zero
+ * groups becomes "::", and IPv4-mapped and -compatible addresses end in
+ * dotted-quad form.
+ *
+ * @param dst   Destination, at least INET6_ADDRSTRLEN - 1 bytes
+ * @param addr  Address bytes
+ *
+ * @return Pointer past the last character written (not NUL-terminated)
+ */
+char* sav_json_format_ipv6(char *dst, const uint8_t addr[16]);
+
+#endif /* SAV_JSON_H */
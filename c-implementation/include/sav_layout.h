@@ -0,0 +1,164 @@
+/**
+ * @file sav_layout.h
+ * @brief Single definition of the SAV sub-template layouts (901-904)
+ *
+ * SAV_SUB_TEMPLATE_TABLE lists every sub-template once: its ID, address
+ * family, prefix size and field order. Everything that depends on a layout
+ * is generated from it:
+ *
+ * - the fbInfoElementSpec_t arrays registered by sav_add_templates()
+ * - the template layouts the fast decoder verifies and writes
+ * - one encode and one decode kernel per sub-template with constant
+ *   offsets, e.g. sav_encode_ipv6_prefix_interface()
+ * - sav_sub_template_layout(), a table keyed by template ID with the
+ *   offsets and batch decode/encode functions, so callers pick a kernel
+ *   once per list instead of branching per entry
+ *
+ * Entries are packed in wire order without padding: the interface and
+ * IPv4 prefix are big-endian in messages, and in host order in the
+ * records libfixbuf transcodes.
+ */
+
+#ifndef SAV_LAYOUT_H
+#define SAV_LAYOUT_H
+
+#include <stdint.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include "sav_ie_definitions.h"
+
+/**
+ * The sub-templates: X(id, name, family, prefix_bytes, order)
+ *
+ * family is 4 or 6; order is INTERFACE_FIRST (ingressInterface, prefix,
+ * prefix length) or PREFIX_FIRST (prefix, prefix length, ingressInterface).
+ */
+#define SAV_SUB_TEMPLATE_TABLE(X) \
+    X(SAV_TMPL_IPV4_INTERFACE_PREFIX, ipv4_interface_prefix, 4, 4,  INTERFACE_FIRST) \
+    X(SAV_TMPL_IPV6_INTERFACE_PREFIX, ipv6_interface_prefix, 6, 16, INTERFACE_FIRST) \
+    X(SAV_TMPL_IPV4_PREFIX_INTERFACE, ipv4_prefix_interface, 4, 4,  PREFIX_FIRST) \
+    X(SAV_TMPL_IPV6_PREFIX_INTERFACE, ipv6_prefix_interface, 6, 16, PREFIX_FIRST)
+
+/* Fields of each order, in template order: F(field, family, size) */
+#define SAV_FIELDS_INTERFACE_FIRST(F, family, prefix_bytes) \
+    F(INTERFACE, family, 4) F(PREFIX, family, prefix_bytes) F(PREFIX_LENGTH, family, 1)
+#define SAV_FIELDS_PREFIX_FIRST(F, family, prefix_bytes) \
+    F(PREFIX, family, prefix_bytes) F(PREFIX_LENGTH, family, 1) F(INTERFACE, family, 4)
+#define SAV_FIELDS(order, F, family, prefix_bytes) \
+    SAV_FIELDS_##order(F, family, prefix_bytes)
+
+/* Field offsets of each order */
+#define SAV_OFF_INTERFACE_FIRST_INTERFACE(prefix_bytes)      0
+#define SAV_OFF_INTERFACE_FIRST_PREFIX(prefix_bytes)         4
+#define SAV_OFF_INTERFACE_FIRST_PREFIX_LENGTH(prefix_bytes)  (4 + (prefix_bytes))
+#define SAV_OFF_PREFIX_FIRST_INTERFACE(prefix_bytes)         ((prefix_bytes) + 1)
+#define SAV_OFF_PREFIX_FIRST_PREFIX(prefix_bytes)            0
+#define SAV_OFF_PREFIX_FIRST_PREFIX_LENGTH(prefix_bytes)     (prefix_bytes)
+#define SAV_OFF(order, field, prefix_bytes) SAV_OFF_##order##_##field(prefix_bytes)
+
+/* Entry size: interface(4) + prefix + prefix length(1) */
+#define SAV_ENTRY_SIZE(prefix_bytes) (4 + (prefix_bytes) + 1)
+
+/* Largest entry of any sub-template (IPv6) */
+#define SAV_MAX_ENTRY_SIZE SAV_ENTRY_SIZE(16)
+
+/* Information element names and IANA IDs of the fields */
+#define SAV_STR_(x) #x
+#define SAV_STR(x)  SAV_STR_(x)
+#define SAV_IE_NAME_INTERFACE(family)      "ingressInterface"
+#define SAV_IE_NAME_PREFIX(family)         "sourceIPv" SAV_STR(family) "Prefix"
+#define SAV_IE_NAME_PREFIX_LENGTH(family)  "sourceIPv" SAV_STR(family) "PrefixLength"
+#define SAV_IE_ID_INTERFACE_4          10
+#define SAV_IE_ID_INTERFACE_6          10
+#define SAV_IE_ID_PREFIX_4             44
+#define SAV_IE_ID_PREFIX_6             170
+#define SAV_IE_ID_PREFIX_LENGTH_4      9
+#define SAV_IE_ID_PREFIX_LENGTH_6      29
+#define SAV_IE_ID(field, family)       SAV_IE_ID_##field##_##family
+
+/* Mapping type of each family */
+#define SAV_MAPPING_T(family) sav_ipv##family##_mapping_t
+
+/* Prefix in a mapping: host-order integer for IPv4, bytes for IPv6 */
+#define SAV_PREFIX_TO_WIRE_4(dst, m)    do { uint32_t be_ = htonl((m)->sourceIPv4Prefix); \
+                                             memcpy((dst), &be_, 4); } while (0)
+#define SAV_PREFIX_TO_WIRE_6(dst, m)    memcpy((dst), (m)->sourceIPv6Prefix, 16)
+#define SAV_PREFIX_TO_HOST_4(m)         ((m)->sourceIPv4Prefix = ntohl((m)->sourceIPv4Prefix))
+#define SAV_PREFIX_TO_HOST_6(m)         ((void)(m))
+
+/**
+ * Batch decoder: copy count entries, stride bytes apart, into an array of
+ * sav_ipv4_mapping_t or sav_ipv6_mapping_t; wire_order converts the
+ * big-endian fields to host order
+ */
+typedef void (*sav_decode_n_fn)(
+    const uint8_t *entries,
+    size_t        stride,
+    uint32_t      count,
+    void          *mappings,
+    gboolean      wire_order);
+
+/**
+ * Batch encoder: write count host-order mappings as packed wire entries
+ */
+typedef uint8_t* (*sav_encode_n_fn)(
+    uint8_t       *dst,
+    const void    *mappings,
+    uint32_t      count);
+
+/**
+ * Layout of one sub-template
+ */
+typedef struct sav_sub_template_layout {
+    uint16_t         tmpl_id;
+    uint8_t          family;           /* 4 or 6 */
+    uint8_t          entry_size;       /* Packed entry size in bytes */
+    uint8_t          interface_off;    /* ingressInterface offset */
+    uint8_t          prefix_off;       /* Prefix offset */
+    uint8_t          prefix_size;      /* Prefix size (4 or 16) */
+    uint8_t          prefix_len_off;   /* Prefix length offset */
+    sav_decode_n_fn  decode_n;         /* Entries -> mappings */
+    sav_encode_n_fn  encode_n;         /* Mappings -> wire entries */
+} sav_sub_template_layout_t;
+
+/**
+ * Look up a sub-template layout
+ *
+ * @param tmpl_id  Template ID
+ *
+ * @return Layout, or NULL if tmpl_id is not one of 901-904
+ */
+const sav_sub_template_layout_t* sav_sub_template_layout(uint16_t tmpl_id);
+
+/* Encode kernels: sav_encode_<name>(entry, interface, prefix, prefix_len)
+ * write one entry; interface and prefix are already in the byte order of
+ * the destination (network order for messages, host order for libfixbuf
+ * records) */
+#define SAV_ENCODE_KERNEL(id, name, family, prefix_bytes, order)                  \
+static inline void sav_encode_##name(uint8_t *entry, uint32_t interface_id,       \
+                                     const void *prefix, uint8_t prefix_len)      \
+{                                                                                 \
+    memcpy(entry + SAV_OFF(order, INTERFACE, prefix_bytes), &interface_id, 4);    \
+    memcpy(entry + SAV_OFF(order, PREFIX, prefix_bytes), prefix, prefix_bytes);   \
+    entry[SAV_OFF(order, PREFIX_LENGTH, prefix_bytes)] = prefix_len;              \
+}
+SAV_SUB_TEMPLATE_TABLE(SAV_ENCODE_KERNEL)
+#undef SAV_ENCODE_KERNEL
+
+/* Decode kernels: sav_decode_<name>(entry, mapping) copy one entry without
+ * byte-order conversion */
+#define SAV_DECODE_KERNEL(id, name, family, prefix_bytes, order)                  \
+static inline void sav_decode_##name(const uint8_t *entry,                        \
+                                     SAV_MAPPING_T(family) *mapping)              \
+{                                                                                 \
+    memcpy(&mapping->ingressInterface,                                            \
+           entry + SAV_OFF(order, INTERFACE, prefix_bytes), 4);                   \
+    memcpy(&mapping->sourceIPv##family##Prefix,                                   \
+           entry + SAV_OFF(order, PREFIX, prefix_bytes), prefix_bytes);           \
+    mapping->sourceIPv##family##PrefixLength =                                    \
+        entry[SAV_OFF(order, PREFIX_LENGTH, prefix_bytes)];                       \
+}
+SAV_SUB_TEMPLATE_TABLE(SAV_DECODE_KERNEL)
+#undef SAV_DECODE_KERNEL
+
+#endif /* SAV_LAYOUT_H */
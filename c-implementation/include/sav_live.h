@@ -0,0 +1,296 @@
+/**
+ * @file sav_live.h
+ * @brief Lock-free published snapshots of the live SAV rule table
+ *
+ * sav_live_t keeps a sav_state_t (see sav_state.h) for one writer, the
+ * collector thread, and publishes what it holds to any number of lookup
+ * threads as immutable, versioned snapshots. Publishing swaps one
+ * pointer; readers never take a lock and never see a half-applied
+ * update, and a snapshot a reader still holds stays valid until it lets
+ * go of it.
+ *
+ * Snapshots are partitioned so that a publish only rebuilds what changed:
+ *
+ *   - prefixes shorter than /8 of each family form one partition;
+ *   - /8 to /15 form one partition per /8;
+ *   - longer prefixes form one partition per /16 (IPv6: for /16 to /31,
+ *     with one partition per /32 below it for /32 and longer).
+ *
+ * A partition holds the leaves of its prefixes (see sav_lpm.h) and the
+ * address ranges on which each leaf is the longest match. A publish
+ * rebuilds the partitions whose mappings changed, copies the page of the
+ * /8 above each (its partition and 256 /16 slots), and shares everything
+ * else with the previous snapshot. Mappings whose rule type and action did not change
+ * (records that only refresh the time) do not make a partition dirty.
+ *
+ * A lookup reads the page and slot of the address, searches the deepest
+ * partition with a prefix covering it and falls back to shallower ones.
+ * Interface sets of every partition are over one interface index that
+ * only grows, so checks cost the same few reads as sav_lpm4_check().
+ *
+ * Old snapshots are reclaimed by epoch: each reader announces the global
+ * epoch when it enters a read section and clears it when it leaves; a
+ * snapshot replaced at epoch e is freed, by the writer, once no reader
+ * is inside a section entered before e.
+ *
+ * Usage: the writer applies records (or upserts and removes entries) and
+ * calls sav_live_publish() whenever lookups should see the changes, e.g.
+ * after each batch of records. Each lookup thread registers a reader and
+ * brackets its lookups with sav_live_read_begin() and sav_live_read_end().
+ * Read sections should be short (a batch of lookups): a reader that stays
+ * inside one keeps every snapshot published since from being freed.
+ */
+
+#ifndef SAV_LIVE_H
+#define SAV_LIVE_H
+
+#include <stdint.h>
+#include <glib.h>
+#include "sav_collector.h"
+#include "sav_state.h"
+#include "sav_lpm.h"
+
+typedef struct sav_live sav_live_t;
+typedef struct sav_live_snapshot sav_live_snapshot_t;
+typedef struct sav_live_reader sav_live_reader_t;
+
+/**
+ * Table statistics
+ */
+typedef struct sav_live_stats {
+    uint64_t  version;                /* Version of the current snapshot (0: empty) */
+    uint64_t  records;                /* Records applied */
+    uint64_t  rejected;               /* Invalid mappings skipped */
+    uint64_t  published;              /* Snapshots published */
+    uint64_t  rebuilt;                /* Partitions rebuilt by all publishes */
+    uint64_t  partitions;             /* Partitions in the current snapshot */
+    uint64_t  retired;                /* Replaced snapshots not yet freed */
+    uint64_t  reclaimed;              /* Replaced snapshots freed */
+    uint32_t  readers;                /* Registered readers */
+    uint32_t  interfaces;             /* Interfaces in the interface index */
+    size_t    memory_bytes;           /* Current snapshot, shared parts included */
+} sav_live_stats_t;
+
+/**
+ * Create an empty table
+ *
+ * Publishes an empty snapshot (version 0) so that readers always find one.
+ *
+ * @return New table (free with sav_live_free())
+ */
+sav_live_t* sav_live_new(void);
+
+/**
+ * Free a table and every snapshot
+ *
+ * Free all readers first.
+ *
+ * @param live  Table (may be NULL)
+ */
+void sav_live_free(sav_live_t *live);
+
+/**
+ * Apply every mapping of a record (writer)
+ *
+ * Same semantics as sav_state_apply_record(); lookups see the result
+ * after the next publish.
+ *
+ * @param live    Table
+ * @param record  Record to apply
+ * @param err     Error structure
+ *
+ * @return TRUE on success, FALSE if the record itself is invalid
+ */
+gboolean sav_live_apply_record(
+    sav_live_t                *live,
+    const sav_parsed_record_t *record,
+    GError                    **err);
+
+/**
+ * Insert an entry or replace the value of the entry with its key (writer)
+ *
+ * The entry is stored as given; callers are responsible for a valid
+ * family, prefix length and rule type.
+ *
+ * @param live   Table
+ * @param entry  Entry
+ *
+ * @return TRUE if a new entry was added, FALSE if one was replaced
+ */
+gboolean sav_live_upsert(
+    sav_live_t              *live,
+    const sav_state_entry_t *entry);
+
+/**
+ * Remove an entry by key (writer)
+ *
+ * @param live  Table
+ * @param key   Entry whose key fields identify the entry to remove
+ *
+ * @return TRUE if an entry was removed
+ */
+gboolean sav_live_remove(
+    sav_live_t              *live,
+    const sav_state_entry_t *key);
+
+/**
+ * Rule table behind the snapshots, as of the last change (writer)
+ *
+ * @param live  Table
+ *
+ * @return Table, owned by live; do not modify
+ */
+const sav_state_t* sav_live_state(const sav_live_t *live);
+
+/**
+ * Publish the changes made since the last publish (writer)
+ *
+ * Builds the next snapshot from the dirty partitions, swaps it in and
+ * frees the replaced snapshots no reader can still hold. Does nothing
+ * but reclaim if nothing changed.
+ *
+ * @param live  Table
+ *
+ * @return Version of the current snapshot
+ */
+uint64_t sav_live_publish(sav_live_t *live);
+
+/**
+ * Free the replaced snapshots no reader can still hold (writer)
+ *
+ * sav_live_publish() does this too; a writer that stops publishing can
+ * call it to release memory once readers move on.
+ *
+ * @param live  Table
+ *
+ * @return Replaced snapshots still waiting for readers
+ */
+uint64_t sav_live_reclaim(sav_live_t *live);
+
+/**
+ * Table statistics (writer)
+ *
+ * @param live   Table
+ * @param stats  Output statistics
+ */
+void sav_live_get_stats(
+    sav_live_t       *live,
+    sav_live_stats_t *stats);
+
+/**
+ * Register a lookup thread
+ *
+ * May be called from any thread; takes a lock shared with
+ * sav_live_reclaim(), never held during lookups.
+ *
+ * @param live  Table
+ *
+ * @return Reader for one thread (free with sav_live_reader_free())
+ */
+sav_live_reader_t* sav_live_reader_new(sav_live_t *live);
+
+/**
+ * Unregister a lookup thread
+ *
+ * @param reader  Reader outside any read section (may be NULL)
+ */
+void sav_live_reader_free(sav_live_reader_t *reader);
+
+/**
+ * Enter a read section and take the current snapshot
+ *
+ * Wait-free. Sections do not nest.
+ *
+ * @param reader  Reader of the calling thread
+ *
+ * @return Snapshot, valid until sav_live_read_end()
+ */
+const sav_live_snapshot_t* sav_live_read_begin(sav_live_reader_t *reader);
+
+/**
+ * Leave the read section
+ *
+ * @param reader  Reader of the calling thread
+ */
+void sav_live_read_end(sav_live_reader_t *reader);
+
+/**
+ * Version of a snapshot
+ *
+ * Versions count publishes that changed something, from 0 for the
+ * empty table.
+ *
+ * @param snap  Snapshot
+ *
+ * @return Version
+ */
+uint64_t sav_live_snapshot_version(const sav_live_snapshot_t *snap);
+
+/**
+ * Leaf of the longest prefix covering an IPv4 address
+ *
+ * The allow and block lists and actions are those of sav_lpm4_lookup().
+ * The inherited list and covered flag only account for covering prefixes
+ * of the same partition; sav_live_check4() accounts for all of them.
+ *
+ * @param snap  Snapshot
+ * @param addr  Source address, host byte order
+ *
+ * @return Leaf (empty if no prefix covers addr), valid while snap is
+ */
+const sav_lpm_leaf_t* sav_live_lookup4(
+    const sav_live_snapshot_t *snap,
+    uint32_t                  addr);
+
+/**
+ * Leaf of the longest prefix covering an IPv6 address
+ *
+ * See sav_live_lookup4().
+ *
+ * @param snap  Snapshot
+ * @param addr  Source address, 16 bytes in network byte order
+ *
+ * @return Leaf (empty if no prefix covers addr), valid while snap is
+ */
+const sav_lpm_leaf_t* sav_live_lookup6(
+    const sav_live_snapshot_t *snap,
+    const uint8_t             *addr);
+
+/**
+ * Is an IPv4 source address valid on an ingress interface?
+ *
+ * Same result as sav_lpm4_check() on a table built from the same entries
+ * with feasible checks enabled.
+ *
+ * @param snap       Snapshot
+ * @param addr       Source address, host byte order
+ * @param interface  Ingress interface
+ * @param mode       Check mode
+ *
+ * @return TRUE if valid
+ */
+gboolean sav_live_check4(
+    const sav_live_snapshot_t *snap,
+    uint32_t                  addr,
+    uint32_t                  interface,
+    sav_urpf_mode_t           mode);
+
+/**
+ * Is an IPv6 source address valid on an ingress interface?
+ *
+ * See sav_live_check4().
+ *
+ * @param snap       Snapshot
+ * @param addr       Source address, 16 bytes in network byte order
+ * @param interface  Ingress interface
+ * @param mode       Check mode
+ *
+ * @return TRUE if valid
+ */
+gboolean sav_live_check6(
+    const sav_live_snapshot_t *snap,
+    const uint8_t             *addr,
+    uint32_t                  interface,
+    sav_urpf_mode_t           mode);
+
+#endif /* SAV_LIVE_H */
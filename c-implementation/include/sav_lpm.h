@@ -0,0 +1,624 @@
+/**
+ * @file sav_lpm.h
+ * @brief Longest-prefix-match source address validation tables
+ *
+ * Compiles SAV mappings into a lookup structure that maps a packet's
+ * source address to a leaf: the interfaces on which the longest matching
+ * prefix is allowlisted or blocklisted, and the policy action of each.
+ *
+ * IPv4 uses DIR-24-8: a 2^24-entry first-level table indexed by the top
+ * 24 address bits and 256-entry second-level groups for the prefixes
+ * longer than /24, so every lookup takes one or two memory reads.
+ *
+ * IPv6 uses a poptrie: a 2^16-entry direct table for the top 16 bits,
+ * then 64-way nodes of 24 bytes. A node keeps a bitmap of which of its 64
+ * slots lead to child nodes and a bitmap marking where runs of equal
+ * leaves start; children and leaf runs are stored contiguously and found
+ * by popcount, so empty and repeated slots cost nothing.
+ *
+ * Each leaf also carries its interface lists as compact bitsets over a
+ * dense per-table interface index, so the uRPF checks (strict, feasible,
+ * loose) cost the same on a router with thousands of ports as on one
+ * with four. Feasible checks need the interfaces of all covering
+ * prefixes in each leaf, which splits leaves that would otherwise be
+ * shared; tables enable them explicitly.
+ *
+ * Usage: add mappings (sav_lpm4_add(), sav_lpm4_add_record() or
+ * sav_lpm4_add_state(), likewise for sav_lpm6), build, then look up or
+ * check.
+ * Adding more mappings requires another build; lookups see the last
+ * build only. A built table may be read by several threads at once, but
+ * not while it is being rebuilt.
+ */
+
+#ifndef SAV_LPM_H
+#define SAV_LPM_H
+
+#include <stdint.h>
+#include <glib.h>
+#include "sav_collector.h"
+#include "sav_state.h"
+
+/* Leaf ID returned for addresses no prefix covers */
+#define SAV_LPM_NO_MATCH 0
+
+/* How far ahead sav_lpm4_lookup_n() prefetches first-level entries */
+#define SAV_LPM4_PREFETCH_AHEAD 16
+
+/* tbl24 entry flag: the low 31 bits index a tbl8 group, not a leaf */
+#define SAV_LPM4_EXTENDED 0x80000000u
+
+/* Interface index of interfaces no leaf mentions */
+#define SAV_LPM_NO_IFACE UINT32_MAX
+
+/* The interface index is a plain array if the highest interface value is
+ * below this, or below 16 per distinct interface; else a hash */
+#define SAV_LPM_DIRECT_IFACES 65536
+
+/* Addresses the check_n functions look up per lookup_n() call */
+#define SAV_LPM_CHECK_BATCH 256
+
+/* How far ahead the check_n functions prefetch leaves */
+#define SAV_LPM_CHECK_PREFETCH_AHEAD 8
+
+/**
+ * uRPF check modes
+ *
+ * In every mode an interface blocklisting the longest matching prefix
+ * fails the check. Otherwise:
+ */
+typedef enum sav_urpf_mode {
+    SAV_URPF_STRICT   = 0,            /* Interface allowlists the longest matching prefix */
+    SAV_URPF_FEASIBLE = 1,            /* Interface allowlists any prefix covering the source
+                                         (tables built with feasible checks enabled) */
+    SAV_URPF_LOOSE    = 2             /* Some interface allowlists a prefix covering the source */
+} sav_urpf_mode_t;
+
+/**
+ * Set of interface indexes
+ *
+ * Indexes are grouped in blocks of 64 << shift, counted from word first;
+ * bit b of summary says whether block b has members, and only the words
+ * of those blocks are stored, packed in block order. The shift is the
+ * smallest that fits the set in 64 blocks, so a set of a few interfaces
+ * scattered over thousands costs a few words, and membership is still two
+ * reads and a popcount. A set of a single word keeps it inline.
+ */
+typedef struct sav_lpm_ifset {
+    uint64_t        summary;          /* Blocks with members */
+    union {
+        const uint64_t *words;        /* Words of the blocks with members */
+        uint64_t        word;         /* The word, if it is the only one */
+    } data;
+    uint32_t        first;            /* Word of the lowest member */
+    uint8_t         shift;            /* log2 words per block */
+} sav_lpm_ifset_t;
+
+/**
+ * What the longest matching prefix says about a source address
+ *
+ * Leaves are shared by every prefix with the same content. Mappings of
+ * one prefix with the same rule type but different actions keep the
+ * highest action value. Interfaces are listed by their ingress interface
+ * value and, in the sets, by the table's dense interface index. The
+ * inherited list is only built for tables with feasible checks enabled,
+ * and is shared by all leaves under the same covering prefixes.
+ */
+typedef struct sav_lpm_leaf {
+    sav_lpm_ifset_t block_set;        /* Sets and counts first: all a check reads */
+    sav_lpm_ifset_t allow_set;
+    sav_lpm_ifset_t inherited_set;
+    uint32_t        n_allow;
+    uint32_t        n_block;
+    uint32_t        n_inherited;
+    uint8_t         allow_action;     /* savPolicyAction of the allowlist rules */
+    uint8_t         block_action;     /* savPolicyAction of the blocklist rules */
+    uint8_t         covered;          /* The prefix or a covering one is allowlisted */
+    const uint32_t  *allow;           /* Interfaces allowlisting the prefix, ascending */
+    const uint32_t  *block;           /* Interfaces blocklisting the prefix, ascending */
+    const uint32_t  *inherited;       /* Interfaces allowlisting a covering prefix, ascending */
+} sav_lpm_leaf_t;
+
+/**
+ * Dense index of the interfaces named by a set of leaves
+ *
+ * Part of sav_lpm_leafset_t; treat as opaque.
+ */
+typedef struct sav_lpm_ifindex {
+    uint32_t        *direct;          /* Index per interface below n_direct, or NULL */
+    uint32_t        n_direct;
+    uint32_t        *keys;            /* Otherwise a hash: interface per slot */
+    uint32_t        *vals;            /* Index per slot, SAV_LPM_NO_IFACE if free */
+    uint32_t        bits;             /* log2 of the slot count */
+    uint32_t        n;                /* Distinct interfaces */
+} sav_lpm_ifindex_t;
+
+/**
+ * Leaves of a table and the interface index they are built on
+ *
+ * Part of sav_lpm4_t so that checks can be inlined; treat as opaque.
+ */
+typedef struct sav_lpm_leafset {
+    sav_lpm_leaf_t  *leaves;          /* leaves[SAV_LPM_NO_MATCH] is empty */
+    uint32_t        n_leaves;
+    uint32_t        *ifaces;          /* Storage of the leaf lists */
+    size_t          n_list;
+    uint64_t        *words;           /* Storage of the leaf sets */
+    size_t          n_words;
+    sav_lpm_ifindex_t index;          /* Interfaces of the leaves */
+} sav_lpm_leafset_t;
+
+/**
+ * Dense index of an interface
+ *
+ * @param index      Interface index of a built table
+ * @param interface  Ingress interface
+ *
+ * @return Index, SAV_LPM_NO_IFACE if no mapping names the interface
+ */
+static inline uint32_t sav_lpm_iface_index(const sav_lpm_ifindex_t *index, uint32_t interface)
+{
+    if (index->direct) {
+        return interface < index->n_direct ? index->direct[interface] : SAV_LPM_NO_IFACE;
+    }
+
+    uint32_t mask = (1u << index->bits) - 1;
+    uint32_t i = (interface * 0x9E3779B1u) >> (32 - index->bits);
+
+    while (index->vals[i] != SAV_LPM_NO_IFACE && index->keys[i] != interface) {
+        i = (i + 1) & mask;
+    }
+    return index->vals[i];
+}
+
+/**
+ * Test an interface index against a set
+ *
+ * @param set    Set
+ * @param index  Interface index (SAV_LPM_NO_IFACE is never a member)
+ *
+ * @return TRUE if index is a member
+ */
+static inline gboolean sav_lpm_ifset_has(const sav_lpm_ifset_t *set, uint32_t index)
+{
+    uint32_t w = (index >> 6) - set->first;
+    uint32_t blk = w >> set->shift;
+    uint64_t bits;
+
+    if (blk >= 64 || !((set->summary >> blk) & 1)) {
+        return FALSE;
+    }
+    if (set->shift == 0 && (set->summary & (set->summary - 1)) == 0) {
+        bits = set->data.word;
+    } else {
+        uint32_t pos = (uint32_t)__builtin_popcountll(set->summary & ((1ULL << blk) - 1));
+        bits = set->data.words[(pos << set->shift) | (w & ((1u << set->shift) - 1))];
+    }
+    return (bits >> (index & 63)) & 1;
+}
+
+/**
+ * uRPF check of a leaf
+ *
+ * Constant time in the number of interfaces.
+ *
+ * @param leaf   Leaf of the source address
+ * @param index  Interface index of the ingress interface
+ * @param mode   Check mode
+ *
+ * @return TRUE if the source is valid on the interface
+ */
+static inline gboolean sav_lpm_leaf_check(const sav_lpm_leaf_t *leaf, uint32_t index,
+                                          sav_urpf_mode_t mode)
+{
+    if (sav_lpm_ifset_has(&leaf->block_set, index)) {
+        return FALSE;
+    }
+    switch (mode) {
+    case SAV_URPF_STRICT:
+        return sav_lpm_ifset_has(&leaf->allow_set, index);
+    case SAV_URPF_FEASIBLE:
+        return sav_lpm_ifset_has(&leaf->allow_set, index) ||
+               sav_lpm_ifset_has(&leaf->inherited_set, index);
+    default:
+        return leaf->covered;
+    }
+}
+
+/**
+ * Table statistics
+ */
+typedef struct sav_lpm_stats {
+    uint64_t  mappings;               /* Mappings added */
+    uint64_t  prefixes;               /* Distinct prefixes in the last build */
+    uint64_t  leaves;                 /* Distinct leaves in the last build */
+    uint64_t  groups;                 /* IPv4 tbl8 groups, IPv6 trie nodes */
+    uint64_t  interfaces;             /* Distinct interfaces in the last build */
+    size_t    memory_bytes;           /* Lookup structure and leaves */
+} sav_lpm_stats_t;
+
+/**
+ * IPv4 DIR-24-8 table
+ *
+ * Exposed so that lookups and checks can be inlined; treat as opaque.
+ */
+typedef struct sav_lpm4 {
+    uint32_t       *tbl24;            /* 2^24 entries: leaf ID or SAV_LPM4_EXTENDED | group */
+    uint32_t       *tbl8;             /* groups * 256 leaf IDs */
+    uint32_t       groups;
+    sav_lpm_leafset_t leafset;
+    struct sav_lpm4_route *routes;    /* Mappings added so far */
+    size_t         n_routes;
+    size_t         routes_cap;
+    uint64_t       prefixes;          /* Distinct prefixes in the last build */
+    gboolean       feasible;          /* Build inherited interface lists */
+} sav_lpm4_t;
+
+/**
+ * Create an empty IPv4 table
+ *
+ * @return New table (free with sav_lpm4_free())
+ */
+sav_lpm4_t* sav_lpm4_new(void);
+
+/**
+ * Free an IPv4 table
+ *
+ * @param lpm  Table (may be NULL)
+ */
+void sav_lpm4_free(sav_lpm4_t *lpm);
+
+/**
+ * Add one mapping
+ *
+ * Host bits beyond prefix_len are ignored.
+ *
+ * @param lpm            Table
+ * @param prefix         Prefix, host byte order
+ * @param prefix_len     Prefix length (0-32)
+ * @param interface      Ingress interface
+ * @param rule_type      sav_rule_type_t
+ * @param policy_action  sav_policy_action_t
+ *
+ * @return TRUE on success, FALSE if prefix_len or rule_type is invalid
+ */
+gboolean sav_lpm4_add(
+    sav_lpm4_t *lpm,
+    uint32_t   prefix,
+    uint8_t    prefix_len,
+    uint32_t   interface,
+    uint8_t    rule_type,
+    uint8_t    policy_action);
+
+/**
+ * Add the mappings of an IPv4 record (templates 901 and 903)
+ *
+ * IPv6 records are ignored. Invalid mappings are skipped.
+ *
+ * @param lpm     Table
+ * @param record  Record
+ *
+ * @return Number of mappings added
+ */
+uint32_t sav_lpm4_add_record(
+    sav_lpm4_t                *lpm,
+    const sav_parsed_record_t *record);
+
+/**
+ * Add every IPv4 entry of a rule table
+ *
+ * @param lpm    Table
+ * @param state  Rule table
+ *
+ * @return Number of mappings added
+ */
+uint64_t sav_lpm4_add_state(
+    sav_lpm4_t        *lpm,
+    const sav_state_t *state);
+
+/**
+ * Enable or disable feasible uRPF checks (disabled by default)
+ *
+ * Takes effect at the next build. While disabled, leaves have no
+ * inherited interfaces and SAV_URPF_FEASIBLE checks only the longest
+ * matching prefix, like SAV_URPF_STRICT.
+ *
+ * @param lpm      Table
+ * @param enabled  TRUE to keep the interfaces of covering prefixes in leaves
+ */
+void sav_lpm4_set_feasible(
+    sav_lpm4_t *lpm,
+    gboolean   enabled);
+
+/**
+ * Compile the mappings added so far into the lookup tables
+ *
+ * @param lpm  Table
+ * @param err  Error structure
+ *
+ * @return TRUE on success, FALSE if the table is too large
+ */
+gboolean sav_lpm4_build(
+    sav_lpm4_t *lpm,
+    GError     **err);
+
+/**
+ * Look up one address
+ *
+ * @param lpm   Built table
+ * @param addr  Source address, host byte order
+ *
+ * @return Leaf ID, SAV_LPM_NO_MATCH if no prefix covers addr
+ */
+static inline uint32_t sav_lpm4_lookup(const sav_lpm4_t *lpm, uint32_t addr)
+{
+    uint32_t e = lpm->tbl24[addr >> 8];
+    if (e & SAV_LPM4_EXTENDED) {
+        e = lpm->tbl8[((size_t)(e & ~SAV_LPM4_EXTENDED) << 8) | (addr & 0xFF)];
+    }
+    return e;
+}
+
+/**
+ * Look up many addresses
+ *
+ * Prefetches the first-level entry of the address
+ * SAV_LPM4_PREFETCH_AHEAD positions ahead while resolving the current one,
+ * so the cache misses of consecutive lookups overlap.
+ *
+ * @param lpm     Built table
+ * @param addrs   Source addresses, host byte order
+ * @param n       Number of addresses
+ * @param leaves  Output: leaf ID per address
+ */
+void sav_lpm4_lookup_n(
+    const sav_lpm4_t *lpm,
+    const uint32_t   *addrs,
+    uint32_t         n,
+    uint32_t         *leaves);
+
+/**
+ * Leaf of a leaf ID
+ *
+ * @param lpm      Built table
+ * @param leaf_id  ID from a lookup
+ *
+ * @return Leaf (empty for SAV_LPM_NO_MATCH), valid until the next build
+ */
+static inline const sav_lpm_leaf_t* sav_lpm4_leaf(const sav_lpm4_t *lpm, uint32_t leaf_id)
+{
+    return &lpm->leafset.leaves[leaf_id];
+}
+
+/**
+ * Is a source address valid on an ingress interface?
+ *
+ * @param lpm        Built table
+ * @param addr       Source address, host byte order
+ * @param interface  Ingress interface
+ * @param mode       Check mode
+ *
+ * @return TRUE if valid
+ */
+static inline gboolean sav_lpm4_check(const sav_lpm4_t *lpm, uint32_t addr, uint32_t interface,
+                                      sav_urpf_mode_t mode)
+{
+    return sav_lpm_leaf_check(sav_lpm4_leaf(lpm, sav_lpm4_lookup(lpm, addr)),
+                              sav_lpm_iface_index(&lpm->leafset.index, interface), mode);
+}
+
+/**
+ * Check many source addresses
+ *
+ * Looks the addresses up with sav_lpm4_lookup_n().
+ *
+ * @param lpm         Built table
+ * @param addrs       Source addresses, host byte order
+ * @param interfaces  Ingress interface per address
+ * @param n           Number of addresses
+ * @param mode        Check mode
+ * @param valid       Output: 1 if valid, 0 if not, per address
+ */
+void sav_lpm4_check_n(
+    const sav_lpm4_t *lpm,
+    const uint32_t   *addrs,
+    const uint32_t   *interfaces,
+    uint32_t         n,
+    sav_urpf_mode_t  mode,
+    uint8_t          *valid);
+
+/**
+ * Table statistics
+ *
+ * @param lpm    Table
+ * @param stats  Output statistics
+ */
+void sav_lpm4_get_stats(
+    const sav_lpm4_t *lpm,
+    sav_lpm_stats_t  *stats);
+
+/* Addresses sav_lpm6_lookup_n() walks down the trie together */
+#define SAV_LPM6_LOOKUP_BATCH 8
+
+/**
+ * IPv6 poptrie
+ */
+typedef struct sav_lpm6 sav_lpm6_t;
+
+/**
+ * Create an empty IPv6 table
+ *
+ * @return New table (free with sav_lpm6_free())
+ */
+sav_lpm6_t* sav_lpm6_new(void);
+
+/**
+ * Free an IPv6 table
+ *
+ * @param lpm  Table (may be NULL)
+ */
+void sav_lpm6_free(sav_lpm6_t *lpm);
+
+/**
+ * Add one mapping
+ *
+ * Host bits beyond prefix_len are ignored.
+ *
+ * @param lpm            Table
+ * @param prefix         Prefix, 16 bytes in network byte order
+ * @param prefix_len     Prefix length (0-128)
+ * @param interface      Ingress interface
+ * @param rule_type      sav_rule_type_t
+ * @param policy_action  sav_policy_action_t
+ *
+ * @return TRUE on success, FALSE if prefix_len or rule_type is invalid
+ */
+gboolean sav_lpm6_add(
+    sav_lpm6_t    *lpm,
+    const uint8_t *prefix,
+    uint8_t       prefix_len,
+    uint32_t      interface,
+    uint8_t       rule_type,
+    uint8_t       policy_action);
+
+/**
+ * Add the mappings of an IPv6 record (templates 902 and 904)
+ *
+ * IPv4 records are ignored. Invalid mappings are skipped.
+ *
+ * @param lpm     Table
+ * @param record  Record
+ *
+ * @return Number of mappings added
+ */
+uint32_t sav_lpm6_add_record(
+    sav_lpm6_t                *lpm,
+    const sav_parsed_record_t *record);
+
+/**
+ * Add every IPv6 entry of a rule table
+ *
+ * @param lpm    Table
+ * @param state  Rule table
+ *
+ * @return Number of mappings added
+ */
+uint64_t sav_lpm6_add_state(
+    sav_lpm6_t        *lpm,
+    const sav_state_t *state);
+
+/**
+ * Enable or disable feasible uRPF checks (disabled by default)
+ *
+ * Takes effect at the next build. While disabled, leaves have no
+ * inherited interfaces and SAV_URPF_FEASIBLE checks only the longest
+ * matching prefix, like SAV_URPF_STRICT.
+ *
+ * @param lpm      Table
+ * @param enabled  TRUE to keep the interfaces of covering prefixes in leaves
+ */
+void sav_lpm6_set_feasible(
+    sav_lpm6_t *lpm,
+    gboolean   enabled);
+
+/**
+ * Compile the mappings added so far into the trie
+ *
+ * @param lpm  Table
+ * @param err  Error structure
+ *
+ * @return TRUE on success, FALSE if the table is too large
+ */
+gboolean sav_lpm6_build(
+    sav_lpm6_t *lpm,
+    GError     **err);
+
+/**
+ * Look up one address
+ *
+ * @param lpm   Built table
+ * @param addr  Source address, 16 bytes in network byte order
+ *
+ * @return Leaf ID, SAV_LPM_NO_MATCH if no prefix covers addr
+ */
+uint32_t sav_lpm6_lookup(
+    const sav_lpm6_t *lpm,
+    const uint8_t    *addr);
+
+/**
+ * Look up many addresses
+ *
+ * Walks SAV_LPM6_LOOKUP_BATCH addresses down the trie in lockstep,
+ * prefetching each one's next node before moving on to the others, so
+ * the dependent node reads of different addresses overlap.
+ *
+ * @param lpm     Built table
+ * @param addrs   n source addresses of 16 bytes each, network byte order
+ * @param n       Number of addresses
+ * @param leaves  Output: leaf ID per address
+ */
+void sav_lpm6_lookup_n(
+    const sav_lpm6_t *lpm,
+    const uint8_t    *addrs,
+    uint32_t         n,
+    uint32_t         *leaves);
+
+/**
+ * Leaf of a leaf ID
+ *
+ * @param lpm      Built table
+ * @param leaf_id  ID from a lookup
+ *
+ * @return Leaf (empty for SAV_LPM_NO_MATCH), valid until the next build
+ */
+const sav_lpm_leaf_t* sav_lpm6_leaf(
+    const sav_lpm6_t *lpm,
+    uint32_t         leaf_id);
+
+/**
+ * Is a source address valid on an ingress interface?
+ *
+ * @param lpm        Built table
+ * @param addr       Source address, 16 bytes in network byte order
+ * @param interface  Ingress interface
+ * @param mode       Check mode
+ *
+ * @return TRUE if valid
+ */
+gboolean sav_lpm6_check(
+    const sav_lpm6_t *lpm,
+    const uint8_t    *addr,
+    uint32_t         interface,
+    sav_urpf_mode_t  mode);
+
+/**
+ * Check many source addresses
+ *
+ * Looks the addresses up with sav_lpm6_lookup_n().
+ *
+ * @param lpm         Built table
+ * @param addrs       n source addresses of 16 bytes each, network byte order
+ * @param interfaces  Ingress interface per address
+ * @param n           Number of addresses
+ * @param mode        Check mode
+ * @param valid       Output: 1 if valid, 0 if not, per address
+ */
+void sav_lpm6_check_n(
+    const sav_lpm6_t *lpm,
+    const uint8_t    *addrs,
+    const uint32_t   *interfaces,
+    uint32_t         n,
+    sav_urpf_mode_t  mode,
+    uint8_t          *valid);
+
+/**
+ * Table statistics
+ *
+ * @param lpm    Table
+ * @param stats  Output statistics
+ */
+void sav_lpm6_get_stats(
+    const sav_lpm6_t *lpm,
+    sav_lpm_stats_t  *stats);
+
+#endif /* SAV_LPM_H */
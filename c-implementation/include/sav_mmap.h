@@ -0,0 +1,100 @@
+/**
+ * @file sav_mmap.h
+ * @brief Memory-mapped IPFIX message source
+ * 
+ * Maps an IPFIX file read-only and walks its messages in place, so the
+ * fast-path decoder reads records straight out of the page cache without
+ * any intermediate copy.
+ */
+
+#ifndef SAV_MMAP_H
+#define SAV_MMAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <glib.h>
+
+/* Readahead window used with SAV_MMAP_READAHEAD (multiple of 2 MiB so the
+ * hint lines up with transparent huge pages) */
+#define SAV_MMAP_READAHEAD_WINDOW (8 * 1024 * 1024)
+
+/* Mapping options for sav_mmap_open() */
+typedef enum {
+    SAV_MMAP_DEFAULT   = 0,           /* madvise(MADV_SEQUENTIAL) only */
+    SAV_MMAP_READAHEAD = 1 << 0,      /* Prefetch a window ahead of the reader */
+    SAV_MMAP_HUGEPAGE  = 1 << 1,      /* Request huge pages where supported */
+    SAV_MMAP_DROP_BEHIND = 1 << 2     /* Drop consumed pages from the page cache */
+} sav_mmap_flags_t;
+
+/**
+ * SAV Mapped File
+ */
+typedef struct sav_mmap_file {
+    int            fd;                /* File descriptor */
+    const uint8_t  *base;             /* Start of mapping */
+    size_t         len;               /* File length */
+    size_t         off;               /* Offset of the next message */
+    size_t         ra_next;           /* End of the range already prefetched */
+    size_t         dropped;           /* End of the range already dropped */
+    unsigned       flags;             /* sav_mmap_flags_t */
+    gboolean       borrowed;          /* Range of another mapping, not unmapped on close */
+} sav_mmap_file_t;
+
+/**
+ * Map an IPFIX file read-only
+ * 
+ * @param mf        Mapped file state to initialize
+ * @param filename  Path to IPFIX file
+ * @param flags     Combination of sav_mmap_flags_t
+ * @param err       Error structure
+ * 
+ * @return TRUE on success, FALSE on error
+ */
+gboolean sav_mmap_open(
+    sav_mmap_file_t *mf,
+    const char      *filename,
+    unsigned        flags,
+    GError          **err);
+
+/**
+ * Return the next complete IPFIX message in place
+ * 
+ * @param mf       Mapped file
+ * @param msg      Output: message start (inside the mapping)
+ * @param msg_len  Output: message length
+ * @param err      Error structure
+ * 
+ * @return TRUE if a message was returned; FALSE with err unset at end of
+ *         file, or with err set if the file is truncated or malformed
+ */
+gboolean sav_mmap_next_message(
+    sav_mmap_file_t *mf,
+    const uint8_t   **msg,
+    size_t          *msg_len,
+    GError          **err);
+
+/**
+ * Set up a borrowed view of a byte range of an existing mapping
+ * 
+ * The range must start and end on message boundaries. sav_mmap_close() on
+ * the borrowed view leaves the parent mapping untouched.
+ * 
+ * @param mf      Borrowed view to initialize
+ * @param parent  Mapping that owns the memory
+ * @param start   Offset of the first message
+ * @param end     Offset just past the last message
+ */
+void sav_mmap_borrow_range(
+    sav_mmap_file_t       *mf,
+    const sav_mmap_file_t *parent,
+    size_t                start,
+    size_t                end);
+
+/**
+ * Unmap and close a mapped file
+ * 
+ * @param mf  Mapped file
+ */
+void sav_mmap_close(sav_mmap_file_t *mf);
+
+#endif /* SAV_MMAP_H */
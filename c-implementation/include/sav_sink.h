@@ -0,0 +1,166 @@
+/**
+ * @file sav_sink.h
+ * @brief Output sinks for parsed SAV records
+ *
+ * A sink turns a stream of sav_parsed_record_t into one output format on a
+ * FILE: the human-readable text of sav_print_record(), a JSON array
+ * (pretty or compact), NDJSON, or a length-prefixed binary layout that can
+ * be consumed without parsing. Tools create one sink, write records as they
+ * are read and finish it once; the sink writes any stream header and
+ * trailer itself.
+ *
+ * Binary layout (SAV_SINK_BINARY)
+ *
+ * All integers are little-endian and prefixes are in network byte order.
+ * Values are those of the parsed record, as libfixbuf decodes them: the
+ * interface is written as the host-order integer and the IPv4 prefix is
+ * converted from its host-order integer to address bytes. The structs below have no
+ * implicit padding and every record starts 8-byte aligned, so a mapped
+ * file can be read through them directly on little-endian hosts.
+ *
+ *   stream:   sav_binary_stream_header_t, then records until EOF
+ *   record:   sav_binary_record_header_t, then mapping_count entries of
+ *             sav_binary_ipv4_entry_t (family 4) or sav_binary_ipv6_entry_t
+ *             (family 6), then zero bytes up to a multiple of 8; family 0
+ *             records carry no entries
+ *
+ * record_length counts the bytes after the record_length field itself,
+ * padding included, so a reader can skip a record without looking at its
+ * contents.
+ */
+
+#ifndef SAV_SINK_H
+#define SAV_SINK_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <glib.h>
+#include "sav_collector.h"
+
+/* Binary stream magic and version */
+#define SAV_BINARY_MAGIC    "SAVB"
+#define SAV_BINARY_VERSION  1
+
+/**
+ * Binary stream header (8 bytes)
+ */
+typedef struct sav_binary_stream_header {
+    char      magic[4];               /* SAV_BINARY_MAGIC */
+    uint16_t  version;                /* SAV_BINARY_VERSION */
+    uint16_t  reserved;               /* 0 */
+} sav_binary_stream_header_t;
+
+/**
+ * Binary record header (24 bytes)
+ */
+typedef struct sav_binary_record_header {
+    uint32_t  record_length;          /* Bytes following this field */
+    uint16_t  sub_template_id;        /* SubTemplateList template ID */
+    uint8_t   rule_type;              /* SAV rule type */
+    uint8_t   target_type;            /* SAV target type */
+    uint8_t   policy_action;          /* Policy action */
+    uint8_t   family;                 /* 4, 6, or 0 for an unknown template */
+    uint16_t  reserved;               /* 0 */
+    uint32_t  mapping_count;          /* Entries following the header */
+    uint64_t  timestamp_ms;           /* Observation time in milliseconds */
+} sav_binary_record_header_t;
+
+/**
+ * Binary IPv4 mapping (12 bytes)
+ */
+typedef struct sav_binary_ipv4_entry {
+    uint32_t  interface_id;           /* ingressInterface */
+    uint8_t   prefix[4];              /* sourceIPv4Prefix, network order */
+    uint8_t   prefix_length;          /* sourceIPv4PrefixLength */
+    uint8_t   reserved[3];            /* 0 */
+} sav_binary_ipv4_entry_t;
+
+/**
+ * Binary IPv6 mapping (24 bytes)
+ */
+typedef struct sav_binary_ipv6_entry {
+    uint32_t  interface_id;           /* ingressInterface */
+    uint8_t   prefix[16];             /* sourceIPv6Prefix */
+    uint8_t   prefix_length;          /* sourceIPv6PrefixLength */
+    uint8_t   reserved[3];            /* 0 */
+} sav_binary_ipv6_entry_t;
+
+/**
+ * Output format of a sink
+ */
+typedef enum sav_sink_format {
+    SAV_SINK_TEXT = 0,                /* sav_print_record() with record numbers */
+    SAV_SINK_JSON,                    /* Pretty JSON array */
+    SAV_SINK_JSON_COMPACT,            /* Compact JSON array */
+    SAV_SINK_NDJSON,                  /* One compact JSON object per line */
+    SAV_SINK_BINARY                   /* Length-prefixed binary layout */
+} sav_sink_format_t;
+
+typedef struct sav_sink sav_sink_t;
+
+/**
+ * Create an output sink
+ *
+ * Nothing is written until the first record or sav_sink_finish().
+ *
+ * @param output  Destination stream (not closed by the sink)
+ * @param format  Output format
+ * @param err     Error structure
+ *
+ * @return New sink, or NULL on error
+ */
+sav_sink_t* sav_sink_new(
+    FILE              *output,
+    sav_sink_format_t format,
+    GError            **err);
+
+/**
+ * Write one record
+ *
+ * Output is buffered; errors of earlier buffered writes are reported by
+ * the first call after they happen.
+ *
+ * @param sink    Sink
+ * @param record  Record to write
+ * @param err     Error structure
+ *
+ * @return TRUE on success, FALSE on write error
+ */
+gboolean sav_sink_write(
+    sav_sink_t                *sink,
+    const sav_parsed_record_t *record,
+    GError                    **err);
+
+/**
+ * Write the stream trailer and hand all buffered output to the stream
+ *
+ * Call once after the last record. The stream itself is not fflush()ed.
+ *
+ * @param sink  Sink
+ * @param err   Error structure
+ *
+ * @return TRUE on success, FALSE if any write failed
+ */
+gboolean sav_sink_finish(
+    sav_sink_t *sink,
+    GError     **err);
+
+/**
+ * Number of records written to a sink
+ *
+ * @param sink  Sink
+ *
+ * @return Record count
+ */
+uint64_t sav_sink_record_count(const sav_sink_t *sink);
+
+/**
+ * Free a sink
+ *
+ * Output not yet handed over by sav_sink_finish() is discarded.
+ *
+ * @param sink  Sink to free (may be NULL)
+ */
+void sav_sink_free(sav_sink_t *sink);
+
+#endif /* SAV_SINK_H */
@@ -0,0 +1,243 @@
+/**
+ * @file sav_snapshot.h
+ * @brief Persistent, memory-mapped snapshots of the SAV rule table
+ *
+ * A snapshot file holds every entry of a sav_state_t (see sav_state.h)
+ * laid out for querying in place: a fixed header, the entries sorted by
+ * interface and key, and a directory of interfaces with the first entry
+ * and entry count of each. sav_snapshot_open() maps the file read-only
+ * and checks the header and the directory; nothing is decoded or copied,
+ * so opening costs about the same whatever the table size and processes
+ * that open the same file share its pages through the page cache.
+ *
+ * Files are in host byte order and alignment; the header records both,
+ * and a file written on a host with a different layout is rejected.
+ * sav_snapshot_write() writes to a temporary file next to the target and
+ * renames it over the target once it is on disk, so readers see either
+ * the old snapshot or the new one. A reader that keeps a file open keeps
+ * the snapshot it mapped after a newer one replaces it.
+ *
+ * Typical use: a collector writes a snapshot periodically and on
+ * shutdown; on restart it answers queries from the snapshot at once and,
+ * to continue updating, loads it into a table with sav_snapshot_load()
+ * before applying records newer than sav_snapshot_updated_ms().
+ */
+
+#ifndef SAV_SNAPSHOT_H
+#define SAV_SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <glib.h>
+#include "sav_state.h"
+
+/* "SAVS" */
+#define SAV_SNAPSHOT_MAGIC     0x53415653u
+
+/* Version of the file layout written by this library */
+#define SAV_SNAPSHOT_VERSION   1
+
+/**
+ * One entry as stored in the file
+ *
+ * Fields as in sav_state_entry_t, reordered so that the record has no
+ * implicit padding.
+ */
+typedef struct sav_snapshot_entry {
+    uint64_t  updated_ms;             /* observationTimeMilliseconds of the last update */
+    uint32_t  interface;              /* ingressInterface */
+    uint8_t   family;                 /* 4 or 6 */
+    uint8_t   prefix_len;
+    uint8_t   target_type;            /* sav_target_type_t */
+    uint8_t   rule_type;              /* sav_rule_type_t */
+    uint8_t   policy_action;          /* sav_policy_action_t */
+    uint8_t   reserved[7];            /* Zero */
+    uint8_t   prefix[16];             /* Network byte order; IPv4 uses the first 4 bytes */
+} sav_snapshot_entry_t;
+
+/**
+ * Directory entry: the entries of one interface
+ */
+typedef struct sav_snapshot_iface {
+    uint32_t  interface;
+    uint32_t  count;                  /* Entries of the interface */
+    uint64_t  first;                  /* Index of its first entry */
+} sav_snapshot_iface_t;
+
+/**
+ * File header, at offset 0
+ */
+typedef struct sav_snapshot_header {
+    uint32_t  magic;                  /* SAV_SNAPSHOT_MAGIC, in host byte order */
+    uint16_t  version;                /* SAV_SNAPSHOT_VERSION */
+    uint16_t  header_size;            /* sizeof(sav_snapshot_header_t) */
+    uint16_t  entry_size;             /* sizeof(sav_snapshot_entry_t) */
+    uint16_t  iface_size;             /* sizeof(sav_snapshot_iface_t) */
+    uint32_t  reserved;               /* Zero */
+    uint64_t  generation;             /* Set by the writer, e.g. a sequence number */
+    uint64_t  created_ms;             /* Wall clock time of the write */
+    uint64_t  updated_ms;             /* Latest updated_ms of any entry */
+    uint64_t  n_entries;
+    uint64_t  n_ifaces;
+    uint64_t  entries_offset;         /* Multiple of 8 */
+    uint64_t  ifaces_offset;          /* Multiple of 8 */
+    uint64_t  file_size;
+} sav_snapshot_header_t;
+
+/**
+ * Open snapshot
+ */
+typedef struct sav_snapshot {
+    const uint8_t               *base;        /* Start of the mapping */
+    size_t                      len;
+    const sav_snapshot_header_t *header;
+    const sav_snapshot_entry_t  *entries;     /* Sorted by interface, then key */
+    const sav_snapshot_iface_t  *ifaces;      /* Sorted by interface */
+} sav_snapshot_t;
+
+/**
+ * Write a table to a snapshot file
+ *
+ * Replaces path atomically (temporary file, fsync, rename). The file is
+ * created with mode 0644 less the process umask, like fopen() would.
+ *
+ * @param state       Table
+ * @param path        Output file
+ * @param generation  Stored in the header, returned by sav_snapshot_generation()
+ * @param err         Error structure
+ *
+ * @return TRUE on success, FALSE on error (path is left unchanged)
+ */
+gboolean sav_snapshot_write(
+    const sav_state_t *state,
+    const char        *path,
+    uint64_t          generation,
+    GError            **err);
+
+/**
+ * Map a snapshot file read-only
+ *
+ * Checks the header, the section bounds and the directory; the entries
+ * themselves are not read.
+ *
+ * @param path  Snapshot file
+ * @param err   Error structure
+ *
+ * @return Open snapshot (close with sav_snapshot_close()), or NULL on error
+ */
+sav_snapshot_t* sav_snapshot_open(
+    const char *path,
+    GError     **err);
+
+/**
+ * Unmap a snapshot
+ *
+ * Entries returned by the other functions become invalid.
+ *
+ * @param snap  Snapshot (may be NULL)
+ */
+void sav_snapshot_close(sav_snapshot_t *snap);
+
+/**
+ * Number of entries
+ *
+ * @param snap  Snapshot
+ *
+ * @return Entries; sav_snapshot_t.entries holds them all
+ */
+uint64_t sav_snapshot_count(const sav_snapshot_t *snap);
+
+/**
+ * Generation stored by the writer
+ *
+ * @param snap  Snapshot
+ *
+ * @return Generation
+ */
+uint64_t sav_snapshot_generation(const sav_snapshot_t *snap);
+
+/**
+ * Latest observationTimeMilliseconds of any entry
+ *
+ * Records up to this time are reflected in the snapshot.
+ *
+ * @param snap  Snapshot
+ *
+ * @return Time in milliseconds, 0 for an empty snapshot
+ */
+uint64_t sav_snapshot_updated_ms(const sav_snapshot_t *snap);
+
+/**
+ * Look up an entry by key
+ *
+ * Binary search over the interface's entries.
+ *
+ * @param snap  Snapshot
+ * @param key   Entry whose key fields are looked up (value fields ignored)
+ *
+ * @return Entry inside the mapping, or NULL if not found
+ */
+const sav_snapshot_entry_t* sav_snapshot_find(
+    const sav_snapshot_t    *snap,
+    const sav_state_entry_t *key);
+
+/**
+ * Entries of one interface
+ *
+ * IPv4 entries come first, each family ordered by prefix, then prefix
+ * length, then target type.
+ *
+ * @param snap       Snapshot
+ * @param interface  ingressInterface
+ * @param count      Output: number of entries
+ *
+ * @return First entry inside the mapping, or NULL (count 0) if the
+ *         interface has none
+ */
+const sav_snapshot_entry_t* sav_snapshot_interface(
+    const sav_snapshot_t *snap,
+    uint32_t             interface,
+    size_t               *count);
+
+/**
+ * Order of the entries of a snapshot file
+ *
+ * Interface, then family, prefix, prefix length and target type; two
+ * sorted files can be compared in one merge pass.
+ *
+ * @param a  Entry
+ * @param b  Entry
+ *
+ * @return Negative, zero or positive as a sorts before, with or after b
+ */
+int sav_snapshot_entry_cmp(
+    const sav_snapshot_entry_t *a,
+    const sav_snapshot_entry_t *b);
+
+/**
+ * Convert a stored entry to a table entry
+ *
+ * @param entry  Stored entry
+ * @param out    Output entry
+ */
+void sav_snapshot_entry_get(
+    const sav_snapshot_entry_t *entry,
+    sav_state_entry_t          *out);
+
+/**
+ * Insert every entry of a snapshot into a table
+ *
+ * Entries replace those with the same key already in the table. Entries
+ * with a family other than 4 or 6, or a prefix length beyond it, are
+ * skipped; compare the result with header->n_entries to detect them.
+ *
+ * @param snap   Snapshot
+ * @param state  Table
+ *
+ * @return Entries inserted or replaced
+ */
+uint64_t sav_snapshot_load(
+    const sav_snapshot_t *snap,
+    sav_state_t          *state);
+
+#endif /* SAV_SNAPSHOT_H */
@@ -0,0 +1,171 @@
+/**
+ * @file sav_state.h
+ * @brief Live SAV rule table built from a stream of records
+ *
+ * The collector yields independent records; sav_state_t folds them into
+ * the table a router would hold. Every mapping of an applied record
+ * becomes (or updates) one entry keyed by
+ *
+ *   (target type, ingress interface, address family, prefix, prefix length)
+ *
+ * whose value is the rule type, policy action and time of the record that
+ * last mentioned it. A later mapping with the same key replaces the value,
+ * so re-announcing a prefix on an interface as blocklisted turns the
+ * existing allowlist entry into a blocklist one. Interface-based and
+ * prefix-based rules are kept apart (the target type is part of the key).
+ *
+ * Entries live in one open-addressing hash table per family, so insert,
+ * replace, lookup and remove take expected O(1) time. IPv4 entries take
+ * 24 bytes and IPv6 entries 32 bytes per slot; tables are kept at most
+ * 3/4 full. sav_state_get_stats() reports the memory in use.
+ *
+ * A sav_state_t is not thread-safe.
+ */
+
+#ifndef SAV_STATE_H
+#define SAV_STATE_H
+
+#include <stdint.h>
+#include <glib.h>
+#include "sav_collector.h"
+
+typedef struct sav_state sav_state_t;
+
+/**
+ * One table entry
+ *
+ * The first five fields are the key. prefix is in network byte order;
+ * IPv4 prefixes use its first 4 bytes and leave the rest zero.
+ */
+typedef struct sav_state_entry {
+    uint8_t   target_type;          /* sav_target_type_t */
+    uint8_t   family;               /* 4 or 6 */
+    uint8_t   prefix_len;           /* Prefix length */
+    uint32_t  interface;            /* ingressInterface */
+    uint8_t   prefix[16];           /* Prefix, network byte order */
+
+    uint8_t   rule_type;            /* sav_rule_type_t */
+    uint8_t   policy_action;        /* sav_policy_action_t */
+    uint64_t  updated_ms;           /* observationTimeMilliseconds of the last update */
+} sav_state_entry_t;
+
+/**
+ * Table statistics
+ */
+typedef struct sav_state_stats {
+    uint64_t  records;              /* Records applied */
+    uint64_t  inserts;              /* Mappings that added an entry */
+    uint64_t  replaces;             /* Mappings that updated an existing entry */
+    uint64_t  rejected;             /* Invalid mappings skipped (see sav_validate.h) */
+    uint64_t  ipv4_entries;         /* Live IPv4 entries */
+    uint64_t  ipv6_entries;         /* Live IPv6 entries */
+    size_t    memory_bytes;         /* Heap memory held by the table */
+} sav_state_stats_t;
+
+/**
+ * Callback for sav_state_foreach()
+ *
+ * @param entry  Entry (valid only during the call)
+ * @param user   User data
+ */
+typedef void (*sav_state_fn)(const sav_state_entry_t *entry, void *user);
+
+/**
+ * Create an empty table
+ *
+ * @return New table (free with sav_state_free())
+ */
+sav_state_t* sav_state_new(void);
+
+/**
+ * Free a table
+ *
+ * @param state  Table to free (may be NULL)
+ */
+void sav_state_free(sav_state_t *state);
+
+/**
+ * Apply every mapping of a record
+ *
+ * Mappings that fail batch validation (bad length or host bits set) are
+ * skipped and counted as rejected; the others are inserted or replace the
+ * entry with the same key.
+ *
+ * @param state   Table
+ * @param record  Record to apply
+ * @param err     Error structure
+ *
+ * @return TRUE on success, FALSE if the record itself is invalid
+ *         (see sav_validate_record_header())
+ */
+gboolean sav_state_apply_record(
+    sav_state_t               *state,
+    const sav_parsed_record_t *record,
+    GError                    **err);
+
+/**
+ * Insert an entry or replace the value of the entry with its key
+ *
+ * The entry is stored as given; callers are responsible for a valid
+ * family and prefix length.
+ *
+ * @param state  Table
+ * @param entry  Entry
+ *
+ * @return TRUE if a new entry was added, FALSE if one was replaced
+ */
+gboolean sav_state_upsert(
+    sav_state_t             *state,
+    const sav_state_entry_t *entry);
+
+/**
+ * Look up an entry by key
+ *
+ * @param state  Table
+ * @param key    Entry whose key fields are looked up (value fields ignored)
+ * @param out    Output: the stored entry (may be NULL)
+ *
+ * @return TRUE if found
+ */
+gboolean sav_state_lookup(
+    const sav_state_t       *state,
+    const sav_state_entry_t *key,
+    sav_state_entry_t       *out);
+
+/**
+ * Remove an entry by key
+ *
+ * @param state  Table
+ * @param key    Entry whose key fields identify the entry to remove
+ *
+ * @return TRUE if an entry was removed
+ */
+gboolean sav_state_remove(
+    sav_state_t             *state,
+    const sav_state_entry_t *key);
+
+/**
+ * Call fn for every entry, IPv4 first, in no particular order
+ *
+ * The table must not be modified during the walk.
+ *
+ * @param state  Table
+ * @param fn     Callback
+ * @param user   User data passed to fn
+ */
+void sav_state_foreach(
+    const sav_state_t *state,
+    sav_state_fn      fn,
+    void              *user);
+
+/**
+ * Table statistics
+ *
+ * @param state  Table
+ * @param stats  Output statistics
+ */
+void sav_state_get_stats(
+    const sav_state_t *state,
+    sav_state_stats_t *stats);
+
+#endif /* SAV_STATE_H */
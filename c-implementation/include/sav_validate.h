@@ -0,0 +1,130 @@
+/**
+ * @file sav_validate.h
+ * @brief Batch validation of SAV mapping arrays
+ *
+ * Checks a whole mapping array at once and marks every bad entry in a
+ * bitmap instead of stopping at the first one. A mapping is bad if its
+ * prefix length exceeds the family maximum (32 or 128) or if its prefix
+ * has host bits set beyond that length (e.g. 10.0.0.1/24).
+ *
+ * On x86 the kernels use SSE4.1 or AVX2 when the CPU supports them; the
+ * choice is made once at first use. Every implementation produces the
+ * same bitmap as the scalar one.
+ */
+
+#ifndef SAV_VALIDATE_H
+#define SAV_VALIDATE_H
+
+#include <stdint.h>
+#include <glib.h>
+#include "sav_collector.h"
+
+/* 64-bit words of a bitmap covering count mappings */
+#define SAV_VALIDATE_BITMAP_WORDS(count) (((size_t)(count) + 63) / 64)
+
+/**
+ * Kernel implementations
+ */
+typedef enum {
+    SAV_VALIDATE_IMPL_SCALAR = 0,
+    SAV_VALIDATE_IMPL_SSE41  = 1,
+    SAV_VALIDATE_IMPL_AVX2   = 2
+} sav_validate_impl_t;
+
+/**
+ * Validate IPv4 mappings
+ *
+ * Bit i of bad (bad[i / 64] >> (i % 64)) is set if mappings[i] is bad.
+ * All SAV_VALIDATE_BITMAP_WORDS(count) words are written; bits at and
+ * beyond count are zero. sourceIPv4Prefix is in host order, as in
+ * records read by the collector.
+ *
+ * @param mappings  Mapping array
+ * @param count     Number of mappings
+ * @param bad       Output bitmap of SAV_VALIDATE_BITMAP_WORDS(count) words
+ *
+ * @return Number of bad mappings
+ */
+uint32_t sav_validate_ipv4_mappings(
+    const sav_ipv4_mapping_t *mappings,
+    uint32_t                 count,
+    uint64_t                 *bad);
+
+/**
+ * Validate IPv6 mappings
+ *
+ * Same contract as sav_validate_ipv4_mappings().
+ *
+ * @param mappings  Mapping array
+ * @param count     Number of mappings
+ * @param bad       Output bitmap of SAV_VALIDATE_BITMAP_WORDS(count) words
+ *
+ * @return Number of bad mappings
+ */
+uint32_t sav_validate_ipv6_mappings(
+    const sav_ipv6_mapping_t *mappings,
+    uint32_t                 count,
+    uint64_t                 *bad);
+
+/**
+ * Validate the mappings of a record
+ *
+ * Picks the IPv4 or IPv6 kernel from the record's sub-template. Records
+ * with an unknown sub-template have no readable mappings; their bitmap
+ * is cleared and 0 is returned (sav_validate_record_header() rejects
+ * them).
+ *
+ * @param record  Record to validate
+ * @param bad     Output bitmap of SAV_VALIDATE_BITMAP_WORDS(mapping_count) words
+ *
+ * @return Number of bad mappings
+ */
+uint32_t sav_validate_record_mappings(
+    const sav_parsed_record_t *record,
+    uint64_t                  *bad);
+
+/**
+ * Validate the record-level fields of a record
+ *
+ * Checks the rule_type, target_type and policy_action values and the
+ * sub-template ID, i.e. everything sav_validate_record() checks except
+ * the mappings.
+ *
+ * @param record  Record to validate
+ * @param err     Error structure (populated if validation fails)
+ *
+ * @return TRUE if valid, FALSE otherwise
+ */
+gboolean sav_validate_record_header(
+    const sav_parsed_record_t *record,
+    GError                    **err);
+
+/**
+ * Implementation in use
+ *
+ * @return Best implementation the CPU supports, unless overridden with
+ *         sav_validate_set_impl()
+ */
+sav_validate_impl_t sav_validate_get_impl(void);
+
+/**
+ * Override the implementation (for tests and benchmarks)
+ *
+ * Not thread-safe: call it before validating from several threads.
+ *
+ * @param impl  Implementation to use
+ *
+ * @return TRUE if selected, FALSE if this CPU or build does not support it
+ */
+gboolean sav_validate_set_impl(sav_validate_impl_t impl);
+
+/**
+ * Name of an implementation ("scalar", "sse4.1" or "avx2")
+ *
+ * @param impl  Implementation
+ *
+ * @return Static string
+ */
+const char* sav_validate_impl_name(sav_validate_impl_t impl);
+
+#endif /* SAV_VALIDATE_H */
@@ -0,0 +1,95 @@
+/**
+ * @file sav_wire_writer.h
+ * @brief Direct encoder for SAV IPFIX messages
+ *
+ * Builds IPFIX messages carrying template 400 records straight into a
+ * caller-supplied buffer, without a libfixbuf session. Intended for
+ * network load generators and transport tests that need complete
+ * messages of a bounded size (e.g. one per UDP datagram) and full control
+ * over sequence numbers. The layouts are the ones the fast decoder
+ * verifies (see sav_fast_decoder.h), so the output is readable by every
+ * collector.
+ */
+
+#ifndef SAV_WIRE_WRITER_H
+#define SAV_WIRE_WRITER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "sav_collector.h"
+
+/**
+ * SAV Wire Writer
+ *
+ * Message under construction plus the exporter's sequence state.
+ */
+typedef struct sav_wire_writer {
+    uint8_t   *buf;                   /* Message buffer (caller-owned) */
+    size_t    cap;                    /* Capacity of buf (at most 65535 is used) */
+    size_t    len;                    /* Bytes of the open message, 0 = none */
+    size_t    set_off;                /* Offset of the open data set, 0 = none */
+    uint32_t  domain_id;              /* Observation domain */
+    uint32_t  sequence;               /* Data records in finished messages */
+    uint32_t  msg_records;            /* Data records in the open message */
+} sav_wire_writer_t;
+
+/**
+ * Initialize a writer
+ *
+ * @param w          Writer
+ * @param buf        Message buffer
+ * @param cap        Capacity of buf; also the maximum message size
+ * @param domain_id  Observation domain ID written to each message header
+ */
+void sav_wire_writer_init(
+    sav_wire_writer_t *w,
+    uint8_t           *buf,
+    size_t            cap,
+    uint32_t          domain_id);
+
+/**
+ * Start a new message, discarding any unfinished one
+ *
+ * @param w            Writer
+ * @param export_time  Export time in seconds since the epoch
+ */
+void sav_wire_begin_message(sav_wire_writer_t *w, uint32_t export_time);
+
+/**
+ * Append a template set defining 400 and 901-904
+ *
+ * @param w  Writer with an open message
+ *
+ * @return TRUE on success, FALSE if the set does not fit
+ */
+gboolean sav_wire_add_templates(sav_wire_writer_t *w);
+
+/**
+ * Append one template-400 data record
+ *
+ * Mapping values use the same representation the collector returns, so
+ * a record read back compares equal to the one written.
+ *
+ * @param w       Writer with an open message
+ * @param record  Record to encode (sub_template_id selects the layout)
+ *
+ * @return TRUE on success, FALSE if the record does not fit into the
+ *         message or its sub-template is unknown
+ */
+gboolean sav_wire_add_record(
+    sav_wire_writer_t         *w,
+    const sav_parsed_record_t *record);
+
+/**
+ * Finish the open message
+ *
+ * Fills in the message length and sequence number. The message occupies
+ * buf[0 .. returned length) until the next sav_wire_begin_message().
+ *
+ * @param w  Writer
+ *
+ * @return Message length in bytes, 0 if no message is open
+ */
+size_t sav_wire_finish_message(sav_wire_writer_t *w);
+
+#endif /* SAV_WIRE_WRITER_H */
@@ -0,0 +1,101 @@
+/**
+ * @file sav_arena.c
+ * @brief Bump (arena) allocator implementation
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "sav_arena.h"
+
+struct sav_arena_chunk {
+    sav_arena_chunk_t *next;          /* Next chunk in the list */
+    size_t            size;           /* Usable bytes in data[] */
+    size_t            used;           /* Bytes handed out from data[] */
+    uint8_t           *data;          /* Aligned start of usable memory */
+};
+
+#define ALIGN_UP(n, a) (((n) + ((a) - 1)) & ~((size_t)(a) - 1))
+
+/* Allocate a chunk header and its payload in one block */
+static sav_arena_chunk_t* chunk_new(size_t size)
+{
+    size_t header = ALIGN_UP(sizeof(sav_arena_chunk_t), SAV_ARENA_ALIGNMENT);
+    uint8_t *block = g_malloc(header + size + SAV_ARENA_ALIGNMENT);
+    sav_arena_chunk_t *chunk = (sav_arena_chunk_t *)block;
+    
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->used = 0;
+    chunk->data = (uint8_t *)ALIGN_UP((uintptr_t)(block + header), SAV_ARENA_ALIGNMENT);
+    return chunk;
+}
+
+void sav_arena_init(sav_arena_t *arena, size_t chunk_size)
+{
+    if (!arena) return;
+    
+    memset(arena, 0, sizeof(*arena));
+    arena->chunk_size = chunk_size ? chunk_size : SAV_ARENA_DEFAULT_CHUNK_SIZE;
+}
+
+void* sav_arena_alloc(sav_arena_t *arena, size_t size)
+{
+    if (!arena) return NULL;
+    
+    size = ALIGN_UP(size ? size : 1, SAV_ARENA_ALIGNMENT);
+    
+    /* Fast path: bump inside the current chunk */
+    sav_arena_chunk_t *chunk = arena->current;
+    if (chunk && chunk->size - chunk->used >= size) {
+        void *ptr = chunk->data + chunk->used;
+        chunk->used += size;
+        arena->bytes_used += size;
+        return ptr;
+    }
+    
+    /* Reuse a chunk kept from before the last reset if it is large enough */
+    if (chunk && chunk->next && chunk->next->size >= size) {
+        chunk = chunk->next;
+    } else {
+        sav_arena_chunk_t *fresh = chunk_new(MAX(size, arena->chunk_size));
+        arena->bytes_reserved += fresh->size;
+        
+        if (!chunk) {
+            fresh->next = arena->head;
+            arena->head = fresh;
+        } else {
+            fresh->next = chunk->next;
+            chunk->next = fresh;
+        }
+        chunk = fresh;
+    }
+    
+    arena->current = chunk;
+    chunk->used = size;
+    arena->bytes_used += size;
+    return chunk->data;
+}
+
+void sav_arena_reset(sav_arena_t *arena)
+{
+    if (!arena) return;
+    
+    for (sav_arena_chunk_t *c = arena->head; c; c = c->next) {
+        c->used = 0;
+    }
+    arena->current = arena->head;
+    arena->bytes_used = 0;
+}
+
+void sav_arena_destroy(sav_arena_t *arena)
+{
+    if (!arena) return;
+    
+    sav_arena_chunk_t *c = arena->head;
+    while (c) {
+        sav_arena_chunk_t *next = c->next;
+        g_free(c);
+        c = next;
+    }
+    sav_arena_init(arena, arena->chunk_size);
+}
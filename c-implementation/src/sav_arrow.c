@@ -0,0 +1,531 @@
+/**
+ * @file sav_arrow.c
+ * @brief Arrow IPC stream writer: column buffers and hand-built Flatbuffers
+ *
+ * Arrow IPC stream framing (format version V5):
+ *
+ *   message := 0xFFFFFFFF, int32 metadata size, Flatbuffers Message padded
+ *              to 8 bytes, body
+ *   stream  := Schema message, RecordBatch messages, 0xFFFFFFFF 0x00000000
+ *
+ * The Flatbuffers builder below writes front to back: a table's vtable
+ * comes first, then the table, then the strings, vectors and tables it
+ * refers to, whose offsets are patched in once their position is known.
+ * All offsets therefore point forward, as Flatbuffers requires.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include "sav_arrow.h"
+#include "sav_layout.h"
+
+/* Arrow schema enums (Schema.fbs / Message.fbs) */
+#define ARROW_METADATA_V5          4
+#define ARROW_HEADER_SCHEMA        1
+#define ARROW_HEADER_RECORD_BATCH  3
+#define ARROW_TYPE_INT             2
+#define ARROW_TYPE_TIMESTAMP       10
+#define ARROW_TYPE_FIXED_BINARY    15
+#define ARROW_TIME_UNIT_MS         1
+
+#define ARROW_CONTINUATION 0xFFFFFFFFu
+
+#define PAD8(n) (((n) + 7) & ~(size_t)7)
+
+/* ------------------------------------------------------------ columns */
+
+enum {
+    COL_TIMESTAMP,
+    COL_RULE_TYPE,
+    COL_TARGET_TYPE,
+    COL_POLICY_ACTION,
+    COL_INTERFACE,
+    COL_PREFIX_V4,
+    COL_PREFIX_V6,
+    COL_PREFIX_LENGTH,
+    COL_COUNT
+};
+
+typedef struct column_def {
+    const char *name;
+    uint8_t    type;                  /* ARROW_TYPE_* */
+    uint8_t    width;                 /* Bytes per value */
+    gboolean   nullable;
+} column_def_t;
+
+static const column_def_t columns[COL_COUNT] = {
+    { "timestamp",         ARROW_TYPE_TIMESTAMP,    8,  FALSE },
+    { "rule_type",         ARROW_TYPE_INT,          1,  FALSE },
+    { "target_type",       ARROW_TYPE_INT,          1,  FALSE },
+    { "policy_action",     ARROW_TYPE_INT,          1,  FALSE },
+    { "ingress_interface", ARROW_TYPE_INT,          4,  FALSE },
+    { "prefix_v4",         ARROW_TYPE_FIXED_BINARY, 4,  TRUE  },
+    { "prefix_v6",         ARROW_TYPE_FIXED_BINARY, 16, TRUE  },
+    { "prefix_length",     ARROW_TYPE_INT,          1,  FALSE },
+};
+
+struct sav_arrow_writer {
+    FILE      *output;                /* Destination stream */
+    uint32_t  batch_rows;             /* Rows per record batch */
+    uint32_t  rows;                   /* Rows buffered in the current batch */
+    uint8_t   *values[COL_COUNT];     /* Value buffers, batch_rows * width */
+    uint8_t   *validity[COL_COUNT];   /* Validity bitmaps (nullable columns) */
+    uint32_t  null_count[COL_COUNT];  /* Nulls in the current batch */
+    gboolean  started;                /* Schema written */
+    gboolean  finished;               /* End-of-stream written */
+    uint64_t  total_rows;             /* Rows written or buffered */
+    uint64_t  batches;                /* Record batches written */
+    int       error;                  /* errno of the first failed write, 0 = none */
+
+    uint8_t   *meta;                  /* Flatbuffers metadata under construction */
+    size_t    meta_len;
+    size_t    meta_cap;
+};
+
+/* ------------------------------------------------- little-endian stores */
+
+static inline void store_le16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void store_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static inline void store_le64(uint8_t *p, uint64_t v)
+{
+    store_le32(p, (uint32_t)v);
+    store_le32(p + 4, (uint32_t)(v >> 32));
+}
+
+/* -------------------------------------------------- Flatbuffers builder */
+
+/* One scalar or offset field of a table */
+typedef struct fb_field {
+    uint16_t  id;                     /* Field index in the schema */
+    uint8_t   size;                   /* 1, 2, 4 or 8 bytes */
+    gboolean  is_ref;                 /* uoffset, patched later via fb_patch() */
+    uint64_t  value;                  /* Scalar value */
+} fb_field_t;
+
+#define FB_SCALAR(id, size, value)  { (id), (size), FALSE, (uint64_t)(value) }
+#define FB_REF(id)                  { (id), 4, TRUE, 0 }
+#define FB_MAX_FIELDS 8
+
+/* Append n zero bytes; returns their position */
+static size_t fb_reserve(sav_arrow_writer_t *w, size_t n)
+{
+    if (w->meta_cap - w->meta_len < n) {
+        size_t cap = w->meta_cap ? w->meta_cap : 1024;
+        while (cap - w->meta_len < n) cap *= 2;
+        w->meta = g_realloc(w->meta, cap);
+        w->meta_cap = cap;
+    }
+    size_t pos = w->meta_len;
+    memset(w->meta + pos, 0, n);
+    w->meta_len += n;
+    return pos;
+}
+
+static void fb_align(sav_arrow_writer_t *w, size_t align)
+{
+    fb_reserve(w, (align - w->meta_len % align) % align);
+}
+
+/* Point the uoffset at slot to target (target must follow slot) */
+static void fb_patch(sav_arrow_writer_t *w, size_t slot, size_t target)
+{
+    store_le32(w->meta + slot, (uint32_t)(target - slot));
+}
+
+/* Write a vtable and its table; slots[i] receives the position of the
+ * i-th field when it is a reference. Returns the table position. */
+static size_t fb_table(sav_arrow_writer_t *w, const fb_field_t *fields, int n, size_t *slots)
+{
+    uint16_t vt_entries[FB_MAX_FIELDS] = { 0 };
+    uint16_t max_id = 0;
+
+    for (int i = 0; i < n; i++) {
+        if (fields[i].id + 1 > max_id) max_id = (uint16_t)(fields[i].id + 1);
+    }
+
+    fb_align(w, 2);
+    size_t vt = fb_reserve(w, 4 + 2 * (size_t)max_id);
+
+    /* Table at 8-byte alignment, so relative alignment of fields is absolute */
+    fb_align(w, 8);
+    size_t table = fb_reserve(w, 4);
+
+    /* Largest fields first to keep padding down */
+    for (uint8_t size = 8; size >= 1; size /= 2) {
+        for (int i = 0; i < n; i++) {
+            if (fields[i].size != size) continue;
+            fb_align(w, size);
+            size_t pos = fb_reserve(w, size);
+            uint8_t *p = w->meta + pos;
+            switch (size) {
+                case 8: store_le64(p, fields[i].value); break;
+                case 4: store_le32(p, (uint32_t)fields[i].value); break;
+                case 2: store_le16(p, (uint16_t)fields[i].value); break;
+                default: *p = (uint8_t)fields[i].value; break;
+            }
+            vt_entries[fields[i].id] = (uint16_t)(pos - table);
+            if (fields[i].is_ref && slots) slots[i] = pos;
+        }
+    }
+
+    store_le16(w->meta + vt, (uint16_t)(4 + 2 * max_id));
+    store_le16(w->meta + vt + 2, (uint16_t)(w->meta_len - table));
+    for (uint16_t id = 0; id < max_id; id++) {
+        store_le16(w->meta + vt + 4 + 2 * id, vt_entries[id]);
+    }
+    store_le32(w->meta + table, (uint32_t)(table - vt));
+    return table;
+}
+
+static size_t fb_string(sav_arrow_writer_t *w, const char *s)
+{
+    size_t n = strlen(s);
+
+    fb_align(w, 4);
+    size_t pos = fb_reserve(w, 4 + n + 1);
+    store_le32(w->meta + pos, (uint32_t)n);
+    memcpy(w->meta + pos + 4, s, n);
+    return pos;
+}
+
+/* Vector of n uoffsets; slot of element i is pos + 4 + 4 * i */
+static size_t fb_ref_vector(sav_arrow_writer_t *w, uint32_t n)
+{
+    fb_align(w, 4);
+    size_t pos = fb_reserve(w, 4 + 4 * (size_t)n);
+    store_le32(w->meta + pos, n);
+    return pos;
+}
+
+/* Vector of n 16-byte structs of two longs (FieldNode, Buffer) */
+static size_t fb_long_pair_vector(sav_arrow_writer_t *w, const uint64_t *pairs, uint32_t n)
+{
+    /* Elements 8-byte aligned, so the count sits at 4 mod 8 */
+    fb_align(w, 4);
+    if (w->meta_len % 8 == 0) fb_reserve(w, 4);
+    size_t pos = fb_reserve(w, 4 + 16 * (size_t)n);
+    store_le32(w->meta + pos, n);
+    for (uint32_t i = 0; i < 2 * n; i++) {
+        store_le64(w->meta + pos + 4 + 8 * i, pairs[i]);
+    }
+    return pos;
+}
+
+/* Root offset and Message table; returns the slot of Message.header */
+static size_t fb_message(sav_arrow_writer_t *w, uint8_t header_type, uint64_t body_length)
+{
+    const fb_field_t msg[] = {
+        FB_SCALAR(0, 2, ARROW_METADATA_V5),     /* version */
+        FB_SCALAR(1, 1, header_type),           /* header_type */
+        FB_REF(2),                              /* header */
+        FB_SCALAR(3, 8, body_length),           /* bodyLength */
+    };
+    size_t slots[4];
+
+    w->meta_len = 0;
+    size_t root = fb_reserve(w, 4);
+    fb_patch(w, root, fb_table(w, msg, 4, slots));
+    return slots[2];
+}
+
+/* ------------------------------------------------------------- output */
+
+static void emit(sav_arrow_writer_t *w, const void *data, size_t n)
+{
+    if (n && w->error == 0 && fwrite(data, 1, n, w->output) < n) {
+        w->error = errno ? errno : EIO;
+    }
+}
+
+static void emit_padding(sav_arrow_writer_t *w, size_t n)
+{
+    static const uint8_t zeros[8] = { 0 };
+    emit(w, zeros, PAD8(n) - n);
+}
+
+/* Frame and write the metadata built in w->meta */
+static void emit_metadata(sav_arrow_writer_t *w)
+{
+    uint8_t prefix[8];
+    size_t padded = PAD8(w->meta_len);
+
+    store_le32(prefix, ARROW_CONTINUATION);
+    store_le32(prefix + 4, (uint32_t)padded);
+    emit(w, prefix, sizeof(prefix));
+    emit(w, w->meta, w->meta_len);
+    emit_padding(w, w->meta_len);
+}
+
+static void write_schema(sav_arrow_writer_t *w)
+{
+    size_t header_slot = fb_message(w, ARROW_HEADER_SCHEMA, 0);
+
+    const fb_field_t schema[] = {
+        FB_SCALAR(0, 2, 0),                     /* endianness: Little */
+        FB_REF(1),                              /* fields */
+    };
+    size_t schema_slots[2];
+    fb_patch(w, header_slot, fb_table(w, schema, 2, schema_slots));
+
+    size_t fields_vec = fb_ref_vector(w, COL_COUNT);
+    fb_patch(w, schema_slots[1], fields_vec);
+
+    for (int c = 0; c < COL_COUNT; c++) {
+        const column_def_t *col = &columns[c];
+        const fb_field_t field[] = {
+            FB_REF(0),                          /* name */
+            FB_SCALAR(1, 1, col->nullable),     /* nullable */
+            FB_SCALAR(2, 1, col->type),         /* type_type */
+            FB_REF(3),                          /* type */
+            FB_REF(5),                          /* children */
+        };
+        size_t slots[5];
+
+        fb_patch(w, fields_vec + 4 + 4 * (size_t)c, fb_table(w, field, 5, slots));
+        fb_patch(w, slots[0], fb_string(w, col->name));
+
+        if (col->type == ARROW_TYPE_TIMESTAMP) {
+            const fb_field_t ts[] = {
+                FB_SCALAR(0, 2, ARROW_TIME_UNIT_MS),    /* unit */
+                FB_REF(1),                              /* timezone */
+            };
+            size_t ts_slots[2];
+            fb_patch(w, slots[3], fb_table(w, ts, 2, ts_slots));
+            fb_patch(w, ts_slots[1], fb_string(w, "UTC"));
+        } else if (col->type == ARROW_TYPE_FIXED_BINARY) {
+            const fb_field_t fsb[] = {
+                FB_SCALAR(0, 4, col->width),            /* byteWidth */
+            };
+            fb_patch(w, slots[3], fb_table(w, fsb, 1, NULL));
+        } else {
+            const fb_field_t integer[] = {
+                FB_SCALAR(0, 4, col->width * 8),        /* bitWidth */
+                FB_SCALAR(1, 1, 0),                     /* is_signed */
+            };
+            fb_patch(w, slots[3], fb_table(w, integer, 2, NULL));
+        }
+
+        /* Readers expect a children vector even when it is empty */
+        fb_patch(w, slots[4], fb_ref_vector(w, 0));
+    }
+
+    emit_metadata(w);
+}
+
+static void start(sav_arrow_writer_t *w)
+{
+    if (!w->started) {
+        w->started = TRUE;
+        write_schema(w);
+    }
+}
+
+/* Write the buffered rows as one record batch */
+static void flush_batch(sav_arrow_writer_t *w)
+{
+    uint64_t nodes[2 * COL_COUNT];
+    uint64_t buffers[4 * COL_COUNT];
+    size_t lengths[2 * COL_COUNT];
+    uint64_t body = 0;
+
+    if (w->rows == 0) {
+        return;
+    }
+    start(w);
+
+    /* Two buffers per column: validity (empty when nothing is null), values */
+    for (int c = 0; c < COL_COUNT; c++) {
+        size_t validity = w->null_count[c] ? ((size_t)w->rows + 7) / 8 : 0;
+        size_t values = (size_t)w->rows * columns[c].width;
+
+        nodes[2 * c] = w->rows;
+        nodes[2 * c + 1] = w->null_count[c];
+        lengths[2 * c] = validity;
+        lengths[2 * c + 1] = values;
+        buffers[4 * c] = body;
+        buffers[4 * c + 1] = validity;
+        body += PAD8(validity);
+        buffers[4 * c + 2] = body;
+        buffers[4 * c + 3] = values;
+        body += PAD8(values);
+    }
+
+    size_t header_slot = fb_message(w, ARROW_HEADER_RECORD_BATCH, body);
+    const fb_field_t batch[] = {
+        FB_SCALAR(0, 8, w->rows),               /* length */
+        FB_REF(1),                              /* nodes */
+        FB_REF(2),                              /* buffers */
+    };
+    size_t slots[3];
+    fb_patch(w, header_slot, fb_table(w, batch, 3, slots));
+    fb_patch(w, slots[1], fb_long_pair_vector(w, nodes, COL_COUNT));
+    fb_patch(w, slots[2], fb_long_pair_vector(w, buffers, 2 * COL_COUNT));
+    emit_metadata(w);
+
+    for (int c = 0; c < COL_COUNT; c++) {
+        emit(w, w->validity[c], lengths[2 * c]);
+        emit_padding(w, lengths[2 * c]);
+        emit(w, w->values[c], lengths[2 * c + 1]);
+        emit_padding(w, lengths[2 * c + 1]);
+    }
+
+    w->batches++;
+    w->rows = 0;
+    for (int c = 0; c < COL_COUNT; c++) {
+        w->null_count[c] = 0;
+        if (w->validity[c]) {
+            memset(w->validity[c], 0, ((size_t)w->batch_rows + 7) / 8);
+        }
+    }
+}
+
+static gboolean check_error(const sav_arrow_writer_t *w, GError **err)
+{
+    if (w->error) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                    "Arrow write failed: %s", g_strerror(w->error));
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/* ---------------------------------------------------------------- API */
+
+sav_arrow_writer_t* sav_arrow_writer_new(
+    FILE     *output,
+    uint32_t batch_rows,
+    GError   **err)
+{
+    if (!output) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                    "NULL output stream in sav_arrow_writer_new");
+        return NULL;
+    }
+
+    sav_arrow_writer_t *w = g_new0(sav_arrow_writer_t, 1);
+    w->output = output;
+    w->batch_rows = batch_rows ? batch_rows : SAV_ARROW_DEFAULT_BATCH_ROWS;
+
+    for (int c = 0; c < COL_COUNT; c++) {
+        w->values[c] = g_malloc((size_t)w->batch_rows * columns[c].width);
+        if (columns[c].nullable) {
+            w->validity[c] = g_malloc0(((size_t)w->batch_rows + 7) / 8);
+        }
+    }
+    return w;
+}
+
+gboolean sav_arrow_write_record(
+    sav_arrow_writer_t        *w,
+    const sav_parsed_record_t *record,
+    GError                    **err)
+{
+    if (!w || !record) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                    "NULL parameter in sav_arrow_write_record");
+        return FALSE;
+    }
+
+    const sav_sub_template_layout_t *layout = sav_sub_template_layout(record->sub_template_id);
+    uint32_t count = layout ? record->mapping_count : 0;
+    gboolean v4 = layout && layout->family == 4;
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t r = w->rows;
+        uint32_t iface;
+        uint8_t plen;
+
+        store_le64(w->values[COL_TIMESTAMP] + 8 * (size_t)r, record->timestamp_ms);
+        w->values[COL_RULE_TYPE][r] = record->rule_type;
+        w->values[COL_TARGET_TYPE][r] = record->target_type;
+        w->values[COL_POLICY_ACTION][r] = record->policy_action;
+
+        /* The other family's prefix is null; its slot is zeroed */
+        uint8_t *p4 = w->values[COL_PREFIX_V4] + 4 * (size_t)r;
+        uint8_t *p6 = w->values[COL_PREFIX_V6] + 16 * (size_t)r;
+        if (v4) {
+            const sav_ipv4_mapping_t *m = &record->mappings.ipv4_mappings[i];
+            uint32_t prefix = htonl(m->sourceIPv4Prefix);
+            iface = m->ingressInterface;
+            plen = m->sourceIPv4PrefixLength;
+            memcpy(p4, &prefix, 4);
+            memset(p6, 0, 16);
+            w->validity[COL_PREFIX_V4][r / 8] |= (uint8_t)(1u << (r % 8));
+            w->null_count[COL_PREFIX_V6]++;
+        } else {
+            const sav_ipv6_mapping_t *m = &record->mappings.ipv6_mappings[i];
+            iface = m->ingressInterface;
+            plen = m->sourceIPv6PrefixLength;
+            memset(p4, 0, 4);
+            memcpy(p6, m->sourceIPv6Prefix, 16);
+            w->validity[COL_PREFIX_V6][r / 8] |= (uint8_t)(1u << (r % 8));
+            w->null_count[COL_PREFIX_V4]++;
+        }
+        store_le32(w->values[COL_INTERFACE] + 4 * (size_t)r, iface);
+        w->values[COL_PREFIX_LENGTH][r] = plen;
+
+        w->total_rows++;
+        if (++w->rows == w->batch_rows) {
+            flush_batch(w);
+        }
+    }
+
+    return check_error(w, err);
+}
+
+gboolean sav_arrow_writer_finish(
+    sav_arrow_writer_t *w,
+    GError             **err)
+{
+    if (!w) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                    "NULL parameter in sav_arrow_writer_finish");
+        return FALSE;
+    }
+
+    if (!w->finished) {
+        uint8_t eos[8];
+
+        w->finished = TRUE;
+        start(w);
+        flush_batch(w);
+        store_le32(eos, ARROW_CONTINUATION);
+        store_le32(eos + 4, 0);
+        emit(w, eos, sizeof(eos));
+    }
+    return check_error(w, err);
+}
+
+void sav_arrow_writer_get_stats(
+    const sav_arrow_writer_t *w,
+    uint64_t                 *rows,
+    uint64_t                 *batches)
+{
+    if (rows) *rows = w ? w->total_rows : 0;
+    if (batches) *batches = w ? w->batches : 0;
+}
+
+void sav_arrow_writer_free(sav_arrow_writer_t *w)
+{
+    if (!w) return;
+
+    for (int c = 0; c < COL_COUNT; c++) {
+        g_free(w->values[c]);
+        g_free(w->validity[c]);
+    }
+    g_free(w->meta);
+    g_free(w);
+}
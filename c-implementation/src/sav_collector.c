@@ -6,215 +6,1038 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 #include <arpa/inet.h>
 #include "sav_collector.h"
+#include "sav_collector_internal.h"
+#include "sav_fast_decoder.h"
+#include "sav_layout.h"
+#include "sav_mmap.h"
+#include "sav_validate.h"
 
-/* Create a file-based collector */
-sav_collector_ctx_t* sav_create_file_collector(
-    const char *filename,
-    GError     **err)
+/* Allocate a context with session and SAV templates on an existing model */
+sav_collector_ctx_t* sav_collector_alloc_shared(
+    fbInfoModel_t *model,
+    GError        **err)
 {
-    if (!filename) {
+    sav_collector_ctx_t *ctx = g_new0(sav_collector_ctx_t, 1);
+    
+    /* Create session */
+    ctx->session = fbSessionAlloc(model);
+    if (!ctx->session) {
         g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
-                    "NULL filename provided");
+                    "Failed to allocate session");
+        g_free(ctx);
         return NULL;
     }
     
-    /* Allocate context */
-    sav_collector_ctx_t *ctx = g_new0(sav_collector_ctx_t, 1);
+    /* Add templates to session */
+    if (!sav_add_templates(ctx->session, err)) {
+        sav_collector_ctx_destroy(ctx);
+        return NULL;
+    }
     
+    return ctx;
+}
+
+/* Allocate a context with info model, session and SAV templates */
+sav_collector_ctx_t* sav_collector_alloc(GError **err)
+{
     /* Initialize info model */
-    ctx->model = fbInfoModelAlloc();
-    if (!ctx->model) {
+    fbInfoModel_t *model = fbInfoModelAlloc();
+    if (!model) {
         g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
                     "Failed to allocate info model");
-        g_free(ctx);
         return NULL;
     }
     
-    if (!sav_init_info_model(ctx->model)) {
+    if (!sav_init_info_model(model)) {
         g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
                     "Failed to initialize SAV info model");
-        fbInfoModelFree(ctx->model);
-        g_free(ctx);
+        fbInfoModelFree(model);
         return NULL;
     }
     
-    /* Create session */
-    ctx->session = fbSessionAlloc(ctx->model);
-    if (!ctx->session) {
+    sav_collector_ctx_t *ctx = sav_collector_alloc_shared(model, err);
+    if (!ctx) {
+        fbInfoModelFree(model);
+        return NULL;
+    }
+    
+    /* The context owns the model from here on */
+    ctx->model = model;
+    return ctx;
+}
+
+/* Create the collection buffer (collector may be NULL for buffer-fed reads) */
+gboolean sav_collector_attach_fbuf(
+    sav_collector_ctx_t *ctx,
+    fbCollector_t       *collector,
+    GError              **err)
+{
+    /* Create buffer for collection */
+    ctx->fbuf = fBufAllocForCollection(ctx->session, collector);
+    if (!ctx->fbuf) {
         g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
-                    "Failed to allocate session");
-        fbInfoModelFree(ctx->model);
-        g_free(ctx);
+                    "Failed to create collection buffer");
+        return FALSE;
+    }
+    
+    /* Set internal template for reading */
+    if (!fBufSetInternalTemplate(ctx->fbuf, SAV_MAIN_TEMPLATE_ID, err)) {
+        return FALSE;
+    }
+    
+    ctx->records_read = 0;
+    ctx->parse_errors = 0;
+    return TRUE;
+}
+
+/* Create a file-based collector */
+sav_collector_ctx_t* sav_create_file_collector(
+    const char *filename,
+    GError     **err)
+{
+    if (!filename) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                    "NULL filename provided");
         return NULL;
     }
     
-    /* Add templates to session */
-    if (!sav_add_templates(ctx->session, err)) {
-        sav_collector_ctx_destroy(ctx);
+    sav_collector_ctx_t *ctx = sav_collector_alloc(err);
+    if (!ctx) {
         return NULL;
     }
     
     /* Create collector */
     fbCollector_t *collector = fbCollectorAllocFile(NULL, filename, err);
     if (!collector) {
-        fbSessionFree(ctx->session);
-        fbInfoModelFree(ctx->model);
-        g_free(ctx);
+        sav_collector_ctx_destroy(ctx);
         return NULL;
     }
     
-    /* Create buffer for collection */
-    ctx->fbuf = fBufAllocForCollection(ctx->session, collector);
-    if (!ctx->fbuf) {
+    if (!sav_collector_attach_fbuf(ctx, collector, err)) {
+        sav_collector_ctx_destroy(ctx);
+        return NULL;
+    }
+    
+    return ctx;
+}
+
+/* Create a file-based collector using the native fast path */
+sav_collector_ctx_t* sav_create_fast_file_collector(
+    const char *filename,
+    GError     **err)
+{
+    if (!filename) {
         g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
-                    "Failed to create collection buffer");
-        fbSessionFree(ctx->session);
-        fbInfoModelFree(ctx->model);
-        g_free(ctx);
+                    "NULL filename provided");
         return NULL;
     }
     
-    /* Set internal template for reading */
-    if (!fBufSetInternalTemplate(ctx->fbuf, SAV_MAIN_TEMPLATE_ID, err)) {
-        fBufFree(ctx->fbuf);
-        fbSessionFree(ctx->session);
-        fbInfoModelFree(ctx->model);
-        g_free(ctx);
+    sav_collector_ctx_t *ctx = sav_collector_alloc(err);
+    if (!ctx) {
         return NULL;
     }
     
-    ctx->records_read = 0;
-    ctx->parse_errors = 0;
+    ctx->fast_fp = fopen(filename, "rb");
+    if (!ctx->fast_fp) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                    "Cannot open %s: %s", filename, strerror(errno));
+        sav_collector_ctx_destroy(ctx);
+        return NULL;
+    }
+    
+    /* libfixbuf reads fallback messages from msg_buf, not from the file */
+    if (!sav_collector_attach_fbuf(ctx, NULL, err)) {
+        sav_collector_ctx_destroy(ctx);
+        return NULL;
+    }
+    
+    ctx->fast = g_new0(sav_fast_decoder_t, 1);
+    sav_fast_decoder_init(ctx->fast);
+    ctx->msg_cap = SAV_IPFIX_MAX_MSG_LEN;
+    ctx->msg_buf = g_malloc(ctx->msg_cap);
     
     return ctx;
 }
 
-/* Parse SubTemplateList entries */
-static gboolean parse_subtmpl_list(
-    fbSubTemplateList_t       *stl,
-    sav_parsed_record_t       *record,
-    GError                    **err)
+/* Create a memory-mapped file collector using the native fast path */
+sav_collector_ctx_t* sav_create_mmap_file_collector(
+    const char *filename,
+    unsigned   flags,
+    GError     **err)
 {
-    if (!stl || !record) {
+    if (!filename) {
         g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
-                    "NULL parameter in parse_subtmpl_list");
+                    "NULL filename provided");
+        return NULL;
+    }
+    
+    sav_collector_ctx_t *ctx = sav_collector_alloc(err);
+    if (!ctx) {
+        return NULL;
+    }
+    
+    ctx->map = g_new0(sav_mmap_file_t, 1);
+    if (!sav_mmap_open(ctx->map, filename, flags, err)) {
+        g_free(ctx->map);
+        ctx->map = NULL;
+        sav_collector_ctx_destroy(ctx);
+        return NULL;
+    }
+    
+    /* libfixbuf reads fallback messages straight from the mapping */
+    if (!sav_collector_attach_fbuf(ctx, NULL, err)) {
+        sav_collector_ctx_destroy(ctx);
+        return NULL;
+    }
+    
+    ctx->fast = g_new0(sav_fast_decoder_t, 1);
+    sav_fast_decoder_init(ctx->fast);
+    
+    return ctx;
+}
+
+static void view_to_record(
+    const sav_record_view_t *view,
+    sav_parsed_record_t     *record,
+    sav_arena_t             *arena);
+
+/* Release the SubTemplateList backing the previous view, if any */
+void sav_collector_release_view(sav_collector_ctx_t *ctx)
+{
+    if (ctx->view_active) {
+        fbSubTemplateListClear(&ctx->view_record.savMatchedContentList);
+        ctx->view_active = FALSE;
+    }
+}
+
+/* Read next SAV record */
+gboolean sav_read_record(
+    sav_collector_ctx_t *ctx,
+    sav_parsed_record_t *record,
+    GError              **err)
+{
+    if (!ctx || !record) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                    "NULL parameter in sav_read_record");
         return FALSE;
     }
     
-    /* Get SubTemplateList info */
-    record->sub_template_id = fbSubTemplateListGetTemplateID(stl);
-    record->mapping_count = fbSubTemplateListCountElements(stl);
+    /* Clear record; any outstanding view is invalidated by this read */
+    memset(record, 0, sizeof(*record));
+    sav_collector_release_view(ctx);
+    
+    /* Every path yields a view; copy it into an owned record. The libfixbuf
+     * list is decoded through the sub-template layout, at its real stride
+     * and field order. */
+    sav_record_view_t view;
+    if (!sav_read_record_view(ctx, &view, err)) {
+        return FALSE;
+    }
+    view_to_record(&view, record, NULL);
+    return TRUE;
+}
+
+/* Decode the next record with libfixbuf into the context-owned view record.
+ * Errors (including EOF/EOM) are left in err for the caller to classify. */
+static gboolean fbuf_next_view(
+    sav_collector_ctx_t *ctx,
+    sav_record_view_t   *view,
+    GError              **err)
+{
+    /* Decode into the context-owned record so the list outlives this call */
+    memset(&ctx->view_record, 0, sizeof(ctx->view_record));
+    size_t len = sizeof(ctx->view_record);
+    if (!fBufNext(ctx->fbuf, (uint8_t *)&ctx->view_record, &len, err)) {
+        return FALSE;
+    }
+    ctx->view_active = TRUE;
+    
+    fbSubTemplateList_t *stl = &ctx->view_record.savMatchedContentList;
+    
+    view->timestamp_ms = ctx->view_record.observationTimeMilliseconds;
+    view->rule_type = ctx->view_record.savRuleType;
+    view->target_type = ctx->view_record.savTargetType;
+    view->policy_action = ctx->view_record.savPolicyAction;
+    view->sub_template_id = fbSubTemplateListGetTemplateID(stl);
+    view->mapping_count = fbSubTemplateListCountElements(stl);
     
-    if (record->mapping_count == 0) {
+    if (view->mapping_count == 0) {
         /* Empty list is valid (no mappings) */
-        record->mappings.ipv4_mappings = NULL;
         return TRUE;
     }
     
-    /* Determine if IPv4 or IPv6 based on template ID */
-    gboolean is_ipv4 = (record->sub_template_id == SAV_TMPL_IPV4_INTERFACE_PREFIX ||
-                        record->sub_template_id == SAV_TMPL_IPV4_PREFIX_INTERFACE);
-    gboolean is_ipv6 = (record->sub_template_id == SAV_TMPL_IPV6_INTERFACE_PREFIX ||
-                        record->sub_template_id == SAV_TMPL_IPV6_PREFIX_INTERFACE);
-    
-    if (!is_ipv4 && !is_ipv6) {
+    if (!sav_sub_template_layout(view->sub_template_id)) {
         g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
-                    "Unknown sub-template ID: %u", record->sub_template_id);
+                    "Unknown sub-template ID: %u", view->sub_template_id);
+        sav_collector_release_view(ctx);
         return FALSE;
     }
     
-    /* Allocate mapping array */
-    if (is_ipv4) {
-        record->mappings.ipv4_mappings = g_new0(sav_ipv4_mapping_t, record->mapping_count);
-    } else {
-        record->mappings.ipv6_mappings = g_new0(sav_ipv6_mapping_t, record->mapping_count);
+    /* Entries are packed at the internal template length (9 or 21 bytes),
+     * not at sizeof() of the mapping structs */
+    view->entries = fbSubTemplateListGetDataPtr(stl);
+    view->entry_stride = fbTemplateGetIELenOfMemBuffer(fbSubTemplateListGetTemplate(stl));
+    return TRUE;
+}
+
+/* Read the next complete IPFIX message of a stdio fast collector into
+ * msg_buf. Returns FALSE with err unset at a clean end of file. */
+static gboolean fast_read_message(
+    sav_collector_ctx_t *ctx,
+    size_t              *msg_len,
+    GError              **err)
+{
+    size_t got = fread(ctx->msg_buf, 1, SAV_IPFIX_MSG_HEADER_LEN, ctx->fast_fp);
+    if (got == 0 && feof(ctx->fast_fp)) {
+        return FALSE;
+    }
+    if (got != SAV_IPFIX_MSG_HEADER_LEN) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                    "Truncated IPFIX message header");
+        return FALSE;
     }
     
-    /* Iterate through SubTemplateList entries */
-    uint32_t idx = 0;
-    void *entry_ptr = NULL;
+    size_t len = sav_read_be16(ctx->msg_buf + 2);
+    if (sav_read_be16(ctx->msg_buf) != SAV_IPFIX_VERSION ||
+        len < SAV_IPFIX_MSG_HEADER_LEN) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IPFIX,
+                    "Invalid IPFIX message header");
+        return FALSE;
+    }
+    
+    size_t body = len - SAV_IPFIX_MSG_HEADER_LEN;
+    if (fread(ctx->msg_buf + SAV_IPFIX_MSG_HEADER_LEN, 1, body, ctx->fast_fp) != body) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                    "Truncated IPFIX message (%zu bytes expected)", len);
+        return FALSE;
+    }
+    
+    *msg_len = len;
+    return TRUE;
+}
+
+/* Load one message: native decode, or libfixbuf for messages the fast
+ * path does not handle */
+gboolean sav_collector_load_message(
+    sav_collector_ctx_t *ctx,
+    const uint8_t       *msg,
+    size_t              msg_len,
+    GError              **err)
+{
+    gboolean native;
+    
+    ctx->fast_fallback = FALSE;
+    if (!sav_fast_decoder_load_message(ctx->fast, msg, msg_len, &native, err)) {
+        return FALSE;
+    }
+    if (!native) {
+        /* libfixbuf only reads from the buffer */
+        fBufSetBuffer(ctx->fbuf, (uint8_t *)msg, msg_len);
+        ctx->fast_fallback = TRUE;
+    }
+    return TRUE;
+}
+
+/* Next record of the loaded message */
+gboolean sav_collector_message_next_view(
+    sav_collector_ctx_t *ctx,
+    sav_record_view_t   *view,
+    GError              **err)
+{
+    if (!ctx->fast_fallback) {
+        return sav_fast_decoder_next(ctx->fast, view);
+    }
+    
+    sav_collector_release_view(ctx);
+    if (fbuf_next_view(ctx, view, err)) {
+        return TRUE;
+    }
+    ctx->fast_fallback = FALSE;
+    if (g_error_matches(*err, FB_ERROR_DOMAIN, FB_ERROR_EOM) ||
+        g_error_matches(*err, FB_ERROR_DOMAIN, FB_ERROR_EOF)) {
+        /* libfixbuf consumed the whole message buffer */
+        g_clear_error(err);
+    }
+    return FALSE;
+}
+
+/* Next record of a fast file collector */
+static gboolean fast_next_view(
+    sav_collector_ctx_t *ctx,
+    sav_record_view_t   *view,
+    GError              **err)
+{
+    for (;;) {
+        if (sav_collector_message_next_view(ctx, view, err)) {
+            return TRUE;
+        }
+        if (*err) {
+            return FALSE;
+        }
+        
+        const uint8_t *msg = ctx->msg_buf;
+        size_t msg_len;
+        gboolean more = ctx->map ? sav_mmap_next_message(ctx->map, &msg, &msg_len, err)
+                                 : fast_read_message(ctx, &msg_len, err);
+        if (!more) {
+            if (!*err) {
+                g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_EOF, "End of file");
+            }
+            return FALSE;
+        }
+        if (!sav_collector_load_message(ctx, msg, msg_len, err)) {
+            return FALSE;
+        }
+    }
+}
+
+/*
+ * Multi-threaded decoding
+ *
+ * The consumer (the thread calling the read functions) walks chunks in
+ * order. Workers claim chunk indices from next_job but never run more than
+ * slot_count chunks ahead of the consumer, which bounds the reorder buffer.
+ */
+
+/* Reorder-buffer slot holding the decoded records of one chunk */
+typedef struct sav_par_slot {
+    uint32_t          chunk;          /* Chunk index held by this slot */
+    gboolean          done;           /* Chunk fully decoded */
+    sav_record_view_t *views;         /* Decoded records in file order */
+    uint32_t          count;          /* Number of views */
+    uint32_t          cap;            /* Capacity of views */
+    sav_arena_t       arena;          /* List entries copied out of libfixbuf */
+    GError            *error;         /* Error that ended the chunk, if any */
+} sav_par_slot_t;
+
+/* Decoder thread and its private collector (own session and fast decoder) */
+typedef struct sav_par_worker {
+    struct sav_parallel *par;
+    sav_collector_ctx_t *ctx;
+} sav_par_worker_t;
+
+/* Template record already seen during the pre-scan */
+typedef struct sav_par_tmpl {
+    const uint8_t     *rec;           /* Record bytes inside the mapping */
+    size_t            len;            /* Record length */
+} sav_par_tmpl_t;
+
+struct sav_parallel {
+    sav_mmap_file_t   map;            /* Owned mapping of the whole file */
+    uint8_t           *tmpl_msg;      /* Synthetic message with all template sets */
+    size_t            tmpl_len;       /* Length of tmpl_msg */
+    size_t            *bounds;        /* Chunk i covers [bounds[i], bounds[i+1]) */
+    uint32_t          chunk_count;    /* Number of chunks */
+    sav_par_slot_t    *slots;         /* Reorder buffer */
+    uint32_t          slot_count;     /* Number of slots */
+    sav_par_worker_t  *workers;       /* Worker state */
+    GThread           **threads;      /* Worker threads */
+    uint32_t          thread_count;   /* Threads started */
+    GMutex            lock;           /* Protects the fields below */
+    GCond             cond;           /* Signals slot completion and progress */
+    uint32_t          next_job;       /* Next chunk to hand out */
+    uint32_t          consume_chunk;  /* Chunk the consumer is reading */
+    gboolean          stop;           /* Shut down workers */
+    uint32_t          consume_pos;    /* Next view in consume_chunk (consumer only) */
+};
+
+/* Record the template records of one (options) template set. Returns FALSE
+ * if a template is withdrawn, redefined differently or malformed. */
+static gboolean par_collect_templates(
+    GHashTable    *seen,
+    const uint8_t *p,
+    const uint8_t *end,
+    gboolean      options,
+    gboolean      *added)
+{
+    size_t hdr = options ? 6 : 4;
     
-    while ((entry_ptr = fbSubTemplateListGetNextPtr(stl, entry_ptr)) != NULL && 
-           idx < record->mapping_count) {
+    while (end - p >= 4) {
+        uint16_t tmpl_id = sav_read_be16(p);
+        uint16_t field_count = sav_read_be16(p + 2);
         
-        if (is_ipv4) {
-            /* Copy IPv4 mapping */
-            sav_ipv4_mapping_t *src = (sav_ipv4_mapping_t *)entry_ptr;
-            memcpy(&record->mappings.ipv4_mappings[idx], src, sizeof(sav_ipv4_mapping_t));
+        if (tmpl_id < SAV_IPFIX_MIN_DATA_SET_ID) {
+            /* Set padding */
+            break;
+        }
+        if (field_count == 0 || (size_t)(end - p) < hdr) {
+            return FALSE;
+        }
+        
+        const uint8_t *q = p + hdr;
+        for (uint16_t i = 0; i < field_count; i++) {
+            if (end - q < 4) return FALSE;
+            gboolean enterprise = (sav_read_be16(q) & 0x8000) != 0;
+            q += enterprise ? 8 : 4;
+            if (q > end) return FALSE;
+        }
+        
+        size_t len = (size_t)(q - p);
+        sav_par_tmpl_t *prev = g_hash_table_lookup(seen, GUINT_TO_POINTER(tmpl_id));
+        if (prev) {
+            if (prev->len != len || memcmp(prev->rec, p, len) != 0) {
+                return FALSE;
+            }
         } else {
-            /* Copy IPv6 mapping */
-            sav_ipv6_mapping_t *src = (sav_ipv6_mapping_t *)entry_ptr;
-            memcpy(&record->mappings.ipv6_mappings[idx], src, sizeof(sav_ipv6_mapping_t));
+            sav_par_tmpl_t *t = g_new(sav_par_tmpl_t, 1);
+            t->rec = p;
+            t->len = len;
+            g_hash_table_insert(seen, GUINT_TO_POINTER(tmpl_id), t);
+            *added = TRUE;
         }
+        p = q;
+    }
+    
+    return TRUE;
+}
+
+/* Walk every message once: collect chunk boundaries and template sets */
+static gboolean par_prescan(
+    struct sav_parallel *par,
+    gboolean            *splittable,
+    GError              **err)
+{
+    GHashTable *seen = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+    GArray *bounds = g_array_new(FALSE, FALSE, sizeof(size_t));
+    GArray *tmpl = g_array_new(FALSE, TRUE, 1);
+    GError *local_err = NULL;
+    const uint8_t *msg;
+    size_t msg_len;
+    size_t chunk_start = 0;
+    uint32_t domain = 0;
+    gboolean have_domain = FALSE;
+    
+    *splittable = TRUE;
+    g_array_set_size(tmpl, SAV_IPFIX_MSG_HEADER_LEN);
+    g_array_append_val(bounds, chunk_start);
+    
+    while (sav_mmap_next_message(&par->map, &msg, &msg_len, &local_err)) {
+        /* Templates are scoped per observation domain */
+        uint32_t msg_domain = sav_read_be32(msg + 12);
+        if (have_domain && msg_domain != domain) {
+            *splittable = FALSE;
+        }
+        domain = msg_domain;
+        have_domain = TRUE;
         
-        idx++;
+        const uint8_t *p = msg + SAV_IPFIX_MSG_HEADER_LEN;
+        const uint8_t *end = msg + msg_len;
+        while (end - p >= SAV_IPFIX_SET_HEADER_LEN) {
+            uint16_t set_id = sav_read_be16(p);
+            uint16_t set_len = sav_read_be16(p + 2);
+            if (set_len < SAV_IPFIX_SET_HEADER_LEN || set_len > end - p) {
+                /* Leave the error to the single-threaded path */
+                *splittable = FALSE;
+                break;
+            }
+            if (set_id == SAV_IPFIX_TEMPLATE_SET_ID || set_id == SAV_IPFIX_OPTIONS_SET_ID) {
+                gboolean added = FALSE;
+                if (!par_collect_templates(seen, p + SAV_IPFIX_SET_HEADER_LEN, p + set_len,
+                                           set_id == SAV_IPFIX_OPTIONS_SET_ID, &added)) {
+                    *splittable = FALSE;
+                } else if (added) {
+                    g_array_append_vals(tmpl, p, set_len);
+                }
+            } else if (set_id >= SAV_IPFIX_MIN_DATA_SET_ID &&
+                       !g_hash_table_lookup(seen, GUINT_TO_POINTER(set_id))) {
+                /* Data ahead of its template is skipped by a sequential
+                 * reader, but workers primed with every template would
+                 * decode it */
+                *splittable = FALSE;
+            }
+            p += set_len;
+        }
+        
+        if (par->map.off - chunk_start >= SAV_PARALLEL_CHUNK_BYTES) {
+            chunk_start = par->map.off;
+            g_array_append_val(bounds, chunk_start);
+        }
     }
     
-    if (idx != record->mapping_count) {
-        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
-                    "SubTemplateList iteration mismatch: expected %u, got %u",
-                    record->mapping_count, idx);
-        return FALSE;
+    if (chunk_start != par->map.off) {
+        chunk_start = par->map.off;
+        g_array_append_val(bounds, chunk_start);
+    }
+    if (tmpl->len > SAV_IPFIX_MAX_MSG_LEN) {
+        *splittable = FALSE;
     }
     
+    /* Message header for the synthetic template message */
+    uint8_t *hdr = (uint8_t *)tmpl->data;
+    hdr[0] = 0;
+    hdr[1] = SAV_IPFIX_VERSION;
+    hdr[2] = (uint8_t)(tmpl->len >> 8);
+    hdr[3] = (uint8_t)(tmpl->len & 0xFF);
+    hdr[12] = (uint8_t)(domain >> 24);
+    hdr[13] = (uint8_t)(domain >> 16);
+    hdr[14] = (uint8_t)(domain >> 8);
+    hdr[15] = (uint8_t)domain;
+    
+    par->tmpl_len = tmpl->len;
+    par->tmpl_msg = (uint8_t *)g_array_free(tmpl, FALSE);
+    par->chunk_count = bounds->len - 1;
+    par->bounds = (size_t *)g_array_free(bounds, FALSE);
+    g_hash_table_destroy(seen);
+    
+    if (local_err) {
+        g_propagate_error(err, local_err);
+        return FALSE;
+    }
     return TRUE;
 }
 
-/* Read next SAV record */
-gboolean sav_read_record(
+/* Create a worker collector primed with the pre-scanned templates */
+static sav_collector_ctx_t* par_worker_ctx_new(struct sav_parallel *par, GError **err)
+{
+    sav_collector_ctx_t *w = sav_collector_alloc(err);
+    if (!w) {
+        return NULL;
+    }
+    if (!sav_collector_attach_fbuf(w, NULL, err)) {
+        sav_collector_ctx_destroy(w);
+        return NULL;
+    }
+    
+    w->fast = g_new0(sav_fast_decoder_t, 1);
+    sav_fast_decoder_init(w->fast);
+    w->map = g_new0(sav_mmap_file_t, 1);
+    sav_mmap_borrow_range(w->map, &par->map, 0, 0);
+    
+    /* Feed the template sets to both the fast decoder and libfixbuf */
+    gboolean native;
+    if (!sav_fast_decoder_load_message(w->fast, par->tmpl_msg, par->tmpl_len, &native, err)) {
+        sav_collector_ctx_destroy(w);
+        return NULL;
+    }
+    
+    sav_record_view_t view;
+    GError *local_err = NULL;
+    fBufSetBuffer(w->fbuf, par->tmpl_msg, par->tmpl_len);
+    while (fbuf_next_view(w, &view, &local_err)) {
+        sav_collector_release_view(w);
+    }
+    if (!g_error_matches(local_err, FB_ERROR_DOMAIN, FB_ERROR_EOM) &&
+        !g_error_matches(local_err, FB_ERROR_DOMAIN, FB_ERROR_EOF)) {
+        g_propagate_error(err, local_err);
+        sav_collector_ctx_destroy(w);
+        return NULL;
+    }
+    g_clear_error(&local_err);
+    
+    return w;
+}
+
+/* Decode one chunk into its reorder-buffer slot */
+static void par_decode_chunk(
+    struct sav_parallel *par,
+    sav_collector_ctx_t *w,
+    uint32_t            chunk,
+    sav_par_slot_t      *slot)
+{
+    sav_mmap_borrow_range(w->map, &par->map, par->bounds[chunk], par->bounds[chunk + 1]);
+    w->fast->msg = NULL;
+    w->fast_fallback = FALSE;
+    
+    slot->count = 0;
+    slot->error = NULL;
+    sav_arena_reset(&slot->arena);
+    
+    sav_record_view_t view;
+    while (sav_read_record_view(w, &view, &slot->error)) {
+        /* Native views point into the mapping; libfixbuf lists are freed on
+         * the next read and must be copied */
+        if (!view.wire_order && view.entries) {
+            size_t bytes = view.mapping_count * view.entry_stride;
+            uint8_t *copy = sav_arena_alloc(&slot->arena, bytes);
+            memcpy(copy, view.entries, bytes);
+            view.entries = copy;
+        }
+        if (slot->count == slot->cap) {
+            slot->cap = slot->cap ? slot->cap * 2 : 1024;
+            slot->views = g_renew(sav_record_view_t, slot->views, slot->cap);
+        }
+        slot->views[slot->count++] = view;
+    }
+}
+
+static gpointer par_worker_main(gpointer data)
+{
+    sav_par_worker_t *worker = data;
+    struct sav_parallel *par = worker->par;
+    
+    g_mutex_lock(&par->lock);
+    while (!par->stop && par->next_job < par->chunk_count) {
+        uint32_t chunk = par->next_job;
+        if (chunk >= par->consume_chunk + par->slot_count) {
+            /* Reorder buffer full; wait for the consumer */
+            g_cond_wait(&par->cond, &par->lock);
+            continue;
+        }
+        par->next_job++;
+        sav_par_slot_t *slot = &par->slots[chunk % par->slot_count];
+        g_mutex_unlock(&par->lock);
+        
+        par_decode_chunk(par, worker->ctx, chunk, slot);
+        
+        g_mutex_lock(&par->lock);
+        slot->chunk = chunk;
+        slot->done = TRUE;
+        g_cond_broadcast(&par->cond);
+    }
+    g_mutex_unlock(&par->lock);
+    
+    return NULL;
+}
+
+/* Next record in file order from the reorder buffer */
+static gboolean par_next_view(
     sav_collector_ctx_t *ctx,
-    sav_parsed_record_t *record,
+    sav_record_view_t   *view,
     GError              **err)
 {
-    if (!ctx || !record) {
+    struct sav_parallel *par = ctx->par;
+    
+    for (;;) {
+        if (par->consume_chunk >= par->chunk_count) {
+            g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_EOF, "End of file");
+            return FALSE;
+        }
+        
+        sav_par_slot_t *slot = &par->slots[par->consume_chunk % par->slot_count];
+        g_mutex_lock(&par->lock);
+        while (!slot->done || slot->chunk != par->consume_chunk) {
+            g_cond_wait(&par->cond, &par->lock);
+        }
+        g_mutex_unlock(&par->lock);
+        
+        if (par->consume_pos < slot->count) {
+            *view = slot->views[par->consume_pos++];
+            return TRUE;
+        }
+        
+        g_mutex_lock(&par->lock);
+        if (slot->error) {
+            /* Records before the error were delivered; stop here */
+            g_propagate_error(err, slot->error);
+            slot->error = NULL;
+            par->stop = TRUE;
+            par->consume_chunk = par->chunk_count;
+            g_cond_broadcast(&par->cond);
+            g_mutex_unlock(&par->lock);
+            return FALSE;
+        }
+        
+        /* Chunk exhausted: recycle its slot */
+        slot->done = FALSE;
+        par->consume_chunk++;
+        par->consume_pos = 0;
+        g_cond_broadcast(&par->cond);
+        g_mutex_unlock(&par->lock);
+    }
+}
+
+static void par_destroy(struct sav_parallel *par)
+{
+    if (!par) return;
+    
+    g_mutex_lock(&par->lock);
+    par->stop = TRUE;
+    g_cond_broadcast(&par->cond);
+    g_mutex_unlock(&par->lock);
+    
+    for (uint32_t i = 0; i < par->thread_count; i++) {
+        g_thread_join(par->threads[i]);
+    }
+    if (par->workers) {
+        for (uint32_t i = 0; par->workers[i].par; i++) {
+            sav_collector_ctx_destroy(par->workers[i].ctx);
+        }
+    }
+    for (uint32_t i = 0; i < par->slot_count; i++) {
+        g_free(par->slots[i].views);
+        sav_arena_destroy(&par->slots[i].arena);
+        g_clear_error(&par->slots[i].error);
+    }
+    
+    g_free(par->threads);
+    g_free(par->workers);
+    g_free(par->slots);
+    g_free(par->bounds);
+    g_free(par->tmpl_msg);
+    sav_mmap_close(&par->map);
+    g_mutex_clear(&par->lock);
+    g_cond_clear(&par->cond);
+    g_free(par);
+}
+
+/* Create a multi-threaded file collector */
+sav_collector_ctx_t* sav_create_parallel_file_collector(
+    const char *filename,
+    uint32_t   threads,
+    GError     **err)
+{
+    if (!filename) {
         g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
-                    "NULL parameter in sav_read_record");
-        return FALSE;
+                    "NULL filename provided");
+        return NULL;
     }
     
-    /* Clear record */
-    memset(record, 0, sizeof(*record));
+    if (threads <= 1) {
+        return sav_create_mmap_file_collector(filename, SAV_MMAP_DEFAULT, err);
+    }
+    
+    struct sav_parallel *par = g_new0(struct sav_parallel, 1);
+    g_mutex_init(&par->lock);
+    g_cond_init(&par->cond);
+    
+    if (!sav_mmap_open(&par->map, filename, SAV_MMAP_READAHEAD, err)) {
+        par_destroy(par);
+        return NULL;
+    }
     
-    /* Read raw IPFIX record */
-    sav_data_record_t raw_record;
-    memset(&raw_record, 0, sizeof(raw_record));
+    gboolean splittable;
+    if (!par_prescan(par, &splittable, err) || !splittable) {
+        par_destroy(par);
+        if (err && *err) {
+            return NULL;
+        }
+        g_debug("%s cannot be split on message boundaries; decoding on one thread",
+                filename);
+        return sav_create_mmap_file_collector(filename, SAV_MMAP_DEFAULT, err);
+    }
+    
+    sav_collector_ctx_t *ctx = sav_collector_alloc(err);
+    if (!ctx) {
+        par_destroy(par);
+        return NULL;
+    }
+    
+    par->slot_count = 2 * threads;
+    par->slots = g_new0(sav_par_slot_t, par->slot_count);
+    for (uint32_t i = 0; i < par->slot_count; i++) {
+        sav_arena_init(&par->slots[i].arena, 0);
+    }
     
-    size_t len = sizeof(raw_record);
-    gboolean result = fBufNext(ctx->fbuf, (uint8_t *)&raw_record, &len, err);
+    /* One extra zeroed entry terminates the list for par_destroy() */
+    par->workers = g_new0(sav_par_worker_t, threads + 1);
+    for (uint32_t i = 0; i < threads; i++) {
+        par->workers[i].ctx = par_worker_ctx_new(par, err);
+        if (!par->workers[i].ctx) {
+            par_destroy(par);
+            sav_collector_ctx_destroy(ctx);
+            return NULL;
+        }
+        par->workers[i].par = par;
+    }
+    
+    par->threads = g_new0(GThread *, threads);
+    for (uint32_t i = 0; i < threads; i++) {
+        par->threads[i] = g_thread_new("sav-decode", par_worker_main, &par->workers[i]);
+        par->thread_count++;
+    }
+    
+    ctx->par = par;
+    return ctx;
+}
+
+/* Read next SAV record as a borrowed view */
+gboolean sav_read_record_view(
+    sav_collector_ctx_t *ctx,
+    sav_record_view_t   *view,
+    GError              **err)
+{
+    if (!ctx || !view) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                    "NULL parameter in sav_read_record_view");
+        return FALSE;
+    }
+    
+    memset(view, 0, sizeof(*view));
+    sav_collector_release_view(ctx);
+    
+    /* err may be NULL; classify failures through a local error */
+    GError *local_err = NULL;
+    gboolean result;
+    if (ctx->par) {
+        result = par_next_view(ctx, view, &local_err);
+    } else if (ctx->udp) {
+        result = sav_udp_next_view(ctx, view, &local_err);
+    } else if (ctx->stream) {
+        g_set_error(&local_err, FB_ERROR_DOMAIN, FB_ERROR_IMPL,
+                    "Stream collectors deliver records through "
+                    "sav_stream_collector_run()");
+        result = FALSE;
+    } else if (ctx->fast) {
+        result = fast_next_view(ctx, view, &local_err);
+    } else {
+        result = fbuf_next_view(ctx, view, &local_err);
+    }
     
     if (!result) {
-        if (err && *err && (*err)->code == FB_ERROR_EOF) {
+        if (local_err && local_err->code == FB_ERROR_EOF) {
             /* End of file - not an error */
-            g_clear_error(err);
+            g_clear_error(&local_err);
+            return FALSE;
+        }
+        if (local_err && local_err->code == FB_ERROR_NLREAD) {
+            /* Receive timeout on a network collector - not a parse error */
+            g_propagate_error(err, local_err);
             return FALSE;
         }
         /* Real error */
-        ctx->parse_errors++;
+        SAV_STAT_ADD(ctx->parse_errors, 1);
+        g_propagate_error(err, local_err);
         return FALSE;
     }
     
-    /* Extract basic fields */
-    record->timestamp_ms = raw_record.observationTimeMilliseconds;
-    record->rule_type = raw_record.savRuleType;
-    record->target_type = raw_record.savTargetType;
-    record->policy_action = raw_record.savPolicyAction;
+    view->legacy_order = ctx->legacy_order;
+    SAV_STAT_ADD(ctx->records_read, 1);
+    return TRUE;
+}
+
+/* Helper: Undo the byte swap of a legacy exporter (see
+ * sav_collector_set_legacy_byte_order()) */
+static void legacy_to_host(uint16_t family, void *mappings, uint32_t count)
+{
+    if (family == 4) {
+        sav_ipv4_mapping_t *m = mappings;
+        for (uint32_t i = 0; i < count; i++) {
+            m[i].ingressInterface = GUINT32_SWAP_LE_BE(m[i].ingressInterface);
+            m[i].sourceIPv4Prefix = GUINT32_SWAP_LE_BE(m[i].sourceIPv4Prefix);
+        }
+    } else {
+        sav_ipv6_mapping_t *m = mappings;
+        for (uint32_t i = 0; i < count; i++) {
+            m[i].ingressInterface = GUINT32_SWAP_LE_BE(m[i].ingressInterface);
+        }
+    }
+}
+
+/* Decode one IPv4 mapping from a view */
+gboolean sav_record_view_get_ipv4(
+    const sav_record_view_t *view,
+    uint32_t                index,
+    sav_ipv4_mapping_t      *mapping)
+{
+    if (!view || !mapping || !view->entries || index >= view->mapping_count) {
+        return FALSE;
+    }
     
-    /* Parse SubTemplateList */
-    if (!parse_subtmpl_list(&raw_record.savMatchedContentList, record, err)) {
-        ctx->parse_errors++;
-        fbSubTemplateListClear(&raw_record.savMatchedContentList);
+    const uint8_t *entry = view->entries + (size_t)index * view->entry_stride;
+    
+    if (view->sub_template_id == SAV_TMPL_IPV4_INTERFACE_PREFIX) {
+        sav_decode_ipv4_interface_prefix(entry, mapping);
+    } else if (view->sub_template_id == SAV_TMPL_IPV4_PREFIX_INTERFACE) {
+        sav_decode_ipv4_prefix_interface(entry, mapping);
+    } else {
         return FALSE;
     }
     
-    /* Clean up SubTemplateList */
-    fbSubTemplateListClear(&raw_record.savMatchedContentList);
+    /* Match the host-order values libfixbuf produces */
+    if (view->wire_order) {
+        mapping->ingressInterface = ntohl(mapping->ingressInterface);
+        mapping->sourceIPv4Prefix = ntohl(mapping->sourceIPv4Prefix);
+    }
+    if (view->legacy_order) {
+        legacy_to_host(4, mapping, 1);
+    }
+    
+    return TRUE;
+}
+
+/* Decode one IPv6 mapping from a view */
+gboolean sav_record_view_get_ipv6(
+    const sav_record_view_t *view,
+    uint32_t                index,
+    sav_ipv6_mapping_t      *mapping)
+{
+    if (!view || !mapping || !view->entries || index >= view->mapping_count) {
+        return FALSE;
+    }
+    
+    const uint8_t *entry = view->entries + (size_t)index * view->entry_stride;
+    
+    if (view->sub_template_id == SAV_TMPL_IPV6_INTERFACE_PREFIX) {
+        sav_decode_ipv6_interface_prefix(entry, mapping);
+    } else if (view->sub_template_id == SAV_TMPL_IPV6_PREFIX_INTERFACE) {
+        sav_decode_ipv6_prefix_interface(entry, mapping);
+    } else {
+        return FALSE;
+    }
+    
+    if (view->wire_order) {
+        mapping->ingressInterface = ntohl(mapping->ingressInterface);
+    }
+    if (view->legacy_order) {
+        legacy_to_host(6, mapping, 1);
+    }
     
-    ctx->records_read++;
     return TRUE;
 }
 
+/* Copy a view into a parsed record; mappings come from the arena, or from
+ * the heap when arena is NULL */
+static void view_to_record(
+    const sav_record_view_t *view,
+    sav_parsed_record_t     *record,
+    sav_arena_t             *arena)
+{
+    record->timestamp_ms = view->timestamp_ms;
+    record->rule_type = view->rule_type;
+    record->target_type = view->target_type;
+    record->policy_action = view->policy_action;
+    record->sub_template_id = view->sub_template_id;
+    record->mapping_count = view->mapping_count;
+    record->mappings.ipv4_mappings = NULL;
+    
+    if (view->mapping_count == 0) {
+        return;
+    }
+    
+    /* One kernel for the whole list instead of a branch per entry */
+    const sav_sub_template_layout_t *layout = sav_sub_template_layout(view->sub_template_id);
+    if (!layout) {
+        record->mapping_count = 0;
+        return;
+    }
+    size_t size = view->mapping_count * (layout->family == 4 ? sizeof(sav_ipv4_mapping_t)
+                                                            : sizeof(sav_ipv6_mapping_t));
+    void *m = arena ? sav_arena_alloc(arena, size) : g_malloc(size);
+    layout->decode_n(view->entries, view->entry_stride, view->mapping_count, m,
+                     view->wire_order);
+    if (view->legacy_order) {
+        legacy_to_host(layout->family, m, view->mapping_count);
+    }
+    record->mappings.ipv4_mappings = m;
+}
+
+/* Read a batch of records into arena storage */
+uint32_t sav_read_batch(
+    sav_collector_ctx_t *ctx,
+    sav_parsed_record_t *records,
+    uint32_t            max_records,
+    sav_arena_t         *arena,
+    GError              **err)
+{
+    if (!ctx || !records || !arena) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                    "NULL parameter in sav_read_batch");
+        return 0;
+    }
+    
+    uint32_t n = 0;
+    sav_record_view_t view;
+    
+    while (n < max_records && sav_read_record_view(ctx, &view, err)) {
+        view_to_record(&view, &records[n++], arena);
+    }
+    
+    return n;
+}
+
 /* Free parsed record */
 void sav_free_parsed_record(sav_parsed_record_t *record)
 {
@@ -233,6 +1056,19 @@ void sav_collector_ctx_destroy(sav_collector_ctx_t *ctx)
 {
     if (!ctx) return;
 
+    sav_collector_release_view(ctx);
+    par_destroy(ctx->par);
+    sav_udp_destroy(ctx->udp);
+    sav_stream_destroy(ctx->stream);
+    if (ctx->fast_fp) {
+        fclose(ctx->fast_fp);
+    }
+    if (ctx->map) {
+        sav_mmap_close(ctx->map);
+        g_free(ctx->map);
+    }
+    g_free(ctx->fast);
+    g_free(ctx->msg_buf);
     if (ctx->fbuf) {
         fBufFree(ctx->fbuf);
     }
@@ -255,6 +1091,22 @@ void sav_close_collector(sav_collector_ctx_t *ctx)
     sav_collector_ctx_destroy(ctx);
 }
 
+/* Read files of a legacy exporter */
+gboolean sav_collector_set_legacy_byte_order(
+    sav_collector_ctx_t *ctx,
+    gboolean            legacy,
+    GError              **err)
+{
+    if (!ctx) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                    "NULL parameter in sav_collector_set_legacy_byte_order");
+        return FALSE;
+    }
+    
+    ctx->legacy_order = legacy;
+    return TRUE;
+}
+
 /* Get statistics */
 void sav_collector_get_stats(
     sav_collector_ctx_t *ctx,
@@ -262,8 +1114,15 @@ void sav_collector_get_stats(
     uint64_t            *parse_errors)
 {
     if (ctx) {
-        if (records_read) *records_read = ctx->records_read;
-        if (parse_errors) *parse_errors = ctx->parse_errors;
+        uint64_t records = SAV_STAT_GET(ctx->records_read);
+        uint64_t errors = SAV_STAT_GET(ctx->parse_errors);
+        
+        /* Sharded UDP and stream workers count into their own state */
+        sav_udp_add_worker_stats(ctx->udp, &records, &errors);
+        sav_stream_add_worker_stats(ctx->stream, &records, &errors);
+        
+        if (records_read) *records_read = records;
+        if (parse_errors) *parse_errors = errors;
     }
 }
 
@@ -295,120 +1154,34 @@ void sav_print_record(
             if (is_ipv4) {
                 sav_ipv4_mapping_t *m = &record->mappings.ipv4_mappings[i];
                 struct in_addr addr;
-                addr.s_addr = m->sourceIPv4Prefix;
+                addr.s_addr = htonl(m->sourceIPv4Prefix);
                 char ip_str[INET_ADDRSTRLEN];
                 inet_ntop(AF_INET, &addr, ip_str, sizeof(ip_str));
                 
                 fprintf(output, "  [%u] Interface %u <-> %s/%u\n",
-                        i, ntohl(m->ingressInterface), ip_str, m->sourceIPv4PrefixLength);
+                        i, m->ingressInterface, ip_str, m->sourceIPv4PrefixLength);
             } else {
                 sav_ipv6_mapping_t *m = &record->mappings.ipv6_mappings[i];
                 char ip_str[INET6_ADDRSTRLEN];
                 inet_ntop(AF_INET6, m->sourceIPv6Prefix, ip_str, sizeof(ip_str));
                 
                 fprintf(output, "  [%u] Interface %u <-> %s/%u\n",
-                        i, ntohl(m->ingressInterface), ip_str, m->sourceIPv6PrefixLength);
+                        i, m->ingressInterface, ip_str, m->sourceIPv6PrefixLength);
             }
         }
     }
     fprintf(output, "\n");
 }
 
-/* Export to JSON */
-void sav_export_record_json(
-    const sav_parsed_record_t *record,
-    FILE                      *output)
-{
-    if (!record || !output) return;
-    
-    fprintf(output, "{\n");
-    fprintf(output, "  \"timestamp_ms\": %lu,\n", (unsigned long)record->timestamp_ms);
-    fprintf(output, "  \"rule_type\": %u,\n", record->rule_type);
-    fprintf(output, "  \"rule_type_name\": \"%s\",\n", sav_rule_type_name(record->rule_type));
-    fprintf(output, "  \"target_type\": %u,\n", record->target_type);
-    fprintf(output, "  \"target_type_name\": \"%s\",\n", sav_target_type_name(record->target_type));
-    fprintf(output, "  \"policy_action\": %u,\n", record->policy_action);
-    fprintf(output, "  \"policy_action_name\": \"%s\",\n", sav_policy_action_name(record->policy_action));
-    fprintf(output, "  \"sub_template_id\": %u,\n", record->sub_template_id);
-    fprintf(output, "  \"mapping_count\": %u,\n", record->mapping_count);
-    fprintf(output, "  \"mappings\": [\n");
-    
-    gboolean is_ipv4 = (record->sub_template_id == SAV_TMPL_IPV4_INTERFACE_PREFIX ||
-                        record->sub_template_id == SAV_TMPL_IPV4_PREFIX_INTERFACE);
-    
-    for (uint32_t i = 0; i < record->mapping_count; i++) {
-        fprintf(output, "    {\n");
-        
-        if (is_ipv4) {
-            sav_ipv4_mapping_t *m = &record->mappings.ipv4_mappings[i];
-            struct in_addr addr;
-            addr.s_addr = m->sourceIPv4Prefix;
-            char ip_str[INET_ADDRSTRLEN];
-            inet_ntop(AF_INET, &addr, ip_str, sizeof(ip_str));
-            
-            fprintf(output, "      \"interface\": %u,\n", ntohl(m->ingressInterface));
-            fprintf(output, "      \"prefix\": \"%s\",\n", ip_str);
-            fprintf(output, "      \"prefix_length\": %u\n", m->sourceIPv4PrefixLength);
-        } else {
-            sav_ipv6_mapping_t *m = &record->mappings.ipv6_mappings[i];
-            char ip_str[INET6_ADDRSTRLEN];
-            inet_ntop(AF_INET6, m->sourceIPv6Prefix, ip_str, sizeof(ip_str));
-            
-            fprintf(output, "      \"interface\": %u,\n", ntohl(m->ingressInterface));
-            fprintf(output, "      \"prefix\": \"%s\",\n", ip_str);
-            fprintf(output, "      \"prefix_length\": %u\n", m->sourceIPv6PrefixLength);
-        }
-        
-        fprintf(output, "    }%s\n", (i < record->mapping_count - 1) ? "," : "");
-    }
-    
-    fprintf(output, "  ]\n");
-    fprintf(output, "}\n");
-}
-
 /* Validate record */
 gboolean sav_validate_record(
     const sav_parsed_record_t *record,
     GError                    **err)
 {
-    if (!record) {
-        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP, "NULL record");
-        return FALSE;
-    }
-    
-    /* Validate enum values */
-    if (!sav_validate_rule_type(record->rule_type)) {
-        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
-                    "Invalid rule_type: %u", record->rule_type);
-        return FALSE;
-    }
-    
-    if (!sav_validate_target_type(record->target_type)) {
-        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
-                    "Invalid target_type: %u", record->target_type);
-        return FALSE;
-    }
-    
-    if (!sav_validate_policy_action(record->policy_action)) {
-        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
-                    "Invalid policy_action: %u", record->policy_action);
+    if (!sav_validate_record_header(record, err)) {
         return FALSE;
     }
     
-    /* Validate template ID matches target type */
-    uint16_t expected_tmpl = sav_get_template_id(record->rule_type, record->target_type);
-    if (record->sub_template_id != expected_tmpl && 
-        record->sub_template_id != expected_tmpl + 1) { /* Allow IPv4/IPv6 variance */
-        /* More flexible check */
-        gboolean valid_tmpl = (record->sub_template_id >= SAV_TMPL_IPV4_INTERFACE_PREFIX &&
-                               record->sub_template_id <= SAV_TMPL_IPV6_PREFIX_INTERFACE);
-        if (!valid_tmpl) {
-            g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
-                        "Invalid sub-template ID: %u", record->sub_template_id);
-            return FALSE;
-        }
-    }
-    
     /* Validate prefix lengths */
     gboolean is_ipv4 = (record->sub_template_id == SAV_TMPL_IPV4_INTERFACE_PREFIX ||
                         record->sub_template_id == SAV_TMPL_IPV4_PREFIX_INTERFACE);
@@ -0,0 +1,126 @@
+/**
+ * @file sav_collector_internal.h
+ * @brief Collector internals shared between the collector source files
+ *
+ * Not installed. The transport-specific collectors (file, UDP, TCP/SCTP)
+ * build on the same context setup and per-message decode path declared here.
+ */
+
+#ifndef SAV_COLLECTOR_INTERNAL_H
+#define SAV_COLLECTOR_INTERNAL_H
+
+#include "sav_collector.h"
+
+/*
+ * Statistics counters have a single writer (the thread reading from the
+ * context) but may be read from any thread, e.g. sav_collector_get_stats()
+ * while sharded UDP workers run. Relaxed atomic loads and stores keep that
+ * lock-free and compile to plain moves on common targets.
+ */
+#define SAV_STAT_ADD(counter, n) \
+    __atomic_store_n(&(counter), __atomic_load_n(&(counter), __ATOMIC_RELAXED) + (n), \
+                     __ATOMIC_RELAXED)
+#define SAV_STAT_SET(counter, v) __atomic_store_n(&(counter), (v), __ATOMIC_RELAXED)
+#define SAV_STAT_GET(counter)    __atomic_load_n(&(counter), __ATOMIC_RELAXED)
+
+/**
+ * Allocate a collector context with info model, session and SAV templates
+ *
+ * @param err  Error structure
+ *
+ * @return New context (no fBuf attached yet), NULL on error
+ */
+sav_collector_ctx_t* sav_collector_alloc(GError **err);
+
+/**
+ * Allocate a collector context on a caller-owned info model
+ *
+ * Like sav_collector_alloc(), but the session is created on model, which
+ * the context does not free. Sessions may add alien elements to their
+ * model, so contexts sharing a model must be used from one thread only.
+ *
+ * @param model  Info model with the SAV elements (see sav_init_info_model())
+ * @param err    Error structure
+ *
+ * @return New context (no fBuf attached yet), NULL on error
+ */
+sav_collector_ctx_t* sav_collector_alloc_shared(
+    fbInfoModel_t *model,
+    GError        **err);
+
+/**
+ * Create the collection buffer and set the internal template
+ *
+ * @param ctx        Context from sav_collector_alloc()
+ * @param collector  libfixbuf collector, or NULL for a buffer-fed fBuf
+ *                   (see sav_collector_load_message())
+ * @param err        Error structure
+ *
+ * @return TRUE on success, FALSE on error
+ */
+gboolean sav_collector_attach_fbuf(
+    sav_collector_ctx_t *ctx,
+    fbCollector_t       *collector,
+    GError              **err);
+
+/**
+ * Release the SubTemplateList backing the previous view, if any
+ *
+ * @param ctx  Collector context
+ */
+void sav_collector_release_view(sav_collector_ctx_t *ctx);
+
+/**
+ * Load one complete IPFIX message into a fast-path context
+ *
+ * The message is decoded natively when possible and otherwise handed to
+ * the buffer-fed libfixbuf fBuf. It must stay valid until all its records
+ * have been read with sav_collector_message_next_view().
+ *
+ * @param ctx      Context with fast decoder and buffer-fed fBuf
+ * @param msg      Message bytes, starting at the IPFIX message header
+ * @param msg_len  Message length in bytes
+ * @param err      Error structure
+ *
+ * @return TRUE on success, FALSE if the message is malformed
+ */
+gboolean sav_collector_load_message(
+    sav_collector_ctx_t *ctx,
+    const uint8_t       *msg,
+    size_t              msg_len,
+    GError              **err);
+
+/**
+ * Decode the next record of the message last loaded
+ *
+ * @param ctx   Context with fast decoder and buffer-fed fBuf
+ * @param view  Output: record view
+ * @param err   Error structure (must not be NULL)
+ *
+ * @return TRUE if a record was decoded; FALSE with *err unset at the end of
+ *         the message, FALSE with *err set on error
+ */
+gboolean sav_collector_message_next_view(
+    sav_collector_ctx_t *ctx,
+    sav_record_view_t   *view,
+    GError              **err);
+
+/* UDP transport (sav_udp_collector.c) */
+gboolean sav_udp_next_view(
+    sav_collector_ctx_t *ctx,
+    sav_record_view_t   *view,
+    GError              **err);
+void sav_udp_destroy(struct sav_udp *udp);
+void sav_udp_add_worker_stats(
+    const struct sav_udp *udp,
+    uint64_t             *records_read,
+    uint64_t             *parse_errors);
+
+/* TCP/SCTP transport (sav_stream_collector.c) */
+void sav_stream_destroy(struct sav_stream *stream);
+void sav_stream_add_worker_stats(
+    const struct sav_stream *stream,
+    uint64_t                *records_read,
+    uint64_t                *parse_errors);
+
+#endif /* SAV_COLLECTOR_INTERNAL_H */
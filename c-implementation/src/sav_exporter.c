@@ -8,6 +8,23 @@
 #include <string.h>
 #include <arpa/inet.h>
 #include "sav_exporter.h"
+#include "sav_layout.h"
+
+/* Helper: Make a cached sub-template the current one */
+static gboolean select_sub_template(sav_record_ctx_t *ctx, uint16_t tmpl_id, GError **err)
+{
+    fbTemplate_t *tmpl = ctx->sub_tmpls[tmpl_id - SAV_TMPL_IPV4_INTERFACE_PREFIX];
+    if (!tmpl) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                    "Cannot get internal template %u", tmpl_id);
+        return FALSE;
+    }
+    
+    ctx->sub_tmpl_id = tmpl_id; /* Store for later use */
+    ctx->sub_tmpl = tmpl;
+    ctx->entry_size = sav_sub_template_layout(tmpl_id)->entry_size;
+    return TRUE;
+}
 
 /* Initialize a SAV record context */
 gboolean sav_record_ctx_init(
@@ -41,34 +58,27 @@ gboolean sav_record_ctx_init(
         return FALSE;
     }
     
-    /* Determine which sub-template to use based on rule_type and target_type */
-    uint16_t tmpl_id = sav_get_template_id(rule_type, target_type);
-    ctx->sub_tmpl_id = tmpl_id; /* Store for later use */
-    
     /* CRITICAL FIX (from YAF analysis): Use INTERNAL template pointer for SubTemplateList!
      * YAF always uses internal template pointers in fbSubTemplateListInit().
      * The internal template must be registered via fbSessionAddTemplate(session, TRUE, ...).
      * Both internal and external templates must be registered for SubTemplateList to work.
+     * All four are looked up once so that sav_record_ctx_reset() can switch freely.
      */
-    ctx->sub_tmpl = fbSessionGetTemplate(session, TRUE, tmpl_id, err);
-    if (!ctx->sub_tmpl) {
-        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
-                    "Cannot get internal template %u", tmpl_id);
-        return FALSE;
+    for (uint16_t i = 0; i < SAV_SUB_TEMPLATE_COUNT; i++) {
+        GError *tmp_err = NULL;
+        ctx->sub_tmpls[i] = fbSessionGetTemplate(session, TRUE,
+                                                 SAV_TMPL_IPV4_INTERFACE_PREFIX + i, &tmp_err);
+        g_clear_error(&tmp_err);
     }
-    g_debug("Got internal template %u for SubTemplateList", tmpl_id);
     
-    /* Calculate entry size based on sub-template */
-    /* Template 901/902: ingressInterface(4) + prefix(4/16) + prefixLen(1) = 9/21 bytes */
-    /* Template 903/904: prefix(4/16) + prefixLen(1) + ingressInterface(4) = 9/21 bytes */
-    if (tmpl_id == SAV_TMPL_IPV4_INTERFACE_PREFIX || tmpl_id == SAV_TMPL_IPV4_PREFIX_INTERFACE) {
-        ctx->entry_size = 4 + 4 + 1; /* interface(4) + ipv4(4) + prefixlen(1) = 9 */
-    } else {
-        ctx->entry_size = 4 + 16 + 1; /* interface(4) + ipv6(16) + prefixlen(1) = 21 */
+    /* Determine which sub-template to use based on rule_type and target_type */
+    if (!select_sub_template(ctx, sav_get_template_id(rule_type, target_type), err)) {
+        return FALSE;
     }
+    g_debug("Got internal template %u for SubTemplateList", ctx->sub_tmpl_id);
     
-    /* Allocate buffer for SubTemplateList entries */
-    ctx->stl_capacity = ctx->entry_size * SAV_MAX_LIST_ENTRIES;
+    /* Allocate buffer for SubTemplateList entries; it grows on demand */
+    ctx->stl_capacity = ctx->entry_size * SAV_STL_INITIAL_ENTRIES;
     ctx->stl_buffer = g_malloc0(ctx->stl_capacity);
     if (!ctx->stl_buffer) {
         g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
@@ -77,7 +87,77 @@ gboolean sav_record_ctx_init(
     }
     
     ctx->entry_count = 0;
+    ctx->msg_budget = SAV_DEFAULT_MSG_BUDGET;
+    
+    return TRUE;
+}
+
+/* Start a new record on an initialized context */
+gboolean sav_record_ctx_reset(
+    sav_record_ctx_t *ctx,
+    uint8_t          rule_type,
+    uint8_t          target_type,
+    GError           **err)
+{
+    if (!ctx || !ctx->stl_buffer) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP, "Context not initialized");
+        return FALSE;
+    }
+    
+    if (!sav_validate_rule_type(rule_type) || !sav_validate_target_type(target_type)) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                    "Invalid rule_type (%u) or target_type (%u)", rule_type, target_type);
+        return FALSE;
+    }
     
+    if (!select_sub_template(ctx, sav_get_template_id(rule_type, target_type), err)) {
+        return FALSE;
+    }
+    
+    ctx->entry_count = 0;
+    for (uint16_t i = 0; i < SAV_SUB_TEMPLATE_COUNT; i++) {
+        ctx->lanes[i].entry_count = 0;
+    }
+    ctx->records_exported = 0;
+    return TRUE;
+}
+
+/* Set the record size budget */
+gboolean sav_record_ctx_set_msg_budget(
+    sav_record_ctx_t *ctx,
+    size_t           msg_budget,
+    GError           **err)
+{
+    if (!ctx || !ctx->stl_buffer) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP, "Context not initialized");
+        return FALSE;
+    }
+    
+    /* Any list may hold IPv6 entries, so one of those must fit */
+    size_t min_budget = SAV_RECORD_FIXED_BYTES + SAV_MAX_ENTRY_SIZE;
+    if (msg_budget < min_budget || msg_budget > SAV_DEFAULT_MSG_BUDGET) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                    "Record budget %zu out of range (%zu-%u)", msg_budget,
+                    min_budget, SAV_DEFAULT_MSG_BUDGET);
+        return FALSE;
+    }
+    
+    ctx->msg_budget = msg_budget;
+    return TRUE;
+}
+
+/* Former in-place export switch, kept for source compatibility */
+gboolean sav_record_ctx_set_direct(
+    sav_record_ctx_t *ctx,
+    gboolean         direct,
+    GError           **err)
+{
+    if (!ctx || !ctx->stl_buffer) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP, "Context not initialized");
+        return FALSE;
+    }
+    
+    (void)direct;
     return TRUE;
 }
 
@@ -85,25 +165,98 @@ gboolean sav_record_ctx_init(
 void sav_record_ctx_cleanup(sav_record_ctx_t *ctx)
 {
     if (ctx) {
+        if (ctx->list_tmpl_id) {
+            fbSubTemplateListClear(&ctx->record.savMatchedContentList);
+        }
         if (ctx->stl_buffer) {
             g_free(ctx->stl_buffer);
             ctx->stl_buffer = NULL;
         }
+        for (uint16_t i = 0; i < SAV_SUB_TEMPLATE_COUNT; i++) {
+            g_free(ctx->lanes[i].buffer);
+        }
         memset(ctx, 0, sizeof(*ctx));
     }
 }
 
-/* Helper: Check if there's space for one more entry */
-static gboolean check_capacity(sav_record_ctx_t *ctx, GError **err)
+/* Helper: Staging list of one sub-template, either the primary list held in
+ * the context's own fields or one of ctx->lanes */
+typedef struct lane_ref {
+    uint16_t     tmpl_id;
+    fbTemplate_t *tmpl;
+    size_t       entry_size;
+    uint8_t      **buffer;
+    size_t       *capacity;
+    uint32_t     *count;
+} lane_ref_t;
+
+/* Helper: The primary list */
+static lane_ref_t primary_lane(sav_record_ctx_t *ctx)
+{
+    lane_ref_t lane = {
+        ctx->sub_tmpl_id, ctx->sub_tmpl, ctx->entry_size,
+        &ctx->stl_buffer, &ctx->stl_capacity, &ctx->entry_count
+    };
+    return lane;
+}
+
+/* Helper: The list that entries of tmpl_id are staged in */
+static lane_ref_t lane_for(sav_record_ctx_t *ctx, uint16_t tmpl_id)
+{
+    if (tmpl_id == ctx->sub_tmpl_id) {
+        return primary_lane(ctx);
+    }
+    
+    uint16_t i = tmpl_id - SAV_TMPL_IPV4_INTERFACE_PREFIX;
+    lane_ref_t lane = {
+        tmpl_id, ctx->sub_tmpls[i], sav_sub_template_layout(tmpl_id)->entry_size,
+        &ctx->lanes[i].buffer, &ctx->lanes[i].capacity, &ctx->lanes[i].entry_count
+    };
+    return lane;
+}
+
+/* Helper: Make room for one more entry, doubling the buffer when full */
+static gboolean check_capacity(const lane_ref_t *lane, GError **err)
 {
-    if (ctx->entry_count >= SAV_MAX_LIST_ENTRIES) {
+    if ((size_t)(*lane->count + 1) * lane->entry_size <= *lane->capacity) {
+        return TRUE;
+    }
+    
+    if (*lane->count == UINT32_MAX) {
         g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
-                    "SubTemplateList capacity exceeded (%u entries)", SAV_MAX_LIST_ENTRIES);
+                    "SubTemplateList capacity exceeded (%u entries)", UINT32_MAX);
         return FALSE;
     }
+    
+    /* Geometric growth keeps adding n entries O(n) overall */
+    size_t needed = (size_t)(*lane->count + 1) * lane->entry_size;
+    size_t capacity = *lane->capacity ? *lane->capacity
+                                      : lane->entry_size * SAV_STL_INITIAL_ENTRIES;
+    while (capacity < needed) {
+        capacity *= 2;
+    }
+    *lane->buffer = g_realloc(*lane->buffer, capacity);
+    *lane->capacity = capacity;
     return TRUE;
 }
 
+/* Helper: Reserve the next entry of sub-template tmpl_id's list */
+static uint8_t *stage_entry(sav_record_ctx_t *ctx, uint16_t tmpl_id, GError **err)
+{
+    lane_ref_t lane = lane_for(ctx, tmpl_id);
+    
+    if (!lane.tmpl) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                    "Cannot get internal template %u", tmpl_id);
+        return NULL;
+    }
+    if (!check_capacity(&lane, err)) {
+        return NULL;
+    }
+    
+    return *lane.buffer + (size_t)(*lane.count)++ * lane.entry_size;
+}
+
 /* Add IPv4 Interface-to-Prefix entry */
 gboolean sav_add_ipv4_interface_prefix(
     sav_record_ctx_t *ctx,
@@ -117,26 +270,21 @@ gboolean sav_add_ipv4_interface_prefix(
         return FALSE;
     }
     
-    if (!check_capacity(ctx, err)) {
-        return FALSE;
-    }
-    
     if (prefix_len > 32) {
         g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
                     "Invalid IPv4 prefix length: %u", prefix_len);
         return FALSE;
     }
     
-    /* Calculate offset for new entry */
-    uint8_t *entry = ctx->stl_buffer + (ctx->entry_count * ctx->entry_size);
+    uint8_t *entry = stage_entry(ctx, SAV_TMPL_IPV4_INTERFACE_PREFIX, err);
+    if (!entry) {
+        return FALSE;
+    }
     
-    /* Write entry: ingressInterface(4) + sourceIPv4Prefix(4) + sourceIPv4PrefixLength(1) */
-    uint32_t interface_be = htonl(interface_id);
-    memcpy(entry, &interface_be, 4);
-    memcpy(entry + 4, &prefix, 4); /* prefix already in network byte order */
-    entry[8] = prefix_len;
+    /* The record holds host-order values; libfixbuf writes them big-endian */
+    uint32_t host_prefix = ntohl(prefix);
+    sav_encode_ipv4_interface_prefix(entry, interface_id, &host_prefix, prefix_len);
     
-    ctx->entry_count++;
     return TRUE;
 }
 
@@ -154,26 +302,19 @@ gboolean sav_add_ipv6_interface_prefix(
         return FALSE;
     }
     
-    if (!check_capacity(ctx, err)) {
-        return FALSE;
-    }
-    
     if (prefix_len > 128) {
         g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
                     "Invalid IPv6 prefix length: %u", prefix_len);
         return FALSE;
     }
     
-    /* Calculate offset for new entry */
-    uint8_t *entry = ctx->stl_buffer + (ctx->entry_count * ctx->entry_size);
+    uint8_t *entry = stage_entry(ctx, SAV_TMPL_IPV6_INTERFACE_PREFIX, err);
+    if (!entry) {
+        return FALSE;
+    }
     
-    /* Write entry: ingressInterface(4) + sourceIPv6Prefix(16) + sourceIPv6PrefixLength(1) */
-    uint32_t interface_be = htonl(interface_id);
-    memcpy(entry, &interface_be, 4);
-    memcpy(entry + 4, prefix, 16);
-    entry[20] = prefix_len;
+    sav_encode_ipv6_interface_prefix(entry, interface_id, prefix, prefix_len);
     
-    ctx->entry_count++;
     return TRUE;
 }
 
@@ -190,26 +331,21 @@ gboolean sav_add_ipv4_prefix_interface(
         return FALSE;
     }
     
-    if (!check_capacity(ctx, err)) {
-        return FALSE;
-    }
-    
     if (prefix_len > 32) {
         g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
                     "Invalid IPv4 prefix length: %u", prefix_len);
         return FALSE;
     }
     
-    /* Calculate offset for new entry */
-    uint8_t *entry = ctx->stl_buffer + (ctx->entry_count * ctx->entry_size);
+    uint8_t *entry = stage_entry(ctx, SAV_TMPL_IPV4_PREFIX_INTERFACE, err);
+    if (!entry) {
+        return FALSE;
+    }
     
-    /* Write entry: sourceIPv4Prefix(4) + sourceIPv4PrefixLength(1) + ingressInterface(4) */
-    memcpy(entry, &prefix, 4); /* prefix already in network byte order */
-    entry[4] = prefix_len;
-    uint32_t interface_be = htonl(interface_id);
-    memcpy(entry + 5, &interface_be, 4);
+    /* The record holds host-order values; libfixbuf writes them big-endian */
+    uint32_t host_prefix = ntohl(prefix);
+    sav_encode_ipv4_prefix_interface(entry, interface_id, &host_prefix, prefix_len);
     
-    ctx->entry_count++;
     return TRUE;
 }
 
@@ -227,29 +363,147 @@ gboolean sav_add_ipv6_prefix_interface(
         return FALSE;
     }
     
-    if (!check_capacity(ctx, err)) {
-        return FALSE;
-    }
-    
     if (prefix_len > 128) {
         g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
                     "Invalid IPv6 prefix length: %u", prefix_len);
         return FALSE;
     }
     
-    /* Calculate offset for new entry */
-    uint8_t *entry = ctx->stl_buffer + (ctx->entry_count * ctx->entry_size);
+    uint8_t *entry = stage_entry(ctx, SAV_TMPL_IPV6_PREFIX_INTERFACE, err);
+    if (!entry) {
+        return FALSE;
+    }
     
-    /* Write entry: sourceIPv6Prefix(16) + sourceIPv6PrefixLength(1) + ingressInterface(4) */
-    memcpy(entry, prefix, 16);
-    entry[16] = prefix_len;
-    uint32_t interface_be = htonl(interface_id);
-    memcpy(entry + 17, &interface_be, 4);
+    sav_encode_ipv6_prefix_interface(entry, interface_id, prefix, prefix_len);
     
-    ctx->entry_count++;
     return TRUE;
 }
 
+/* Helper: Size the context's list for count entries of a lane's sub-template
+ * and return its data pointer. The list is initialized once per sub-template
+ * and then only resized, which keeps the allocation while the entry count
+ * stays the same. */
+static void *prepare_list(sav_record_ctx_t *ctx, const lane_ref_t *lane, uint32_t count)
+{
+    fbSubTemplateList_t *stl = &ctx->record.savMatchedContentList;
+    
+    if (ctx->list_tmpl_id == lane->tmpl_id) {
+        return fbSubTemplateListRealloc(stl, (uint16_t)count);
+    }
+    if (ctx->list_tmpl_id) {
+        fbSubTemplateListClear(stl);
+    }
+    
+    /* CRITICAL FIX: Correctly call fbSubTemplateListInit with all 5 arguments */
+    /* The semantic 3 means 'allOf' as used by YAF (libfixbuf convention) */
+    /* NOTE: RFC 6313 defines 0xFF, but libfixbuf uses 3 internally */
+    ctx->list_tmpl_id = lane->tmpl_id;
+    return fbSubTemplateListInit(stl,
+                                 3,                  /* semantic: 3 = allOf (libfixbuf convention) */
+                                 lane->tmpl_id,      /* external template ID */
+                                 lane->tmpl,         /* internal template pointer, MUST NOT be NULL */
+                                 (uint16_t)count);
+}
+
+/* Append one template-400 record holding entries [first, first + count) of a list */
+static gboolean export_list_chunk(
+    sav_record_ctx_t *ctx,
+    const lane_ref_t *lane,
+    fBuf_t           *exporter,
+    uint64_t         timestamp_ms,
+    uint8_t          rule_type,
+    uint8_t          target_type,
+    uint8_t          policy_action,
+    uint32_t         first,
+    uint32_t         count,
+    GError           **err)
+{
+    /* Fill in the context's SAV main record; its list outlives the record */
+    sav_data_record_t *record = &ctx->record;
+    
+    record->observationTimeMilliseconds = timestamp_ms;
+    record->savRuleType = rule_type;
+    record->savTargetType = target_type;
+    record->savPolicyAction = policy_action;
+    
+    /* CRITICAL: Template pointer MUST be valid even for empty lists!
+     * Based on testing: libfixbuf will pre-allocate buffer if entry_count > 0
+     */
+    g_debug("sav_export_record: sub_tmpl_id=%u, entries %u-%u of %u, entry_size=%zu",
+            lane->tmpl_id, first, first + count, *lane->count, lane->entry_size);
+    
+    void *stl_data = prepare_list(ctx, lane, count);
+    
+    /* If we have entries, copy them to the pre-allocated buffer */
+    if (count > 0) {
+        if (!stl_data) {
+            g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                        "SubTemplateList data pointer is NULL (expected pre-allocated)");
+            return FALSE;
+        }
+        /* Copy all entries of this record at once */
+        memcpy(stl_data, *lane->buffer + (size_t)first * lane->entry_size,
+               (size_t)count * lane->entry_size);
+    }
+    
+    /* Append record to exporter; the list is kept for the next record */
+    return fBufAppend(exporter, (uint8_t *)record, sizeof(*record), err);
+}
+
+/* Export one list as one or more records, each within the record budget */
+static gboolean export_list(
+    sav_record_ctx_t *ctx,
+    const lane_ref_t *lane,
+    fBuf_t           *exporter,
+    uint64_t         timestamp_ms,
+    uint8_t          rule_type,
+    uint8_t          target_type,
+    uint8_t          policy_action,
+    uint32_t         first_entry,
+    uint32_t         entry_count,
+    GError           **err)
+{
+    /* Split the list so that every record fits into a message on its own */
+    size_t budget = ctx->msg_budget ? ctx->msg_budget : SAV_DEFAULT_MSG_BUDGET;
+    uint32_t per_record = (uint32_t)((budget - SAV_RECORD_FIXED_BYTES) / lane->entry_size);
+    uint32_t done = 0;
+    uint32_t records = 0;
+    
+    do {
+        uint32_t count = entry_count - done;
+        if (count > per_record) {
+            count = per_record;
+        }
+        
+        if (!export_list_chunk(ctx, lane, exporter, timestamp_ms, rule_type, target_type,
+                               policy_action, first_entry + done, count, err)) {
+            return FALSE;
+        }
+        ctx->records_exported++;
+        records++;
+        done += count;
+    } while (done < entry_count);
+    
+    if (records > 1) {
+        g_debug("sav_export_record: split %u entries into %u records",
+                entry_count, records);
+    }
+    
+    return TRUE;
+}
+
+/* Helper: Entries staged outside the primary list */
+static uint64_t lane_entries(const sav_record_ctx_t *ctx)
+{
+    uint64_t n = 0;
+    for (uint16_t i = 0; i < SAV_SUB_TEMPLATE_COUNT; i++) {
+        if (SAV_TMPL_IPV4_INTERFACE_PREFIX + i != ctx->sub_tmpl_id) {
+            n += ctx->lanes[i].entry_count;
+        }
+    }
+    return n;
+}
+
 /* Export a complete SAV record */
 gboolean sav_export_record(
     sav_record_ctx_t *ctx,
@@ -260,7 +514,7 @@ gboolean sav_export_record(
     uint8_t          policy_action,
     GError           **err)
 {
-    if (!ctx || !exporter) {
+    if (!ctx || !exporter || !ctx->entry_size) {
         g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
                     "Invalid parameters to sav_export_record");
         return FALSE;
@@ -272,77 +526,110 @@ gboolean sav_export_record(
         return FALSE;
     }
     
-    /* Internal template should already be set by sav_create_file_exporter */
-    /* Prepare SAV main record structure */
-    sav_data_record_t record;
-    memset(&record, 0, sizeof(record));
+    /* CRITICAL: Set both internal and export templates before fBufAppend
+     * Using libfixbuf 3.x API */
+    if (!fBufSetTemplatesForExport(exporter, SAV_MAIN_TEMPLATE_ID, err)) {
+        return FALSE;
+    }
     
-    record.observationTimeMilliseconds = timestamp_ms;
-    record.savRuleType = rule_type;
-    record.savTargetType = target_type;
-    record.savPolicyAction = policy_action;
+    ctx->records_exported = 0;
     
-    /* Initialize SubTemplateList for export
-     * CRITICAL: Template pointer MUST be valid even for empty lists!
-     * Based on testing: libfixbuf will pre-allocate buffer if entry_count > 0
-     */
-    g_debug("sav_export_record: sub_tmpl_id=%u, entry_count=%u, entry_size=%zu",
-            ctx->sub_tmpl_id, ctx->entry_count, ctx->entry_size);
+    /* The primary list goes out even when empty, unless entries of the
+     * other sub-templates make up the record instead */
+    lane_ref_t lane = primary_lane(ctx);
+    if (ctx->entry_count > 0 || lane_entries(ctx) == 0) {
+        if (!export_list(ctx, &lane, exporter, timestamp_ms, rule_type, target_type,
+                         policy_action, 0, ctx->entry_count, err)) {
+            return FALSE;
+        }
+    }
     
-    /* CRITICAL FIX: Correctly call fbSubTemplateListInit with all 5 arguments */
-    /* The semantic 3 means 'allOf' as used by YAF (libfixbuf convention) */
-    /* NOTE: RFC 6313 defines 0xFF, but libfixbuf uses 3 internally */
-    fbSubTemplateListInit(&record.savMatchedContentList, 
-                          3,                  /* semantic: 3 = allOf (libfixbuf convention) */
-                          ctx->sub_tmpl_id,   /* external template ID */
-                          ctx->sub_tmpl,      /* internal template pointer, MUST NOT be NULL */
-                          ctx->entry_count);
-
+    /* One record per other sub-template with entries, e.g. the IPv6 list
+     * of a dual-stack table */
+    for (uint16_t i = 0; i < SAV_SUB_TEMPLATE_COUNT; i++) {
+        uint16_t tmpl_id = SAV_TMPL_IPV4_INTERFACE_PREFIX + i;
+        if (tmpl_id == ctx->sub_tmpl_id || ctx->lanes[i].entry_count == 0) {
+            continue;
+        }
+        lane = lane_for(ctx, tmpl_id);
+        if (!export_list(ctx, &lane, exporter, timestamp_ms, rule_type, target_type,
+                         policy_action, 0, ctx->lanes[i].entry_count, err)) {
+            return FALSE;
+        }
+    }
+    
+    return TRUE;
+}
 
+/* Export many SAV records */
+gboolean sav_export_records_batch(
+    sav_record_ctx_t        *ctx,
+    fBuf_t                  *exporter,
+    const sav_record_desc_t *records,
+    size_t                  n_records,
+    GError                  **err)
+{
+    if (!ctx || !exporter || !ctx->entry_size || (!records && n_records)) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                    "Invalid parameters to sav_export_records_batch");
+        return FALSE;
+    }
     
-    /* If we have entries, copy them to the pre-allocated buffer */
-    if (ctx->entry_count > 0 && ctx->stl_buffer) {
-        void *stl_data = fbSubTemplateListGetDataPtr(&record.savMatchedContentList);
-        if (!stl_data) {
+    /* Slices index the primary list only */
+    if (lane_entries(ctx) > 0) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                    "Batch export needs all entries in template %u", ctx->sub_tmpl_id);
+        return FALSE;
+    }
+    
+    /* Validate everything first so that a bad descriptor writes nothing */
+    gboolean ipv6 = sav_sub_template_layout(ctx->sub_tmpl_id)->family == 6;
+    for (size_t i = 0; i < n_records; i++) {
+        const sav_record_desc_t *rec = &records[i];
+        
+        /* The list is encoded with the context's sub-template, so the
+         * header must describe that sub-template */
+        if (!sav_validate_rule_type(rec->rule_type) ||
+            !sav_validate_target_type(rec->target_type) ||
+            sav_get_template_id_for_family(rec->rule_type, rec->target_type, ipv6)
+                != ctx->sub_tmpl_id) {
             g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
-                        "SubTemplateList data pointer is NULL (expected pre-allocated)");
-            fbSubTemplateListClear(&record.savMatchedContentList);
+                        "Record %zu: rule_type (%u) / target_type (%u) do not match template %u",
+                        i, rec->rule_type, rec->target_type, ctx->sub_tmpl_id);
             return FALSE;
         }
-        /* Copy all entries at once */
-        memcpy(stl_data, ctx->stl_buffer, ctx->entry_count * ctx->entry_size);
-        g_debug("  Copied %u entries (%zu bytes total)", ctx->entry_count, 
-                ctx->entry_count * ctx->entry_size);
-        
-        /* Debug: Print first entry */
-        if (ctx->entry_size == 9) {
-            uint32_t *iface = (uint32_t *)stl_data;
-            uint32_t *prefix = (uint32_t *)(stl_data + 4);
-            uint8_t *len = (uint8_t *)(stl_data + 8);
-            g_debug("  First entry: iface=%u, prefix=0x%08x, len=%u", 
-                    ntohl(*iface), ntohl(*prefix), *len);
+        if (!sav_validate_policy_action(rec->policy_action)) {
+            g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                        "Record %zu: invalid policy_action: %u", i, rec->policy_action);
+            return FALSE;
+        }
+        if (rec->first_entry > ctx->entry_count ||
+            rec->entry_count > ctx->entry_count - rec->first_entry) {
+            g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                        "Record %zu: entries %u+%u out of range (%u staged)",
+                        i, rec->first_entry, rec->entry_count, ctx->entry_count);
+            return FALSE;
         }
     }
     
-    /* Verify STL before export */
-    uint16_t stl_tmpl_id = fbSubTemplateListGetTemplateID(&record.savMatchedContentList);
-    uint32_t stl_count = fbSubTemplateListCountElements(&record.savMatchedContentList);
-    g_debug("  Before fBufAppend: STL tmpl_id=%u, count=%u", stl_tmpl_id, stl_count);
-    
-    /* CRITICAL: Set both internal and export templates before fBufAppend
-     * Using libfixbuf 3.x API */
+    /* Templates are the same for every record; select them once */
     if (!fBufSetTemplatesForExport(exporter, SAV_MAIN_TEMPLATE_ID, err)) {
-        fbSubTemplateListClear(&record.savMatchedContentList);
         return FALSE;
     }
     
-    /* Append record to exporter */
-    gboolean result = fBufAppend(exporter, (uint8_t *)&record, sizeof(record), err);
-    
-    /* Clean up SubTemplateList */
-    fbSubTemplateListClear(&record.savMatchedContentList);
+    lane_ref_t lane = primary_lane(ctx);
+    ctx->records_exported = 0;
+    for (size_t i = 0; i < n_records; i++) {
+        const sav_record_desc_t *rec = &records[i];
+        
+        if (!export_list(ctx, &lane, exporter, rec->timestamp_ms, rec->rule_type,
+                         rec->target_type, rec->policy_action, rec->first_entry,
+                         rec->entry_count, err)) {
+            return FALSE;
+        }
+    }
     
-    return result;
+    return TRUE;
 }
 
 /* Create file exporter */
@@ -0,0 +1,376 @@
+/**
+ * @file sav_fast_decoder.c
+ * @brief Native fast-path decoder for SAV IPFIX messages
+ */
+
+#include <string.h>
+#include "sav_fast_decoder.h"
+#include "sav_layout.h"
+
+/* IANA Information Element IDs used by template 400 (the sub-template
+ * fields come from sav_layout.h) */
+#define IE_SUB_TEMPLATE_LIST           292
+#define IE_OBSERVATION_TIME_MS         323
+
+/* Smallest template-400 record: time(8) + rule(1) + target(1) +
+ * varlen(1) + STL header(3) + policy(1) */
+#define MIN_MAIN_RECORD_LEN 15
+
+/* Field of an expected template layout */
+typedef struct fast_field {
+    uint16_t  ie_id;
+    uint32_t  pen;
+    uint16_t  len;
+} fast_field_t;
+
+/* Expected layout of one known template */
+typedef struct fast_layout {
+    uint16_t            tmpl_id;
+    uint16_t            entry_len;    /* Fixed record length (0 = variable) */
+    uint16_t            field_count;
+    const fast_field_t  *fields;
+} fast_layout_t;
+
+/* Template 400, in the order of sav_main_template_spec */
+static const fast_field_t main_fields[] = {
+    { IE_OBSERVATION_TIME_MS,      0,                 8 },
+    { SAV_IE_RULE_TYPE,            SAV_ENTERPRISE_ID, 1 },
+    { SAV_IE_TARGET_TYPE,          SAV_ENTERPRISE_ID, 1 },
+    { IE_SUB_TEMPLATE_LIST,        0,                 FB_IE_VARLEN },
+    { SAV_IE_POLICY_ACTION,        SAV_ENTERPRISE_ID, 1 },
+};
+
+/* Templates 901-904, from SAV_SUB_TEMPLATE_TABLE */
+#define FAST_FIELD(field, family, size) { SAV_IE_ID(field, family), 0, size },
+#define FAST_FIELDS(id, name, family, prefix_bytes, order)             \
+static const fast_field_t name##_fields[] = {                          \
+    SAV_FIELDS(order, FAST_FIELD, family, prefix_bytes)                \
+};
+SAV_SUB_TEMPLATE_TABLE(FAST_FIELDS)
+#undef FAST_FIELDS
+#undef FAST_FIELD
+
+/* Indexed like sav_fast_decoder_t.layout_ok */
+static const fast_layout_t known_layouts[SAV_FAST_TMPL_COUNT] = {
+    { SAV_MAIN_TEMPLATE_ID,           0,  5, main_fields },
+#define FAST_LAYOUT(id, name, family, prefix_bytes, order) \
+    { id, SAV_ENTRY_SIZE(prefix_bytes), 3, name##_fields },
+    SAV_SUB_TEMPLATE_TABLE(FAST_LAYOUT)
+#undef FAST_LAYOUT
+};
+
+/* Map a template ID to its known_layouts index, -1 if not a SAV template */
+static int layout_index(uint16_t tmpl_id)
+{
+    if (tmpl_id == SAV_MAIN_TEMPLATE_ID) return 0;
+    if (tmpl_id >= SAV_TMPL_IPV4_INTERFACE_PREFIX &&
+        tmpl_id <= SAV_TMPL_IPV6_PREFIX_INTERFACE) {
+        return 1 + (tmpl_id - SAV_TMPL_IPV4_INTERFACE_PREFIX);
+    }
+    return -1;
+}
+
+/* Decode an RFC 7011 variable-length field header; returns the content
+ * start or NULL if it does not fit before end */
+static const uint8_t* read_varlen(const uint8_t *p, const uint8_t *end, size_t *len)
+{
+    if (p >= end) return NULL;
+    if (p[0] < 255) {
+        *len = p[0];
+        p += 1;
+    } else {
+        if (end - p < 3) return NULL;
+        *len = sav_read_be16(p + 1);
+        p += 3;
+    }
+    return ((size_t)(end - p) >= *len) ? p : NULL;
+}
+
+/* Parse a template or options template set and record which SAV layouts
+ * it (re)defines or withdraws. SAV templates are never options templates,
+ * so a SAV ID defined in an options template set never matches. */
+static gboolean parse_template_set(
+    sav_fast_decoder_t *dec,
+    uint16_t           set_id,
+    const uint8_t      *p,
+    const uint8_t      *end,
+    GError             **err)
+{
+    gboolean options = (set_id == SAV_IPFIX_OPTIONS_SET_ID);
+    
+    while (end - p >= 4) {
+        uint16_t tmpl_id = sav_read_be16(p);
+        uint16_t field_count = sav_read_be16(p + 2);
+        p += 4;
+        
+        if (tmpl_id == set_id && field_count == 0) {
+            /* All (options) templates withdrawn (RFC 7011, section 8.1);
+             * libfixbuf drops the data until they are defined again */
+            memset(dec->layout_ok, 0, sizeof(dec->layout_ok));
+            continue;
+        }
+        if (tmpl_id < SAV_IPFIX_MIN_DATA_SET_ID) {
+            /* Set padding */
+            break;
+        }
+        if (options && field_count > 0) {
+            /* Scope field count */
+            if (end - p < 2) {
+                g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IPFIX,
+                            "Options template %u truncated", tmpl_id);
+                return FALSE;
+            }
+            p += 2;
+        }
+        
+        int idx = layout_index(tmpl_id);
+        gboolean match = (!options && idx >= 0 &&
+                          field_count == known_layouts[idx].field_count);
+        
+        for (uint16_t i = 0; i < field_count; i++) {
+            if (end - p < 4) {
+                g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IPFIX,
+                            "Template %u truncated", tmpl_id);
+                return FALSE;
+            }
+            uint16_t ie_id = sav_read_be16(p);
+            uint16_t ie_len = sav_read_be16(p + 2);
+            uint32_t pen = 0;
+            p += 4;
+            
+            if (ie_id & 0x8000) {
+                if (end - p < 4) {
+                    g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IPFIX,
+                                "Template %u truncated", tmpl_id);
+                    return FALSE;
+                }
+                pen = sav_read_be32(p);
+                ie_id &= 0x7FFF;
+                p += 4;
+            }
+            
+            if (match) {
+                const fast_field_t *f = &known_layouts[idx].fields[i];
+                match = (f->ie_id == ie_id && f->pen == pen && f->len == ie_len);
+            }
+        }
+        
+        /* A redefinition or withdrawal with another layout disables the
+         * fast path for this template until it is defined correctly again */
+        if (idx >= 0) {
+            dec->layout_ok[idx] = match;
+        }
+    }
+    
+    return TRUE;
+}
+
+/* Check that every record of a template-400 data set can be decoded natively */
+static gboolean data_set_is_native(
+    const sav_fast_decoder_t *dec,
+    const uint8_t            *p,
+    const uint8_t            *end)
+{
+    while (end - p >= MIN_MAIN_RECORD_LEN) {
+        size_t stl_len;
+        const uint8_t *stl = read_varlen(p + 10, end, &stl_len);
+        
+        if (!stl || stl_len < 3 || stl + stl_len >= end) {
+            return FALSE;
+        }
+        
+        int idx = layout_index(sav_read_be16(stl + 1));
+        if (idx < 1 || !dec->layout_ok[idx] ||
+            (stl_len - 3) % known_layouts[idx].entry_len != 0) {
+            return FALSE;
+        }
+        
+        p = stl + stl_len + 1;
+    }
+    
+    return TRUE;
+}
+
+/* Count the records of a template-400 data set; FALSE if one is truncated */
+static gboolean count_main_records(
+    const uint8_t *p,
+    const uint8_t *end,
+    uint32_t      *count)
+{
+    while (end - p >= MIN_MAIN_RECORD_LEN) {
+        size_t stl_len;
+        const uint8_t *stl = read_varlen(p + 10, end, &stl_len);
+        
+        if (!stl || stl + stl_len >= end) {
+            return FALSE;
+        }
+        (*count)++;
+        p = stl + stl_len + 1;
+    }
+    
+    return TRUE;
+}
+
+size_t sav_fast_encode_template_set(uint8_t *buf, size_t cap)
+{
+    size_t len = SAV_IPFIX_SET_HEADER_LEN;
+    
+    for (int t = 0; t < SAV_FAST_TMPL_COUNT; t++) {
+        const fast_layout_t *layout = &known_layouts[t];
+        if (cap < len + 4) return 0;
+        sav_write_be16(buf + len, layout->tmpl_id);
+        sav_write_be16(buf + len + 2, layout->field_count);
+        len += 4;
+        
+        for (uint16_t i = 0; i < layout->field_count; i++) {
+            const fast_field_t *f = &layout->fields[i];
+            if (cap < len + (f->pen ? 8 : 4)) return 0;
+            sav_write_be16(buf + len, f->pen ? (uint16_t)(f->ie_id | 0x8000) : f->ie_id);
+            sav_write_be16(buf + len + 2, f->len);
+            len += 4;
+            if (f->pen) {
+                sav_write_be32(buf + len, f->pen);
+                len += 4;
+            }
+        }
+    }
+    
+    sav_write_be16(buf, SAV_IPFIX_TEMPLATE_SET_ID);
+    sav_write_be16(buf + 2, (uint16_t)len);
+    return len;
+}
+
+void sav_fast_decoder_init(sav_fast_decoder_t *dec)
+{
+    if (dec) {
+        memset(dec, 0, sizeof(*dec));
+    }
+}
+
+gboolean sav_fast_decoder_load_message(
+    sav_fast_decoder_t *dec,
+    const uint8_t      *msg,
+    size_t             len,
+    gboolean           *native,
+    GError             **err)
+{
+    if (!dec || !msg || !native) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                    "NULL parameter in sav_fast_decoder_load_message");
+        return FALSE;
+    }
+    
+    *native = FALSE;
+    dec->msg = dec->msg_end = dec->cur = dec->set_end = NULL;
+    dec->data_records = 0;
+    dec->records_known = FALSE;
+    
+    if (len < SAV_IPFIX_MSG_HEADER_LEN || sav_read_be16(msg) != SAV_IPFIX_VERSION) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IPFIX,
+                    "Not an IPFIX message");
+        return FALSE;
+    }
+    
+    uint16_t msg_len = sav_read_be16(msg + 2);
+    if (msg_len < SAV_IPFIX_MSG_HEADER_LEN || msg_len > len) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IPFIX,
+                    "Invalid IPFIX message length %u", msg_len);
+        return FALSE;
+    }
+    
+    const uint8_t *end = msg + msg_len;
+    const uint8_t *p = msg + SAV_IPFIX_MSG_HEADER_LEN;
+    gboolean can_decode = TRUE;
+    gboolean records_known = TRUE;
+    uint32_t data_records = 0;
+    
+    while (end - p >= SAV_IPFIX_SET_HEADER_LEN) {
+        uint16_t set_id = sav_read_be16(p);
+        uint16_t set_len = sav_read_be16(p + 2);
+        
+        if (set_len < SAV_IPFIX_SET_HEADER_LEN || set_len > end - p) {
+            g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IPFIX,
+                        "Invalid set length %u for set %u", set_len, set_id);
+            return FALSE;
+        }
+        
+        const uint8_t *body = p + SAV_IPFIX_SET_HEADER_LEN;
+        p += set_len;
+        
+        if (set_id == SAV_IPFIX_TEMPLATE_SET_ID || set_id == SAV_IPFIX_OPTIONS_SET_ID) {
+            /* libfixbuf must see every template set too */
+            if (!parse_template_set(dec, set_id, body, p, err)) {
+                return FALSE;
+            }
+            can_decode = FALSE;
+        } else if (set_id != SAV_MAIN_TEMPLATE_ID || !dec->layout_ok[0] ||
+                   !data_set_is_native(dec, body, p)) {
+            can_decode = FALSE;
+        }
+        
+        if (set_id >= SAV_IPFIX_MIN_DATA_SET_ID &&
+            (set_id != SAV_MAIN_TEMPLATE_ID || !dec->layout_ok[0] ||
+             !count_main_records(body, p, &data_records))) {
+            records_known = FALSE;
+        }
+    }
+    
+    dec->data_records = data_records;
+    dec->records_known = records_known;
+    
+    if (!can_decode) {
+        dec->fallback_messages++;
+        return TRUE;
+    }
+    
+    dec->msg = msg;
+    dec->msg_end = end;
+    dec->cur = msg + SAV_IPFIX_MSG_HEADER_LEN;
+    dec->sequence = sav_read_be32(msg + 8);
+    dec->domain_id = sav_read_be32(msg + 12);
+    dec->native_messages++;
+    *native = TRUE;
+    return TRUE;
+}
+
+gboolean sav_fast_decoder_next(
+    sav_fast_decoder_t *dec,
+    sav_record_view_t  *view)
+{
+    if (!dec || !view || !dec->msg) {
+        return FALSE;
+    }
+    
+    /* Advance to the next data set with room for a record */
+    while (!dec->set_end || dec->set_end - dec->cur < MIN_MAIN_RECORD_LEN) {
+        const uint8_t *p = dec->set_end ? dec->set_end : dec->cur;
+        
+        if (dec->msg_end - p < SAV_IPFIX_SET_HEADER_LEN) {
+            dec->msg = NULL;
+            return FALSE;
+        }
+        dec->set_end = p + sav_read_be16(p + 2);
+        dec->cur = p + SAV_IPFIX_SET_HEADER_LEN;
+    }
+    
+    /* Framing was verified by sav_fast_decoder_load_message() */
+    const uint8_t *p = dec->cur;
+    size_t stl_len;
+    const uint8_t *stl = read_varlen(p + 10, dec->set_end, &stl_len);
+    uint16_t sub_id = sav_read_be16(stl + 1);
+    const fast_layout_t *layout = &known_layouts[layout_index(sub_id)];
+    
+    memset(view, 0, sizeof(*view));
+    view->timestamp_ms = sav_read_be64(p);
+    view->rule_type = p[8];
+    view->target_type = p[9];
+    view->policy_action = stl[stl_len];
+    view->sub_template_id = sub_id;
+    view->mapping_count = (uint32_t)((stl_len - 3) / layout->entry_len);
+    view->entries = view->mapping_count ? stl + 3 : NULL;
+    view->entry_stride = layout->entry_len;
+    view->wire_order = TRUE;
+    
+    dec->cur = stl + stl_len + 1;
+    return TRUE;
+}
@@ -7,6 +7,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include "sav_ie_definitions.h"
+#include "sav_layout.h"
 
 /* SAV Information Elements - using FB_IE_INIT_FULL macro to specify data types */
 static fbInfoElement_t sav_info_elements[] = {
@@ -25,36 +26,26 @@ static fbInfoElement_t sav_info_elements[] = {
     FB_IE_NULL
 };
 
-/* Template spec for IPv4 Interface-to-Prefix mapping (Template 901) */
-static fbInfoElementSpec_t sav_ipv4_interface_prefix_spec[] = {
-    { "ingressInterface",        4, 0 },
-    { "sourceIPv4Prefix",        4, 0 },
-    { "sourceIPv4PrefixLength",  1, 0 },
-    FB_IESPEC_NULL
-};
-
-/* Template spec for IPv6 Interface-to-Prefix mapping (Template 902) */
-static fbInfoElementSpec_t sav_ipv6_interface_prefix_spec[] = {
-    { "ingressInterface",        4, 0 },
-    { "sourceIPv6Prefix",       16, 0 },
-    { "sourceIPv6PrefixLength",  1, 0 },
-    FB_IESPEC_NULL
+/* Template specs for the sub-templates 901-904, generated from
+ * SAV_SUB_TEMPLATE_TABLE (e.g. sav_ipv6_prefix_interface_spec) */
+#define SAV_SPEC_FIELD(field, family, size) { SAV_IE_NAME_##field(family), size, 0 },
+#define SAV_SPEC(id, name, family, prefix_bytes, order)                 \
+static fbInfoElementSpec_t sav_##name##_spec[] = {                      \
+    SAV_FIELDS(order, SAV_SPEC_FIELD, family, prefix_bytes)             \
+    FB_IESPEC_NULL                                                      \
 };
-
-/* Template spec for IPv4 Prefix-to-Interface mapping (Template 903) */
-static fbInfoElementSpec_t sav_ipv4_prefix_interface_spec[] = {
-    { "sourceIPv4Prefix",        4, 0 },
-    { "sourceIPv4PrefixLength",  1, 0 },
-    { "ingressInterface",        4, 0 },
-    FB_IESPEC_NULL
-};
-
-/* Template spec for IPv6 Prefix-to-Interface mapping (Template 904) */
-static fbInfoElementSpec_t sav_ipv6_prefix_interface_spec[] = {
-    { "sourceIPv6Prefix",       16, 0 },
-    { "sourceIPv6PrefixLength",  1, 0 },
-    { "ingressInterface",        4, 0 },
-    FB_IESPEC_NULL
+SAV_SUB_TEMPLATE_TABLE(SAV_SPEC)
+#undef SAV_SPEC
+#undef SAV_SPEC_FIELD
+
+/* Sub-template IDs with their specs, in table order */
+static const struct {
+    uint16_t            tmpl_id;
+    fbInfoElementSpec_t *spec;
+} sav_sub_template_specs[] = {
+#define SAV_SPEC_ROW(id, name, family, prefix_bytes, order) { id, sav_##name##_spec },
+    SAV_SUB_TEMPLATE_TABLE(SAV_SPEC_ROW)
+#undef SAV_SPEC_ROW
 };
 
 /* Main template spec for SAV Data Records (Template 400) */
@@ -89,26 +80,14 @@ gboolean sav_add_templates(fbSession_t *session, GError **err)
         return FALSE;
     }
 
-    /* Template 901: IPv4 Interface-to-Prefix */
+    /* Templates 901-904 */
     /* Use fbSessionAddTemplatesForExport which handles dual registration automatically */
-    tmpl = fbTemplateAlloc(model);
-    if (!fbTemplateAppendSpecArray(tmpl, sav_ipv4_interface_prefix_spec, 0, err)) return FALSE;
-    if (!fbSessionAddTemplatesForExport(session, SAV_TMPL_IPV4_INTERFACE_PREFIX, tmpl, NULL, err)) return FALSE;
-
-    /* Template 902: IPv6 Interface-to-Prefix */
-    tmpl = fbTemplateAlloc(model);
-    if (!fbTemplateAppendSpecArray(tmpl, sav_ipv6_interface_prefix_spec, 0, err)) return FALSE;
-    if (!fbSessionAddTemplatesForExport(session, SAV_TMPL_IPV6_INTERFACE_PREFIX, tmpl, NULL, err)) return FALSE;
-
-    /* Template 903: IPv4 Prefix-to-Interface */
-    tmpl = fbTemplateAlloc(model);
-    if (!fbTemplateAppendSpecArray(tmpl, sav_ipv4_prefix_interface_spec, 0, err)) return FALSE;
-    if (!fbSessionAddTemplatesForExport(session, SAV_TMPL_IPV4_PREFIX_INTERFACE, tmpl, NULL, err)) return FALSE;
-
-    /* Template 904: IPv6 Prefix-to-Interface */
-    tmpl = fbTemplateAlloc(model);
-    if (!fbTemplateAppendSpecArray(tmpl, sav_ipv6_prefix_interface_spec, 0, err)) return FALSE;
-    if (!fbSessionAddTemplatesForExport(session, SAV_TMPL_IPV6_PREFIX_INTERFACE, tmpl, NULL, err)) return FALSE;
+    for (size_t i = 0; i < G_N_ELEMENTS(sav_sub_template_specs); i++) {
+        tmpl = fbTemplateAlloc(model);
+        if (!fbTemplateAppendSpecArray(tmpl, sav_sub_template_specs[i].spec, 0, err)) return FALSE;
+        if (!fbSessionAddTemplatesForExport(session, sav_sub_template_specs[i].tmpl_id,
+                                            tmpl, NULL, err)) return FALSE;
+    }
 
     /* Main template for SAV Data Records */
     tmpl = fbTemplateAlloc(model);
@@ -117,10 +96,10 @@ gboolean sav_add_templates(fbSession_t *session, GError **err)
 
     /* Template pairs are now automatically established by dual registration above */
     /* But we keep these calls for compatibility with older libfixbuf versions */
-    fbSessionAddTemplatePair(session, SAV_TMPL_IPV4_INTERFACE_PREFIX, SAV_TMPL_IPV4_INTERFACE_PREFIX);
-    fbSessionAddTemplatePair(session, SAV_TMPL_IPV6_INTERFACE_PREFIX, SAV_TMPL_IPV6_INTERFACE_PREFIX);
-    fbSessionAddTemplatePair(session, SAV_TMPL_IPV4_PREFIX_INTERFACE, SAV_TMPL_IPV4_PREFIX_INTERFACE);
-    fbSessionAddTemplatePair(session, SAV_TMPL_IPV6_PREFIX_INTERFACE, SAV_TMPL_IPV6_PREFIX_INTERFACE);
+    for (size_t i = 0; i < G_N_ELEMENTS(sav_sub_template_specs); i++) {
+        fbSessionAddTemplatePair(session, sav_sub_template_specs[i].tmpl_id,
+                                 sav_sub_template_specs[i].tmpl_id);
+    }
     fbSessionAddTemplatePair(session, SAV_MAIN_TEMPLATE_ID, SAV_MAIN_TEMPLATE_ID);
 
     return TRUE;
@@ -183,18 +162,20 @@ gboolean sav_validate_policy_action(uint8_t action)
 
 uint16_t sav_get_template_id(uint8_t rule_type, uint8_t target_type)
 {
-    /* Determine template ID based on target type */
-    /* For now, we ignore rule_type and focus on target_type + IP version */
-    /* IPv4/IPv6 will be determined at runtime when adding entries */
+    /* IPv4 by default; the exporter routes IPv6 entries itself */
+    return sav_get_template_id_for_family(rule_type, target_type, FALSE);
+}
+
+uint16_t sav_get_template_id_for_family(uint8_t rule_type, uint8_t target_type,
+                                        gboolean ipv6)
+{
+    /* Template ID depends on target type and IP version, not on rule_type */
+    (void)rule_type;
     
-    if (target_type == SAV_TARGET_TYPE_INTERFACE_BASED) {
-        /* Default to IPv4 Interface->Prefix, caller can override */
-        return SAV_TMPL_IPV4_INTERFACE_PREFIX;
-    } else if (target_type == SAV_TARGET_TYPE_PREFIX_BASED) {
-        /* Default to IPv4 Prefix->Interface, caller can override */
-        return SAV_TMPL_IPV4_PREFIX_INTERFACE;
+    if (target_type == SAV_TARGET_TYPE_PREFIX_BASED) {
+        return ipv6 ? SAV_TMPL_IPV6_PREFIX_INTERFACE : SAV_TMPL_IPV4_PREFIX_INTERFACE;
     }
     
-    /* Fallback */
-    return SAV_TMPL_IPV4_INTERFACE_PREFIX;
+    /* Interface-based, and fallback */
+    return ipv6 ? SAV_TMPL_IPV6_INTERFACE_PREFIX : SAV_TMPL_IPV4_INTERFACE_PREFIX;
 }
@@ -0,0 +1,445 @@
+/**
+ * @file sav_json.c
+ * @brief Buffered streaming JSON writer implementation
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include "sav_json.h"
+
+/* Upper bounds of the pieces appended between buffer checks */
+#define RECORD_HEAD_MAX 512
+#define MAPPING_MAX     256
+
+/* Literal pieces of a record, in output order */
+enum {
+    LIT_TIMESTAMP,
+    LIT_RULE_TYPE,
+    LIT_RULE_TYPE_NAME,
+    LIT_TARGET_TYPE,
+    LIT_TARGET_TYPE_NAME,
+    LIT_POLICY_ACTION,
+    LIT_POLICY_ACTION_NAME,
+    LIT_SUB_TEMPLATE_ID,
+    LIT_MAPPING_COUNT,
+    LIT_MAPPINGS_OPEN,
+    LIT_INTERFACE,
+    LIT_PREFIX,
+    LIT_PREFIX_LENGTH,
+    LIT_MAPPING_CLOSE_SEP,
+    LIT_MAPPING_CLOSE_LAST,
+    LIT_RECORD_CLOSE,
+    LIT_ARRAY_OPEN,
+    LIT_ARRAY_SEP,
+    LIT_ARRAY_CLOSE,
+    LIT_COUNT
+};
+
+typedef struct json_lit {
+    const char *s;
+    size_t     n;
+} json_lit_t;
+
+#define LIT(str) { str, sizeof(str) - 1 }
+
+/* Indexed by sav_json_style_t */
+static const json_lit_t lits[3][LIT_COUNT] = {
+    [SAV_JSON_PRETTY] = {
+        LIT("{\n  \"timestamp_ms\": "),
+        LIT(",\n  \"rule_type\": "),
+        LIT(",\n  \"rule_type_name\": \""),
+        LIT("\",\n  \"target_type\": "),
+        LIT(",\n  \"target_type_name\": \""),
+        LIT("\",\n  \"policy_action\": "),
+        LIT(",\n  \"policy_action_name\": \""),
+        LIT("\",\n  \"sub_template_id\": "),
+        LIT(",\n  \"mapping_count\": "),
+        LIT(",\n  \"mappings\": [\n"),
+        LIT("    {\n      \"interface\": "),
+        LIT(",\n      \"prefix\": \""),
+        LIT("\",\n      \"prefix_length\": "),
+        LIT("\n    },\n"),
+        LIT("\n    }\n"),
+        LIT("  ]\n}\n"),
+        LIT("[\n"),
+        LIT(",\n"),
+        LIT("\n]\n"),
+    },
+    [SAV_JSON_COMPACT] = {
+        LIT("{\"timestamp_ms\":"),
+        LIT(",\"rule_type\":"),
+        LIT(",\"rule_type_name\":\""),
+        LIT("\",\"target_type\":"),
+        LIT(",\"target_type_name\":\""),
+        LIT("\",\"policy_action\":"),
+        LIT(",\"policy_action_name\":\""),
+        LIT("\",\"sub_template_id\":"),
+        LIT(",\"mapping_count\":"),
+        LIT(",\"mappings\":["),
+        LIT("{\"interface\":"),
+        LIT(",\"prefix\":\""),
+        LIT("\",\"prefix_length\":"),
+        LIT("},"),
+        LIT("}"),
+        LIT("]}"),
+        LIT("["),
+        LIT(","),
+        LIT("]\n"),
+    },
+    [SAV_JSON_NDJSON] = {
+        LIT("{\"timestamp_ms\":"),
+        LIT(",\"rule_type\":"),
+        LIT(",\"rule_type_name\":\""),
+        LIT("\",\"target_type\":"),
+        LIT(",\"target_type_name\":\""),
+        LIT("\",\"policy_action\":"),
+        LIT(",\"policy_action_name\":\""),
+        LIT("\",\"sub_template_id\":"),
+        LIT(",\"mapping_count\":"),
+        LIT(",\"mappings\":["),
+        LIT("{\"interface\":"),
+        LIT(",\"prefix\":\""),
+        LIT("\",\"prefix_length\":"),
+        LIT("},"),
+        LIT("}"),
+        LIT("]}\n"),
+        LIT(""),
+        LIT(""),
+        LIT(""),
+    },
+};
+
+/* "00" .. "99" */
+static const char digits2[201] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const char hex_digits[16] = "0123456789abcdef";
+
+static inline char* put_lit(char *p, const json_lit_t *lit)
+{
+    memcpy(p, lit->s, lit->n);
+    return p + lit->n;
+}
+
+static inline char* put_str(char *p, const char *s)
+{
+    size_t n = strlen(s);
+    memcpy(p, s, n);
+    return p + n;
+}
+
+/* Decimal 0-255 */
+static inline char* put_u8(char *p, unsigned v)
+{
+    if (v >= 100) {
+        *p++ = (char)('0' + v / 100);
+        v %= 100;
+        *p++ = digits2[v * 2];
+        *p++ = digits2[v * 2 + 1];
+    } else if (v >= 10) {
+        *p++ = digits2[v * 2];
+        *p++ = digits2[v * 2 + 1];
+    } else {
+        *p++ = (char)('0' + v);
+    }
+    return p;
+}
+
+char* sav_json_format_u64(char *dst, uint64_t value)
+{
+    char tmp[20];
+    char *t = tmp + sizeof(tmp);
+
+    while (value >= 100) {
+        unsigned idx = (unsigned)(value % 100) * 2;
+        value /= 100;
+        *--t = digits2[idx + 1];
+        *--t = digits2[idx];
+    }
+    if (value >= 10) {
+        *--t = digits2[value * 2 + 1];
+        *--t = digits2[value * 2];
+    } else {
+        *--t = (char)('0' + value);
+    }
+
+    size_t n = (size_t)(tmp + sizeof(tmp) - t);
+    memcpy(dst, t, n);
+    return dst + n;
+}
+
+char* sav_json_format_ipv4(char *dst, const uint8_t addr[4])
+{
+    char *p = put_u8(dst, addr[0]);
+    *p++ = '.';
+    p = put_u8(p, addr[1]);
+    *p++ = '.';
+    p = put_u8(p, addr[2]);
+    *p++ = '.';
+    return put_u8(p, addr[3]);
+}
+
+/* Same algorithm as glibc's inet_ntop6() */
+char* sav_json_format_ipv6(char *dst, const uint8_t addr[16])
+{
+    unsigned words[8];
+    int best_base = -1, best_len = 0;
+    int cur_base = -1, cur_len = 0;
+    char *p = dst;
+
+    for (int i = 0; i < 8; i++) {
+        words[i] = ((unsigned)addr[2 * i] << 8) | addr[2 * i + 1];
+    }
+
+    /* First longest run of zero groups */
+    for (int i = 0; i < 8; i++) {
+        if (words[i] == 0) {
+            if (cur_base == -1) {
+                cur_base = i;
+                cur_len = 1;
+            } else {
+                cur_len++;
+            }
+        } else if (cur_base != -1) {
+            if (best_base == -1 || cur_len > best_len) {
+                best_base = cur_base;
+                best_len = cur_len;
+            }
+            cur_base = -1;
+        }
+    }
+    if (cur_base != -1 && (best_base == -1 || cur_len > best_len)) {
+        best_base = cur_base;
+        best_len = cur_len;
+    }
+    if (best_base != -1 && best_len < 2) {
+        best_base = -1;
+    }
+
+    for (int i = 0; i < 8; i++) {
+        if (best_base != -1 && i >= best_base && i < best_base + best_len) {
+            if (i == best_base) {
+                *p++ = ':';
+            }
+            continue;
+        }
+        if (i != 0) {
+            *p++ = ':';
+        }
+        /* IPv4-compatible or IPv4-mapped tail */
+        if (i == 6 && best_base == 0 &&
+            (best_len == 6 || (best_len == 5 && words[5] == 0xffff))) {
+            return sav_json_format_ipv4(p, addr + 12);
+        }
+
+        unsigned w = words[i];
+        int shift = 12;
+        while (shift > 0 && (w >> shift) == 0) {
+            shift -= 4;
+        }
+        for (; shift >= 0; shift -= 4) {
+            *p++ = hex_digits[(w >> shift) & 0xf];
+        }
+    }
+    if (best_base != -1 && best_base + best_len == 8) {
+        *p++ = ':';
+    }
+    return p;
+}
+
+/* Hand the buffer to the stream; remembers the first error */
+static void flush_buffer(sav_json_writer_t *writer)
+{
+    if (writer->len == 0) {
+        return;
+    }
+    if (writer->error == 0) {
+        size_t n = fwrite(writer->buf, 1, writer->len, writer->output);
+        writer->bytes_written += n;
+        if (n < writer->len) {
+            writer->error = errno ? errno : EIO;
+        }
+    }
+    writer->len = 0;
+}
+
+/* Make room for n bytes and return the write position */
+static inline char* reserve(sav_json_writer_t *writer, size_t n)
+{
+    if (writer->cap - writer->len < n) {
+        flush_buffer(writer);
+    }
+    return writer->buf + writer->len;
+}
+
+static inline void commit(sav_json_writer_t *writer, char *p)
+{
+    writer->len = (size_t)(p - writer->buf);
+}
+
+static void writer_init_buffer(
+    sav_json_writer_t *writer,
+    FILE              *output,
+    sav_json_style_t  style,
+    char              *buf,
+    size_t            cap,
+    gboolean          owns_buf)
+{
+    memset(writer, 0, sizeof(*writer));
+    writer->output = output;
+    writer->style = (style == SAV_JSON_COMPACT || style == SAV_JSON_NDJSON) ? style
+                                                                          : SAV_JSON_PRETTY;
+    writer->buf = buf;
+    writer->cap = cap;
+    writer->owns_buf = owns_buf;
+}
+
+void sav_json_writer_init(
+    sav_json_writer_t *writer,
+    FILE              *output,
+    sav_json_style_t  style,
+    size_t            buf_size)
+{
+    if (!writer) return;
+
+    if (buf_size == 0) {
+        buf_size = SAV_JSON_DEFAULT_BUFFER_SIZE;
+    } else if (buf_size < SAV_JSON_MIN_BUFFER_SIZE) {
+        buf_size = SAV_JSON_MIN_BUFFER_SIZE;
+    }
+    writer_init_buffer(writer, output, style, g_malloc(buf_size), buf_size, TRUE);
+}
+
+void sav_json_begin_array(sav_json_writer_t *writer)
+{
+    const json_lit_t *l = lits[writer->style];
+
+    commit(writer, put_lit(reserve(writer, l[LIT_ARRAY_OPEN].n), &l[LIT_ARRAY_OPEN]));
+    writer->in_array = TRUE;
+    writer->records_in_array = 0;
+}
+
+void sav_json_end_array(sav_json_writer_t *writer)
+{
+    const json_lit_t *l = lits[writer->style];
+
+    commit(writer, put_lit(reserve(writer, l[LIT_ARRAY_CLOSE].n), &l[LIT_ARRAY_CLOSE]));
+    writer->in_array = FALSE;
+}
+
+void sav_json_write_record(
+    sav_json_writer_t         *writer,
+    const sav_parsed_record_t *record)
+{
+    if (!writer || !record) return;
+
+    const json_lit_t *l = lits[writer->style];
+    char *p = reserve(writer, RECORD_HEAD_MAX);
+
+    if (writer->in_array && writer->records_in_array++ > 0) {
+        p = put_lit(p, &l[LIT_ARRAY_SEP]);
+    }
+    p = put_lit(p, &l[LIT_TIMESTAMP]);
+    p = sav_json_format_u64(p, record->timestamp_ms);
+    p = put_lit(p, &l[LIT_RULE_TYPE]);
+    p = put_u8(p, record->rule_type);
+    p = put_lit(p, &l[LIT_RULE_TYPE_NAME]);
+    p = put_str(p, sav_rule_type_name(record->rule_type));
+    p = put_lit(p, &l[LIT_TARGET_TYPE]);
+    p = put_u8(p, record->target_type);
+    p = put_lit(p, &l[LIT_TARGET_TYPE_NAME]);
+    p = put_str(p, sav_target_type_name(record->target_type));
+    p = put_lit(p, &l[LIT_POLICY_ACTION]);
+    p = put_u8(p, record->policy_action);
+    p = put_lit(p, &l[LIT_POLICY_ACTION_NAME]);
+    p = put_str(p, sav_policy_action_name(record->policy_action));
+    p = put_lit(p, &l[LIT_SUB_TEMPLATE_ID]);
+    p = sav_json_format_u64(p, record->sub_template_id);
+    p = put_lit(p, &l[LIT_MAPPING_COUNT]);
+    p = sav_json_format_u64(p, record->mapping_count);
+    p = put_lit(p, &l[LIT_MAPPINGS_OPEN]);
+    commit(writer, p);
+
+    gboolean is_ipv4 = (record->sub_template_id == SAV_TMPL_IPV4_INTERFACE_PREFIX ||
+                        record->sub_template_id == SAV_TMPL_IPV4_PREFIX_INTERFACE);
+
+    for (uint32_t i = 0; i < record->mapping_count; i++) {
+        uint32_t iface;
+        uint8_t plen;
+
+        p = reserve(writer, MAPPING_MAX);
+        p = put_lit(p, &l[LIT_INTERFACE]);
+        if (is_ipv4) {
+            const sav_ipv4_mapping_t *m = &record->mappings.ipv4_mappings[i];
+            iface = m->ingressInterface;
+            plen = m->sourceIPv4PrefixLength;
+            p = sav_json_format_u64(p, iface);
+            p = put_lit(p, &l[LIT_PREFIX]);
+            uint32_t prefix = htonl(m->sourceIPv4Prefix);
+            p = sav_json_format_ipv4(p, (const uint8_t *)&prefix);
+        } else {
+            const sav_ipv6_mapping_t *m = &record->mappings.ipv6_mappings[i];
+            iface = m->ingressInterface;
+            plen = m->sourceIPv6PrefixLength;
+            p = sav_json_format_u64(p, iface);
+            p = put_lit(p, &l[LIT_PREFIX]);
+            p = sav_json_format_ipv6(p, m->sourceIPv6Prefix);
+        }
+        p = put_lit(p, &l[LIT_PREFIX_LENGTH]);
+        p = put_u8(p, plen);
+        p = put_lit(p, &l[(i + 1 < record->mapping_count) ? LIT_MAPPING_CLOSE_SEP
+                                                         : LIT_MAPPING_CLOSE_LAST]);
+        commit(writer, p);
+    }
+
+    commit(writer, put_lit(reserve(writer, l[LIT_RECORD_CLOSE].n), &l[LIT_RECORD_CLOSE]));
+}
+
+gboolean sav_json_writer_flush(
+    sav_json_writer_t *writer,
+    GError            **err)
+{
+    if (!writer) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                    "NULL parameter in sav_json_writer_flush");
+        return FALSE;
+    }
+
+    flush_buffer(writer);
+    if (writer->error) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                    "JSON write failed: %s", g_strerror(writer->error));
+        return FALSE;
+    }
+    return TRUE;
+}
+
+void sav_json_writer_destroy(sav_json_writer_t *writer)
+{
+    if (!writer) return;
+
+    if (writer->owns_buf) {
+        g_free(writer->buf);
+    }
+    memset(writer, 0, sizeof(*writer));
+}
+
+/* Export to JSON: one pretty record through a stack buffer */
+void sav_export_record_json(
+    const sav_parsed_record_t *record,
+    FILE                      *output)
+{
+    if (!record || !output) return;
+
+    char buf[SAV_JSON_MIN_BUFFER_SIZE];
+    sav_json_writer_t writer;
+
+    writer_init_buffer(&writer, output, SAV_JSON_PRETTY, buf, sizeof(buf), FALSE);
+    sav_json_write_record(&writer, record);
+    flush_buffer(&writer);
+}
@@ -0,0 +1,61 @@
+/**
+ * @file sav_layout.c
+ * @brief Per-sub-template batch kernels and the layout table
+ */
+
+#include "sav_layout.h"
+
+/* Batch decoders: one loop per sub-template, byte order handled per list */
+#define SAV_DECODE_N(id, name, family, prefix_bytes, order)                       \
+static void decode_n_##name(const uint8_t *entries, size_t stride, uint32_t count, \
+                            void *mappings, gboolean wire_order)                  \
+{                                                                                 \
+    SAV_MAPPING_T(family) *m = mappings;                                          \
+    for (uint32_t i = 0; i < count; i++) {                                        \
+        sav_decode_##name(entries + (size_t)i * stride, &m[i]);                   \
+    }                                                                             \
+    if (wire_order) {                                                             \
+        for (uint32_t i = 0; i < count; i++) {                                    \
+            m[i].ingressInterface = ntohl(m[i].ingressInterface);                 \
+            SAV_PREFIX_TO_HOST_##family(&m[i]);                                   \
+        }                                                                         \
+    }                                                                             \
+}
+SAV_SUB_TEMPLATE_TABLE(SAV_DECODE_N)
+#undef SAV_DECODE_N
+
+/* Batch encoders: host-order mappings to packed wire entries */
+#define SAV_ENCODE_N(id, name, family, prefix_bytes, order)                       \
+static uint8_t* encode_n_##name(uint8_t *dst, const void *mappings, uint32_t count) \
+{                                                                                 \
+    const SAV_MAPPING_T(family) *m = mappings;                                    \
+    for (uint32_t i = 0; i < count; i++) {                                        \
+        uint8_t prefix[prefix_bytes];                                             \
+        SAV_PREFIX_TO_WIRE_##family(prefix, &m[i]);                               \
+        sav_encode_##name(dst, htonl(m[i].ingressInterface), prefix,              \
+                          m[i].sourceIPv##family##PrefixLength);                  \
+        dst += SAV_ENTRY_SIZE(prefix_bytes);                                      \
+    }                                                                             \
+    return dst;                                                                   \
+}
+SAV_SUB_TEMPLATE_TABLE(SAV_ENCODE_N)
+#undef SAV_ENCODE_N
+
+/* Indexed by template ID - SAV_TMPL_IPV4_INTERFACE_PREFIX */
+#define SAV_LAYOUT_ROW(id, name, family, prefix_bytes, order)                     \
+    { id, family, SAV_ENTRY_SIZE(prefix_bytes),                                   \
+      SAV_OFF(order, INTERFACE, prefix_bytes), SAV_OFF(order, PREFIX, prefix_bytes), \
+      prefix_bytes, SAV_OFF(order, PREFIX_LENGTH, prefix_bytes),                  \
+      decode_n_##name, encode_n_##name },
+static const sav_sub_template_layout_t layouts[] = {
+    SAV_SUB_TEMPLATE_TABLE(SAV_LAYOUT_ROW)
+};
+#undef SAV_LAYOUT_ROW
+
+#define LAYOUT_COUNT (sizeof(layouts) / sizeof(layouts[0]))
+
+const sav_sub_template_layout_t* sav_sub_template_layout(uint16_t tmpl_id)
+{
+    uint16_t i = (uint16_t)(tmpl_id - SAV_TMPL_IPV4_INTERFACE_PREFIX);
+    return i < LAYOUT_COUNT ? &layouts[i] : NULL;
+}
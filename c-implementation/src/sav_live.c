@@ -0,0 +1,984 @@
+/**
+ * @file sav_live.c
+ * @brief Lock-free published snapshots of the live SAV rule table
+ *
+ * Addresses of both families are handled as 128-bit integers with the
+ * address in the top bits, so IPv4 prefix lengths and masks work the same
+ * way as IPv6 ones. A partition fixes the top 0, 8, 16 or 32 bits and keeps
+ * the ranges between the starts and ends of its prefixes, each with the
+ * leaf of the longest prefix covering it (SAV_LPM_NO_MATCH where none
+ * does), as starts shifted left past the fixed bits; a lookup finds the
+ * last start at or below the address. Partitions with many ranges also
+ * keep, per value of the next byte, where that search starts and ends.
+ * Ranges and that table share the allocation of the partition, and the
+ * /16 slots are stored in their page, to keep the chain of reads of a
+ * lookup short.
+ *
+ * Snapshot, pages, partitions and the interface index carry reference
+ * counts touched by the writer only: a publish copies the current
+ * snapshot (taking a reference on every page), then copies the page above
+ * each dirty partition before changing it. Objects this publish created
+ * are the only ones with one reference, so they are changed in place.
+ * Freeing a snapshot drops its references.
+ *
+ * Readers share nothing with the writer but the current pointer, the
+ * global epoch and their own epoch slot, each on its own cache line.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include "sav_live.h"
+#include "sav_lpm_internal.h"
+#include "sav_layout.h"
+#include "sav_validate.h"
+
+/* /16 slots per page: the slots under one /8 */
+#define PAGE_SLOTS        256
+
+/* Partitions with more ranges than this get a jump table */
+#define JUMP_MIN_RANGES   16
+
+/* Separates data written by different threads */
+#define LIVE_CACHE_LINE   64
+
+/* Partition levels: prefixes shorter than /8, per /8, per /16, per /32 (IPv6) */
+#define LEVEL_TOP         0
+#define LEVEL_OCTET       1
+#define LEVEL_SLOT        2
+#define LEVEL_KID         3
+#define LEVELS            4
+
+/* Fixed address bits per level */
+static const uint8_t level_shift[LEVELS] = { 0, 8, 16, 32 };
+
+typedef unsigned __int128 live_u128;
+
+/* Addresses from start to the next range's start have leaf leaf_id */
+typedef struct live_range {
+    live_u128         start;          /* Address << shift */
+    uint32_t          leaf_id;
+} live_range_t;
+
+typedef struct live_part {
+    uint32_t          refs;           /* Holders (writer only) */
+    uint32_t          n_ranges;
+    uint8_t           shift;          /* Fixed address bits */
+    const uint32_t    *jump;          /* 257 entries or NULL: ranges to search per next byte */
+    const live_range_t *ranges;       /* Ascending; jump and ranges follow the struct */
+    sav_lpm_leafset_t leafset;        /* Leaves; sets over the snapshot's interface index */
+} live_part_t;
+
+/* One /16 */
+typedef struct live_slot {
+    live_part_t       *part;          /* /16-/31 (IPv4: /16-/32), or NULL */
+    uint32_t          n_kids;
+    uint16_t          *kid_keys;      /* IPv6: bits 16-31 of each /32 partition, ascending */
+    live_part_t       **kids;         /* /32 and longer, per kid key */
+} live_slot_t;
+
+/* One /8 */
+typedef struct live_page {
+    uint32_t          refs;
+    live_part_t       *part;          /* /8-/15, or NULL */
+    live_slot_t       slots[PAGE_SLOTS];
+} live_page_t;
+
+typedef struct live_ifindex {
+    uint32_t          refs;
+    sav_lpm_ifindex_t index;
+} live_ifindex_t;
+
+struct sav_live_snapshot {
+    uint64_t            version;
+    live_ifindex_t      *ifindex;     /* Index of every interface seen so far */
+    live_part_t         *top[2];      /* Per family (IPv4, IPv6): prefixes shorter than /8 */
+    live_page_t         *pages[2][PAGE_SLOTS];
+    uint64_t            retired_epoch;  /* Writer only: epoch at which it was replaced */
+    sav_live_snapshot_t *next_retired;
+};
+
+struct sav_live_reader {
+    char                pad0[LIVE_CACHE_LINE];
+    uint64_t            epoch;        /* Epoch of the open section, 0 outside one */
+    char                pad1[LIVE_CACHE_LINE - sizeof(uint64_t)];
+    sav_live_t          *live;
+};
+
+/* Mappings of one partition, kept by the writer */
+typedef struct live_src {
+    uint64_t          id;             /* See part_id() */
+    GArray            *keys;          /* sav_state_entry_t; values are read from the state */
+    gboolean          dirty;
+} live_src_t;
+
+struct sav_live {
+    /* Read by readers */
+    sav_live_snapshot_t *current;
+    uint64_t            epoch;        /* Starts at 1 */
+    char                pad[LIVE_CACHE_LINE];
+
+    /* Writer */
+    sav_state_t         *state;
+    GHashTable          *sources;     /* Partition ID -> live_src_t */
+    GPtrArray           *dirty;       /* Sources changed since the last publish */
+    GHashTable          *iface_ids;   /* Interface -> index + 1 */
+    GArray              *ifaces;      /* Interface per index */
+    sav_live_snapshot_t *retired;     /* Replaced snapshots, oldest first */
+    sav_live_snapshot_t *retired_tail;
+    uint64_t            *bad;         /* Validation bitmap, reused per record */
+    size_t              bad_words;
+    sav_live_stats_t    stats;
+
+    GMutex              lock;         /* Guards readers */
+    GPtrArray           *readers;
+};
+
+static const sav_lpm_leaf_t empty_leaf;
+
+/* ---------------------------------------------------------------- keys */
+
+static inline live_u128 host_mask(uint8_t len)
+{
+    return len >= 128 ? 0 : ~(live_u128)0 >> len;
+}
+
+static live_u128 entry_addr(const sav_state_entry_t *e)
+{
+    live_u128 a = 0;
+    int bytes = (e->family == 4) ? 4 : 16;
+
+    for (int i = 0; i < bytes; i++) {
+        a |= (live_u128)e->prefix[i] << (120 - 8 * i);
+    }
+    return a;
+}
+
+static live_u128 addr6(const uint8_t *addr)
+{
+    uint64_t hi, lo;
+
+    memcpy(&hi, addr, 8);
+    memcpy(&lo, addr + 8, 8);
+    return (live_u128)GUINT64_FROM_BE(hi) << 64 | GUINT64_FROM_BE(lo);
+}
+
+static inline int entry_level(const sav_state_entry_t *e)
+{
+    if (e->prefix_len < 8) return LEVEL_TOP;
+    if (e->prefix_len < 16) return LEVEL_OCTET;
+    return (e->family == 4 || e->prefix_len < 32) ? LEVEL_SLOT : LEVEL_KID;
+}
+
+/* Family, level and fixed address bits of the partition of an entry */
+static uint64_t part_id(const sav_state_entry_t *e)
+{
+    int level = entry_level(e);
+    live_u128 a = entry_addr(e);
+    uint64_t bits = (level == LEVEL_TOP) ? 0 : (uint64_t)(a >> (128 - level_shift[level]));
+
+    return (uint64_t)(e->family == 6) << 36 | (uint64_t)level << 32 | bits;
+}
+
+static inline int id_family(uint64_t id)  { return (int)(id >> 36); }
+static inline int id_level(uint64_t id)   { return (int)(id >> 32) & 0xF; }
+static inline uint8_t id_shift(uint64_t id) { return level_shift[id_level(id)]; }
+
+static gboolean key_eq(const sav_state_entry_t *a, const sav_state_entry_t *b)
+{
+    return a->family == b->family && a->target_type == b->target_type &&
+           a->prefix_len == b->prefix_len && a->interface == b->interface &&
+           memcmp(a->prefix, b->prefix, a->family == 4 ? 4 : 16) == 0;
+}
+
+/* ---------------------------------------------------------------- partitions */
+
+/* One mapping of a partition during its build */
+typedef struct live_map {
+    live_u128 start;
+    uint32_t  interface;
+    uint8_t   prefix_len;
+    uint8_t   rule_type;
+    uint8_t   policy_action;
+} live_map_t;
+
+/* Address order, shorter first, then (rule type, interface) as
+ * sav_lpm_content_add() wants */
+static int map_cmp(const void *pa, const void *pb)
+{
+    const live_map_t *a = pa, *b = pb;
+
+    if (a->start != b->start) return a->start < b->start ? -1 : 1;
+    if (a->prefix_len != b->prefix_len) return a->prefix_len < b->prefix_len ? -1 : 1;
+    if (a->rule_type != b->rule_type) return a->rule_type < b->rule_type ? -1 : 1;
+    if (a->interface != b->interface) return a->interface < b->interface ? -1 : 1;
+    return 0;
+}
+
+/* Append a range unless it continues the previous one */
+static void range_add(live_range_t *ranges, uint32_t *n, uint8_t shift, live_u128 start,
+                      uint32_t leaf_id)
+{
+    if (*n && ranges[*n - 1].leaf_id == leaf_id) {
+        return;
+    }
+    ranges[*n].start = start << shift;
+    ranges[*n].leaf_id = leaf_id;
+    (*n)++;
+}
+
+/* Ranges of prefixes in address order, shorter first. A stack holds the
+ * prefixes covering the current position; pos is the first address not
+ * yet given a range. */
+static uint32_t build_ranges(live_range_t *ranges, uint8_t shift, const live_u128 *starts,
+                             const uint8_t *lens, const uint32_t *ids, size_t np,
+                             live_u128 lo, live_u128 hi)
+{
+    uint32_t n = 0;
+    live_u128 last[129];
+    uint32_t leaf[129];
+    size_t depth = 0;
+    live_u128 pos = lo;
+    gboolean done = FALSE;
+
+    for (size_t i = 0; i <= np; i++) {
+        /* Close the prefixes that end before this one (all of them at the end) */
+        while (depth > 0 && (i == np || last[depth - 1] < starts[i])) {
+            depth--;
+            if (!done && pos <= last[depth]) {
+                range_add(ranges, &n, shift, pos, leaf[depth]);
+                if (last[depth] == hi) done = TRUE; else pos = last[depth] + 1;
+            }
+        }
+        if (i == np) break;
+        if (pos < starts[i]) {
+            range_add(ranges, &n, shift, pos, depth ? leaf[depth - 1] : SAV_LPM_NO_MATCH);
+        }
+        pos = starts[i];
+        last[depth] = starts[i] | host_mask(lens[i]);
+        leaf[depth] = ids[i];
+        depth++;
+    }
+    if (!done) {
+        range_add(ranges, &n, shift, pos, SAV_LPM_NO_MATCH);
+    }
+    return n;
+}
+
+static void build_jump(uint32_t *jump, const live_range_t *ranges, uint32_t n)
+{
+    uint32_t r = 0;
+
+    for (uint32_t b = 0; b < 256; b++) {
+        live_u128 block = (live_u128)b << 120;
+        while (r + 1 < n && ranges[r + 1].start <= block) r++;
+        jump[b] = r;
+    }
+    jump[256] = n - 1;
+}
+
+/* Partition of a source's current mappings, NULL if it has none */
+static live_part_t* part_build(sav_live_t *live, const live_src_t *src,
+                               const sav_lpm_ifindex_t *index)
+{
+    size_t n = src->keys->len, np = 0, used = 0;
+    if (n == 0) {
+        return NULL;
+    }
+
+    live_map_t *maps = g_new(live_map_t, n);
+    for (size_t i = 0; i < n; i++) {
+        sav_state_entry_t e;
+        sav_state_lookup(live->state, &g_array_index(src->keys, sav_state_entry_t, i), &e);
+        maps[i].start = entry_addr(&e);
+        maps[i].interface = e.interface;
+        maps[i].prefix_len = e.prefix_len;
+        maps[i].rule_type = e.rule_type;
+        maps[i].policy_action = e.policy_action;
+    }
+    qsort(maps, n, sizeof(live_map_t), map_cmp);
+
+    /* Merge the mappings of each prefix; the order is already the
+     * nesting order, so parents come from a stack as for sav_lpm6 */
+    uint32_t *buf = g_new(uint32_t, n);
+    sav_lpm_leaf_t *contents = g_new0(sav_lpm_leaf_t, n);
+    live_u128 *starts = g_new(live_u128, n);
+    uint8_t *lens = g_new(uint8_t, n);
+    size_t *parents = g_new(size_t, n);
+    size_t stack[129], depth = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        const live_map_t *m = &maps[i];
+        if (np == 0 || starts[np - 1] != m->start || lens[np - 1] != m->prefix_len) {
+            while (depth > 0) {
+                size_t top = stack[depth - 1];
+                if ((m->start & ~host_mask(lens[top])) == starts[top]) break;
+                depth--;
+            }
+            parents[np] = depth ? stack[depth - 1] : SAV_LPM_NO_PARENT;
+            stack[depth++] = np;
+            starts[np] = m->start;
+            lens[np] = m->prefix_len;
+            np++;
+        }
+        sav_lpm_content_add(&contents[np - 1], m->rule_type == SAV_RULE_TYPE_BLOCKLIST,
+                            buf, &used, m->interface, m->policy_action);
+    }
+
+    uint8_t shift = id_shift(src->id);
+    uint32_t *ids = g_new(uint32_t, np);
+    sav_lpm_leafset_t leafset;
+    sav_lpm_leafset_build(&leafset, contents, parents, np, TRUE, index, ids);
+
+    live_u128 lo = starts[0] & ~host_mask(shift);
+    live_range_t *ranges = g_new(live_range_t, 2 * np + 1);
+    uint32_t n_ranges = build_ranges(ranges, shift, starts, lens, ids, np, lo,
+                                     lo | host_mask(shift));
+
+    /* Struct, jump table and ranges in one block */
+    size_t jump_at = (sizeof(live_part_t) + 15) & ~(size_t)15;
+    size_t ranges_at = jump_at + (n_ranges > JUMP_MIN_RANGES ? (257 * sizeof(uint32_t) + 15) & ~(size_t)15 : 0);
+    char *block = g_malloc(ranges_at + n_ranges * sizeof(live_range_t));
+    live_part_t *p = (live_part_t *)block;
+    memset(p, 0, sizeof(*p));
+    p->refs = 1;
+    p->shift = shift;
+    p->n_ranges = n_ranges;
+    p->leafset = leafset;
+    memcpy(block + ranges_at, ranges, n_ranges * sizeof(live_range_t));
+    p->ranges = (const live_range_t *)(block + ranges_at);
+    if (ranges_at > jump_at) {
+        build_jump((uint32_t *)(block + jump_at), p->ranges, n_ranges);
+        p->jump = (const uint32_t *)(block + jump_at);
+    }
+
+    g_free(ranges);
+    g_free(ids);
+    g_free(parents);
+    g_free(lens);
+    g_free(starts);
+    g_free(contents);
+    g_free(buf);
+    g_free(maps);
+    return p;
+}
+
+/* Leaf ID of the longest prefix of p covering addr */
+static inline uint32_t part_find(const live_part_t *p, live_u128 addr)
+{
+    live_u128 key = addr << p->shift;
+    uint32_t lo = 0, hi = p->n_ranges - 1;
+
+    if (p->jump) {
+        uint32_t b = (uint32_t)(key >> 120);
+        lo = p->jump[b];
+        hi = p->jump[b + 1];
+    }
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo + 1) / 2;
+        if (p->ranges[mid].start <= key) lo = mid; else hi = mid - 1;
+    }
+    return p->ranges[lo].leaf_id;
+}
+
+static size_t part_memory(const live_part_t *p)
+{
+    return (size_t)((const char *)(p->ranges + p->n_ranges) - (const char *)p) +
+           sav_lpm_leafset_memory(&p->leafset);
+}
+
+/* ---------------------------------------------------------------- references */
+
+static void part_unref(live_part_t *p)
+{
+    if (p && --p->refs == 0) {
+        sav_lpm_leafset_clear(&p->leafset);
+        g_free(p);
+    }
+}
+
+static void page_unref(live_page_t *page)
+{
+    if (page && --page->refs == 0) {
+        part_unref(page->part);
+        for (int i = 0; i < PAGE_SLOTS; i++) {
+            live_slot_t *slot = &page->slots[i];
+            part_unref(slot->part);
+            for (uint32_t k = 0; k < slot->n_kids; k++) part_unref(slot->kids[k]);
+            g_free(slot->kid_keys);
+            g_free(slot->kids);
+        }
+        g_free(page);
+    }
+}
+
+static live_ifindex_t* ifindex_new(const uint32_t *ifaces, uint32_t n)
+{
+    live_ifindex_t *ix = g_new0(live_ifindex_t, 1);
+    ix->refs = 1;
+    sav_lpm_ifindex_build(&ix->index, ifaces, n);
+    return ix;
+}
+
+static void ifindex_unref(live_ifindex_t *ix)
+{
+    if (ix && --ix->refs == 0) {
+        sav_lpm_ifindex_clear(&ix->index);
+        g_free(ix);
+    }
+}
+
+static void snapshot_free(sav_live_snapshot_t *snap)
+{
+    ifindex_unref(snap->ifindex);
+    for (int f = 0; f < 2; f++) {
+        part_unref(snap->top[f]);
+        for (int i = 0; i < PAGE_SLOTS; i++) page_unref(snap->pages[f][i]);
+    }
+    g_free(snap);
+}
+
+/* Next snapshot, sharing everything with snap */
+static sav_live_snapshot_t* snapshot_copy(const sav_live_snapshot_t *snap)
+{
+    sav_live_snapshot_t *next = g_new(sav_live_snapshot_t, 1);
+
+    *next = *snap;
+    next->retired_epoch = 0;
+    next->next_retired = NULL;
+    next->ifindex->refs++;
+    for (int f = 0; f < 2; f++) {
+        if (next->top[f]) next->top[f]->refs++;
+        for (int i = 0; i < PAGE_SLOTS; i++) {
+            if (next->pages[f][i]) next->pages[f][i]->refs++;
+        }
+    }
+    return next;
+}
+
+/* Page of snap this publish may change: a copy unless it made it */
+static live_page_t* page_own(sav_live_snapshot_t *snap, int family, uint32_t i)
+{
+    live_page_t *page = snap->pages[family][i];
+    if (page && page->refs == 1) {
+        return page;
+    }
+
+    live_page_t *copy = g_new0(live_page_t, 1);
+    copy->refs = 1;
+    if (page) {
+        copy->part = page->part;
+        if (copy->part) copy->part->refs++;
+        memcpy(copy->slots, page->slots, sizeof(copy->slots));
+        for (int k = 0; k < PAGE_SLOTS; k++) {
+            live_slot_t *slot = &copy->slots[k];
+            if (slot->part) slot->part->refs++;
+            if (slot->n_kids == 0) continue;
+            slot->kid_keys = g_new(uint16_t, slot->n_kids);
+            slot->kids = g_new(live_part_t *, slot->n_kids);
+            memcpy(slot->kid_keys, page->slots[k].kid_keys, slot->n_kids * sizeof(uint16_t));
+            memcpy(slot->kids, page->slots[k].kids, slot->n_kids * sizeof(live_part_t *));
+            for (uint32_t j = 0; j < slot->n_kids; j++) slot->kids[j]->refs++;
+        }
+        page_unref(page);
+    }
+    snap->pages[family][i] = copy;
+    return copy;
+}
+
+/* First kid position with a key not below key */
+static uint32_t kid_pos(const live_slot_t *slot, uint16_t key)
+{
+    uint32_t lo = 0, hi = slot->n_kids;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (slot->kid_keys[mid] < key) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+/* Replace, add or (part NULL) drop the kid with key; returns the old one */
+static live_part_t* kid_set(live_slot_t *slot, uint16_t key, live_part_t *part)
+{
+    uint32_t i = kid_pos(slot, key);
+    gboolean found = i < slot->n_kids && slot->kid_keys[i] == key;
+    live_part_t *old = found ? slot->kids[i] : NULL;
+
+    if (found && part) {
+        slot->kids[i] = part;
+    } else if (found) {
+        memmove(&slot->kid_keys[i], &slot->kid_keys[i + 1], (slot->n_kids - i - 1) * sizeof(uint16_t));
+        memmove(&slot->kids[i], &slot->kids[i + 1], (slot->n_kids - i - 1) * sizeof(live_part_t *));
+        if (--slot->n_kids == 0) {
+            g_free(slot->kid_keys);
+            g_free(slot->kids);
+            slot->kid_keys = NULL;
+            slot->kids = NULL;
+        }
+    } else if (part) {
+        slot->kid_keys = g_renew(uint16_t, slot->kid_keys, slot->n_kids + 1);
+        slot->kids = g_renew(live_part_t *, slot->kids, slot->n_kids + 1);
+        memmove(&slot->kid_keys[i + 1], &slot->kid_keys[i], (slot->n_kids - i) * sizeof(uint16_t));
+        memmove(&slot->kids[i + 1], &slot->kids[i], (slot->n_kids - i) * sizeof(live_part_t *));
+        slot->kid_keys[i] = key;
+        slot->kids[i] = part;
+        slot->n_kids++;
+    }
+    return old;
+}
+
+/* Put part (NULL: none) in place of partition id of snap */
+static void install(sav_live_t *live, sav_live_snapshot_t *snap, uint64_t id, live_part_t *part)
+{
+    int family = id_family(id);
+    live_part_t *old;
+
+    if (id_level(id) == LEVEL_TOP) {
+        old = snap->top[family];
+        snap->top[family] = part;
+    } else if (id_level(id) == LEVEL_OCTET) {
+        live_page_t *page = page_own(snap, family, (uint32_t)id & 0xFF);
+        old = page->part;
+        page->part = part;
+    } else {
+        uint32_t s16 = (id_level(id) == LEVEL_SLOT) ? (uint32_t)id & 0xFFFF
+                                                    : ((uint32_t)id >> 16);
+        live_slot_t *slot = &page_own(snap, family, s16 >> 8)->slots[s16 & 0xFF];
+        if (id_level(id) == LEVEL_SLOT) {
+            old = slot->part;
+            slot->part = part;
+        } else {
+            old = kid_set(slot, (uint16_t)id, part);
+        }
+    }
+    live->stats.partitions += (part != NULL) - (old != NULL);
+    part_unref(old);
+}
+
+/* ---------------------------------------------------------------- lookups */
+
+/* Partitions that may hold prefixes covering addr, deepest first */
+static inline int snapshot_parts(const sav_live_snapshot_t *snap, int family, live_u128 addr,
+                                 const live_part_t **parts)
+{
+    const live_page_t *page = snap->pages[family][(uint32_t)(addr >> 120)];
+    int n = 0;
+
+    if (page) {
+        const live_slot_t *slot = &page->slots[(uint32_t)(addr >> 112) & 0xFF];
+        if (slot->n_kids) {
+            uint16_t key = (uint16_t)(addr >> 96);
+            uint32_t i = kid_pos(slot, key);
+            if (i < slot->n_kids && slot->kid_keys[i] == key) parts[n++] = slot->kids[i];
+        }
+        if (slot->part) parts[n++] = slot->part;
+        if (page->part) parts[n++] = page->part;
+    }
+    if (snap->top[family]) parts[n++] = snap->top[family];
+    return n;
+}
+
+static const sav_lpm_leaf_t* snapshot_lookup(const sav_live_snapshot_t *snap, int family,
+                                             live_u128 addr)
+{
+    const live_part_t *parts[LEVELS];
+    int n = snapshot_parts(snap, family, addr, parts);
+
+    for (int k = 0; k < n; k++) {
+        uint32_t id = part_find(parts[k], addr);
+        if (id != SAV_LPM_NO_MATCH) return &parts[k]->leafset.leaves[id];
+    }
+    return &empty_leaf;
+}
+
+/* The longest match decides block and strict; feasible and loose also
+ * accept what the matches of shallower partitions allow */
+static gboolean snapshot_check(const sav_live_snapshot_t *snap, int family, live_u128 addr,
+                               uint32_t interface, sav_urpf_mode_t mode)
+{
+    const live_part_t *parts[LEVELS];
+    int n = snapshot_parts(snap, family, addr, parts);
+    uint32_t index = sav_lpm_iface_index(&snap->ifindex->index, interface);
+    gboolean longest = TRUE;
+
+    for (int k = 0; k < n; k++) {
+        uint32_t id = part_find(parts[k], addr);
+        if (id == SAV_LPM_NO_MATCH) continue;
+
+        const sav_lpm_leaf_t *leaf = &parts[k]->leafset.leaves[id];
+        if (longest) {
+            if (sav_lpm_ifset_has(&leaf->block_set, index)) return FALSE;
+            if (mode == SAV_URPF_STRICT) return sav_lpm_ifset_has(&leaf->allow_set, index);
+            longest = FALSE;
+        }
+        if (mode == SAV_URPF_LOOSE ? leaf->covered
+                                   : sav_lpm_ifset_has(&leaf->allow_set, index) ||
+                                     sav_lpm_ifset_has(&leaf->inherited_set, index)) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+uint64_t sav_live_snapshot_version(const sav_live_snapshot_t *snap)
+{
+    return snap->version;
+}
+
+const sav_lpm_leaf_t* sav_live_lookup4(
+    const sav_live_snapshot_t *snap,
+    uint32_t                  addr)
+{
+    return snapshot_lookup(snap, 0, (live_u128)addr << 96);
+}
+
+const sav_lpm_leaf_t* sav_live_lookup6(
+    const sav_live_snapshot_t *snap,
+    const uint8_t             *addr)
+{
+    return snapshot_lookup(snap, 1, addr6(addr));
+}
+
+gboolean sav_live_check4(
+    const sav_live_snapshot_t *snap,
+    uint32_t                  addr,
+    uint32_t                  interface,
+    sav_urpf_mode_t           mode)
+{
+    return snapshot_check(snap, 0, (live_u128)addr << 96, interface, mode);
+}
+
+gboolean sav_live_check6(
+    const sav_live_snapshot_t *snap,
+    const uint8_t             *addr,
+    uint32_t                  interface,
+    sav_urpf_mode_t           mode)
+{
+    return snapshot_check(snap, 1, addr6(addr), interface, mode);
+}
+
+/* ---------------------------------------------------------------- readers */
+
+sav_live_reader_t* sav_live_reader_new(sav_live_t *live)
+{
+    sav_live_reader_t *reader = g_new0(sav_live_reader_t, 1);
+
+    reader->live = live;
+    g_mutex_lock(&live->lock);
+    g_ptr_array_add(live->readers, reader);
+    g_mutex_unlock(&live->lock);
+    return reader;
+}
+
+void sav_live_reader_free(sav_live_reader_t *reader)
+{
+    if (!reader) {
+        return;
+    }
+    g_mutex_lock(&reader->live->lock);
+    g_ptr_array_remove_fast(reader->live->readers, reader);
+    g_mutex_unlock(&reader->live->lock);
+    g_free(reader);
+}
+
+/* The epoch store must be visible before the pointer is read: a reader
+ * that took a snapshot then shows an epoch older than the one at which
+ * that snapshot was replaced */
+const sav_live_snapshot_t* sav_live_read_begin(sav_live_reader_t *reader)
+{
+    sav_live_t *live = reader->live;
+
+    __atomic_store_n(&reader->epoch, __atomic_load_n(&live->epoch, __ATOMIC_ACQUIRE),
+                     __ATOMIC_SEQ_CST);
+    return __atomic_load_n(&live->current, __ATOMIC_SEQ_CST);
+}
+
+void sav_live_read_end(sav_live_reader_t *reader)
+{
+    __atomic_store_n(&reader->epoch, 0, __ATOMIC_RELEASE);
+}
+
+/* ---------------------------------------------------------------- writer */
+
+sav_live_t* sav_live_new(void)
+{
+    sav_live_t *live = g_new0(sav_live_t, 1);
+    sav_live_snapshot_t *snap = g_new0(sav_live_snapshot_t, 1);
+
+    snap->ifindex = ifindex_new(NULL, 0);
+    live->current = snap;
+    live->epoch = 1;
+    live->state = sav_state_new();
+    live->sources = g_hash_table_new_full(g_int64_hash, g_int64_equal, NULL, NULL);
+    live->dirty = g_ptr_array_new();
+    live->iface_ids = g_hash_table_new(g_direct_hash, g_direct_equal);
+    live->ifaces = g_array_new(FALSE, FALSE, sizeof(uint32_t));
+    live->readers = g_ptr_array_new();
+    g_mutex_init(&live->lock);
+    return live;
+}
+
+static void src_free(live_src_t *src)
+{
+    g_array_free(src->keys, TRUE);
+    g_free(src);
+}
+
+void sav_live_free(sav_live_t *live)
+{
+    if (!live) {
+        return;
+    }
+
+    GHashTableIter it;
+    gpointer value;
+    g_hash_table_iter_init(&it, live->sources);
+    while (g_hash_table_iter_next(&it, NULL, &value)) {
+        src_free(value);
+    }
+    while (live->retired) {
+        sav_live_snapshot_t *next = live->retired->next_retired;
+        snapshot_free(live->retired);
+        live->retired = next;
+    }
+    snapshot_free(live->current);
+
+    g_hash_table_destroy(live->sources);
+    g_ptr_array_free(live->dirty, TRUE);
+    g_hash_table_destroy(live->iface_ids);
+    g_array_free(live->ifaces, TRUE);
+    g_ptr_array_free(live->readers, TRUE);
+    g_mutex_clear(&live->lock);
+    sav_state_free(live->state);
+    g_free(live->bad);
+    g_free(live);
+}
+
+/* Source of the partition of e, created if asked */
+static live_src_t* src_get(sav_live_t *live, const sav_state_entry_t *e, gboolean create)
+{
+    uint64_t id = part_id(e);
+    live_src_t *src = g_hash_table_lookup(live->sources, &id);
+
+    if (!src && create) {
+        src = g_new0(live_src_t, 1);
+        src->id = id;
+        src->keys = g_array_new(FALSE, FALSE, sizeof(sav_state_entry_t));
+        g_hash_table_insert(live->sources, &src->id, src);
+    }
+    return src;
+}
+
+static void src_touch(sav_live_t *live, live_src_t *src)
+{
+    if (!src->dirty) {
+        src->dirty = TRUE;
+        g_ptr_array_add(live->dirty, src);
+    }
+}
+
+gboolean sav_live_upsert(
+    sav_live_t              *live,
+    const sav_state_entry_t *entry)
+{
+    sav_state_entry_t old;
+    gboolean found = sav_state_lookup(live->state, entry, &old);
+
+    sav_state_upsert(live->state, entry);
+    if (found && old.rule_type == entry->rule_type && old.policy_action == entry->policy_action) {
+        return FALSE;
+    }
+
+    live_src_t *src = src_get(live, entry, TRUE);
+    if (!found) {
+        g_array_append_val(src->keys, *entry);
+        if (!g_hash_table_lookup(live->iface_ids, GUINT_TO_POINTER(entry->interface))) {
+            g_array_append_val(live->ifaces, entry->interface);
+            g_hash_table_insert(live->iface_ids, GUINT_TO_POINTER(entry->interface),
+                                GUINT_TO_POINTER(live->ifaces->len));
+        }
+    }
+    src_touch(live, src);
+    return !found;
+}
+
+gboolean sav_live_remove(
+    sav_live_t              *live,
+    const sav_state_entry_t *key)
+{
+    if (!sav_state_remove(live->state, key)) {
+        return FALSE;
+    }
+
+    live_src_t *src = src_get(live, key, FALSE);
+    for (guint i = 0; i < src->keys->len; i++) {
+        if (key_eq(&g_array_index(src->keys, sav_state_entry_t, i), key)) {
+            g_array_remove_index_fast(src->keys, i);
+            break;
+        }
+    }
+    src_touch(live, src);
+    return TRUE;
+}
+
+gboolean sav_live_apply_record(
+    sav_live_t                *live,
+    const sav_parsed_record_t *record,
+    GError                    **err)
+{
+    if (!sav_validate_record_header(record, err)) {
+        return FALSE;
+    }
+    live->stats.records++;
+
+    uint32_t n = record->mapping_count;
+    if (n == 0 || !record->mappings.ipv4_mappings) {
+        return TRUE;
+    }
+
+    size_t words = SAV_VALIDATE_BITMAP_WORDS(n);
+    if (words > live->bad_words) {
+        live->bad = g_renew(uint64_t, live->bad, words);
+        live->bad_words = words;
+    }
+    live->stats.rejected += sav_validate_record_mappings(record, live->bad);
+
+    sav_state_entry_t e;
+    memset(&e, 0, sizeof(e));
+    e.target_type = record->target_type;
+    e.rule_type = record->rule_type;
+    e.policy_action = record->policy_action;
+    e.updated_ms = record->timestamp_ms;
+
+    if (sav_sub_template_layout(record->sub_template_id)->family == 4) {
+        const sav_ipv4_mapping_t *m = record->mappings.ipv4_mappings;
+        e.family = 4;
+        for (uint32_t i = 0; i < n; i++) {
+            if ((live->bad[i / 64] >> (i % 64)) & 1) continue;
+            uint32_t prefix = htonl(m[i].sourceIPv4Prefix);
+            e.interface = m[i].ingressInterface;
+            e.prefix_len = m[i].sourceIPv4PrefixLength;
+            memcpy(e.prefix, &prefix, 4);
+            sav_live_upsert(live, &e);
+        }
+    } else {
+        const sav_ipv6_mapping_t *m = record->mappings.ipv6_mappings;
+        e.family = 6;
+        for (uint32_t i = 0; i < n; i++) {
+            if ((live->bad[i / 64] >> (i % 64)) & 1) continue;
+            e.interface = m[i].ingressInterface;
+            e.prefix_len = m[i].sourceIPv6PrefixLength;
+            memcpy(e.prefix, m[i].sourceIPv6Prefix, 16);
+            sav_live_upsert(live, &e);
+        }
+    }
+    return TRUE;
+}
+
+const sav_state_t* sav_live_state(const sav_live_t *live)
+{
+    return live->state;
+}
+
+uint64_t sav_live_publish(sav_live_t *live)
+{
+    sav_live_snapshot_t *old = live->current;
+    gboolean new_ifaces = live->ifaces->len > old->ifindex->index.n;
+
+    if (live->dirty->len == 0 && !new_ifaces) {
+        sav_live_reclaim(live);
+        return old->version;
+    }
+
+    /* Partitions built before keep their sets: indexes never change */
+    sav_live_snapshot_t *snap = snapshot_copy(old);
+    if (new_ifaces) {
+        ifindex_unref(snap->ifindex);
+        snap->ifindex = ifindex_new((const uint32_t *)live->ifaces->data, live->ifaces->len);
+    }
+    for (guint i = 0; i < live->dirty->len; i++) {
+        live_src_t *src = g_ptr_array_index(live->dirty, i);
+        install(live, snap, src->id, part_build(live, src, &snap->ifindex->index));
+        live->stats.rebuilt++;
+        src->dirty = FALSE;
+        if (src->keys->len == 0) {
+            g_hash_table_remove(live->sources, &src->id);
+            src_free(src);
+        }
+    }
+    g_ptr_array_set_size(live->dirty, 0);
+    snap->version = old->version + 1;
+
+    /* Readers that still see the old snapshot announced an epoch below
+     * the one this increment makes */
+    __atomic_store_n(&live->current, snap, __ATOMIC_SEQ_CST);
+    old->retired_epoch = __atomic_add_fetch(&live->epoch, 1, __ATOMIC_SEQ_CST);
+    if (live->retired_tail) {
+        live->retired_tail->next_retired = old;
+    } else {
+        live->retired = old;
+    }
+    live->retired_tail = old;
+    live->stats.retired++;
+    live->stats.published++;
+
+    sav_live_reclaim(live);
+    return snap->version;
+}
+
+uint64_t sav_live_reclaim(sav_live_t *live)
+{
+    uint64_t oldest = UINT64_MAX;
+
+    g_mutex_lock(&live->lock);
+    for (guint i = 0; i < live->readers->len; i++) {
+        const sav_live_reader_t *reader = g_ptr_array_index(live->readers, i);
+        uint64_t epoch = __atomic_load_n(&reader->epoch, __ATOMIC_SEQ_CST);
+        if (epoch && epoch < oldest) oldest = epoch;
+    }
+    g_mutex_unlock(&live->lock);
+
+    /* A reader in a section entered at epoch e took a snapshot current at e */
+    while (live->retired && live->retired->retired_epoch <= oldest) {
+        sav_live_snapshot_t *snap = live->retired;
+        live->retired = snap->next_retired;
+        if (!live->retired) live->retired_tail = NULL;
+        snapshot_free(snap);
+        live->stats.retired--;
+        live->stats.reclaimed++;
+    }
+    return live->stats.retired;
+}
+
+void sav_live_get_stats(
+    sav_live_t       *live,
+    sav_live_stats_t *stats)
+{
+    const sav_live_snapshot_t *snap = live->current;
+    size_t bytes = sizeof(*snap) + sizeof(live_ifindex_t) +
+                   sav_lpm_ifindex_memory(&snap->ifindex->index);
+
+    for (int f = 0; f < 2; f++) {
+        if (snap->top[f]) bytes += part_memory(snap->top[f]);
+        for (int i = 0; i < PAGE_SLOTS; i++) {
+            const live_page_t *page = snap->pages[f][i];
+            if (!page) continue;
+            bytes += sizeof(*page) + (page->part ? part_memory(page->part) : 0);
+            for (int k = 0; k < PAGE_SLOTS; k++) {
+                const live_slot_t *slot = &page->slots[k];
+                bytes += slot->n_kids * (sizeof(uint16_t) + sizeof(live_part_t *));
+                if (slot->part) bytes += part_memory(slot->part);
+                for (uint32_t j = 0; j < slot->n_kids; j++) bytes += part_memory(slot->kids[j]);
+            }
+        }
+    }
+
+    g_mutex_lock(&live->lock);
+    live->stats.readers = live->readers->len;
+    g_mutex_unlock(&live->lock);
+
+    *stats = live->stats;
+    stats->version = snap->version;
+    stats->interfaces = live->ifaces->len;
+    stats->memory_bytes = bytes;
+}
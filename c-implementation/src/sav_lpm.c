@@ -0,0 +1,415 @@
+/**
+ * @file sav_lpm.c
+ * @brief Leaf building and table memory shared by the LPM tables
+ *
+ * Interface lists hold ingress interface values; the sets hold the dense
+ * index of each interface. A table's own index numbers its interfaces in
+ * ascending order; an index kept by the caller may number them in any
+ * order, so a set is bounded by the lowest and highest index of its list.
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "sav_lpm_internal.h"
+
+/* Order on interface lists; equal lists compare 0 */
+static int list_cmp(const uint32_t *a, uint32_t na, const uint32_t *b, uint32_t nb)
+{
+    if (na != nb) return na < nb ? -1 : 1;
+    return na && a != b ? memcmp(a, b, na * sizeof(uint32_t)) : 0;
+}
+
+/* Total order on leaf content; equal content compares 0 */
+static int content_cmp(const void *pa, const void *pb)
+{
+    const sav_lpm_leaf_t *a = *(const sav_lpm_leaf_t *const *)pa;
+    const sav_lpm_leaf_t *b = *(const sav_lpm_leaf_t *const *)pb;
+    int c;
+
+    if (a->allow_action != b->allow_action) return a->allow_action < b->allow_action ? -1 : 1;
+    if (a->block_action != b->block_action) return a->block_action < b->block_action ? -1 : 1;
+    if (a->covered != b->covered) return a->covered < b->covered ? -1 : 1;
+    if ((c = list_cmp(a->allow, a->n_allow, b->allow, b->n_allow)) != 0) return c;
+    if ((c = list_cmp(a->block, a->n_block, b->block, b->n_block)) != 0) return c;
+    return list_cmp(a->inherited, a->n_inherited, b->inherited, b->n_inherited);
+}
+
+/* Order on inherited lists only */
+static int inherited_cmp(const void *pa, const void *pb)
+{
+    const sav_lpm_leaf_t *a = *(const sav_lpm_leaf_t *const *)pa;
+    const sav_lpm_leaf_t *b = *(const sav_lpm_leaf_t *const *)pb;
+
+    return list_cmp(a->inherited, a->n_inherited, b->inherited, b->n_inherited);
+}
+
+void sav_lpm_content_add(
+    sav_lpm_leaf_t *content,
+    gboolean       block,
+    uint32_t       *buf,
+    size_t         *used,
+    uint32_t       interface,
+    uint8_t        action)
+{
+    uint32_t *n = block ? &content->n_block : &content->n_allow;
+    uint8_t *act = block ? &content->block_action : &content->allow_action;
+
+    if (*n == 0) {
+        if (block) content->block = buf + *used; else content->allow = buf + *used;
+        *act = action;
+    } else if (buf[*used - 1] == interface) {
+        *act = MAX(*act, action);
+        return;
+    }
+    buf[(*used)++] = interface;
+    (*n)++;
+    *act = MAX(*act, action);
+}
+
+/* Inherited list per prefix: the feasible list of its parent, that is
+ * the parent's allow list merged with the parent's inherited list. A
+ * prefix whose allow list adds nothing passes its own list on unchanged,
+ * so the lists of one subtree share storage. Returns the storage. */
+static uint32_t* inherit_feasible(sav_lpm_leaf_t *contents, const size_t *parents, size_t n)
+{
+    size_t cap = 1024, used = 0;
+    uint32_t *buf = g_new(uint32_t, cap);
+    size_t *off = g_new(size_t, n ? n : 1);       /* Feasible list of each prefix */
+    uint32_t *len = g_new(uint32_t, n ? n : 1);
+
+    for (size_t i = 0; i < n; i++) {
+        const sav_lpm_leaf_t *c = &contents[i];
+        size_t p = parents[i];
+        size_t p_off = p == SAV_LPM_NO_PARENT ? 0 : off[p];
+        uint32_t p_n = p == SAV_LPM_NO_PARENT ? 0 : len[p];
+
+        if (used + p_n + c->n_allow > cap) {
+            while (used + p_n + c->n_allow > cap) cap *= 2;
+            buf = g_renew(uint32_t, buf, cap);
+        }
+
+        const uint32_t *x = buf + p_off, *y = c->allow;
+        uint32_t nx = p_n, ny = c->n_allow, ix = 0, iy = 0;
+        uint32_t *out = buf + used, k = 0;
+        while (ix < nx || iy < ny) {
+            if (iy == ny || (ix < nx && x[ix] < y[iy])) {
+                out[k++] = x[ix++];
+            } else if (ix == nx || y[iy] < x[ix]) {
+                out[k++] = y[iy++];
+            } else {
+                out[k++] = x[ix++];
+                iy++;
+            }
+        }
+        if (k == p_n) {
+            off[i] = p_off;
+        } else {
+            off[i] = used;
+            used += k;
+        }
+        len[i] = k;
+    }
+
+    /* The buffer has stopped moving: turn offsets into pointers */
+    for (size_t i = 0; i < n; i++) {
+        size_t p = parents[i];
+        contents[i].inherited = p == SAV_LPM_NO_PARENT ? buf : buf + off[p];
+        contents[i].n_inherited = p == SAV_LPM_NO_PARENT ? 0 : len[p];
+    }
+    g_free(off);
+    g_free(len);
+    return buf;
+}
+
+static int u32_cmp(const void *pa, const void *pb)
+{
+    uint32_t a = *(const uint32_t *)pa, b = *(const uint32_t *)pb;
+    return a < b ? -1 : a > b;
+}
+
+/* Shape of the set of a non-empty list: first word, shift and summary */
+static void set_plan(sav_lpm_ifset_t *set, const uint32_t *list, uint32_t n,
+                     const sav_lpm_ifindex_t *index)
+{
+    uint32_t lo = UINT32_MAX, hi = 0;
+    uint8_t shift = 0;
+
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t w = sav_lpm_iface_index(index, list[i]) >> 6;
+        lo = MIN(lo, w);
+        hi = MAX(hi, w);
+    }
+    while ((64u << shift) < hi - lo + 1) shift++;
+    memset(set, 0, sizeof(*set));
+    set->first = lo;
+    set->shift = shift;
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t w = (sav_lpm_iface_index(index, list[i]) >> 6) - lo;
+        set->summary |= 1ULL << (w >> shift);
+    }
+}
+
+/* Words stored outside the leaf for a set */
+static size_t set_words(const sav_lpm_ifset_t *set)
+{
+    if (set->summary == 0 || (set->shift == 0 && (set->summary & (set->summary - 1)) == 0)) {
+        return 0;
+    }
+    return (size_t)__builtin_popcountll(set->summary) << set->shift;
+}
+
+/* Set of a list; words outside the leaf are taken from *words */
+static void set_fill(sav_lpm_ifset_t *set, const uint32_t *list, uint32_t n,
+                     const sav_lpm_ifindex_t *index, uint64_t **words)
+{
+    if (n == 0) {
+        memset(set, 0, sizeof(*set));
+        return;
+    }
+    set_plan(set, list, n, index);
+
+    size_t n_words = set_words(set);
+    uint64_t *w = n_words ? *words : &set->data.word;
+    if (n_words) {
+        set->data.words = w;
+        *words += n_words;
+    }
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t idx = sav_lpm_iface_index(index, list[i]);
+        uint32_t off = (idx >> 6) - set->first;
+        uint32_t blk = off >> set->shift;
+        uint32_t pos = (uint32_t)__builtin_popcountll(set->summary & ((1ULL << blk) - 1));
+        w[(pos << set->shift) | (off & ((1u << set->shift) - 1))] |= 1ULL << (idx & 63);
+    }
+}
+
+void sav_lpm_ifindex_build(
+    sav_lpm_ifindex_t *index,
+    const uint32_t    *ifaces,
+    uint32_t          n)
+{
+    uint32_t max = 0;
+
+    memset(index, 0, sizeof(*index));
+    index->n = n;
+    for (uint32_t k = 0; k < n; k++) max = MAX(max, ifaces[k]);
+    if (n == 0 || max < SAV_LPM_DIRECT_IFACES || max / 16 < n) {
+        index->n_direct = n ? max + 1 : 0;
+        index->direct = g_new(uint32_t, index->n_direct + 1);
+        for (uint32_t i = 0; i < index->n_direct; i++) index->direct[i] = SAV_LPM_NO_IFACE;
+        for (uint32_t k = 0; k < n; k++) index->direct[ifaces[k]] = k;
+        return;
+    }
+
+    uint32_t bits = 1;
+    while ((1u << bits) < 2 * (uint64_t)n) bits++;
+
+    uint32_t mask = (1u << bits) - 1;
+    index->bits = bits;
+    index->keys = g_new0(uint32_t, mask + 1);
+    index->vals = g_new(uint32_t, mask + 1);
+    for (uint32_t i = 0; i <= mask; i++) index->vals[i] = SAV_LPM_NO_IFACE;
+
+    for (uint32_t k = 0; k < n; k++) {
+        uint32_t i = (ifaces[k] * 0x9E3779B1u) >> (32 - bits);
+        while (index->vals[i] != SAV_LPM_NO_IFACE) i = (i + 1) & mask;
+        index->keys[i] = ifaces[k];
+        index->vals[i] = k;
+    }
+}
+
+void sav_lpm_ifindex_clear(sav_lpm_ifindex_t *index)
+{
+    g_free(index->direct);
+    g_free(index->keys);
+    g_free(index->vals);
+    memset(index, 0, sizeof(*index));
+}
+
+size_t sav_lpm_ifindex_memory(const sav_lpm_ifindex_t *index)
+{
+    if (index->direct) {
+        return index->n_direct * sizeof(uint32_t);
+    }
+    return index->vals ? ((size_t)2 << index->bits) * sizeof(uint32_t) : 0;
+}
+
+void sav_lpm_leafset_build(
+    sav_lpm_leafset_t       *set,
+    sav_lpm_leaf_t          *contents,
+    const size_t            *parents,
+    size_t                  n,
+    gboolean                feasible,
+    const sav_lpm_ifindex_t *index,
+    uint32_t                *leaf_ids)
+{
+    uint32_t *inherited = feasible ? inherit_feasible(contents, parents, n) : NULL;
+
+    memset(set, 0, sizeof(*set));
+    for (size_t i = 0; i < n; i++) {
+        contents[i].covered = contents[i].n_allow != 0 ||
+                              (parents[i] != SAV_LPM_NO_PARENT && contents[parents[i]].covered);
+    }
+
+    /* Equal content sorts together; each new content gets the next ID */
+    const sav_lpm_leaf_t **order = g_new(const sav_lpm_leaf_t *, n ? n : 1);
+    for (size_t i = 0; i < n; i++) order[i] = &contents[i];
+    if (n) {
+        qsort(order, n, sizeof(*order), content_cmp);
+    }
+
+    uint32_t nl = 1;
+    size_t n_list = 0;
+    for (size_t i = 0; i < n; i++) {
+        size_t k = (size_t)(order[i] - contents);
+        if (i > 0 && content_cmp(&order[i - 1], &order[i]) == 0) {
+            leaf_ids[k] = leaf_ids[order[i - 1] - contents];
+        } else {
+            leaf_ids[k] = nl++;
+            n_list += order[i]->n_allow + order[i]->n_block;
+        }
+    }
+
+    /* Leaves still pointing at the build's lists */
+    sav_lpm_leaf_t *lv = g_new0(sav_lpm_leaf_t, nl);
+    for (size_t i = 0; i < n; i++) {
+        lv[leaf_ids[order[i] - contents]] = *order[i];
+    }
+    g_free(order);
+
+    /* Leaves under the same covering prefixes share one inherited list */
+    const sav_lpm_leaf_t **by_inh = g_new(const sav_lpm_leaf_t *, nl);
+    for (uint32_t id = 0; id < nl; id++) by_inh[id] = &lv[id];
+    qsort(by_inh, nl, sizeof(*by_inh), inherited_cmp);
+    for (uint32_t i = 0; i < nl; i++) {
+        if (i == 0 || inherited_cmp(&by_inh[i - 1], &by_inh[i]) != 0) n_list += by_inh[i]->n_inherited;
+    }
+
+    /* Copy each list once into the final storage */
+    uint32_t *store = g_new(uint32_t, n_list ? n_list : 1);
+    size_t off = 0;
+    for (uint32_t id = 1; id < nl; id++) {
+        sav_lpm_leaf_t *leaf = &lv[id];
+        if (leaf->n_allow) memcpy(store + off, leaf->allow, leaf->n_allow * sizeof(uint32_t));
+        leaf->allow = store + off;
+        off += leaf->n_allow;
+        if (leaf->n_block) memcpy(store + off, leaf->block, leaf->n_block * sizeof(uint32_t));
+        leaf->block = store + off;
+        off += leaf->n_block;
+    }
+    for (uint32_t i = 0; i < nl; i++) {
+        sav_lpm_leaf_t *leaf = (sav_lpm_leaf_t *)by_inh[i];
+        if (i > 0 && inherited_cmp(&by_inh[i - 1], &by_inh[i]) == 0) {
+            leaf->inherited = by_inh[i - 1]->inherited;
+            continue;
+        }
+        if (leaf->n_inherited) memcpy(store + off, leaf->inherited, leaf->n_inherited * sizeof(uint32_t));
+        leaf->inherited = store + off;
+        off += leaf->n_inherited;
+    }
+    g_free(inherited);
+
+    /* Without an index from the caller, a dense one over every interface
+     * of every list */
+    if (!index) {
+        uint32_t *sorted = g_new(uint32_t, n_list ? n_list : 1);
+        uint32_t n_ifaces = 0;
+        if (n_list) {
+            memcpy(sorted, store, n_list * sizeof(uint32_t));
+            qsort(sorted, n_list, sizeof(uint32_t), u32_cmp);
+        }
+        for (size_t i = 0; i < n_list; i++) {
+            if (n_ifaces == 0 || sorted[n_ifaces - 1] != sorted[i]) sorted[n_ifaces++] = sorted[i];
+        }
+        sav_lpm_ifindex_build(&set->index, sorted, n_ifaces);
+        index = &set->index;
+        g_free(sorted);
+    }
+
+    /* Sets of the own lists of each leaf, then of each inherited list */
+    size_t n_words = 0;
+    sav_lpm_ifset_t plan;
+    for (uint32_t id = 1; id < nl; id++) {
+        if (lv[id].n_allow) {
+            set_plan(&plan, lv[id].allow, lv[id].n_allow, index);
+            n_words += set_words(&plan);
+        }
+        if (lv[id].n_block) {
+            set_plan(&plan, lv[id].block, lv[id].n_block, index);
+            n_words += set_words(&plan);
+        }
+    }
+    for (uint32_t i = 0; i < nl; i++) {
+        if (by_inh[i]->n_inherited && (i == 0 || inherited_cmp(&by_inh[i - 1], &by_inh[i]) != 0)) {
+            set_plan(&plan, by_inh[i]->inherited, by_inh[i]->n_inherited, index);
+            n_words += set_words(&plan);
+        }
+    }
+
+    uint64_t *words = g_new0(uint64_t, n_words ? n_words : 1);
+    uint64_t *w = words;
+    for (uint32_t id = 1; id < nl; id++) {
+        set_fill(&lv[id].allow_set, lv[id].allow, lv[id].n_allow, index, &w);
+        set_fill(&lv[id].block_set, lv[id].block, lv[id].n_block, index, &w);
+    }
+    for (uint32_t i = 0; i < nl; i++) {
+        sav_lpm_leaf_t *leaf = (sav_lpm_leaf_t *)by_inh[i];
+        if (i > 0 && inherited_cmp(&by_inh[i - 1], &by_inh[i]) == 0) {
+            leaf->inherited_set = by_inh[i - 1]->inherited_set;
+        } else {
+            set_fill(&leaf->inherited_set, leaf->inherited, leaf->n_inherited, index, &w);
+        }
+    }
+    g_free(by_inh);
+
+    set->leaves = lv;
+    set->n_leaves = nl;
+    set->ifaces = store;
+    set->n_list = n_list;
+    set->words = words;
+    set->n_words = n_words;
+}
+
+void sav_lpm_leafset_init(sav_lpm_leafset_t *set)
+{
+    memset(set, 0, sizeof(*set));
+    set->leaves = g_new0(sav_lpm_leaf_t, 1);
+    set->n_leaves = 1;
+    sav_lpm_ifindex_build(&set->index, NULL, 0);
+}
+
+void sav_lpm_leafset_clear(sav_lpm_leafset_t *set)
+{
+    g_free(set->leaves);
+    g_free(set->ifaces);
+    g_free(set->words);
+    sav_lpm_ifindex_clear(&set->index);
+    memset(set, 0, sizeof(*set));
+}
+
+size_t sav_lpm_leafset_memory(const sav_lpm_leafset_t *set)
+{
+    return set->n_leaves * sizeof(sav_lpm_leaf_t) + set->n_list * sizeof(uint32_t) +
+           set->n_words * sizeof(uint64_t) + sav_lpm_ifindex_memory(&set->index);
+}
+
+void* sav_lpm_huge_alloc(size_t bytes)
+{
+    void *p = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        g_error("LPM table: cannot map %zu bytes", bytes);
+    }
+#ifdef MADV_HUGEPAGE
+    madvise(p, bytes, MADV_HUGEPAGE);
+#endif
+    return p;
+}
+
+void sav_lpm_huge_free(void *p, size_t bytes)
+{
+    if (p) {
+        munmap(p, bytes);
+    }
+}
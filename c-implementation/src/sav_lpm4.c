@@ -0,0 +1,359 @@
+/**
+ * @file sav_lpm4.c
+ * @brief IPv4 DIR-24-8 source address validation table
+ *
+ * Build:
+ * 1. Sort the added mappings by (length, prefix, rule type, interface).
+ * 2. Merge each run of one prefix into its allow and block interface
+ *    lists (sorted and de-duplicated by construction of the order).
+ * 3. Find the longest covering prefix of each prefix, from which it
+ *    inherits whether it is allowlisted at all and, with feasible checks
+ *    enabled, the allowlisting interfaces, then intern the lists:
+ *    prefixes with identical content share a leaf ID.
+ * 4. Write the prefixes into tbl24/tbl8 from shortest to longest, so a
+ *    longer prefix simply overwrites the entries of the shorter ones it
+ *    nests in. A /25-/32 prefix turns its tbl24 entry into a group of 256
+ *    entries that starts as a copy of the entry it replaces.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "sav_lpm_internal.h"
+#include "sav_layout.h"
+
+/* tbl24 size */
+#define TBL24_ENTRIES  (1u << 24)
+
+/* tbl24 bytes */
+#define TBL24_BYTES    ((size_t)TBL24_ENTRIES * sizeof(uint32_t))
+
+/* One added mapping */
+typedef struct sav_lpm4_route {
+    uint32_t  prefix;                 /* Host order, host bits cleared */
+    uint32_t  interface;
+    uint8_t   prefix_len;
+    uint8_t   rule_type;
+    uint8_t   policy_action;
+} sav_lpm4_route_t;
+
+/* A distinct prefix during the build */
+typedef struct lpm4_prefix {
+    uint32_t  prefix;
+    uint8_t   prefix_len;
+    uint32_t  leaf_id;
+} lpm4_prefix_t;
+
+static inline uint32_t prefix_mask(uint8_t len)
+{
+    return len ? 0xFFFFFFFFu << (32 - len) : 0;
+}
+
+/* Address order, shorter first: every prefix follows those covering it */
+static int nest_cmp(const void *pa, const void *pb)
+{
+    const lpm4_prefix_t *a = pa, *b = pb;
+
+    if (a->prefix != b->prefix) return a->prefix < b->prefix ? -1 : 1;
+    if (a->prefix_len != b->prefix_len) return a->prefix_len < b->prefix_len ? -1 : 1;
+    return 0;
+}
+
+static int route_cmp(const void *pa, const void *pb)
+{
+    const sav_lpm4_route_t *a = pa, *b = pb;
+
+    if (a->prefix_len != b->prefix_len) return a->prefix_len < b->prefix_len ? -1 : 1;
+    if (a->prefix != b->prefix) return a->prefix < b->prefix ? -1 : 1;
+    if (a->rule_type != b->rule_type) return a->rule_type < b->rule_type ? -1 : 1;
+    if (a->interface != b->interface) return a->interface < b->interface ? -1 : 1;
+    return 0;
+}
+
+sav_lpm4_t* sav_lpm4_new(void)
+{
+    sav_lpm4_t *lpm = g_new0(sav_lpm4_t, 1);
+
+    lpm->tbl24 = sav_lpm_huge_alloc(TBL24_BYTES);
+    sav_lpm_leafset_init(&lpm->leafset);
+    return lpm;
+}
+
+void sav_lpm4_free(sav_lpm4_t *lpm)
+{
+    if (!lpm) {
+        return;
+    }
+    sav_lpm_huge_free(lpm->tbl24, TBL24_BYTES);
+    g_free(lpm->tbl8);
+    sav_lpm_leafset_clear(&lpm->leafset);
+    g_free(lpm->routes);
+    g_free(lpm);
+}
+
+gboolean sav_lpm4_add(
+    sav_lpm4_t *lpm,
+    uint32_t   prefix,
+    uint8_t    prefix_len,
+    uint32_t   interface,
+    uint8_t    rule_type,
+    uint8_t    policy_action)
+{
+    if (prefix_len > 32 || !sav_validate_rule_type(rule_type)) {
+        return FALSE;
+    }
+    if (lpm->n_routes == lpm->routes_cap) {
+        lpm->routes_cap = lpm->routes_cap ? lpm->routes_cap * 2 : 1024;
+        lpm->routes = g_renew(sav_lpm4_route_t, lpm->routes, lpm->routes_cap);
+    }
+
+    sav_lpm4_route_t *r = &lpm->routes[lpm->n_routes++];
+    r->prefix = prefix & prefix_mask(prefix_len);
+    r->interface = interface;
+    r->prefix_len = prefix_len;
+    r->rule_type = rule_type;
+    r->policy_action = policy_action;
+    return TRUE;
+}
+
+uint32_t sav_lpm4_add_record(
+    sav_lpm4_t                *lpm,
+    const sav_parsed_record_t *record)
+{
+    const sav_sub_template_layout_t *layout = sav_sub_template_layout(record->sub_template_id);
+    uint32_t added = 0;
+
+    if (!layout || layout->family != 4 || !record->mappings.ipv4_mappings) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < record->mapping_count; i++) {
+        const sav_ipv4_mapping_t *m = &record->mappings.ipv4_mappings[i];
+        added += sav_lpm4_add(lpm, m->sourceIPv4Prefix, m->sourceIPv4PrefixLength,
+                              m->ingressInterface, record->rule_type, record->policy_action);
+    }
+    return added;
+}
+
+typedef struct {
+    sav_lpm4_t *lpm;
+    uint64_t   added;
+} add_state_ctx_t;
+
+static void add_state_entry(const sav_state_entry_t *e, void *user)
+{
+    add_state_ctx_t *ctx = user;
+    uint32_t prefix;
+
+    if (e->family != 4) {
+        return;
+    }
+    memcpy(&prefix, e->prefix, 4);
+    ctx->added += sav_lpm4_add(ctx->lpm, ntohl(prefix), e->prefix_len, e->interface,
+                               e->rule_type, e->policy_action);
+}
+
+uint64_t sav_lpm4_add_state(
+    sav_lpm4_t        *lpm,
+    const sav_state_t *state)
+{
+    add_state_ctx_t ctx = { lpm, 0 };
+    sav_state_foreach(state, add_state_entry, &ctx);
+    return ctx.added;
+}
+
+/* Longest covering prefix of each prefix, found with a stack of the
+ * prefixes enclosing the current one in address order */
+static size_t* find_parents(const lpm4_prefix_t *pfx, size_t np)
+{
+    /* Sorted copies whose leaf_id field carries the build index */
+    lpm4_prefix_t *order = g_new(lpm4_prefix_t, np ? np : 1);
+    size_t *stack = g_new(size_t, 33);
+    size_t *parents = g_new(size_t, np ? np : 1);
+    size_t depth = 0;
+
+    for (size_t i = 0; i < np; i++) {
+        order[i] = pfx[i];
+        order[i].leaf_id = (uint32_t)i;
+    }
+    if (np) {
+        qsort(order, np, sizeof(lpm4_prefix_t), nest_cmp);
+    }
+    for (size_t i = 0; i < np; i++) {
+        const lpm4_prefix_t *p = &order[i];
+        while (depth > 0) {
+            const lpm4_prefix_t *top = &pfx[stack[depth - 1]];
+            if ((p->prefix & prefix_mask(top->prefix_len)) == top->prefix) break;
+            depth--;
+        }
+        parents[p->leaf_id] = depth ? stack[depth - 1] : SAV_LPM_NO_PARENT;
+        stack[depth++] = p->leaf_id;
+    }
+    g_free(stack);
+    g_free(order);
+    return parents;
+}
+
+/* Steps 1-3: distinct prefixes in build order with their leaf IDs.
+ * Returns the prefixes; set receives the leaves. */
+static lpm4_prefix_t* merge_and_intern(sav_lpm4_t *lpm, size_t *n_prefixes,
+                                       sav_lpm_leafset_t *set)
+{
+    size_t n = lpm->n_routes, used = 0, np = 0;
+    uint32_t *buf = g_new(uint32_t, n ? n : 1);
+    lpm4_prefix_t *pfx = g_new0(lpm4_prefix_t, n ? n : 1);
+    sav_lpm_leaf_t *contents = g_new0(sav_lpm_leaf_t, n ? n : 1);
+
+    if (n) {
+        qsort(lpm->routes, n, sizeof(sav_lpm4_route_t), route_cmp);
+    }
+    for (size_t i = 0; i < n; i++) {
+        const sav_lpm4_route_t *r = &lpm->routes[i];
+        if (np == 0 || pfx[np - 1].prefix != r->prefix ||
+            pfx[np - 1].prefix_len != r->prefix_len) {
+            pfx[np].prefix = r->prefix;
+            pfx[np].prefix_len = r->prefix_len;
+            np++;
+        }
+        sav_lpm_content_add(&contents[np - 1], r->rule_type == SAV_RULE_TYPE_BLOCKLIST,
+                            buf, &used, r->interface, r->policy_action);
+    }
+
+    size_t *parents = find_parents(pfx, np);
+    uint32_t *ids = g_new(uint32_t, np ? np : 1);
+    sav_lpm_leafset_build(set, contents, parents, np, lpm->feasible, NULL, ids);
+    for (size_t i = 0; i < np; i++) {
+        pfx[i].leaf_id = ids[i];
+    }
+
+    g_free(ids);
+    g_free(parents);
+    g_free(contents);
+    g_free(buf);
+    *n_prefixes = np;
+    return pfx;
+}
+
+void sav_lpm4_set_feasible(
+    sav_lpm4_t *lpm,
+    gboolean   enabled)
+{
+    lpm->feasible = enabled;
+}
+
+gboolean sav_lpm4_build(
+    sav_lpm4_t *lpm,
+    GError     **err)
+{
+    size_t np;
+    sav_lpm_leafset_t leafset;
+
+    if (lpm->n_routes >= SAV_LPM4_EXTENDED) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                    "Too many IPv4 mappings for one table: %zu", lpm->n_routes);
+        return FALSE;
+    }
+
+    lpm4_prefix_t *pfx = merge_and_intern(lpm, &np, &leafset);
+    uint32_t *tbl24 = sav_lpm_huge_alloc(TBL24_BYTES);
+    uint32_t *tbl8 = NULL;
+    uint32_t groups = 0, groups_cap = 0;
+
+    /* Step 4: shortest prefixes first */
+    for (size_t i = 0; i < np; i++) {
+        const lpm4_prefix_t *p = &pfx[i];
+
+        if (p->prefix_len <= 24) {
+            uint32_t start = p->prefix >> 8;
+            uint32_t count = 1u << (24 - p->prefix_len);
+            for (uint32_t j = 0; j < count; j++) {
+                tbl24[start + j] = p->leaf_id;
+            }
+            continue;
+        }
+
+        uint32_t *e = &tbl24[p->prefix >> 8];
+        if (!(*e & SAV_LPM4_EXTENDED)) {
+            if (groups == groups_cap) {
+                groups_cap = groups_cap ? groups_cap * 2 : 256;
+                tbl8 = g_renew(uint32_t, tbl8, (size_t)groups_cap * 256);
+            }
+            for (uint32_t j = 0; j < 256; j++) {
+                tbl8[(size_t)groups * 256 + j] = *e;
+            }
+            *e = SAV_LPM4_EXTENDED | groups++;
+        }
+
+        uint32_t *group = &tbl8[(size_t)(*e & ~SAV_LPM4_EXTENDED) * 256];
+        uint32_t start = p->prefix & 0xFF;
+        uint32_t count = 1u << (32 - p->prefix_len);
+        for (uint32_t j = 0; j < count; j++) {
+            group[start + j] = p->leaf_id;
+        }
+    }
+    g_free(pfx);
+
+    sav_lpm_huge_free(lpm->tbl24, TBL24_BYTES);
+    g_free(lpm->tbl8);
+    sav_lpm_leafset_clear(&lpm->leafset);
+    lpm->tbl24 = tbl24;
+    lpm->tbl8 = tbl8;
+    lpm->groups = groups;
+    lpm->leafset = leafset;
+    lpm->prefixes = np;
+    return TRUE;
+}
+
+void sav_lpm4_lookup_n(
+    const sav_lpm4_t *lpm,
+    const uint32_t   *addrs,
+    uint32_t         n,
+    uint32_t         *leaves)
+{
+    const uint32_t *tbl24 = lpm->tbl24;
+    uint32_t i = 0;
+
+    for (; i + SAV_LPM4_PREFETCH_AHEAD < n; i++) {
+        __builtin_prefetch(&tbl24[addrs[i + SAV_LPM4_PREFETCH_AHEAD] >> 8]);
+        leaves[i] = sav_lpm4_lookup(lpm, addrs[i]);
+    }
+    for (; i < n; i++) {
+        leaves[i] = sav_lpm4_lookup(lpm, addrs[i]);
+    }
+}
+
+void sav_lpm4_check_n(
+    const sav_lpm4_t *lpm,
+    const uint32_t   *addrs,
+    const uint32_t   *interfaces,
+    uint32_t         n,
+    sav_urpf_mode_t  mode,
+    uint8_t          *valid)
+{
+    uint32_t ids[SAV_LPM_CHECK_BATCH];
+
+    for (uint32_t base = 0; base < n; base += SAV_LPM_CHECK_BATCH) {
+        uint32_t m = MIN(n - base, SAV_LPM_CHECK_BATCH);
+        sav_lpm4_lookup_n(lpm, addrs + base, m, ids);
+        for (uint32_t i = 0; i < m; i++) {
+            if (i + SAV_LPM_CHECK_PREFETCH_AHEAD < m) {
+                __builtin_prefetch(&lpm->leafset.leaves[ids[i + SAV_LPM_CHECK_PREFETCH_AHEAD]]);
+            }
+            valid[base + i] = sav_lpm_leaf_check(
+                &lpm->leafset.leaves[ids[i]],
+                sav_lpm_iface_index(&lpm->leafset.index, interfaces[base + i]), mode);
+        }
+    }
+}
+
+void sav_lpm4_get_stats(
+    const sav_lpm4_t *lpm,
+    sav_lpm_stats_t  *stats)
+{
+    stats->mappings = lpm->n_routes;
+    stats->prefixes = lpm->prefixes;
+    stats->leaves = lpm->leafset.n_leaves - 1;
+    stats->groups = lpm->groups;
+    stats->interfaces = lpm->leafset.index.n;
+    stats->memory_bytes = TBL24_BYTES +
+                          (size_t)lpm->groups * 256 * sizeof(uint32_t) +
+                          sav_lpm_leafset_memory(&lpm->leafset);
+}
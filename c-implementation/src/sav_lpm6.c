@@ -0,0 +1,585 @@
+/**
+ * @file sav_lpm6.c
+ * @brief IPv6 poptrie source address validation table
+ *
+ * Build:
+ * 1. Sort the added mappings by (address, length, rule type, interface).
+ *    In that order every prefix comes after all prefixes containing it.
+ * 2. Merge each run of one prefix into leaf content and intern it, as for
+ *    IPv4. The sorted order is a preorder of the prefix tree, so a stack
+ *    of enclosing prefixes yields the longest covering prefix of each.
+ * 3. Fill the direct table with the prefixes of /16 and shorter, in
+ *    sorted order so that nested prefixes overwrite the ones around them.
+ *    Each direct slot holding longer prefixes becomes a trie node whose
+ *    default leaf is the slot's leaf so far.
+ * 4. A node at depth d resolves address bits d..d+5. Prefixes no longer
+ *    than d+6 are expanded over the slots they cover; slots with longer
+ *    prefixes become child nodes, built recursively. Children of a node
+ *    are allocated together, and its leaf slots are stored as runs.
+ *
+ * Path compression: while every prefix below a node is longer than d+6
+ * and falls into the same slot, the node would have one child and no
+ * leaf of its own. Such strides are folded into the next real node as a
+ * skipped path: a lookup compares the address bits with the path and, on
+ * a mismatch, returns the default leaf stored just before the node's
+ * leaf runs. Sparse tables (one /48 under a /32) then need a few nodes
+ * per prefix instead of one per stride.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "sav_lpm_internal.h"
+#include "sav_layout.h"
+
+/* Direct table: top 16 address bits */
+#define DIRECT_BITS     16
+#define DIRECT_ENTRIES  (1u << DIRECT_BITS)
+
+/* Address bits per trie node */
+#define STRIDE          6
+
+/* Direct table entry flag: the low 31 bits index a node, not a leaf */
+#define DIRECT_NODE     0x80000000u
+
+/* One added mapping */
+typedef struct lpm6_route {
+    uint64_t  hi, lo;                 /* Prefix, host order, host bits cleared */
+    uint32_t  interface;
+    uint8_t   prefix_len;
+    uint8_t   rule_type;
+    uint8_t   policy_action;
+} lpm6_route_t;
+
+/* A distinct prefix during the build */
+typedef struct lpm6_prefix {
+    uint64_t  hi, lo;
+    uint8_t   prefix_len;
+    uint32_t  leaf_id;
+} lpm6_prefix_t;
+
+/* Longest path a node can skip, in bits (a multiple of STRIDE that
+ * leaves room for the skip length in the low byte of skip) */
+#define MAX_SKIP        54
+
+/* 64-way trie node */
+typedef struct lpm6_node {
+    uint64_t  vector;                 /* Slots leading to child nodes */
+    uint64_t  leafvec;                /* Leaf slots starting a run of one leaf */
+    uint32_t  base0;                  /* First leaf run in node_leaves */
+    uint32_t  base1;                  /* First child in nodes */
+    uint64_t  skip;                   /* Skipped path bits (top), skip length (low byte) */
+} lpm6_node_t;
+
+struct sav_lpm6 {
+    uint32_t       *direct;           /* Leaf ID or DIRECT_NODE | node */
+    lpm6_node_t    *nodes;
+    uint32_t       n_nodes;
+    uint32_t       *node_leaves;      /* Leaf IDs of the leaf runs */
+    uint32_t       n_node_leaves;
+    sav_lpm_leafset_t leafset;
+    lpm6_route_t   *routes;           /* Mappings added so far */
+    size_t         n_routes;
+    size_t         routes_cap;
+    uint64_t       prefixes;          /* Distinct prefixes in the last build */
+    gboolean       feasible;          /* Build inherited interface lists */
+};
+
+/* Growable node and leaf-run arrays of one build */
+typedef struct {
+    lpm6_node_t  *nodes;
+    uint32_t     n_nodes, nodes_cap;
+    uint32_t     *runs;
+    uint32_t     n_runs, runs_cap;
+} lpm6_builder_t;
+
+static inline uint64_t load_be64(const uint8_t *p)
+{
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return GUINT64_FROM_BE(v);
+}
+
+static inline void mask_prefix(uint64_t *hi, uint64_t *lo, uint8_t len)
+{
+    if (len == 0) {
+        *hi = *lo = 0;
+    } else if (len < 64) {
+        *hi &= ~0ULL << (64 - len);
+        *lo = 0;
+    } else if (len < 128) {
+        *lo &= len == 64 ? 0 : ~0ULL << (128 - len);
+    }
+}
+
+/* Address bits d..d+5, zero-padded past bit 127 */
+static inline uint32_t slot_at(uint64_t hi, uint64_t lo, unsigned d)
+{
+    if (d <= 64 - STRIDE) return (uint32_t)(hi >> (64 - STRIDE - d)) & 63;
+    if (d < 64) return (uint32_t)((hi << (d - (64 - STRIDE))) | (lo >> (128 - STRIDE - d))) & 63;
+    if (d <= 128 - STRIDE) return (uint32_t)(lo >> (128 - STRIDE - d)) & 63;
+    return (uint32_t)(lo << (d - (128 - STRIDE))) & 63;
+}
+
+static int route_cmp(const void *pa, const void *pb)
+{
+    const lpm6_route_t *a = pa, *b = pb;
+
+    if (a->hi != b->hi) return a->hi < b->hi ? -1 : 1;
+    if (a->lo != b->lo) return a->lo < b->lo ? -1 : 1;
+    if (a->prefix_len != b->prefix_len) return a->prefix_len < b->prefix_len ? -1 : 1;
+    if (a->rule_type != b->rule_type) return a->rule_type < b->rule_type ? -1 : 1;
+    if (a->interface != b->interface) return a->interface < b->interface ? -1 : 1;
+    return 0;
+}
+
+sav_lpm6_t* sav_lpm6_new(void)
+{
+    sav_lpm6_t *lpm = g_new0(sav_lpm6_t, 1);
+
+    lpm->direct = g_new0(uint32_t, DIRECT_ENTRIES);
+    sav_lpm_leafset_init(&lpm->leafset);
+    return lpm;
+}
+
+void sav_lpm6_free(sav_lpm6_t *lpm)
+{
+    if (!lpm) {
+        return;
+    }
+    g_free(lpm->direct);
+    sav_lpm_huge_free(lpm->nodes, (size_t)lpm->n_nodes * sizeof(lpm6_node_t));
+    g_free(lpm->node_leaves);
+    sav_lpm_leafset_clear(&lpm->leafset);
+    g_free(lpm->routes);
+    g_free(lpm);
+}
+
+gboolean sav_lpm6_add(
+    sav_lpm6_t    *lpm,
+    const uint8_t *prefix,
+    uint8_t       prefix_len,
+    uint32_t      interface,
+    uint8_t       rule_type,
+    uint8_t       policy_action)
+{
+    if (prefix_len > 128 || !sav_validate_rule_type(rule_type)) {
+        return FALSE;
+    }
+    if (lpm->n_routes == lpm->routes_cap) {
+        lpm->routes_cap = lpm->routes_cap ? lpm->routes_cap * 2 : 1024;
+        lpm->routes = g_renew(lpm6_route_t, lpm->routes, lpm->routes_cap);
+    }
+
+    lpm6_route_t *r = &lpm->routes[lpm->n_routes++];
+    r->hi = load_be64(prefix);
+    r->lo = load_be64(prefix + 8);
+    mask_prefix(&r->hi, &r->lo, prefix_len);
+    r->interface = interface;
+    r->prefix_len = prefix_len;
+    r->rule_type = rule_type;
+    r->policy_action = policy_action;
+    return TRUE;
+}
+
+uint32_t sav_lpm6_add_record(
+    sav_lpm6_t                *lpm,
+    const sav_parsed_record_t *record)
+{
+    const sav_sub_template_layout_t *layout = sav_sub_template_layout(record->sub_template_id);
+    uint32_t added = 0;
+
+    if (!layout || layout->family != 6 || !record->mappings.ipv6_mappings) {
+        return 0;
+    }
+    for (uint32_t i = 0; i < record->mapping_count; i++) {
+        const sav_ipv6_mapping_t *m = &record->mappings.ipv6_mappings[i];
+        added += sav_lpm6_add(lpm, m->sourceIPv6Prefix, m->sourceIPv6PrefixLength,
+                              m->ingressInterface, record->rule_type, record->policy_action);
+    }
+    return added;
+}
+
+typedef struct {
+    sav_lpm6_t *lpm;
+    uint64_t   added;
+} add_state_ctx_t;
+
+static void add_state_entry(const sav_state_entry_t *e, void *user)
+{
+    add_state_ctx_t *ctx = user;
+
+    if (e->family != 6) {
+        return;
+    }
+    ctx->added += sav_lpm6_add(ctx->lpm, e->prefix, e->prefix_len, e->interface,
+                               e->rule_type, e->policy_action);
+}
+
+uint64_t sav_lpm6_add_state(
+    sav_lpm6_t        *lpm,
+    const sav_state_t *state)
+{
+    add_state_ctx_t ctx = { lpm, 0 };
+    sav_state_foreach(state, add_state_entry, &ctx);
+    return ctx.added;
+}
+
+static uint32_t alloc_nodes(lpm6_builder_t *b, uint32_t count)
+{
+    uint32_t first = b->n_nodes;
+
+    if (b->n_nodes + count > b->nodes_cap) {
+        b->nodes_cap = MAX(b->nodes_cap * 2, b->n_nodes + count);
+        b->nodes = g_renew(lpm6_node_t, b->nodes, b->nodes_cap);
+    }
+    b->n_nodes += count;
+    return first;
+}
+
+static void push_run(lpm6_builder_t *b, uint32_t leaf_id)
+{
+    if (b->n_runs == b->runs_cap) {
+        b->runs_cap = b->runs_cap ? b->runs_cap * 2 : 1024;
+        b->runs = g_renew(uint32_t, b->runs, b->runs_cap);
+    }
+    b->runs[b->n_runs++] = leaf_id;
+}
+
+/* Step 4: node idx for the n prefixes of pfx (all longer than d, all
+ * inside one 2^(128-d) block), where def covers the rest of the block */
+static void build_node(lpm6_builder_t *b, uint32_t idx, const lpm6_prefix_t *pfx,
+                       size_t n, unsigned d, uint32_t def)
+{
+    uint32_t slot_leaf[64];
+    uint64_t vector = 0, leafvec = 0, skip = 0;
+    unsigned skip_len = 0;
+
+    /* Fold single-child strides into a skipped path */
+    while (skip_len + STRIDE <= MAX_SKIP &&
+           slot_at(pfx[0].hi, pfx[0].lo, d) == slot_at(pfx[n - 1].hi, pfx[n - 1].lo, d)) {
+        size_t i = 0;
+        while (i < n && pfx[i].prefix_len > d + STRIDE) i++;
+        if (i < n) break;
+        skip |= (uint64_t)slot_at(pfx[0].hi, pfx[0].lo, d) << (64 - STRIDE - skip_len);
+        skip_len += STRIDE;
+        d += STRIDE;
+    }
+    if (skip_len) {
+        push_run(b, def);
+    }
+
+    for (uint32_t s = 0; s < 64; s++) slot_leaf[s] = def;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t s = slot_at(pfx[i].hi, pfx[i].lo, d);
+        if (pfx[i].prefix_len <= d + STRIDE) {
+            uint32_t count = 1u << (d + STRIDE - pfx[i].prefix_len);
+            for (uint32_t j = 0; j < count; j++) slot_leaf[s + j] = pfx[i].leaf_id;
+        } else {
+            vector |= 1ULL << s;
+        }
+    }
+
+    uint32_t base0 = b->n_runs;
+    int have_run = 0;
+    for (uint32_t s = 0; s < 64; s++) {
+        if (vector & (1ULL << s)) continue;
+        if (!have_run || b->runs[b->n_runs - 1] != slot_leaf[s]) {
+            leafvec |= 1ULL << s;
+            push_run(b, slot_leaf[s]);
+            have_run = 1;
+        }
+    }
+
+    uint32_t base1 = alloc_nodes(b, (uint32_t)__builtin_popcountll(vector));
+    b->nodes[idx].vector = vector;
+    b->nodes[idx].leafvec = leafvec;
+    b->nodes[idx].base0 = base0;
+    b->nodes[idx].base1 = base1;
+    b->nodes[idx].skip = skip | skip_len;
+
+    /* Longer prefixes of one slot are contiguous and follow the shorter
+     * prefixes covering that slot */
+    uint32_t child = base1;
+    for (size_t i = 0; i < n; ) {
+        if (pfx[i].prefix_len <= d + STRIDE) {
+            i++;
+            continue;
+        }
+        uint32_t s = slot_at(pfx[i].hi, pfx[i].lo, d);
+        size_t j = i + 1;
+        while (j < n && pfx[j].prefix_len > d + STRIDE && slot_at(pfx[j].hi, pfx[j].lo, d) == s) {
+            j++;
+        }
+        build_node(b, child++, pfx + i, j - i, d + STRIDE, slot_leaf[s]);
+        i = j;
+    }
+}
+
+void sav_lpm6_set_feasible(
+    sav_lpm6_t *lpm,
+    gboolean   enabled)
+{
+    lpm->feasible = enabled;
+}
+
+gboolean sav_lpm6_build(
+    sav_lpm6_t *lpm,
+    GError     **err)
+{
+    size_t n = lpm->n_routes, used = 0, np = 0;
+
+    if (n >= DIRECT_NODE) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                    "Too many IPv6 mappings for one table: %zu", n);
+        return FALSE;
+    }
+
+    /* Steps 1-2 */
+    uint32_t *buf = g_new(uint32_t, n ? n : 1);
+    lpm6_prefix_t *pfx = g_new0(lpm6_prefix_t, n ? n : 1);
+    sav_lpm_leaf_t *contents = g_new0(sav_lpm_leaf_t, n ? n : 1);
+
+    if (n) {
+        qsort(lpm->routes, n, sizeof(lpm6_route_t), route_cmp);
+    }
+    for (size_t i = 0; i < n; i++) {
+        const lpm6_route_t *r = &lpm->routes[i];
+        if (np == 0 || pfx[np - 1].hi != r->hi || pfx[np - 1].lo != r->lo ||
+            pfx[np - 1].prefix_len != r->prefix_len) {
+            pfx[np].hi = r->hi;
+            pfx[np].lo = r->lo;
+            pfx[np].prefix_len = r->prefix_len;
+            np++;
+        }
+        sav_lpm_content_add(&contents[np - 1], r->rule_type == SAV_RULE_TYPE_BLOCKLIST,
+                            buf, &used, r->interface, r->policy_action);
+    }
+
+    size_t *parents = g_new(size_t, np ? np : 1);
+    size_t stack[129], depth = 0;
+    for (size_t i = 0; i < np; i++) {
+        while (depth > 0) {
+            const lpm6_prefix_t *top = &pfx[stack[depth - 1]];
+            uint64_t hi = pfx[i].hi, lo = pfx[i].lo;
+            mask_prefix(&hi, &lo, top->prefix_len);
+            if (hi == top->hi && lo == top->lo) break;
+            depth--;
+        }
+        parents[i] = depth ? stack[depth - 1] : SAV_LPM_NO_PARENT;
+        stack[depth++] = i;
+    }
+
+    sav_lpm_leafset_t leafset;
+    uint32_t *ids = g_new(uint32_t, np ? np : 1);
+    sav_lpm_leafset_build(&leafset, contents, parents, np, lpm->feasible, NULL, ids);
+    for (size_t i = 0; i < np; i++) {
+        pfx[i].leaf_id = ids[i];
+    }
+    g_free(ids);
+    g_free(parents);
+    g_free(contents);
+    g_free(buf);
+
+    /* Step 3 */
+    uint32_t *direct = g_new0(uint32_t, DIRECT_ENTRIES);
+    for (size_t i = 0; i < np; i++) {
+        if (pfx[i].prefix_len <= DIRECT_BITS) {
+            uint32_t start = (uint32_t)(pfx[i].hi >> (64 - DIRECT_BITS));
+            uint32_t count = 1u << (DIRECT_BITS - pfx[i].prefix_len);
+            for (uint32_t j = 0; j < count; j++) direct[start + j] = pfx[i].leaf_id;
+        }
+    }
+
+    lpm6_builder_t b = { 0 };
+    for (size_t i = 0; i < np; ) {
+        if (pfx[i].prefix_len <= DIRECT_BITS) {
+            i++;
+            continue;
+        }
+        uint32_t s = (uint32_t)(pfx[i].hi >> (64 - DIRECT_BITS));
+        size_t j = i + 1;
+        while (j < np && (uint32_t)(pfx[j].hi >> (64 - DIRECT_BITS)) == s) {
+            j++;
+        }
+        uint32_t idx = alloc_nodes(&b, 1);
+        build_node(&b, idx, pfx + i, j - i, DIRECT_BITS, direct[s]);
+        direct[s] = DIRECT_NODE | idx;
+        i = j;
+    }
+    g_free(pfx);
+
+    /* Nodes are read at random by lookups: move them to huge pages */
+    lpm6_node_t *nodes = NULL;
+    if (b.n_nodes) {
+        nodes = sav_lpm_huge_alloc((size_t)b.n_nodes * sizeof(lpm6_node_t));
+        memcpy(nodes, b.nodes, (size_t)b.n_nodes * sizeof(lpm6_node_t));
+    }
+    g_free(b.nodes);
+
+    g_free(lpm->direct);
+    sav_lpm_huge_free(lpm->nodes, (size_t)lpm->n_nodes * sizeof(lpm6_node_t));
+    g_free(lpm->node_leaves);
+    sav_lpm_leafset_clear(&lpm->leafset);
+    lpm->direct = direct;
+    lpm->nodes = nodes;
+    lpm->n_nodes = b.n_nodes;
+    lpm->node_leaves = b.runs;
+    lpm->n_node_leaves = b.n_runs;
+    lpm->leafset = leafset;
+    lpm->prefixes = np;
+    return TRUE;
+}
+
+/* Advance the lookup key by bits */
+static inline void key_shift(uint64_t *hi, uint64_t *lo, unsigned bits)
+{
+    *hi = (*hi << bits) | (*lo >> (64 - bits));
+    *lo <<= bits;
+}
+
+/* One trie step: the child to descend to (with the key advanced past
+ * this node's bits), or NULL with *leaf set */
+static inline const lpm6_node_t* node_step(const sav_lpm6_t *lpm, const lpm6_node_t *node,
+                                           uint64_t *hi, uint64_t *lo, uint32_t *leaf)
+{
+    unsigned skip_len = (unsigned)(node->skip & 0xFF);
+
+    if (skip_len) {
+        if ((*hi ^ node->skip) >> (64 - skip_len)) {
+            *leaf = lpm->node_leaves[node->base0 - 1];
+            return NULL;
+        }
+        key_shift(hi, lo, skip_len);
+    }
+
+    uint64_t bit = 1ULL << (*hi >> (64 - STRIDE));
+    uint64_t upto = bit | (bit - 1);
+    if (node->vector & bit) {
+        key_shift(hi, lo, STRIDE);
+        return &lpm->nodes[node->base1 + __builtin_popcountll(node->vector & upto) - 1];
+    }
+    *leaf = lpm->node_leaves[node->base0 + __builtin_popcountll(node->leafvec & upto) - 1];
+    return NULL;
+}
+
+uint32_t sav_lpm6_lookup(
+    const sav_lpm6_t *lpm,
+    const uint8_t    *addr)
+{
+    uint64_t hi = load_be64(addr), lo = load_be64(addr + 8);
+    uint32_t e = lpm->direct[hi >> (64 - DIRECT_BITS)];
+
+    if (!(e & DIRECT_NODE)) {
+        return e;
+    }
+
+    const lpm6_node_t *node = &lpm->nodes[e & ~DIRECT_NODE];
+    key_shift(&hi, &lo, DIRECT_BITS);
+    do {
+        node = node_step(lpm, node, &hi, &lo, &e);
+    } while (node);
+    return e;
+}
+
+void sav_lpm6_lookup_n(
+    const sav_lpm6_t *lpm,
+    const uint8_t    *addrs,
+    uint32_t         n,
+    uint32_t         *leaves)
+{
+    const lpm6_node_t *node[SAV_LPM6_LOOKUP_BATCH];
+    uint64_t hi[SAV_LPM6_LOOKUP_BATCH], lo[SAV_LPM6_LOOKUP_BATCH];
+
+    for (uint32_t base = 0; base < n; base += SAV_LPM6_LOOKUP_BATCH) {
+        uint32_t m = MIN(SAV_LPM6_LOOKUP_BATCH, n - base);
+        uint32_t *out = leaves + base;
+        uint32_t active = 0;
+
+        for (uint32_t i = 0; i < m; i++) {
+            const uint8_t *a = addrs + (size_t)(base + i) * 16;
+            uint64_t h = load_be64(a), l = load_be64(a + 8);
+            uint32_t e = lpm->direct[h >> (64 - DIRECT_BITS)];
+
+            node[i] = NULL;
+            out[i] = e;
+            if (e & DIRECT_NODE) {
+                node[i] = &lpm->nodes[e & ~DIRECT_NODE];
+                __builtin_prefetch(node[i]);
+                key_shift(&h, &l, DIRECT_BITS);
+                hi[i] = h;
+                lo[i] = l;
+                active++;
+            }
+        }
+
+        /* One level per address per pass; each next node is prefetched
+         * while the other addresses take their step */
+        while (active) {
+            for (uint32_t i = 0; i < m; i++) {
+                if (!node[i]) continue;
+                node[i] = node_step(lpm, node[i], &hi[i], &lo[i], &out[i]);
+                if (node[i]) {
+                    __builtin_prefetch(node[i]);
+                } else {
+                    active--;
+                }
+            }
+        }
+    }
+}
+
+const sav_lpm_leaf_t* sav_lpm6_leaf(
+    const sav_lpm6_t *lpm,
+    uint32_t         leaf_id)
+{
+    return &lpm->leafset.leaves[leaf_id];
+}
+
+gboolean sav_lpm6_check(
+    const sav_lpm6_t *lpm,
+    const uint8_t    *addr,
+    uint32_t         interface,
+    sav_urpf_mode_t  mode)
+{
+    return sav_lpm_leaf_check(&lpm->leafset.leaves[sav_lpm6_lookup(lpm, addr)],
+                              sav_lpm_iface_index(&lpm->leafset.index, interface), mode);
+}
+
+void sav_lpm6_check_n(
+    const sav_lpm6_t *lpm,
+    const uint8_t    *addrs,
+    const uint32_t   *interfaces,
+    uint32_t         n,
+    sav_urpf_mode_t  mode,
+    uint8_t          *valid)
+{
+    uint32_t ids[SAV_LPM_CHECK_BATCH];
+
+    for (uint32_t base = 0; base < n; base += SAV_LPM_CHECK_BATCH) {
+        uint32_t m = MIN(n - base, SAV_LPM_CHECK_BATCH);
+        sav_lpm6_lookup_n(lpm, addrs + (size_t)base * 16, m, ids);
+        for (uint32_t i = 0; i < m; i++) {
+            if (i + SAV_LPM_CHECK_PREFETCH_AHEAD < m) {
+                __builtin_prefetch(&lpm->leafset.leaves[ids[i + SAV_LPM_CHECK_PREFETCH_AHEAD]]);
+            }
+            valid[base + i] = sav_lpm_leaf_check(
+                &lpm->leafset.leaves[ids[i]],
+                sav_lpm_iface_index(&lpm->leafset.index, interfaces[base + i]), mode);
+        }
+    }
+}
+
+void sav_lpm6_get_stats(
+    const sav_lpm6_t *lpm,
+    sav_lpm_stats_t  *stats)
+{
+    stats->mappings = lpm->n_routes;
+    stats->prefixes = lpm->prefixes;
+    stats->leaves = lpm->leafset.n_leaves - 1;
+    stats->groups = lpm->n_nodes;
+    stats->interfaces = lpm->leafset.index.n;
+    stats->memory_bytes = DIRECT_ENTRIES * sizeof(uint32_t) +
+                          (size_t)lpm->n_nodes * sizeof(lpm6_node_t) +
+                          (size_t)lpm->n_node_leaves * sizeof(uint32_t) +
+                          sav_lpm_leafset_memory(&lpm->leafset);
+}
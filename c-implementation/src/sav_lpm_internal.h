@@ -0,0 +1,141 @@
+/**
+ * @file sav_lpm_internal.h
+ * @brief Leaf building shared by the IPv4 and IPv6 LPM tables
+ *
+ * Not installed. Both tables merge the mappings of each distinct prefix
+ * into allow/block interface lists, find the longest covering prefix of
+ * each prefix, and then intern the lists, so that prefixes with the same
+ * content share one leaf ID.
+ */
+
+#ifndef SAV_LPM_INTERNAL_H
+#define SAV_LPM_INTERNAL_H
+
+#include "sav_lpm.h"
+
+/**
+ * Add one mapping to the content of the prefix being merged
+ *
+ * Mappings must arrive sorted by (rule type, interface) so that each list
+ * is built ascending in buf; a repeated interface keeps the highest action.
+ *
+ * @param content    Content of the current prefix (zeroed before its first mapping)
+ * @param block      TRUE for a blocklist mapping
+ * @param buf        List storage shared by all prefixes of the build
+ * @param used       Entries of buf in use, advanced here
+ * @param interface  Ingress interface
+ * @param action     savPolicyAction
+ */
+void sav_lpm_content_add(
+    sav_lpm_leaf_t *content,
+    gboolean       block,
+    uint32_t       *buf,
+    size_t         *used,
+    uint32_t       interface,
+    uint8_t        action);
+
+/* Parent index of a prefix no other prefix covers */
+#define SAV_LPM_NO_PARENT SIZE_MAX
+
+/**
+ * Build the leaves of a table
+ *
+ * Completes each content with its covered flag and, if asked, its
+ * inherited list (the allow lists of all covering prefixes merged), gives
+ * every distinct content a leaf ID, and builds the leaf bitsets, over an
+ * interface index of the leaves' own interfaces unless one is given.
+ *
+ * @param set       Output: leaves (initialised here; clear the old set first)
+ * @param contents  Content per prefix; covered and inherited are set here
+ * @param parents   Index of the longest covering prefix per prefix, lower
+ *                  than the prefix's own index, or SAV_LPM_NO_PARENT
+ * @param n         Number of prefixes
+ * @param feasible  TRUE to build inherited lists
+ * @param index     Index covering every interface of contents, kept by the
+ *                  caller and left out of set, or NULL to build set's own
+ * @param leaf_ids  Output: leaf ID per prefix (never SAV_LPM_NO_MATCH)
+ */
+void sav_lpm_leafset_build(
+    sav_lpm_leafset_t       *set,
+    sav_lpm_leaf_t          *contents,
+    const size_t            *parents,
+    size_t                  n,
+    gboolean                feasible,
+    const sav_lpm_ifindex_t *index,
+    uint32_t                *leaf_ids);
+
+/**
+ * Set up leaves of an empty table: only the empty leaf, no interfaces
+ *
+ * @param set  Leaves
+ */
+void sav_lpm_leafset_init(sav_lpm_leafset_t *set);
+
+/**
+ * Free leaves
+ *
+ * @param set  Leaves (left unusable until the next init or build)
+ */
+void sav_lpm_leafset_clear(sav_lpm_leafset_t *set);
+
+/**
+ * Bytes held by leaves, their lists and sets and their own interface index
+ *
+ * @param set  Leaves
+ *
+ * @return Memory in bytes
+ */
+size_t sav_lpm_leafset_memory(const sav_lpm_leafset_t *set);
+
+/**
+ * Build an interface index
+ *
+ * A plain array when the interface values are small or dense, as ifIndex
+ * values usually are, else a hash.
+ *
+ * @param index   Output: index (initialised here; clear the old one first)
+ * @param ifaces  Distinct interfaces; ifaces[k] gets index k
+ * @param n       Number of interfaces
+ */
+void sav_lpm_ifindex_build(
+    sav_lpm_ifindex_t *index,
+    const uint32_t    *ifaces,
+    uint32_t          n);
+
+/**
+ * Free an interface index
+ *
+ * @param index  Index (left empty)
+ */
+void sav_lpm_ifindex_clear(sav_lpm_ifindex_t *index);
+
+/**
+ * Bytes held by an interface index
+ *
+ * @param index  Index
+ *
+ * @return Memory in bytes
+ */
+size_t sav_lpm_ifindex_memory(const sav_lpm_ifindex_t *index);
+
+/**
+ * Allocate a zeroed lookup table backed by huge pages where possible
+ *
+ * Lookups touch these tables at random; with 4 KB pages nearly every one
+ * of those reads would also miss the TLB. Aborts on failure, like g_new().
+ *
+ * @param bytes  Size (greater than 0)
+ *
+ * @return Table (free with sav_lpm_huge_free())
+ */
+void* sav_lpm_huge_alloc(size_t bytes);
+
+/**
+ * Free a table from sav_lpm_huge_alloc()
+ *
+ * @param p      Table (may be NULL)
+ * @param bytes  Size passed to sav_lpm_huge_alloc()
+ */
+void sav_lpm_huge_free(void *p, size_t bytes);
+
+#endif /* SAV_LPM_INTERNAL_H */
@@ -0,0 +1,323 @@
+/**
+ * @file sav_sink.c
+ * @brief Output sinks: text, JSON, NDJSON and binary
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include "sav_sink.h"
+#include "sav_json.h"
+#include "sav_layout.h"
+
+/* Binary output buffer */
+#define BINARY_BUFFER_SIZE  (256 * 1024)
+
+/* Per-format behaviour */
+typedef struct sav_sink_ops {
+    void (*begin)(sav_sink_t *sink);
+    void (*write)(sav_sink_t *sink, const sav_parsed_record_t *record);
+    void (*end)(sav_sink_t *sink);
+    void (*flush)(sav_sink_t *sink);
+    int  (*error)(const sav_sink_t *sink);
+} sav_sink_ops_t;
+
+struct sav_sink {
+    const sav_sink_ops_t *ops;
+    FILE              *output;        /* Destination stream */
+    sav_sink_format_t format;         /* Output format */
+    gboolean          started;        /* Stream header written */
+    gboolean          finished;       /* Stream trailer written */
+    uint64_t          records;        /* Records written */
+
+    sav_json_writer_t json;           /* JSON formats */
+
+    uint8_t           *buf;           /* Binary: pending output */
+    size_t            len;            /* Binary: bytes pending */
+    int               error;          /* errno of the first failed write, 0 = none */
+};
+
+/* ---------------------------------------------------------------- text */
+
+static void text_write(sav_sink_t *sink, const sav_parsed_record_t *record)
+{
+    fprintf(sink->output, "=== Record #%lu ===\n", (unsigned long)sink->records + 1);
+    sav_print_record(record, sink->output);
+}
+
+static void text_flush(sav_sink_t *sink)
+{
+    (void)sink;
+}
+
+static int text_error(const sav_sink_t *sink)
+{
+    return ferror(sink->output) ? EIO : 0;
+}
+
+static const sav_sink_ops_t text_ops = {
+    NULL, text_write, NULL, text_flush, text_error
+};
+
+/* ---------------------------------------------------------------- JSON */
+
+static void json_begin(sav_sink_t *sink)
+{
+    sav_json_begin_array(&sink->json);
+}
+
+static void json_write(sav_sink_t *sink, const sav_parsed_record_t *record)
+{
+    sav_json_write_record(&sink->json, record);
+}
+
+static void json_end(sav_sink_t *sink)
+{
+    sav_json_end_array(&sink->json);
+}
+
+static void json_flush(sav_sink_t *sink)
+{
+    sav_json_writer_flush(&sink->json, NULL);
+}
+
+static int json_error(const sav_sink_t *sink)
+{
+    return sink->json.error;
+}
+
+static const sav_sink_ops_t json_ops = {
+    json_begin, json_write, json_end, json_flush, json_error
+};
+
+/* -------------------------------------------------------------- binary */
+
+static void binary_flush(sav_sink_t *sink)
+{
+    if (sink->len == 0) {
+        return;
+    }
+    if (sink->error == 0 && fwrite(sink->buf, 1, sink->len, sink->output) < sink->len) {
+        sink->error = errno ? errno : EIO;
+    }
+    sink->len = 0;
+}
+
+/* Make room for n bytes (n <= BINARY_BUFFER_SIZE) and return the write position */
+static inline uint8_t* binary_reserve(sav_sink_t *sink, size_t n)
+{
+    if (BINARY_BUFFER_SIZE - sink->len < n) {
+        binary_flush(sink);
+    }
+    return sink->buf + sink->len;
+}
+
+static inline uint8_t* put_le16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    return p + 2;
+}
+
+static inline uint8_t* put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+    return p + 4;
+}
+
+static inline uint8_t* put_le64(uint8_t *p, uint64_t v)
+{
+    p = put_le32(p, (uint32_t)v);
+    return put_le32(p, (uint32_t)(v >> 32));
+}
+
+static void binary_begin(sav_sink_t *sink)
+{
+    uint8_t *p = binary_reserve(sink, sizeof(sav_binary_stream_header_t));
+
+    memcpy(p, SAV_BINARY_MAGIC, 4);
+    p = put_le16(p + 4, SAV_BINARY_VERSION);
+    p = put_le16(p, 0);
+    sink->len = (size_t)(p - sink->buf);
+}
+
+static void binary_write(sav_sink_t *sink, const sav_parsed_record_t *record)
+{
+    const sav_sub_template_layout_t *layout = sav_sub_template_layout(record->sub_template_id);
+    uint8_t family = layout ? layout->family : 0;
+    uint32_t count = layout ? record->mapping_count : 0;
+    size_t entry_size = (family == 4) ? sizeof(sav_binary_ipv4_entry_t)
+                                      : sizeof(sav_binary_ipv6_entry_t);
+    size_t body = sizeof(sav_binary_record_header_t) + (size_t)count * entry_size;
+    size_t pad = (8 - body % 8) % 8;
+
+    uint8_t *p = binary_reserve(sink, sizeof(sav_binary_record_header_t));
+    p = put_le32(p, (uint32_t)(body + pad - 4));
+    p = put_le16(p, record->sub_template_id);
+    *p++ = record->rule_type;
+    *p++ = record->target_type;
+    *p++ = record->policy_action;
+    *p++ = family;
+    p = put_le16(p, 0);
+    p = put_le32(p, count);
+    p = put_le64(p, record->timestamp_ms);
+    sink->len = (size_t)(p - sink->buf);
+
+    for (uint32_t i = 0; i < count; i++) {
+        p = binary_reserve(sink, entry_size);
+        if (family == 4) {
+            const sav_ipv4_mapping_t *m = &record->mappings.ipv4_mappings[i];
+            uint32_t prefix = htonl(m->sourceIPv4Prefix);
+            p = put_le32(p, m->ingressInterface);
+            memcpy(p, &prefix, 4);
+            p[4] = m->sourceIPv4PrefixLength;
+            memset(p + 5, 0, 3);
+            p += 8;
+        } else {
+            const sav_ipv6_mapping_t *m = &record->mappings.ipv6_mappings[i];
+            p = put_le32(p, m->ingressInterface);
+            memcpy(p, m->sourceIPv6Prefix, 16);
+            p[16] = m->sourceIPv6PrefixLength;
+            memset(p + 17, 0, 3);
+            p += 20;
+        }
+        sink->len = (size_t)(p - sink->buf);
+    }
+
+    if (pad) {
+        memset(binary_reserve(sink, pad), 0, pad);
+        sink->len += pad;
+    }
+}
+
+static int binary_error(const sav_sink_t *sink)
+{
+    return sink->error;
+}
+
+static const sav_sink_ops_t binary_ops = {
+    binary_begin, binary_write, NULL, binary_flush, binary_error
+};
+
+/* ---------------------------------------------------------------- API */
+
+static gboolean check_error(const sav_sink_t *sink, GError **err)
+{
+    int e = sink->ops->error(sink);
+
+    if (e) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                    "Output write failed: %s", g_strerror(e));
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static void sink_start(sav_sink_t *sink)
+{
+    if (!sink->started) {
+        sink->started = TRUE;
+        if (sink->ops->begin) {
+            sink->ops->begin(sink);
+        }
+    }
+}
+
+sav_sink_t* sav_sink_new(
+    FILE              *output,
+    sav_sink_format_t format,
+    GError            **err)
+{
+    if (!output) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                    "NULL output stream in sav_sink_new");
+        return NULL;
+    }
+
+    sav_sink_t *sink = g_new0(sav_sink_t, 1);
+    sink->output = output;
+    sink->format = format;
+
+    switch (format) {
+        case SAV_SINK_TEXT:
+            sink->ops = &text_ops;
+            break;
+        case SAV_SINK_JSON:
+        case SAV_SINK_JSON_COMPACT:
+        case SAV_SINK_NDJSON:
+            sink->ops = &json_ops;
+            sav_json_writer_init(&sink->json, output,
+                                 format == SAV_SINK_JSON ? SAV_JSON_PRETTY :
+                                 format == SAV_SINK_JSON_COMPACT ? SAV_JSON_COMPACT :
+                                 SAV_JSON_NDJSON, 0);
+            break;
+        case SAV_SINK_BINARY:
+            sink->ops = &binary_ops;
+            sink->buf = g_malloc(BINARY_BUFFER_SIZE);
+            break;
+        default:
+            g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                        "Unknown sink format: %d", (int)format);
+            g_free(sink);
+            return NULL;
+    }
+
+    return sink;
+}
+
+gboolean sav_sink_write(
+    sav_sink_t                *sink,
+    const sav_parsed_record_t *record,
+    GError                    **err)
+{
+    if (!sink || !record) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                    "NULL parameter in sav_sink_write");
+        return FALSE;
+    }
+
+    sink_start(sink);
+    sink->ops->write(sink, record);
+    sink->records++;
+    return check_error(sink, err);
+}
+
+gboolean sav_sink_finish(
+    sav_sink_t *sink,
+    GError     **err)
+{
+    if (!sink) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                    "NULL parameter in sav_sink_finish");
+        return FALSE;
+    }
+
+    sink_start(sink);
+    if (!sink->finished) {
+        sink->finished = TRUE;
+        if (sink->ops->end) {
+            sink->ops->end(sink);
+        }
+    }
+    sink->ops->flush(sink);
+    return check_error(sink, err);
+}
+
+uint64_t sav_sink_record_count(const sav_sink_t *sink)
+{
+    return sink ? sink->records : 0;
+}
+
+void sav_sink_free(sav_sink_t *sink)
+{
+    if (!sink) return;
+
+    if (sink->ops == &json_ops) {
+        sav_json_writer_destroy(&sink->json);
+    }
+    g_free(sink->buf);
+    g_free(sink);
+}
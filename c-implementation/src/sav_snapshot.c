@@ -0,0 +1,394 @@
+/**
+ * @file sav_snapshot.c
+ * @brief Persistent, memory-mapped snapshots of the SAV rule table
+ *
+ * Layout: header, entries at entries_offset, directory at ifaces_offset,
+ * each section starting on an 8-byte boundary. Entries are ordered by
+ * (interface, family, prefix, prefix length, target type), so those of
+ * one interface are contiguous and the directory only needs the first
+ * index and count of each.
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fixbuf/public.h>
+#include "sav_snapshot.h"
+
+#define ALIGN8(x) (((x) + 7) & ~(uint64_t)7)
+
+/* Key order of the file */
+static int key_cmp(uint32_t ia, uint8_t fa, const uint8_t *pa, uint8_t la, uint8_t ta,
+                   const sav_snapshot_entry_t *b)
+{
+    if (ia != b->interface) return ia < b->interface ? -1 : 1;
+    if (fa != b->family) return fa < b->family ? -1 : 1;
+    int c = memcmp(pa, b->prefix, 16);
+    if (c) return c;
+    if (la != b->prefix_len) return la < b->prefix_len ? -1 : 1;
+    if (ta != b->target_type) return ta < b->target_type ? -1 : 1;
+    return 0;
+}
+
+static int entry_cmp(const void *pa, const void *pb)
+{
+    return sav_snapshot_entry_cmp(pa, pb);
+}
+
+/* ---------------------------------------------------------------- writer */
+
+typedef struct {
+    sav_snapshot_entry_t *entries;
+    uint64_t             count;
+    uint64_t             updated_ms;
+} collect_ctx_t;
+
+static void collect_entry(const sav_state_entry_t *e, void *user)
+{
+    collect_ctx_t *ctx = user;
+    sav_snapshot_entry_t *out = &ctx->entries[ctx->count++];
+
+    memset(out, 0, sizeof(*out));
+    out->updated_ms = e->updated_ms;
+    out->interface = e->interface;
+    out->family = e->family;
+    out->prefix_len = e->prefix_len;
+    out->target_type = e->target_type;
+    out->rule_type = e->rule_type;
+    out->policy_action = e->policy_action;
+    memcpy(out->prefix, e->prefix, e->family == 4 ? 4 : 16);
+    ctx->updated_ms = MAX(ctx->updated_ms, e->updated_ms);
+}
+
+static gboolean write_all(FILE *fp, const void *data, size_t len, uint64_t *pos)
+{
+    static const uint8_t zeros[8];
+    size_t pad = (size_t)(ALIGN8(*pos) - *pos);
+
+    if (pad && fwrite(zeros, 1, pad, fp) != pad) return FALSE;
+    if (len && fwrite(data, 1, len, fp) != len) return FALSE;
+    *pos += pad + len;
+    return TRUE;
+}
+
+gboolean sav_snapshot_write(
+    const sav_state_t *state,
+    const char        *path,
+    uint64_t          generation,
+    GError            **err)
+{
+    if (!state || !path) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                    "NULL parameter in sav_snapshot_write");
+        return FALSE;
+    }
+
+    sav_state_stats_t stats;
+    collect_ctx_t ctx = { NULL, 0, 0 };
+    sav_state_get_stats(state, &stats);
+    ctx.entries = g_new(sav_snapshot_entry_t, stats.ipv4_entries + stats.ipv6_entries + 1);
+    sav_state_foreach(state, collect_entry, &ctx);
+    qsort(ctx.entries, ctx.count, sizeof(sav_snapshot_entry_t), entry_cmp);
+
+    GArray *ifaces = g_array_new(FALSE, FALSE, sizeof(sav_snapshot_iface_t));
+    for (uint64_t i = 0; i < ctx.count; i++) {
+        sav_snapshot_iface_t *last = ifaces->len ?
+            &g_array_index(ifaces, sav_snapshot_iface_t, ifaces->len - 1) : NULL;
+        if (last && last->interface == ctx.entries[i].interface) {
+            last->count++;
+        } else {
+            sav_snapshot_iface_t d = { ctx.entries[i].interface, 1, i };
+            g_array_append_val(ifaces, d);
+        }
+    }
+
+    sav_snapshot_header_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.magic = SAV_SNAPSHOT_MAGIC;
+    hdr.version = SAV_SNAPSHOT_VERSION;
+    hdr.header_size = sizeof(sav_snapshot_header_t);
+    hdr.entry_size = sizeof(sav_snapshot_entry_t);
+    hdr.iface_size = sizeof(sav_snapshot_iface_t);
+    hdr.generation = generation;
+    hdr.created_ms = (uint64_t)(g_get_real_time() / 1000);
+    hdr.updated_ms = ctx.updated_ms;
+    hdr.n_entries = ctx.count;
+    hdr.n_ifaces = ifaces->len;
+    hdr.entries_offset = ALIGN8(sizeof(hdr));
+    hdr.ifaces_offset = ALIGN8(hdr.entries_offset + ctx.count * sizeof(sav_snapshot_entry_t));
+    hdr.file_size = hdr.ifaces_offset + (uint64_t)ifaces->len * sizeof(sav_snapshot_iface_t);
+
+    /* Write next to the target so that the rename stays on one file system */
+    char *tmp = g_strdup_printf("%s.XXXXXX", path);
+    gboolean ok = FALSE;
+    int fd = g_mkstemp(tmp);
+    FILE *fp = fd >= 0 ? fdopen(fd, "wb") : NULL;
+    uint64_t pos = 0;
+
+    if (!fp) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                    "Cannot create %s: %s", tmp, strerror(errno));
+        if (fd >= 0) {
+            close(fd);
+            unlink(tmp);
+        }
+        goto done;
+    }
+    /* mkstemp() creates the file 0600; give the snapshot the permissions a
+     * plain fopen() would, so other readers can still map it */
+    mode_t mask = umask(0);
+    umask(mask);
+    ok = fchmod(fd, 0644 & ~mask) == 0 &&
+         write_all(fp, &hdr, sizeof(hdr), &pos) &&
+         write_all(fp, ctx.entries, ctx.count * sizeof(sav_snapshot_entry_t), &pos) &&
+         write_all(fp, ifaces->data, ifaces->len * sizeof(sav_snapshot_iface_t), &pos) &&
+         fflush(fp) == 0 && fsync(fileno(fp)) == 0;
+    if (fclose(fp) != 0) ok = FALSE;
+    if (ok && rename(tmp, path) != 0) ok = FALSE;
+    if (!ok) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                    "Cannot write snapshot %s: %s", path, strerror(errno));
+        unlink(tmp);
+        goto done;
+    }
+
+    /* Make the rename itself durable */
+    char *dir = g_path_get_dirname(path);
+    int dfd = open(dir, O_RDONLY);
+    if (dfd >= 0) {
+        fsync(dfd);
+        close(dfd);
+    }
+    g_free(dir);
+
+done:
+    g_free(tmp);
+    g_array_free(ifaces, TRUE);
+    g_free(ctx.entries);
+    return ok;
+}
+
+/* ---------------------------------------------------------------- reader */
+
+/* Check the header and directory, and point entries and ifaces into the map */
+static gboolean check_layout(sav_snapshot_t *snap, const char *path, GError **err)
+{
+    const sav_snapshot_header_t *h = snap->header;
+
+    if (h->magic != SAV_SNAPSHOT_MAGIC) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                    h->magic == GUINT32_SWAP_LE_BE(SAV_SNAPSHOT_MAGIC) ?
+                    "%s: snapshot written with the other byte order" :
+                    "%s: not a SAV snapshot", path);
+        return FALSE;
+    }
+    if (h->version != SAV_SNAPSHOT_VERSION) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                    "%s: unsupported snapshot version %u", path, h->version);
+        return FALSE;
+    }
+    if (h->header_size != sizeof(sav_snapshot_header_t) ||
+        h->entry_size != sizeof(sav_snapshot_entry_t) ||
+        h->iface_size != sizeof(sav_snapshot_iface_t)) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                    "%s: snapshot written with a different record layout", path);
+        return FALSE;
+    }
+
+    /* Sections inside the file, entry count bounded first so that the
+     * products below cannot overflow */
+    if (h->file_size != snap->len || h->entries_offset % 8 || h->ifaces_offset % 8 ||
+        h->entries_offset < sizeof(*h) || h->entries_offset > snap->len ||
+        h->n_entries > snap->len / sizeof(sav_snapshot_entry_t) ||
+        h->n_ifaces > h->n_entries ||
+        h->entries_offset + h->n_entries * sizeof(sav_snapshot_entry_t) > h->ifaces_offset ||
+        h->ifaces_offset > snap->len ||
+        h->n_ifaces * sizeof(sav_snapshot_iface_t) > snap->len - h->ifaces_offset) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                    "%s: snapshot truncated or corrupt (%zu bytes)", path, snap->len);
+        return FALSE;
+    }
+    snap->entries = (const sav_snapshot_entry_t *)(snap->base + h->entries_offset);
+    snap->ifaces = (const sav_snapshot_iface_t *)(snap->base + h->ifaces_offset);
+
+    /* Directory: ascending interfaces tiling the entries */
+    uint64_t next = 0;
+    for (uint64_t i = 0; i < h->n_ifaces; i++) {
+        const sav_snapshot_iface_t *d = &snap->ifaces[i];
+        if (d->first != next || d->count == 0 ||
+            (i && d->interface <= snap->ifaces[i - 1].interface)) {
+            next = UINT64_MAX;
+            break;
+        }
+        next += d->count;
+    }
+    if (next != h->n_entries) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                    "%s: snapshot directory corrupt", path);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+sav_snapshot_t* sav_snapshot_open(
+    const char *path,
+    GError     **err)
+{
+    if (!path) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                    "NULL parameter in sav_snapshot_open");
+        return NULL;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                    "Cannot open %s: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                    "Cannot stat %s: %s", path, strerror(errno));
+        close(fd);
+        return NULL;
+    }
+    if ((size_t)st.st_size < sizeof(sav_snapshot_header_t)) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                    "%s: snapshot truncated or corrupt (%zu bytes)", path, (size_t)st.st_size);
+        close(fd);
+        return NULL;
+    }
+
+    /* Shared and read-only: every process maps the same page cache pages */
+    void *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                    "Cannot map %s: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    sav_snapshot_t *snap = g_new0(sav_snapshot_t, 1);
+    snap->base = base;
+    snap->len = (size_t)st.st_size;
+    snap->header = base;
+    if (!check_layout(snap, path, err)) {
+        sav_snapshot_close(snap);
+        return NULL;
+    }
+    return snap;
+}
+
+void sav_snapshot_close(sav_snapshot_t *snap)
+{
+    if (!snap) {
+        return;
+    }
+    munmap((void *)snap->base, snap->len);
+    g_free(snap);
+}
+
+uint64_t sav_snapshot_count(const sav_snapshot_t *snap)
+{
+    return snap->header->n_entries;
+}
+
+uint64_t sav_snapshot_generation(const sav_snapshot_t *snap)
+{
+    return snap->header->generation;
+}
+
+uint64_t sav_snapshot_updated_ms(const sav_snapshot_t *snap)
+{
+    return snap->header->updated_ms;
+}
+
+const sav_snapshot_entry_t* sav_snapshot_interface(
+    const sav_snapshot_t *snap,
+    uint32_t             interface,
+    size_t               *count)
+{
+    uint64_t lo = 0, hi = snap->header->n_ifaces;
+
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (snap->ifaces[mid].interface < interface) lo = mid + 1; else hi = mid;
+    }
+    if (lo == snap->header->n_ifaces || snap->ifaces[lo].interface != interface) {
+        *count = 0;
+        return NULL;
+    }
+    *count = snap->ifaces[lo].count;
+    return &snap->entries[snap->ifaces[lo].first];
+}
+
+const sav_snapshot_entry_t* sav_snapshot_find(
+    const sav_snapshot_t    *snap,
+    const sav_state_entry_t *key)
+{
+    uint8_t prefix[16] = { 0 };
+    size_t n;
+    const sav_snapshot_entry_t *e = sav_snapshot_interface(snap, key->interface, &n);
+
+    memcpy(prefix, key->prefix, key->family == 4 ? 4 : 16);
+    size_t lo = 0, hi = n;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int c = key_cmp(key->interface, key->family, prefix, key->prefix_len,
+                        key->target_type, &e[mid]);
+        if (c == 0) return &e[mid];
+        if (c > 0) lo = mid + 1; else hi = mid;
+    }
+    return NULL;
+}
+
+int sav_snapshot_entry_cmp(
+    const sav_snapshot_entry_t *a,
+    const sav_snapshot_entry_t *b)
+{
+    return key_cmp(a->interface, a->family, a->prefix, a->prefix_len, a->target_type, b);
+}
+
+void sav_snapshot_entry_get(
+    const sav_snapshot_entry_t *entry,
+    sav_state_entry_t          *out)
+{
+    memset(out, 0, sizeof(*out));
+    out->target_type = entry->target_type;
+    out->family = entry->family;
+    out->prefix_len = entry->prefix_len;
+    out->interface = entry->interface;
+    memcpy(out->prefix, entry->prefix, 16);
+    out->rule_type = entry->rule_type;
+    out->policy_action = entry->policy_action;
+    out->updated_ms = entry->updated_ms;
+}
+
+uint64_t sav_snapshot_load(
+    const sav_snapshot_t *snap,
+    sav_state_t          *state)
+{
+    sav_state_entry_t e;
+    uint64_t n = snap->header->n_entries;
+    uint64_t loaded = 0;
+
+    for (uint64_t i = 0; i < n; i++) {
+        sav_snapshot_entry_get(&snap->entries[i], &e);
+        /* The table trusts its callers; a damaged entry must not reach it */
+        if ((e.family != 4 || e.prefix_len > 32) &&
+            (e.family != 6 || e.prefix_len > 128)) {
+            continue;
+        }
+        sav_state_upsert(state, &e);
+        loaded++;
+    }
+    return loaded;
+}
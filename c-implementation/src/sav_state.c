@@ -0,0 +1,426 @@
+/**
+ * @file sav_state.c
+ * @brief Live SAV rule table built from a stream of records
+ *
+ * One linear-probing hash table per family. Slots share a 16-byte head
+ * (value fields, interface, length, target type) followed by the prefix,
+ * so the table code is written once over slot_size and per-family hash
+ * and key-compare functions. A slot is empty when its prefix_len is
+ * SLOT_EMPTY, which no valid mapping can have. Removal shifts the rest
+ * of the probe run back instead of leaving tombstones.
+ */
+
+#include <string.h>
+#include <arpa/inet.h>
+#include "sav_state.h"
+#include "sav_layout.h"
+#include "sav_validate.h"
+
+/* Marks an unused slot (valid lengths are <= 128) */
+#define SLOT_EMPTY        0xFF
+
+/* Slots allocated on first insert */
+#define TABLE_MIN_SLOTS   64
+
+typedef struct state_slot_head {
+    uint64_t  updated_ms;
+    uint32_t  interface;
+    uint8_t   prefix_len;             /* SLOT_EMPTY = unused */
+    uint8_t   target_type;
+    uint8_t   rule_type;
+    uint8_t   policy_action;
+} state_slot_head_t;
+
+typedef struct state_slot4 {
+    state_slot_head_t h;
+    uint32_t          prefix;         /* Host order */
+} state_slot4_t;
+
+typedef struct state_slot6 {
+    state_slot_head_t h;
+    uint8_t           prefix[16];     /* Network order */
+} state_slot6_t;
+
+/* Scratch slot of either family */
+typedef union state_slot {
+    state_slot_head_t h;
+    state_slot4_t     s4;
+    state_slot6_t     s6;
+} state_slot_t;
+
+typedef struct state_table {
+    uint8_t   *slots;                 /* capacity * slot_size bytes */
+    size_t    slot_size;
+    size_t    capacity;               /* 0 or a power of two */
+    size_t    count;                  /* Used slots */
+    uint64_t  (*hash)(const state_slot_head_t *slot);
+    gboolean  (*key_eq)(const state_slot_head_t *a, const state_slot_head_t *b);
+} state_table_t;
+
+struct sav_state {
+    state_table_t     v4;
+    state_table_t     v6;
+    uint64_t          *bad;           /* Validation bitmap, reused per record */
+    size_t            bad_words;
+    sav_state_stats_t stats;          /* Counters; entries and memory filled on demand */
+};
+
+/* ---------------------------------------------------------------- keys */
+
+static inline uint64_t mix64(uint64_t x)
+{
+    x ^= x >> 33;
+    x *= 0xFF51AFD7ED558CCDULL;
+    x ^= x >> 33;
+    x *= 0xC4CEB9FE1A85EC53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+static inline uint64_t head_key(const state_slot_head_t *h)
+{
+    return (uint64_t)h->interface | (uint64_t)h->prefix_len << 32 |
+           (uint64_t)h->target_type << 40;
+}
+
+static uint64_t hash4(const state_slot_head_t *slot)
+{
+    const state_slot4_t *s = (const state_slot4_t *)slot;
+    return mix64(head_key(slot) ^ mix64(s->prefix));
+}
+
+static uint64_t hash6(const state_slot_head_t *slot)
+{
+    const state_slot6_t *s = (const state_slot6_t *)slot;
+    uint64_t hi, lo;
+
+    memcpy(&hi, s->prefix, 8);
+    memcpy(&lo, s->prefix + 8, 8);
+    return mix64(hi ^ mix64(lo ^ mix64(head_key(slot))));
+}
+
+static inline gboolean head_eq(const state_slot_head_t *a, const state_slot_head_t *b)
+{
+    return a->interface == b->interface && a->prefix_len == b->prefix_len &&
+           a->target_type == b->target_type;
+}
+
+static gboolean key_eq4(const state_slot_head_t *a, const state_slot_head_t *b)
+{
+    return head_eq(a, b) &&
+           ((const state_slot4_t *)a)->prefix == ((const state_slot4_t *)b)->prefix;
+}
+
+static gboolean key_eq6(const state_slot_head_t *a, const state_slot_head_t *b)
+{
+    return head_eq(a, b) &&
+           memcmp(((const state_slot6_t *)a)->prefix, ((const state_slot6_t *)b)->prefix, 16) == 0;
+}
+
+/* ---------------------------------------------------------------- table */
+
+static inline state_slot_head_t* slot_at(const state_table_t *t, size_t i)
+{
+    return (state_slot_head_t *)(t->slots + i * t->slot_size);
+}
+
+/* Slot holding key, or the empty slot where it would go */
+static size_t table_probe(const state_table_t *t, const state_slot_head_t *key)
+{
+    size_t mask = t->capacity - 1;
+    size_t i = (size_t)t->hash(key) & mask;
+
+    for (;;) {
+        const state_slot_head_t *s = slot_at(t, i);
+        if (s->prefix_len == SLOT_EMPTY || t->key_eq(s, key)) {
+            return i;
+        }
+        i = (i + 1) & mask;
+    }
+}
+
+/* Make room for `needed` entries at a load factor of at most 3/4 */
+static void table_reserve(state_table_t *t, size_t needed)
+{
+    if (needed * 4 <= t->capacity * 3) {
+        return;
+    }
+
+    size_t capacity = t->capacity ? t->capacity : TABLE_MIN_SLOTS;
+    while (needed * 4 > capacity * 3) {
+        capacity *= 2;
+    }
+
+    state_table_t old = *t;
+    t->slots = g_malloc(capacity * t->slot_size);
+    t->capacity = capacity;
+    for (size_t i = 0; i < capacity; i++) {
+        slot_at(t, i)->prefix_len = SLOT_EMPTY;
+    }
+    for (size_t i = 0; i < old.capacity; i++) {
+        const state_slot_head_t *s = slot_at(&old, i);
+        if (s->prefix_len != SLOT_EMPTY) {
+            memcpy(slot_at(t, table_probe(t, s)), s, t->slot_size);
+        }
+    }
+    g_free(old.slots);
+}
+
+static gboolean table_upsert(state_table_t *t, const state_slot_head_t *slot)
+{
+    table_reserve(t, t->count + 1);
+
+    state_slot_head_t *s = slot_at(t, table_probe(t, slot));
+    gboolean added = (s->prefix_len == SLOT_EMPTY);
+
+    memcpy(s, slot, t->slot_size);
+    t->count += added;
+    return added;
+}
+
+static const state_slot_head_t* table_find(const state_table_t *t, const state_slot_head_t *key)
+{
+    if (t->count == 0) {
+        return NULL;
+    }
+    const state_slot_head_t *s = slot_at(t, table_probe(t, key));
+    return (s->prefix_len == SLOT_EMPTY) ? NULL : s;
+}
+
+static gboolean table_remove(state_table_t *t, const state_slot_head_t *key)
+{
+    if (t->count == 0) {
+        return FALSE;
+    }
+
+    size_t mask = t->capacity - 1;
+    size_t hole = table_probe(t, key);
+    if (slot_at(t, hole)->prefix_len == SLOT_EMPTY) {
+        return FALSE;
+    }
+
+    /* Move back every later slot of the run whose home position is not
+     * cyclically within (hole, j] */
+    for (size_t j = (hole + 1) & mask; slot_at(t, j)->prefix_len != SLOT_EMPTY;
+         j = (j + 1) & mask) {
+        size_t home = (size_t)t->hash(slot_at(t, j)) & mask;
+        gboolean stays = (hole < j) ? (home > hole && home <= j)
+                                    : (home > hole || home <= j);
+        if (!stays) {
+            memcpy(slot_at(t, hole), slot_at(t, j), t->slot_size);
+            hole = j;
+        }
+    }
+    slot_at(t, hole)->prefix_len = SLOT_EMPTY;
+    t->count--;
+    return TRUE;
+}
+
+/* ---------------------------------------------------------------- entries */
+
+static void entry_to_head(const sav_state_entry_t *e, state_slot_head_t *h)
+{
+    h->updated_ms = e->updated_ms;
+    h->interface = e->interface;
+    h->prefix_len = e->prefix_len;
+    h->target_type = e->target_type;
+    h->rule_type = e->rule_type;
+    h->policy_action = e->policy_action;
+}
+
+static void slot_to_entry(const state_slot_head_t *h, uint8_t family, sav_state_entry_t *e)
+{
+    memset(e, 0, sizeof(*e));
+    e->target_type = h->target_type;
+    e->family = family;
+    e->prefix_len = h->prefix_len;
+    e->interface = h->interface;
+    e->rule_type = h->rule_type;
+    e->policy_action = h->policy_action;
+    e->updated_ms = h->updated_ms;
+    if (family == 4) {
+        uint32_t prefix = htonl(((const state_slot4_t *)h)->prefix);
+        memcpy(e->prefix, &prefix, 4);
+    } else {
+        memcpy(e->prefix, ((const state_slot6_t *)h)->prefix, 16);
+    }
+}
+
+/* Key and value of e as a slot of its family */
+static const state_slot_head_t* entry_to_slot(const sav_state_entry_t *e, state_slot_t *slot)
+{
+    memset(slot, 0, sizeof(*slot));
+    entry_to_head(e, &slot->h);
+    if (e->family == 4) {
+        uint32_t prefix;
+        memcpy(&prefix, e->prefix, 4);
+        slot->s4.prefix = ntohl(prefix);
+    } else {
+        memcpy(slot->s6.prefix, e->prefix, 16);
+    }
+    return &slot->h;
+}
+
+/* ---------------------------------------------------------------- API */
+
+sav_state_t* sav_state_new(void)
+{
+    sav_state_t *state = g_new0(sav_state_t, 1);
+
+    state->v4.slot_size = sizeof(state_slot4_t);
+    state->v4.hash = hash4;
+    state->v4.key_eq = key_eq4;
+    state->v6.slot_size = sizeof(state_slot6_t);
+    state->v6.hash = hash6;
+    state->v6.key_eq = key_eq6;
+    return state;
+}
+
+void sav_state_free(sav_state_t *state)
+{
+    if (!state) {
+        return;
+    }
+    g_free(state->v4.slots);
+    g_free(state->v6.slots);
+    g_free(state->bad);
+    g_free(state);
+}
+
+gboolean sav_state_apply_record(
+    sav_state_t               *state,
+    const sav_parsed_record_t *record,
+    GError                    **err)
+{
+    if (!sav_validate_record_header(record, err)) {
+        return FALSE;
+    }
+    state->stats.records++;
+
+    uint32_t n = record->mapping_count;
+    if (n == 0 || !record->mappings.ipv4_mappings) {
+        return TRUE;
+    }
+
+    size_t words = SAV_VALIDATE_BITMAP_WORDS(n);
+    if (words > state->bad_words) {
+        state->bad = g_renew(uint64_t, state->bad, words);
+        state->bad_words = words;
+    }
+    state->stats.rejected += sav_validate_record_mappings(record, state->bad);
+
+    state_slot_head_t head;
+    head.updated_ms = record->timestamp_ms;
+    head.target_type = record->target_type;
+    head.rule_type = record->rule_type;
+    head.policy_action = record->policy_action;
+
+    uint64_t added = 0, valid = 0;
+    if (sav_sub_template_layout(record->sub_template_id)->family == 4) {
+        const sav_ipv4_mapping_t *m = record->mappings.ipv4_mappings;
+        state_slot4_t slot;
+        memset(&slot, 0, sizeof(slot));
+        slot.h = head;
+        table_reserve(&state->v4, state->v4.count + n);
+        for (uint32_t i = 0; i < n; i++) {
+            if ((state->bad[i / 64] >> (i % 64)) & 1) continue;
+            slot.h.interface = m[i].ingressInterface;
+            slot.h.prefix_len = m[i].sourceIPv4PrefixLength;
+            slot.prefix = m[i].sourceIPv4Prefix;
+            added += table_upsert(&state->v4, &slot.h);
+            valid++;
+        }
+    } else {
+        const sav_ipv6_mapping_t *m = record->mappings.ipv6_mappings;
+        state_slot6_t slot;
+        slot.h = head;
+        table_reserve(&state->v6, state->v6.count + n);
+        for (uint32_t i = 0; i < n; i++) {
+            if ((state->bad[i / 64] >> (i % 64)) & 1) continue;
+            slot.h.interface = m[i].ingressInterface;
+            slot.h.prefix_len = m[i].sourceIPv6PrefixLength;
+            memcpy(slot.prefix, m[i].sourceIPv6Prefix, 16);
+            added += table_upsert(&state->v6, &slot.h);
+            valid++;
+        }
+    }
+    state->stats.inserts += added;
+    state->stats.replaces += valid - added;
+    return TRUE;
+}
+
+gboolean sav_state_upsert(
+    sav_state_t             *state,
+    const sav_state_entry_t *entry)
+{
+    state_slot_t slot;
+    state_table_t *t = (entry->family == 4) ? &state->v4 : &state->v6;
+    gboolean added = table_upsert(t, entry_to_slot(entry, &slot));
+
+    if (added) {
+        state->stats.inserts++;
+    } else {
+        state->stats.replaces++;
+    }
+    return added;
+}
+
+gboolean sav_state_lookup(
+    const sav_state_t       *state,
+    const sav_state_entry_t *key,
+    sav_state_entry_t       *out)
+{
+    state_slot_t slot;
+    const state_table_t *t = (key->family == 4) ? &state->v4 : &state->v6;
+    const state_slot_head_t *s = table_find(t, entry_to_slot(key, &slot));
+
+    if (!s) {
+        return FALSE;
+    }
+    if (out) {
+        slot_to_entry(s, key->family == 4 ? 4 : 6, out);
+    }
+    return TRUE;
+}
+
+gboolean sav_state_remove(
+    sav_state_t             *state,
+    const sav_state_entry_t *key)
+{
+    state_slot_t slot;
+    state_table_t *t = (key->family == 4) ? &state->v4 : &state->v6;
+    return table_remove(t, entry_to_slot(key, &slot));
+}
+
+void sav_state_foreach(
+    const sav_state_t *state,
+    sav_state_fn      fn,
+    void              *user)
+{
+    const state_table_t *tables[2] = { &state->v4, &state->v6 };
+    sav_state_entry_t entry;
+
+    for (int f = 0; f < 2; f++) {
+        const state_table_t *t = tables[f];
+        for (size_t i = 0; i < t->capacity; i++) {
+            const state_slot_head_t *s = slot_at(t, i);
+            if (s->prefix_len != SLOT_EMPTY) {
+                slot_to_entry(s, f == 0 ? 4 : 6, &entry);
+                fn(&entry, user);
+            }
+        }
+    }
+}
+
+void sav_state_get_stats(
+    const sav_state_t *state,
+    sav_state_stats_t *stats)
+{
+    *stats = state->stats;
+    stats->ipv4_entries = state->v4.count;
+    stats->ipv6_entries = state->v6.count;
+    stats->memory_bytes = sizeof(*state) +
+                          state->v4.capacity * state->v4.slot_size +
+                          state->v6.capacity * state->v6.slot_size +
+                          state->bad_words * sizeof(uint64_t);
+}
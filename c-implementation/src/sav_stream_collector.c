@@ -0,0 +1,785 @@
+/**
+ * @file sav_stream_collector.c
+ * @brief TCP and SCTP transports for the SAV IPFIX collector
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#ifdef __linux__
+#include <linux/sctp.h>
+#endif
+#include "sav_collector.h"
+#include "sav_collector_internal.h"
+#include "sav_fast_decoder.h"
+
+/* SCTP needs the stream id of each message (RFC 6458 SCTP_RCVINFO) */
+#ifdef SCTP_RCVINFO
+#define STREAM_HAVE_SCTP 1
+#else
+#define STREAM_HAVE_SCTP 0
+#endif
+
+/* Kernels before 4.5 wake every worker for a new connection */
+#ifndef EPOLLEXCLUSIVE
+#define EPOLLEXCLUSIVE 0
+#endif
+
+#define STREAM_BUF_INITIAL        4096   /* Grown up to the largest message */
+#define STREAM_READS_PER_EVENT    16     /* Reads per readiness event before yielding */
+#define STREAM_ACCEPTS_PER_EVENT  64
+#define STREAM_EVENTS_MAX         256
+#define STREAM_LISTEN_BACKLOG     1024
+
+/* Template scope within a connection (RFC 7011, section 10.2.4) */
+typedef struct sav_stream_scope {
+    uint16_t            stream_id;    /* SCTP stream, 0 for TCP */
+    uint32_t            domain_id;    /* Observation domain */
+    sav_collector_ctx_t *ctx;         /* Templates, fast decoder and buffer-fed fBuf */
+} sav_stream_scope_t;
+
+/* Exporter connection owned by one worker */
+typedef struct sav_stream_conn {
+    int                     fd;
+    struct sav_stream_conn  *prev;
+    struct sav_stream_conn  *next;
+    uint8_t                 *buf;         /* Reassembly buffer */
+    size_t                  cap;          /* Capacity of buf */
+    size_t                  len;          /* Bytes buffered */
+    uint16_t                stream_id;    /* SCTP stream of the buffered message */
+    sav_stream_scope_t      *scopes;
+    uint32_t                scope_count;
+    char                    peer[INET6_ADDRSTRLEN + 8];
+} sav_stream_conn_t;
+
+/* epoll loop serving a share of the connections */
+typedef struct sav_stream_worker {
+    struct sav_stream       *owner;
+    uint32_t                index;
+    int                     epfd;
+    fbInfoModel_t           *model;       /* Shared by the sessions of this worker */
+    sav_stream_conn_t       *conns;       /* Open connections */
+    sav_record_view_func_t  func;
+    gpointer                user_data;
+    gint64                  last_record;  /* Monotonic time of the last record */
+    uint64_t                records_read; /* Written by the worker thread only */
+    uint64_t                parse_errors;
+    sav_stream_stats_t      stats;
+} sav_stream_worker_t;
+
+struct sav_stream {
+    int                     listen_fd;
+    sav_stream_transport_t  transport;
+    uint16_t                port;         /* Bound local port */
+    uint32_t                idle_ms;      /* Stop after this long without records */
+    sav_stream_worker_t     *workers;
+    uint32_t                worker_count;
+    gint                    stop;
+    GMutex                  lock;         /* Protects run_error */
+    GError                  *run_error;   /* First transport error of a run */
+};
+
+/* Record the first transport error of a run and stop all workers */
+static void stream_fail(struct sav_stream *stream, GError *error)
+{
+    g_mutex_lock(&stream->lock);
+    if (!stream->run_error) {
+        stream->run_error = error;
+        error = NULL;
+    }
+    g_mutex_unlock(&stream->lock);
+    g_clear_error(&error);
+    g_atomic_int_set(&stream->stop, 1);
+}
+
+/* Find or create the template scope of a message */
+static sav_collector_ctx_t* stream_scope_ctx(
+    sav_stream_worker_t *wk,
+    sav_stream_conn_t   *conn,
+    uint16_t            stream_id,
+    uint32_t            domain_id,
+    GError              **err)
+{
+    for (uint32_t i = 0; i < conn->scope_count; i++) {
+        if (conn->scopes[i].stream_id == stream_id &&
+            conn->scopes[i].domain_id == domain_id) {
+            return conn->scopes[i].ctx;
+        }
+    }
+
+    sav_collector_ctx_t *ctx = sav_collector_alloc_shared(wk->model, err);
+    if (!ctx) {
+        return NULL;
+    }
+    if (!sav_collector_attach_fbuf(ctx, NULL, err)) {
+        sav_collector_ctx_destroy(ctx);
+        return NULL;
+    }
+    ctx->fast = g_new0(sav_fast_decoder_t, 1);
+    sav_fast_decoder_init(ctx->fast);
+
+    conn->scopes = g_renew(sav_stream_scope_t, conn->scopes, conn->scope_count + 1);
+    conn->scopes[conn->scope_count].stream_id = stream_id;
+    conn->scopes[conn->scope_count].domain_id = domain_id;
+    conn->scopes[conn->scope_count].ctx = ctx;
+    conn->scope_count++;
+    SAV_STAT_ADD(wk->stats.template_scopes, 1);
+
+    return ctx;
+}
+
+/* Decode one complete message and hand its records to the callback.
+ * Parse errors are counted and end the message. */
+static void stream_deliver(
+    sav_stream_worker_t *wk,
+    sav_stream_conn_t   *conn,
+    const uint8_t       *msg,
+    size_t              msg_len)
+{
+    GError *err = NULL;
+    sav_record_view_t view;
+
+    SAV_STAT_ADD(wk->stats.messages, 1);
+
+    sav_collector_ctx_t *ctx = stream_scope_ctx(wk, conn, conn->stream_id,
+                                                sav_read_be32(msg + 12), &err);
+    if (!ctx || !sav_collector_load_message(ctx, msg, msg_len, &err)) {
+        SAV_STAT_ADD(wk->parse_errors, 1);
+        g_debug("Dropping message from %s: %s", conn->peer, err->message);
+        g_clear_error(&err);
+        return;
+    }
+
+    for (;;) {
+        memset(&view, 0, sizeof(view));
+        if (!sav_collector_message_next_view(ctx, &view, &err)) {
+            break;
+        }
+        SAV_STAT_ADD(wk->records_read, 1);
+        if (!wk->func(&view, wk->index, wk->user_data)) {
+            g_atomic_int_set(&wk->owner->stop, 1);
+            break;
+        }
+    }
+    if (err) {
+        SAV_STAT_ADD(wk->parse_errors, 1);
+        g_debug("Bad record from %s: %s", conn->peer, err->message);
+        g_clear_error(&err);
+    }
+
+    /* The buffer is about to be reused */
+    sav_collector_release_view(ctx);
+    wk->last_record = g_get_monotonic_time();
+}
+
+/* Make room for a message of msg_len bytes */
+static void stream_conn_reserve(sav_stream_conn_t *conn, size_t msg_len)
+{
+    if (msg_len > conn->cap) {
+        size_t cap = conn->cap * 2;
+        while (cap < msg_len) {
+            cap *= 2;
+        }
+        conn->cap = cap < SAV_IPFIX_MAX_MSG_LEN ? cap : SAV_IPFIX_MAX_MSG_LEN;
+        conn->buf = g_realloc(conn->buf, conn->cap);
+    }
+}
+
+/* Check an IPFIX message header; returns its length, 0 if invalid */
+static size_t stream_message_length(const uint8_t *hdr)
+{
+    uint16_t msg_len = sav_read_be16(hdr + 2);
+    if (sav_read_be16(hdr) != SAV_IPFIX_VERSION || msg_len < SAV_IPFIX_MSG_HEADER_LEN) {
+        return 0;
+    }
+    return msg_len;
+}
+
+/* Deliver the complete messages buffered on a TCP connection and keep the
+ * partial tail. Returns FALSE on a framing error. */
+static gboolean stream_tcp_frame(sav_stream_worker_t *wk, sav_stream_conn_t *conn)
+{
+    size_t off = 0;
+
+    while (conn->len - off >= SAV_IPFIX_MSG_HEADER_LEN &&
+           !g_atomic_int_get(&wk->owner->stop)) {
+        size_t msg_len = stream_message_length(conn->buf + off);
+        if (msg_len == 0) {
+            SAV_STAT_ADD(wk->stats.framing_errors, 1);
+            g_debug("Bad IPFIX message header from %s, closing", conn->peer);
+            conn->len = 0;
+            return FALSE;
+        }
+        if (conn->len - off < msg_len) {
+            break;
+        }
+        stream_deliver(wk, conn, conn->buf + off, msg_len);
+        off += msg_len;
+    }
+
+    if (off) {
+        memmove(conn->buf, conn->buf + off, conn->len - off);
+        conn->len -= off;
+    }
+    if (conn->len >= SAV_IPFIX_MSG_HEADER_LEN) {
+        stream_conn_reserve(conn, stream_message_length(conn->buf));
+    }
+    return TRUE;
+}
+
+/* Read what a TCP connection has available. Returns FALSE when the
+ * connection should be closed. */
+static gboolean stream_tcp_read(sav_stream_worker_t *wk, sav_stream_conn_t *conn)
+{
+    for (int r = 0; r < STREAM_READS_PER_EVENT; r++) {
+        /* Once stopped, unread data stays in the socket for the next run */
+        if (g_atomic_int_get(&wk->owner->stop)) {
+            return TRUE;
+        }
+        /* A buffer full of unframed messages must not be read into: recv()
+         * of 0 bytes returns 0, which would look like the end of stream */
+        if (conn->len == conn->cap) {
+            if (!stream_tcp_frame(wk, conn)) {
+                return FALSE;
+            }
+            if (conn->len == conn->cap) {
+                return TRUE;
+            }
+        }
+        
+        ssize_t n = recv(conn->fd, conn->buf + conn->len, conn->cap - conn->len, 0);
+        if (n > 0) {
+            SAV_STAT_ADD(wk->stats.bytes, (uint64_t)n);
+            conn->len += (size_t)n;
+            if (!stream_tcp_frame(wk, conn)) {
+                return FALSE;
+            }
+            continue;
+        }
+        if (n == 0) {
+            return FALSE;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+    return TRUE;
+}
+
+#if STREAM_HAVE_SCTP
+/* Read what an SCTP association has available. Each message arrives as one
+ * or more fragments ending with MSG_EOR on a single stream. Returns FALSE
+ * when the connection should be closed. */
+static gboolean stream_sctp_read(sav_stream_worker_t *wk, sav_stream_conn_t *conn)
+{
+    union {
+        char            buf[CMSG_SPACE(sizeof(struct sctp_rcvinfo))];
+        struct cmsghdr  align;
+    } cmsg;
+
+    for (int r = 0; r < STREAM_READS_PER_EVENT; r++) {
+        struct iovec iov = { conn->buf + conn->len, conn->cap - conn->len };
+        struct msghdr hdr;
+        memset(&hdr, 0, sizeof(hdr));
+        hdr.msg_iov = &iov;
+        hdr.msg_iovlen = 1;
+        hdr.msg_control = cmsg.buf;
+        hdr.msg_controllen = sizeof(cmsg);
+
+        ssize_t n = recvmsg(conn->fd, &hdr, 0);
+        if (n == 0) {
+            return FALSE;
+        }
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        if (hdr.msg_flags & MSG_NOTIFICATION) {
+            continue;
+        }
+
+        SAV_STAT_ADD(wk->stats.bytes, (uint64_t)n);
+        conn->len += (size_t)n;
+        for (struct cmsghdr *c = CMSG_FIRSTHDR(&hdr); c; c = CMSG_NXTHDR(&hdr, c)) {
+            if (c->cmsg_level == IPPROTO_SCTP && c->cmsg_type == SCTP_RCVINFO) {
+                struct sctp_rcvinfo info;
+                memcpy(&info, CMSG_DATA(c), sizeof(info));
+                conn->stream_id = info.rcv_sid;
+            }
+        }
+
+        if (!(hdr.msg_flags & MSG_EOR)) {
+            if (conn->len == conn->cap) {
+                if (conn->cap >= SAV_IPFIX_MAX_MSG_LEN) {
+                    SAV_STAT_ADD(wk->stats.framing_errors, 1);
+                    g_debug("Oversized SCTP message from %s, closing", conn->peer);
+                    conn->len = 0;
+                    return FALSE;
+                }
+                stream_conn_reserve(conn, conn->cap + 1);
+            }
+            continue;
+        }
+
+        /* One SCTP message carries exactly one IPFIX message */
+        if (conn->len < SAV_IPFIX_MSG_HEADER_LEN ||
+            stream_message_length(conn->buf) != conn->len) {
+            SAV_STAT_ADD(wk->stats.framing_errors, 1);
+            g_debug("Bad IPFIX message framing from %s, closing", conn->peer);
+            conn->len = 0;
+            return FALSE;
+        }
+        stream_deliver(wk, conn, conn->buf, conn->len);
+        conn->len = 0;
+
+        if (g_atomic_int_get(&wk->owner->stop)) {
+            break;
+        }
+    }
+    return TRUE;
+}
+#endif
+
+static void stream_conn_free(sav_stream_conn_t *conn)
+{
+    for (uint32_t i = 0; i < conn->scope_count; i++) {
+        sav_collector_ctx_destroy(conn->scopes[i].ctx);
+    }
+    g_free(conn->scopes);
+    g_free(conn->buf);
+    close(conn->fd);
+    g_free(conn);
+}
+
+/* Close a connection; a partially received message counts as framing error */
+static void stream_conn_close(sav_stream_worker_t *wk, sav_stream_conn_t *conn)
+{
+    if (conn->len > 0) {
+        SAV_STAT_ADD(wk->stats.framing_errors, 1);
+        g_debug("Connection from %s closed inside a message", conn->peer);
+    }
+
+    if (conn->prev) {
+        conn->prev->next = conn->next;
+    } else {
+        wk->conns = conn->next;
+    }
+    if (conn->next) {
+        conn->next->prev = conn->prev;
+    }
+
+    /* close() also removes the socket from the epoll set */
+    stream_conn_free(conn);
+    SAV_STAT_ADD(wk->stats.connections_closed, 1);
+}
+
+/* Accept pending connections into this worker */
+static void stream_accept(sav_stream_worker_t *wk)
+{
+    struct sav_stream *stream = wk->owner;
+
+    for (int i = 0; i < STREAM_ACCEPTS_PER_EVENT; i++) {
+        struct sockaddr_storage addr;
+        socklen_t addr_len = sizeof(addr);
+        int fd = accept4(stream->listen_fd, (struct sockaddr *)&addr, &addr_len,
+                         SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                g_debug("accept failed: %s", strerror(errno));
+            }
+            return;
+        }
+
+#if STREAM_HAVE_SCTP
+        if (stream->transport == SAV_TRANSPORT_SCTP) {
+            int one = 1;
+            setsockopt(fd, IPPROTO_SCTP, SCTP_RECVRCVINFO, &one, sizeof(one));
+        }
+#endif
+
+        sav_stream_conn_t *conn = g_new0(sav_stream_conn_t, 1);
+        conn->fd = fd;
+        conn->cap = STREAM_BUF_INITIAL;
+        conn->buf = g_malloc(conn->cap);
+
+        char name[INET6_ADDRSTRLEN] = "?";
+        uint16_t port = 0;
+        if (addr.ss_family == AF_INET) {
+            const struct sockaddr_in *sin = (const struct sockaddr_in *)&addr;
+            inet_ntop(AF_INET, &sin->sin_addr, name, sizeof(name));
+            port = ntohs(sin->sin_port);
+        } else if (addr.ss_family == AF_INET6) {
+            const struct sockaddr_in6 *sin6 = (const struct sockaddr_in6 *)&addr;
+            inet_ntop(AF_INET6, &sin6->sin6_addr, name, sizeof(name));
+            port = ntohs(sin6->sin6_port);
+        }
+        snprintf(conn->peer, sizeof(conn->peer), "%s:%u", name, port);
+
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.ptr = conn;
+        if (epoll_ctl(wk->epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            g_debug("Cannot watch connection from %s: %s", conn->peer, strerror(errno));
+            stream_conn_free(conn);
+            continue;
+        }
+
+        conn->next = wk->conns;
+        if (wk->conns) {
+            wk->conns->prev = conn;
+        }
+        wk->conns = conn;
+        SAV_STAT_ADD(wk->stats.connections_accepted, 1);
+        g_debug("Worker %u accepted exporter %s", wk->index, conn->peer);
+    }
+}
+
+/* Serve the worker's connections until stopped, idle for idle_ms or an
+ * epoll error */
+static void stream_run_worker(sav_stream_worker_t *wk)
+{
+    struct sav_stream *stream = wk->owner;
+    struct epoll_event events[STREAM_EVENTS_MAX];
+    int poll_ms = (stream->idle_ms && stream->idle_ms < SAV_STREAM_STOP_POLL_MS)
+        ? (int)stream->idle_ms : SAV_STREAM_STOP_POLL_MS;
+
+    wk->last_record = g_get_monotonic_time();
+
+    /* Messages left buffered when a previous run was stopped */
+    if (stream->transport == SAV_TRANSPORT_TCP) {
+        sav_stream_conn_t *next;
+        for (sav_stream_conn_t *conn = wk->conns; conn; conn = next) {
+            next = conn->next;
+            if (!stream_tcp_frame(wk, conn)) {
+                stream_conn_close(wk, conn);
+            }
+        }
+    }
+
+    while (!g_atomic_int_get(&stream->stop)) {
+        int n = epoll_wait(wk->epfd, events, STREAM_EVENTS_MAX, poll_ms);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            GError *error = NULL;
+            g_set_error(&error, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                        "epoll_wait failed: %s", strerror(errno));
+            stream_fail(stream, error);
+            break;
+        }
+
+        for (int i = 0; i < n && !g_atomic_int_get(&stream->stop); i++) {
+            sav_stream_conn_t *conn = events[i].data.ptr;
+            if (!conn) {
+                stream_accept(wk);
+                continue;
+            }
+
+            gboolean open;
+#if STREAM_HAVE_SCTP
+            if (stream->transport == SAV_TRANSPORT_SCTP) {
+                open = stream_sctp_read(wk, conn);
+            } else
+#endif
+            {
+                open = stream_tcp_read(wk, conn);
+            }
+            if (!open) {
+                stream_conn_close(wk, conn);
+            }
+        }
+
+        if (stream->idle_ms &&
+            g_get_monotonic_time() - wk->last_record >= (gint64)stream->idle_ms * 1000) {
+            break;
+        }
+    }
+}
+
+static gpointer stream_worker_main(gpointer data)
+{
+    stream_run_worker(data);
+    return NULL;
+}
+
+/* Create, bind and listen on the collector socket */
+static gboolean stream_open_listener(
+    struct sav_stream *stream,
+    const char        *host,
+    uint16_t          port,
+    GError            **err)
+{
+    const char *proto_name = stream->transport == SAV_TRANSPORT_SCTP ? "SCTP" : "TCP";
+    int protocol = stream->transport == SAV_TRANSPORT_SCTP ? IPPROTO_SCTP : IPPROTO_TCP;
+    struct addrinfo hints;
+    struct addrinfo *res = NULL;
+    char service[8];
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+    snprintf(service, sizeof(service), "%u", port);
+
+    int rc = getaddrinfo(host, service, &hints, &res);
+    if (rc != 0) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_CONN,
+                    "Cannot resolve %s: %s", host ? host : "*", gai_strerror(rc));
+        return FALSE;
+    }
+
+    int listen_errno = 0;
+    for (struct addrinfo *ai = res; ai && stream->listen_fd < 0; ai = ai->ai_next) {
+        int fd = socket(ai->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, protocol);
+        if (fd < 0) {
+            listen_errno = errno;
+            continue;
+        }
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(fd, ai->ai_addr, ai->ai_addrlen) != 0 ||
+            listen(fd, STREAM_LISTEN_BACKLOG) != 0) {
+            listen_errno = errno;
+            close(fd);
+            continue;
+        }
+        stream->listen_fd = fd;
+    }
+    freeaddrinfo(res);
+
+    if (stream->listen_fd < 0) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_CONN,
+                    "Cannot listen on %s port %u: %s", proto_name, port,
+                    strerror(listen_errno));
+        return FALSE;
+    }
+
+    struct sockaddr_storage local;
+    socklen_t local_len = sizeof(local);
+    if (getsockname(stream->listen_fd, (struct sockaddr *)&local, &local_len) == 0) {
+        stream->port = ntohs(local.ss_family == AF_INET6
+                             ? ((struct sockaddr_in6 *)&local)->sin6_port
+                             : ((struct sockaddr_in *)&local)->sin_port);
+    }
+
+    return TRUE;
+}
+
+/* Set up the epoll set and info model of a worker */
+static gboolean stream_worker_init(
+    struct sav_stream   *stream,
+    sav_stream_worker_t *wk,
+    uint32_t            index,
+    GError              **err)
+{
+    wk->owner = stream;
+    wk->index = index;
+
+    wk->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (wk->epfd < 0) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                    "epoll_create1 failed: %s", strerror(errno));
+        return FALSE;
+    }
+
+    /* Only one worker wakes up per new connection */
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN | EPOLLEXCLUSIVE;
+    ev.data.ptr = NULL;
+    if (epoll_ctl(wk->epfd, EPOLL_CTL_ADD, stream->listen_fd, &ev) != 0) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                    "Cannot watch listener: %s", strerror(errno));
+        return FALSE;
+    }
+
+    wk->model = fbInfoModelAlloc();
+    if (!wk->model || !sav_init_info_model(wk->model)) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                    "Failed to initialize SAV info model");
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/* Create a TCP or SCTP collector */
+sav_collector_ctx_t* sav_create_stream_collector(
+    sav_stream_transport_t transport,
+    const char             *host,
+    uint16_t               port,
+    uint32_t               workers,
+    uint32_t               timeout_ms,
+    GError                 **err)
+{
+    if (workers == 0) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                    "A stream collector needs at least one worker");
+        return NULL;
+    }
+    if (transport != SAV_TRANSPORT_TCP &&
+        (transport != SAV_TRANSPORT_SCTP || !STREAM_HAVE_SCTP)) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IMPL,
+                    "Unsupported stream transport %d", (int)transport);
+        return NULL;
+    }
+
+    struct sav_stream *stream = g_new0(struct sav_stream, 1);
+    stream->listen_fd = -1;
+    stream->transport = transport;
+    stream->idle_ms = timeout_ms;
+    g_mutex_init(&stream->lock);
+
+    if (!stream_open_listener(stream, host, port, err)) {
+        sav_stream_destroy(stream);
+        return NULL;
+    }
+
+    stream->workers = g_new0(sav_stream_worker_t, workers);
+    for (uint32_t i = 0; i < workers; i++) {
+        stream->workers[i].epfd = -1;
+    }
+    stream->worker_count = workers;
+    for (uint32_t i = 0; i < workers; i++) {
+        if (!stream_worker_init(stream, &stream->workers[i], i, err)) {
+            sav_stream_destroy(stream);
+            return NULL;
+        }
+    }
+
+    /* Decoding happens in the per-connection scope contexts */
+    sav_collector_ctx_t *ctx = g_new0(sav_collector_ctx_t, 1);
+    ctx->stream = stream;
+    return ctx;
+}
+
+/* Run the worker loops of a stream collector */
+gboolean sav_stream_collector_run(
+    sav_collector_ctx_t    *ctx,
+    sav_record_view_func_t func,
+    gpointer               user_data,
+    GError                 **err)
+{
+    if (!ctx || !ctx->stream || !func) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                    "sav_stream_collector_run needs a stream collector and a callback");
+        return FALSE;
+    }
+
+    struct sav_stream *stream = ctx->stream;
+    g_atomic_int_set(&stream->stop, 0);
+
+    for (uint32_t i = 0; i < stream->worker_count; i++) {
+        stream->workers[i].func = func;
+        stream->workers[i].user_data = user_data;
+    }
+
+    if (stream->worker_count == 1) {
+        stream_run_worker(&stream->workers[0]);
+    } else {
+        GThread **threads = g_new0(GThread *, stream->worker_count);
+        for (uint32_t i = 0; i < stream->worker_count; i++) {
+            threads[i] = g_thread_new("sav-stream", stream_worker_main, &stream->workers[i]);
+        }
+        for (uint32_t i = 0; i < stream->worker_count; i++) {
+            g_thread_join(threads[i]);
+        }
+        g_free(threads);
+    }
+
+    if (stream->run_error) {
+        g_propagate_error(err, stream->run_error);
+        stream->run_error = NULL;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+void sav_stream_collector_stop(sav_collector_ctx_t *ctx)
+{
+    if (ctx && ctx->stream) {
+        g_atomic_int_set(&ctx->stream->stop, 1);
+    }
+}
+
+uint16_t sav_stream_collector_get_port(sav_collector_ctx_t *ctx)
+{
+    return (ctx && ctx->stream) ? ctx->stream->port : 0;
+}
+
+gboolean sav_stream_collector_get_stats(
+    sav_collector_ctx_t *ctx,
+    sav_stream_stats_t  *stats)
+{
+    if (!ctx || !ctx->stream || !stats) {
+        return FALSE;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    for (uint32_t i = 0; i < ctx->stream->worker_count; i++) {
+        const sav_stream_stats_t *s = &ctx->stream->workers[i].stats;
+        stats->connections_accepted += SAV_STAT_GET(s->connections_accepted);
+        stats->connections_closed += SAV_STAT_GET(s->connections_closed);
+        stats->bytes += SAV_STAT_GET(s->bytes);
+        stats->messages += SAV_STAT_GET(s->messages);
+        stats->framing_errors += SAV_STAT_GET(s->framing_errors);
+        stats->template_scopes += SAV_STAT_GET(s->template_scopes);
+    }
+    return TRUE;
+}
+
+/* Merge the per-worker record counters */
+void sav_stream_add_worker_stats(
+    const struct sav_stream *stream,
+    uint64_t                *records_read,
+    uint64_t                *parse_errors)
+{
+    if (!stream) return;
+
+    for (uint32_t i = 0; i < stream->worker_count; i++) {
+        *records_read += SAV_STAT_GET(stream->workers[i].records_read);
+        *parse_errors += SAV_STAT_GET(stream->workers[i].parse_errors);
+    }
+}
+
+void sav_stream_destroy(struct sav_stream *stream)
+{
+    if (!stream) return;
+
+    for (uint32_t i = 0; i < stream->worker_count; i++) {
+        sav_stream_worker_t *wk = &stream->workers[i];
+        while (wk->conns) {
+            sav_stream_conn_t *conn = wk->conns;
+            wk->conns = conn->next;
+            stream_conn_free(conn);
+        }
+        if (wk->epfd >= 0) {
+            close(wk->epfd);
+        }
+        /* After the sessions created on it */
+        if (wk->model) {
+            fbInfoModelFree(wk->model);
+        }
+    }
+    g_free(stream->workers);
+    if (stream->listen_fd >= 0) {
+        close(stream->listen_fd);
+    }
+    g_clear_error(&stream->run_error);
+    g_mutex_clear(&stream->lock);
+    g_free(stream);
+}
@@ -0,0 +1,772 @@
+/**
+ * @file sav_udp_collector.c
+ * @brief UDP transport for the SAV IPFIX collector
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sched.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "sav_collector.h"
+#include "sav_collector_internal.h"
+#include "sav_fast_decoder.h"
+
+/* One IPFIX message per datagram (RFC 7011, section 10.3.3) */
+#define UDP_DATAGRAM_MAX SAV_IPFIX_MAX_MSG_LEN
+
+/* Shortest interval between two scans for expired exporters */
+#define UDP_EXPIRY_SCAN_US G_USEC_PER_SEC
+
+/* Template scope of an IPFIX-over-UDP exporter */
+typedef struct sav_udp_key {
+    uint8_t   addr[16];               /* Source address (IPv4 uses 4 bytes) */
+    uint16_t  family;                 /* AF_INET or AF_INET6 */
+    uint16_t  port;                   /* Source port */
+    uint32_t  domain_id;              /* Observation domain */
+} sav_udp_key_t;
+
+/* Per-exporter decode state */
+typedef struct sav_udp_exporter {
+    sav_udp_key_t       key;
+    sav_collector_ctx_t *ctx;         /* Templates, fast decoder and buffer-fed fBuf */
+    uint32_t            next_seq;     /* Expected sequence number of the next message */
+    gboolean            seq_valid;    /* next_seq is known */
+    gint64              last_seen;    /* Monotonic time of the last datagram */
+} sav_udp_exporter_t;
+
+/* Control message space for the SO_RXQ_OVFL drop counter */
+typedef union sav_udp_cmsg {
+    char            buf[CMSG_SPACE(sizeof(uint32_t))];
+    struct cmsghdr  align;
+} sav_udp_cmsg_t;
+
+struct sav_udp {
+    int                     fd;
+    uint16_t                port;             /* Bound local port */
+    uint32_t                timeout_ms;       /* 0 = wait forever */
+    struct mmsghdr          msgs[SAV_UDP_BATCH_SIZE];
+    struct iovec            iov[SAV_UDP_BATCH_SIZE];
+    struct sockaddr_storage addrs[SAV_UDP_BATCH_SIZE];
+    sav_udp_cmsg_t          cmsg[SAV_UDP_BATCH_SIZE];
+    uint8_t                 *bufs;            /* SAV_UDP_BATCH_SIZE datagram buffers */
+    uint32_t                batch_count;      /* Datagrams in the current batch */
+    uint32_t                batch_pos;        /* Next datagram to decode */
+    GHashTable              *exporters;       /* sav_udp_key_t -> sav_udp_exporter_t */
+    fbInfoModel_t           *model;           /* Shared by the exporter sessions */
+    sav_udp_exporter_t      *cur;             /* Exporter whose message is being read */
+    gint64                  now;              /* Monotonic time of the current batch */
+    gint64                  lifetime_us;      /* Template lifetime of a silent exporter */
+    gint64                  last_scan;        /* Last scan for expired exporters */
+    uint32_t                max_exporters;    /* Exporter table limit */
+    sav_udp_stats_t         stats;            /* Written by the reading thread only */
+    
+    /* sav_udp_collector_run() state; a sharded collector owns no socket
+     * itself and runs one single-socket collector per worker instead */
+    sav_collector_ctx_t     **shards;
+    uint32_t                shard_count;
+    uint32_t                idle_ms;          /* Stop after this long without records */
+    gint                    stop;
+    GMutex                  lock;             /* Protects run_error */
+    GError                  *run_error;       /* First transport error of a run */
+};
+
+/* Receive worker of sav_udp_collector_run() */
+typedef struct sav_udp_worker {
+    struct sav_udp          *owner;
+    sav_collector_ctx_t     *shard;
+    uint32_t                index;
+    sav_record_view_func_t  func;
+    gpointer                user_data;
+} sav_udp_worker_t;
+
+static guint udp_key_hash(gconstpointer key)
+{
+    /* FNV-1a; the key has no padding */
+    const uint8_t *p = key;
+    guint h = 2166136261u;
+    for (size_t i = 0; i < sizeof(sav_udp_key_t); i++) {
+        h = (h ^ p[i]) * 16777619u;
+    }
+    return h;
+}
+
+static gboolean udp_key_equal(gconstpointer a, gconstpointer b)
+{
+    return memcmp(a, b, sizeof(sav_udp_key_t)) == 0;
+}
+
+static void udp_exporter_free(gpointer data)
+{
+    sav_udp_exporter_t *exp = data;
+    sav_collector_ctx_destroy(exp->ctx);
+    g_free(exp);
+}
+
+static gboolean udp_exporter_expired(gpointer key, gpointer value, gpointer data)
+{
+    const sav_udp_exporter_t *exp = value;
+    const struct sav_udp *udp = data;
+    (void)key;
+    return udp->now - exp->last_seen > udp->lifetime_us;
+}
+
+/* Forget exporters silent for longer than the template lifetime */
+static void udp_expire_exporters(struct sav_udp *udp)
+{
+    guint n = g_hash_table_foreach_remove(udp->exporters, udp_exporter_expired, udp);
+    if (n > 0) {
+        SAV_STAT_ADD(udp->stats.expired_exporters, n);
+        g_debug("Expired %u silent UDP exporter(s)", n);
+    }
+    udp->last_scan = udp->now;
+}
+
+/* Find or create the state of the exporter that sent a datagram */
+static sav_udp_exporter_t* udp_exporter_get(
+    struct sav_udp                *udp,
+    const struct sockaddr_storage *addr,
+    uint32_t                      domain_id,
+    GError                        **err)
+{
+    sav_udp_key_t key;
+    memset(&key, 0, sizeof(key));
+    key.family = addr->ss_family;
+    key.domain_id = domain_id;
+
+    if (addr->ss_family == AF_INET) {
+        const struct sockaddr_in *sin = (const struct sockaddr_in *)addr;
+        memcpy(key.addr, &sin->sin_addr, 4);
+        key.port = ntohs(sin->sin_port);
+    } else if (addr->ss_family == AF_INET6) {
+        const struct sockaddr_in6 *sin6 = (const struct sockaddr_in6 *)addr;
+        memcpy(key.addr, &sin6->sin6_addr, 16);
+        key.port = ntohs(sin6->sin6_port);
+    }
+
+    sav_udp_exporter_t *exp = g_hash_table_lookup(udp->exporters, &key);
+    if (exp && udp->now - exp->last_seen <= udp->lifetime_us) {
+        return exp;
+    }
+    if (exp) {
+        /* Its templates expired; start over as a new exporter */
+        g_hash_table_remove(udp->exporters, &key);
+        SAV_STAT_ADD(udp->stats.expired_exporters, 1);
+    }
+
+    if (g_hash_table_size(udp->exporters) >= udp->max_exporters) {
+        udp_expire_exporters(udp);
+        if (g_hash_table_size(udp->exporters) >= udp->max_exporters) {
+            SAV_STAT_ADD(udp->stats.table_full_drops, 1);
+            g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IPFIX,
+                        "Exporter table full (%u exporters); datagram dropped",
+                        udp->max_exporters);
+            return NULL;
+        }
+    }
+
+    exp = g_new0(sav_udp_exporter_t, 1);
+    exp->key = key;
+    exp->ctx = sav_collector_alloc_shared(udp->model, err);
+    if (!exp->ctx) {
+        g_free(exp);
+        return NULL;
+    }
+    if (!sav_collector_attach_fbuf(exp->ctx, NULL, err)) {
+        udp_exporter_free(exp);
+        return NULL;
+    }
+    exp->ctx->fast = g_new0(sav_fast_decoder_t, 1);
+    sav_fast_decoder_init(exp->ctx->fast);
+
+    g_hash_table_insert(udp->exporters, &exp->key, exp);
+    SAV_STAT_ADD(udp->stats.exporters, 1);
+
+    char name[INET6_ADDRSTRLEN] = "?";
+    inet_ntop(key.family, key.addr, name, sizeof(name));
+    g_debug("New UDP exporter %s port %u domain %u", name, key.port, domain_id);
+
+    return exp;
+}
+
+/* Receive the next batch of datagrams, waiting up to timeout_ms */
+static gboolean udp_receive_batch(struct sav_udp *udp, GError **err)
+{
+    udp->batch_count = udp->batch_pos = 0;
+
+    for (;;) {
+        for (uint32_t i = 0; i < SAV_UDP_BATCH_SIZE; i++) {
+            udp->msgs[i].msg_hdr.msg_namelen = sizeof(udp->addrs[i]);
+            udp->msgs[i].msg_hdr.msg_controllen = sizeof(udp->cmsg[i]);
+            udp->msgs[i].msg_hdr.msg_flags = 0;
+        }
+
+        /* Under load the queue is rarely empty; only poll when it is */
+        int n = recvmmsg(udp->fd, udp->msgs, SAV_UDP_BATCH_SIZE, MSG_DONTWAIT, NULL);
+        if (n > 0) {
+            udp->batch_count = (uint32_t)n;
+            udp->now = g_get_monotonic_time();
+            return TRUE;
+        }
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                        "recvmmsg failed: %s", strerror(errno));
+            return FALSE;
+        }
+
+        struct pollfd pfd = { .fd = udp->fd, .events = POLLIN };
+        int rc = poll(&pfd, 1, udp->timeout_ms ? (int)udp->timeout_ms : -1);
+        if (rc == 0) {
+            g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_NLREAD,
+                        "No datagram received within %u ms", udp->timeout_ms);
+            return FALSE;
+        }
+        if (rc < 0 && errno != EINTR) {
+            g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IO,
+                        "poll failed: %s", strerror(errno));
+            return FALSE;
+        }
+    }
+}
+
+/* Pick up the kernel's cumulative drop counter, if attached */
+static void udp_update_drops(struct sav_udp *udp, struct msghdr *hdr)
+{
+#ifdef SO_RXQ_OVFL
+    for (struct cmsghdr *c = CMSG_FIRSTHDR(hdr); c; c = CMSG_NXTHDR(hdr, c)) {
+        if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SO_RXQ_OVFL) {
+            uint32_t drops;
+            memcpy(&drops, CMSG_DATA(c), sizeof(drops));
+            SAV_STAT_SET(udp->stats.socket_drops, drops);
+        }
+    }
+#else
+    (void)udp;
+    (void)hdr;
+#endif
+}
+
+/* Load the next datagram of the batch into its exporter's decoder.
+ * Returns FALSE with err unset when the batch is exhausted. */
+static gboolean udp_next_datagram(struct sav_udp *udp, GError **err)
+{
+    if (udp->batch_pos >= udp->batch_count) {
+        return FALSE;
+    }
+
+    uint32_t i = udp->batch_pos++;
+    struct msghdr *hdr = &udp->msgs[i].msg_hdr;
+    const uint8_t *msg = udp->bufs + (size_t)i * UDP_DATAGRAM_MAX;
+    size_t len = udp->msgs[i].msg_len;
+
+    SAV_STAT_ADD(udp->stats.datagrams, 1);
+    SAV_STAT_ADD(udp->stats.bytes, len);
+    udp_update_drops(udp, hdr);
+
+    if (hdr->msg_flags & MSG_TRUNC) {
+        SAV_STAT_ADD(udp->stats.truncated, 1);
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IPFIX,
+                    "Datagram larger than %u bytes", UDP_DATAGRAM_MAX);
+        return FALSE;
+    }
+    if (len < SAV_IPFIX_MSG_HEADER_LEN) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IPFIX,
+                    "Datagram too short for an IPFIX message (%zu bytes)", len);
+        return FALSE;
+    }
+
+    if (udp->now - udp->last_scan >= UDP_EXPIRY_SCAN_US) {
+        udp_expire_exporters(udp);
+    }
+    sav_udp_exporter_t *exp = udp_exporter_get(udp, &udp->addrs[i],
+                                               sav_read_be32(msg + 12), err);
+    if (!exp) {
+        return FALSE;
+    }
+    exp->last_seen = udp->now;
+
+    /* The sequence number counts data records sent before this message */
+    uint32_t seq = sav_read_be32(msg + 8);
+    if (exp->seq_valid && seq != exp->next_seq) {
+        int32_t skipped = (int32_t)(seq - exp->next_seq);
+        SAV_STAT_ADD(udp->stats.sequence_gaps, 1);
+        if (skipped > 0) {
+            SAV_STAT_ADD(udp->stats.lost_records, (uint64_t)skipped);
+        }
+    }
+
+    /* Advance by every data record of the message, including those that
+     * fail to decode or belong to unknown templates; resynchronize on the
+     * next message if they cannot be counted */
+    exp->seq_valid = FALSE;
+    if (!sav_collector_load_message(exp->ctx, msg, len, err)) {
+        return FALSE;
+    }
+    exp->next_seq = seq + exp->ctx->fast->data_records;
+    exp->seq_valid = exp->ctx->fast->records_known;
+    udp->cur = exp;
+    return TRUE;
+}
+
+/* Next record from the network */
+gboolean sav_udp_next_view(
+    sav_collector_ctx_t *ctx,
+    sav_record_view_t   *view,
+    GError              **err)
+{
+    struct sav_udp *udp = ctx->udp;
+
+    if (udp->shards) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_IMPL,
+                    "Sharded UDP collectors deliver records through "
+                    "sav_udp_collector_run()");
+        return FALSE;
+    }
+
+    for (;;) {
+        if (udp->cur) {
+            if (sav_collector_message_next_view(udp->cur->ctx, view, err)) {
+                return TRUE;
+            }
+            udp->cur = NULL;
+            if (*err) {
+                return FALSE;
+            }
+        }
+
+        if (udp->batch_pos >= udp->batch_count && !udp_receive_batch(udp, err)) {
+            return FALSE;
+        }
+        if (!udp_next_datagram(udp, err) && *err) {
+            return FALSE;
+        }
+    }
+}
+
+/* Ask for a large receive buffer; SO_RCVBUFFORCE ignores rmem_max but
+ * needs CAP_NET_ADMIN */
+static void udp_set_rcvbuf(int fd)
+{
+    int size = SAV_UDP_RCVBUF_BYTES;
+
+#ifdef SO_RCVBUFFORCE
+    if (setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &size, sizeof(size)) != 0)
+#endif
+    {
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+    }
+
+    int granted = 0;
+    socklen_t len = sizeof(granted);
+    if (getsockopt(fd, SOL_SOCKET, SO_RCVBUF, &granted, &len) == 0 && granted < size) {
+        g_debug("UDP receive buffer limited to %d bytes (raise net.core.rmem_max)",
+                granted);
+    }
+}
+
+/* Create and bind the collector socket */
+static gboolean udp_open_socket(
+    struct sav_udp *udp,
+    const char     *host,
+    uint16_t       port,
+    gboolean       reuseport,
+    GError         **err)
+{
+    struct addrinfo hints;
+    struct addrinfo *res = NULL;
+    char service[8];
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_flags = AI_PASSIVE;
+    snprintf(service, sizeof(service), "%u", port);
+
+    int rc = getaddrinfo(host, service, &hints, &res);
+    if (rc != 0) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_CONN,
+                    "Cannot resolve %s: %s", host ? host : "*", gai_strerror(rc));
+        return FALSE;
+    }
+
+    int bind_errno = 0;
+    for (struct addrinfo *ai = res; ai && udp->fd < 0; ai = ai->ai_next) {
+        int fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0) {
+            bind_errno = errno;
+            continue;
+        }
+        int one = 1;
+        if (reuseport && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) != 0) {
+            bind_errno = errno;
+            close(fd);
+            continue;
+        }
+        if (bind(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+            bind_errno = errno;
+            close(fd);
+            continue;
+        }
+        udp->fd = fd;
+    }
+    freeaddrinfo(res);
+
+    if (udp->fd < 0) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_CONN,
+                    "Cannot bind UDP port %u: %s", port, strerror(bind_errno));
+        return FALSE;
+    }
+
+    udp_set_rcvbuf(udp->fd);
+
+#ifdef SO_RXQ_OVFL
+    int one = 1;
+    setsockopt(udp->fd, SOL_SOCKET, SO_RXQ_OVFL, &one, sizeof(one));
+#endif
+
+    struct sockaddr_storage local;
+    socklen_t local_len = sizeof(local);
+    if (getsockname(udp->fd, (struct sockaddr *)&local, &local_len) == 0) {
+        udp->port = ntohs(local.ss_family == AF_INET6
+                          ? ((struct sockaddr_in6 *)&local)->sin6_port
+                          : ((struct sockaddr_in *)&local)->sin_port);
+    }
+
+    return TRUE;
+}
+
+/* Create a single-socket UDP collector context */
+static sav_collector_ctx_t* udp_ctx_new(
+    const char *host,
+    uint16_t   port,
+    uint32_t   timeout_ms,
+    gboolean   reuseport,
+    GError     **err)
+{
+    struct sav_udp *udp = g_new0(struct sav_udp, 1);
+    udp->fd = -1;
+    udp->timeout_ms = timeout_ms;
+    udp->idle_ms = timeout_ms;
+    udp->lifetime_us = (gint64)SAV_UDP_TEMPLATE_LIFETIME_SEC * G_USEC_PER_SEC;
+    udp->max_exporters = SAV_UDP_MAX_EXPORTERS;
+    g_mutex_init(&udp->lock);
+
+    if (!udp_open_socket(udp, host, port, reuseport, err)) {
+        sav_udp_destroy(udp);
+        return NULL;
+    }
+
+    /* Sessions may add alien elements to the model, but all exporters of
+     * this socket are decoded on one thread */
+    udp->model = fbInfoModelAlloc();
+    if (!udp->model || !sav_init_info_model(udp->model)) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                    "Failed to initialize SAV info model");
+        sav_udp_destroy(udp);
+        return NULL;
+    }
+
+    udp->bufs = g_malloc((size_t)SAV_UDP_BATCH_SIZE * UDP_DATAGRAM_MAX);
+    for (uint32_t i = 0; i < SAV_UDP_BATCH_SIZE; i++) {
+        udp->iov[i].iov_base = udp->bufs + (size_t)i * UDP_DATAGRAM_MAX;
+        udp->iov[i].iov_len = UDP_DATAGRAM_MAX;
+        udp->msgs[i].msg_hdr.msg_iov = &udp->iov[i];
+        udp->msgs[i].msg_hdr.msg_iovlen = 1;
+        udp->msgs[i].msg_hdr.msg_name = &udp->addrs[i];
+        udp->msgs[i].msg_hdr.msg_control = udp->cmsg[i].buf;
+    }
+
+    udp->exporters = g_hash_table_new_full(udp_key_hash, udp_key_equal,
+                                           NULL, udp_exporter_free);
+
+    /* Decoding happens in the per-exporter contexts */
+    sav_collector_ctx_t *ctx = g_new0(sav_collector_ctx_t, 1);
+    ctx->udp = udp;
+    return ctx;
+}
+
+/* Create a UDP collector */
+sav_collector_ctx_t* sav_create_udp_collector(
+    const char *host,
+    uint16_t   port,
+    uint32_t   timeout_ms,
+    GError     **err)
+{
+    return udp_ctx_new(host, port, timeout_ms, FALSE, err);
+}
+
+/* Create a sharded UDP collector */
+sav_collector_ctx_t* sav_create_udp_sharded_collector(
+    const char *host,
+    uint16_t   port,
+    uint32_t   workers,
+    uint32_t   timeout_ms,
+    GError     **err)
+{
+    if (workers == 0) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                    "A sharded UDP collector needs at least one worker");
+        return NULL;
+    }
+
+    struct sav_udp *udp = g_new0(struct sav_udp, 1);
+    udp->fd = -1;
+    udp->idle_ms = timeout_ms;
+    g_mutex_init(&udp->lock);
+    udp->shards = g_new0(sav_collector_ctx_t *, workers);
+
+    /* Workers wake up at least every SAV_UDP_STOP_POLL_MS to check for stop */
+    uint32_t poll_ms = (timeout_ms && timeout_ms < SAV_UDP_STOP_POLL_MS)
+        ? timeout_ms : SAV_UDP_STOP_POLL_MS;
+
+    for (uint32_t i = 0; i < workers; i++) {
+        /* Port 0 picks an ephemeral port once; the other shards join it */
+        sav_collector_ctx_t *shard = udp_ctx_new(host, udp->port ? udp->port : port,
+                                                 poll_ms, TRUE, err);
+        if (!shard) {
+            sav_udp_destroy(udp);
+            return NULL;
+        }
+        udp->shards[udp->shard_count++] = shard;
+        udp->port = shard->udp->port;
+    }
+
+    sav_collector_ctx_t *ctx = g_new0(sav_collector_ctx_t, 1);
+    ctx->udp = udp;
+    return ctx;
+}
+
+/* Pin the calling thread to the worker-th CPU it is allowed to run on */
+static void udp_pin_thread(uint32_t worker)
+{
+#ifdef CPU_SET
+    cpu_set_t allowed;
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0 || CPU_COUNT(&allowed) == 0) {
+        return;
+    }
+
+    int target = (int)(worker % (uint32_t)CPU_COUNT(&allowed));
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &allowed) && target-- == 0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu, &set);
+            if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+                g_debug("Cannot pin UDP worker %u to CPU %d: %s",
+                        worker, cpu, strerror(errno));
+            }
+            return;
+        }
+    }
+#else
+    (void)worker;
+#endif
+}
+
+/* Deliver the records of one socket until stopped, idle for idle_ms or a
+ * transport error. Parse errors are counted and skipped. */
+static void udp_run_worker(sav_udp_worker_t *wk)
+{
+    struct sav_udp *owner = wk->owner;
+    sav_record_view_t view;
+    gint64 last_record = g_get_monotonic_time();
+
+    while (!g_atomic_int_get(&owner->stop)) {
+        GError *local_err = NULL;
+
+        if (sav_read_record_view(wk->shard, &view, &local_err)) {
+            last_record = g_get_monotonic_time();
+            if (!wk->func(&view, wk->index, wk->user_data)) {
+                g_atomic_int_set(&owner->stop, 1);
+            }
+            continue;
+        }
+
+        if (g_error_matches(local_err, FB_ERROR_DOMAIN, FB_ERROR_NLREAD)) {
+            g_clear_error(&local_err);
+            if (owner->idle_ms &&
+                g_get_monotonic_time() - last_record >= (gint64)owner->idle_ms * 1000) {
+                break;
+            }
+            continue;
+        }
+
+        if (g_error_matches(local_err, FB_ERROR_DOMAIN, FB_ERROR_IO) ||
+            g_error_matches(local_err, FB_ERROR_DOMAIN, FB_ERROR_IMPL)) {
+            g_mutex_lock(&owner->lock);
+            if (!owner->run_error) {
+                owner->run_error = local_err;
+                local_err = NULL;
+            }
+            g_mutex_unlock(&owner->lock);
+            g_clear_error(&local_err);
+            g_atomic_int_set(&owner->stop, 1);
+            break;
+        }
+
+        g_clear_error(&local_err);
+    }
+}
+
+static gpointer udp_worker_main(gpointer data)
+{
+    sav_udp_worker_t *wk = data;
+    udp_pin_thread(wk->index);
+    udp_run_worker(wk);
+    return NULL;
+}
+
+/* Run the receive loop(s) of a UDP collector */
+gboolean sav_udp_collector_run(
+    sav_collector_ctx_t    *ctx,
+    sav_record_view_func_t func,
+    gpointer               user_data,
+    GError                 **err)
+{
+    if (!ctx || !ctx->udp || !func) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                    "sav_udp_collector_run needs a UDP collector and a callback");
+        return FALSE;
+    }
+
+    struct sav_udp *udp = ctx->udp;
+    g_atomic_int_set(&udp->stop, 0);
+
+    if (!udp->shards) {
+        /* Single socket: receive on the calling thread */
+        sav_udp_worker_t wk = { udp, ctx, 0, func, user_data };
+        udp_run_worker(&wk);
+    } else {
+        sav_udp_worker_t *workers = g_new0(sav_udp_worker_t, udp->shard_count);
+        GThread **threads = g_new0(GThread *, udp->shard_count);
+
+        for (uint32_t i = 0; i < udp->shard_count; i++) {
+            workers[i].owner = udp;
+            workers[i].shard = udp->shards[i];
+            workers[i].index = i;
+            workers[i].func = func;
+            workers[i].user_data = user_data;
+            threads[i] = g_thread_new("sav-udp", udp_worker_main, &workers[i]);
+        }
+        for (uint32_t i = 0; i < udp->shard_count; i++) {
+            g_thread_join(threads[i]);
+        }
+
+        g_free(threads);
+        g_free(workers);
+    }
+
+    if (udp->run_error) {
+        g_propagate_error(err, udp->run_error);
+        udp->run_error = NULL;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+void sav_udp_collector_stop(sav_collector_ctx_t *ctx)
+{
+    if (ctx && ctx->udp) {
+        g_atomic_int_set(&ctx->udp->stop, 1);
+    }
+}
+
+gboolean sav_udp_collector_set_exporter_limits(
+    sav_collector_ctx_t *ctx,
+    uint32_t            lifetime_sec,
+    uint32_t            max_exporters,
+    GError              **err)
+{
+    if (!ctx || !ctx->udp || lifetime_sec == 0 || max_exporters == 0) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                    "sav_udp_collector_set_exporter_limits needs a UDP collector "
+                    "and non-zero limits");
+        return FALSE;
+    }
+
+    ctx->udp->lifetime_us = (gint64)lifetime_sec * G_USEC_PER_SEC;
+    ctx->udp->max_exporters = max_exporters;
+    for (uint32_t i = 0; i < ctx->udp->shard_count; i++) {
+        ctx->udp->shards[i]->udp->lifetime_us = ctx->udp->lifetime_us;
+        ctx->udp->shards[i]->udp->max_exporters = max_exporters;
+    }
+    return TRUE;
+}
+
+uint16_t sav_udp_collector_get_port(sav_collector_ctx_t *ctx)
+{
+    return (ctx && ctx->udp) ? ctx->udp->port : 0;
+}
+
+/* Add the transport counters of one socket to stats */
+static void udp_stats_accumulate(sav_udp_stats_t *stats, const struct sav_udp *udp)
+{
+    stats->datagrams += SAV_STAT_GET(udp->stats.datagrams);
+    stats->bytes += SAV_STAT_GET(udp->stats.bytes);
+    stats->socket_drops += SAV_STAT_GET(udp->stats.socket_drops);
+    stats->truncated += SAV_STAT_GET(udp->stats.truncated);
+    stats->sequence_gaps += SAV_STAT_GET(udp->stats.sequence_gaps);
+    stats->lost_records += SAV_STAT_GET(udp->stats.lost_records);
+    stats->expired_exporters += SAV_STAT_GET(udp->stats.expired_exporters);
+    stats->table_full_drops += SAV_STAT_GET(udp->stats.table_full_drops);
+    stats->exporters += SAV_STAT_GET(udp->stats.exporters);
+}
+
+gboolean sav_udp_collector_get_stats(
+    sav_collector_ctx_t *ctx,
+    sav_udp_stats_t     *stats)
+{
+    if (!ctx || !ctx->udp || !stats) {
+        return FALSE;
+    }
+
+    memset(stats, 0, sizeof(*stats));
+    udp_stats_accumulate(stats, ctx->udp);
+    for (uint32_t i = 0; i < ctx->udp->shard_count; i++) {
+        udp_stats_accumulate(stats, ctx->udp->shards[i]->udp);
+    }
+    return TRUE;
+}
+
+/* Merge the per-worker record counters of a sharded collector */
+void sav_udp_add_worker_stats(
+    const struct sav_udp *udp,
+    uint64_t             *records_read,
+    uint64_t             *parse_errors)
+{
+    if (!udp) return;
+
+    for (uint32_t i = 0; i < udp->shard_count; i++) {
+        *records_read += SAV_STAT_GET(udp->shards[i]->records_read);
+        *parse_errors += SAV_STAT_GET(udp->shards[i]->parse_errors);
+    }
+}
+
+void sav_udp_destroy(struct sav_udp *udp)
+{
+    if (!udp) return;
+
+    for (uint32_t i = 0; i < udp->shard_count; i++) {
+        sav_collector_ctx_destroy(udp->shards[i]);
+    }
+    g_free(udp->shards);
+    if (udp->fd >= 0) {
+        close(udp->fd);
+    }
+    if (udp->exporters) {
+        g_hash_table_destroy(udp->exporters);
+    }
+    if (udp->model) {
+        fbInfoModelFree(udp->model);
+    }
+    g_free(udp->bufs);
+    g_clear_error(&udp->run_error);
+    g_mutex_clear(&udp->lock);
+    g_free(udp);
+}
@@ -0,0 +1,438 @@
+/**
+ * @file sav_validate.c
+ * @brief Batch validation of SAV mapping arrays
+ *
+ * A mapping is valid if prefix_length <= 32 (128) and no bit after the
+ * first prefix_length bits of the prefix is set. The vector kernels build
+ * the host-bit mask one address byte at a time: byte j of an address has
+ * clamp(prefix_length - 8 * j, 0, 8) network bits, and a 16-entry PSHUFB
+ * table turns that count into the byte's host-bit mask (0xFF >> n). This
+ * needs no per-lane variable shift, so it works the same for IPv4 and
+ * IPv6 and on SSE4.1. The AVX2 IPv4 kernel uses VPSRLVD instead.
+ *
+ * The mapping arrays are structs (12 bytes for IPv4, 24 for IPv6); the
+ * IPv4 kernels load whole groups of structs and shuffle the prefix and
+ * length words into place rather than gathering them.
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "sav_validate.h"
+#include "sav_layout.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SAV_VALIDATE_X86 1
+#include <immintrin.h>
+#endif
+
+typedef uint32_t (*validate_ipv4_fn)(const sav_ipv4_mapping_t *m, uint32_t count, uint64_t *bad);
+typedef uint32_t (*validate_ipv6_fn)(const sav_ipv6_mapping_t *m, uint32_t count, uint64_t *bad);
+
+#define MARK_BAD(bad, i) ((bad)[(i) / 64] |= 1ULL << ((i) % 64))
+
+/* ---------------------------------------------------------------- scalar */
+
+static inline int ipv4_is_bad(const sav_ipv4_mapping_t *m)
+{
+    uint8_t plen = m->sourceIPv4PrefixLength;
+
+    if (plen > 32) return 1;
+    return (m->sourceIPv4Prefix & (uint32_t)(0xFFFFFFFFULL >> plen)) != 0;
+}
+
+static inline int ipv6_is_bad(const sav_ipv6_mapping_t *m)
+{
+    uint8_t plen = m->sourceIPv6PrefixLength;
+    uint64_t hi, lo;
+
+    memcpy(&hi, m->sourceIPv6Prefix, 8);
+    memcpy(&lo, m->sourceIPv6Prefix + 8, 8);
+    hi = GUINT64_FROM_BE(hi);
+    lo = GUINT64_FROM_BE(lo);
+    /* Host bits of each half, computed without branches so lengths in
+     * random order do not cost a misprediction each */
+    uint64_t hi_host = (UINT64_MAX >> (plen & 63)) & -(uint64_t)(plen < 64);
+    uint64_t lo_host = (UINT64_MAX >> (((plen > 64) * (plen - 64)) & 63)) &
+                       -(uint64_t)(plen < 128);
+
+    return (plen > 128) | (((hi & hi_host) | (lo & lo_host)) != 0);
+}
+
+/* Scalar kernels validate [start, count); the vector kernels use them
+ * for the tail */
+static uint32_t ipv4_scalar_from(const sav_ipv4_mapping_t *m, uint32_t start,
+                                 uint32_t count, uint64_t *bad)
+{
+    uint32_t n_bad = 0;
+    for (uint32_t i = start; i < count; i++) {
+        if (ipv4_is_bad(&m[i])) {
+            MARK_BAD(bad, i);
+            n_bad++;
+        }
+    }
+    return n_bad;
+}
+
+static uint32_t ipv6_scalar_from(const sav_ipv6_mapping_t *m, uint32_t start,
+                                 uint32_t count, uint64_t *bad)
+{
+    uint32_t n_bad = 0;
+    for (uint32_t i = start; i < count; i++) {
+        if (ipv6_is_bad(&m[i])) {
+            MARK_BAD(bad, i);
+            n_bad++;
+        }
+    }
+    return n_bad;
+}
+
+static uint32_t ipv4_scalar(const sav_ipv4_mapping_t *m, uint32_t count, uint64_t *bad)
+{
+    return ipv4_scalar_from(m, 0, count, bad);
+}
+
+static uint32_t ipv6_scalar(const sav_ipv6_mapping_t *m, uint32_t count, uint64_t *bad)
+{
+    return ipv6_scalar_from(m, 0, count, bad);
+}
+
+#ifdef SAV_VALIDATE_X86
+
+/* The struct loads below assume the natural layouts */
+typedef char sav_validate_ipv4_size_check[sizeof(sav_ipv4_mapping_t) == 12 ? 1 : -1];
+typedef char sav_validate_ipv6_size_check[
+    (sizeof(sav_ipv6_mapping_t) == 24 &&
+     offsetof(sav_ipv6_mapping_t, sourceIPv6Prefix) == 4) ? 1 : -1];
+
+/* Host-bit mask of an address byte with n network bits, n = 0..8 */
+#define HOST_BYTE_LUT \
+    (char)0xFF, 0x7F, 0x3F, 0x1F, 0x0F, 0x07, 0x03, 0x01, 0, 0, 0, 0, 0, 0, 0, 0
+
+/* ---------------------------------------------------------------- SSE4.1 */
+
+__attribute__((target("sse4.1")))
+static uint32_t ipv4_sse41(const sav_ipv4_mapping_t *m, uint32_t count, uint64_t *bad)
+{
+    const __m128i lut = _mm_setr_epi8(HOST_BYTE_LUT);
+    /* Broadcast each lane's low byte (the prefix length) to the lane */
+    const __m128i bcast = _mm_setr_epi8(0, 0, 0, 0, 4, 4, 4, 4, 8, 8, 8, 8, 12, 12, 12, 12);
+    /* Host-order prefix: memory byte k holds address byte 3 - k */
+    const __m128i first_bit = _mm_setr_epi8(24, 16, 8, 0, 24, 16, 8, 0,
+                                            24, 16, 8, 0, 24, 16, 8, 0);
+    const __m128i eight = _mm_set1_epi8(8);
+    const __m128i max_len = _mm_set1_epi32(32);
+    const __m128i low_byte = _mm_set1_epi32(0xFF);
+    uint32_t n_bad = 0, i = 0;
+
+    /* 4 mappings = 12 words: {iface, prefix, length} x 4 */
+    for (; i + 4 <= count; i += 4) {
+        const __m128i *p = (const __m128i *)&m[i];
+        __m128i a = _mm_loadu_si128(p);
+        __m128i b = _mm_loadu_si128(p + 1);
+        __m128i c = _mm_loadu_si128(p + 2);
+
+        /* Prefix words 1, 4, 7, 10 */
+        __m128i prefix = _mm_blend_epi16(
+            _mm_blend_epi16(_mm_shuffle_epi32(a, _MM_SHUFFLE(0, 0, 0, 1)),
+                            _mm_shuffle_epi32(b, _MM_SHUFFLE(0, 3, 0, 0)), 0x3C),
+            _mm_shuffle_epi32(c, _MM_SHUFFLE(2, 0, 0, 0)), 0xC0);
+        /* Length words 2, 5, 8, 11 */
+        __m128i plen = _mm_blend_epi16(
+            _mm_blend_epi16(_mm_shuffle_epi32(a, _MM_SHUFFLE(0, 0, 0, 2)),
+                            _mm_shuffle_epi32(b, _MM_SHUFFLE(0, 0, 1, 0)), 0x0C),
+            _mm_shuffle_epi32(c, _MM_SHUFFLE(3, 0, 0, 0)), 0xF0);
+        plen = _mm_and_si128(plen, low_byte);
+
+        __m128i net_bits = _mm_min_epu8(
+            _mm_subs_epu8(_mm_shuffle_epi8(plen, bcast), first_bit), eight);
+        __m128i host = _mm_shuffle_epi8(lut, net_bits);
+        __m128i ok = _mm_andnot_si128(
+            _mm_cmpgt_epi32(plen, max_len),
+            _mm_cmpeq_epi32(_mm_and_si128(prefix, host), _mm_setzero_si128()));
+
+        uint32_t bits = ~(uint32_t)_mm_movemask_ps(_mm_castsi128_ps(ok)) & 0xF;
+        if (bits) {
+            bad[i / 64] |= (uint64_t)bits << (i % 64);
+            n_bad += (uint32_t)__builtin_popcount(bits);
+        }
+    }
+    return n_bad + ipv4_scalar_from(m, i, count, bad);
+}
+
+__attribute__((target("sse4.1")))
+static uint32_t ipv6_sse41(const sav_ipv6_mapping_t *m, uint32_t count, uint64_t *bad)
+{
+    const __m128i lut = _mm_setr_epi8(HOST_BYTE_LUT);
+    const __m128i first_bit = _mm_setr_epi8(0, 8, 16, 24, 32, 40, 48, 56,
+                                            64, 72, 80, 88, 96, 104, 112, (char)120);
+    const __m128i eight = _mm_set1_epi8(8);
+    uint32_t n_bad = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint8_t plen = m[i].sourceIPv6PrefixLength;
+        __m128i addr = _mm_loadu_si128((const __m128i *)m[i].sourceIPv6Prefix);
+        __m128i net_bits = _mm_min_epu8(
+            _mm_subs_epu8(_mm_set1_epi8((char)plen), first_bit), eight);
+        __m128i host = _mm_shuffle_epi8(lut, net_bits);
+
+        if (plen > 128 || !_mm_testz_si128(addr, host)) {
+            MARK_BAD(bad, i);
+            n_bad++;
+        }
+    }
+    return n_bad;
+}
+
+/* ---------------------------------------------------------------- AVX2 */
+
+__attribute__((target("avx2")))
+static uint32_t ipv4_avx2(const sav_ipv4_mapping_t *m, uint32_t count, uint64_t *bad)
+{
+    /* 8 mappings = 24 words in registers a (0-7), b (8-15), c (16-23).
+     * Prefix words 1,4,7 | 10,13 | 16,19,22 and length words
+     * 2,5 | 8,11,14 | 17,20,23 are permuted into lanes and blended. */
+    const __m256i prefix_a = _mm256_setr_epi32(1, 4, 7, 0, 0, 0, 0, 0);
+    const __m256i prefix_b = _mm256_setr_epi32(0, 0, 0, 2, 5, 0, 0, 0);
+    const __m256i prefix_c = _mm256_setr_epi32(0, 0, 0, 0, 0, 0, 3, 6);
+    const __m256i plen_a = _mm256_setr_epi32(2, 5, 0, 0, 0, 0, 0, 0);
+    const __m256i plen_b = _mm256_setr_epi32(0, 0, 0, 3, 6, 0, 0, 0);
+    const __m256i plen_c = _mm256_setr_epi32(0, 0, 0, 0, 0, 1, 4, 7);
+    const __m256i ones = _mm256_set1_epi32(-1);
+    const __m256i max_len = _mm256_set1_epi32(32);
+    const __m256i low_byte = _mm256_set1_epi32(0xFF);
+    uint32_t n_bad = 0, i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        const __m256i *p = (const __m256i *)&m[i];
+        __m256i a = _mm256_loadu_si256(p);
+        __m256i b = _mm256_loadu_si256(p + 1);
+        __m256i c = _mm256_loadu_si256(p + 2);
+
+        __m256i prefix = _mm256_blend_epi32(
+            _mm256_blend_epi32(_mm256_permutevar8x32_epi32(a, prefix_a),
+                               _mm256_permutevar8x32_epi32(b, prefix_b), 0x18),
+            _mm256_permutevar8x32_epi32(c, prefix_c), 0xE0);
+        __m256i plen = _mm256_blend_epi32(
+            _mm256_blend_epi32(_mm256_permutevar8x32_epi32(a, plen_a),
+                               _mm256_permutevar8x32_epi32(b, plen_b), 0x1C),
+            _mm256_permutevar8x32_epi32(c, plen_c), 0xE0);
+        plen = _mm256_and_si256(plen, low_byte);
+
+        /* VPSRLVD yields 0 for counts >= 32 */
+        __m256i host = _mm256_srlv_epi32(ones, plen);
+        __m256i ok = _mm256_andnot_si256(
+            _mm256_cmpgt_epi32(plen, max_len),
+            _mm256_cmpeq_epi32(_mm256_and_si256(prefix, host), _mm256_setzero_si256()));
+
+        uint32_t bits = ~(uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(ok)) & 0xFF;
+        if (bits) {
+            bad[i / 64] |= (uint64_t)bits << (i % 64);
+            n_bad += (uint32_t)__builtin_popcount(bits);
+        }
+    }
+    return n_bad + ipv4_scalar_from(m, i, count, bad);
+}
+
+__attribute__((target("avx2")))
+static uint32_t ipv6_avx2(const sav_ipv6_mapping_t *m, uint32_t count, uint64_t *bad)
+{
+    const __m256i lut = _mm256_setr_epi8(HOST_BYTE_LUT, HOST_BYTE_LUT);
+    const __m256i first_bit = _mm256_setr_epi8(
+        0, 8, 16, 24, 32, 40, 48, 56, 64, 72, 80, 88, 96, 104, 112, (char)120,
+        0, 8, 16, 24, 32, 40, 48, 56, 64, 72, 80, 88, 96, 104, 112, (char)120);
+    const __m256i eight = _mm256_set1_epi8(8);
+    uint32_t n_bad = 0, i = 0;
+
+    /* Two addresses per register, one per 128-bit lane */
+    for (; i + 2 <= count; i += 2) {
+        uint8_t len0 = m[i].sourceIPv6PrefixLength;
+        uint8_t len1 = m[i + 1].sourceIPv6PrefixLength;
+        __m256i addr = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)m[i].sourceIPv6Prefix)),
+            _mm_loadu_si128((const __m128i *)m[i + 1].sourceIPv6Prefix), 1);
+        __m256i plen = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_set1_epi8((char)len0)), _mm_set1_epi8((char)len1), 1);
+
+        __m256i net_bits = _mm256_min_epu8(_mm256_subs_epu8(plen, first_bit), eight);
+        __m256i host = _mm256_shuffle_epi8(lut, net_bits);
+        uint32_t clear = (uint32_t)_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(_mm256_and_si256(addr, host), _mm256_setzero_si256()));
+
+        if (len0 > 128 || (clear & 0xFFFF) != 0xFFFF) {
+            MARK_BAD(bad, i);
+            n_bad++;
+        }
+        if (len1 > 128 || (clear >> 16) != 0xFFFF) {
+            MARK_BAD(bad, i + 1);
+            n_bad++;
+        }
+    }
+    return n_bad + ipv6_scalar_from(m, i, count, bad);
+}
+
+#endif /* SAV_VALIDATE_X86 */
+
+/* ---------------------------------------------------------------- dispatch */
+
+static const struct {
+    const char       *name;
+    validate_ipv4_fn ipv4;
+    validate_ipv6_fn ipv6;
+} impls[] = {
+    [SAV_VALIDATE_IMPL_SCALAR] = { "scalar", ipv4_scalar, ipv6_scalar },
+#ifdef SAV_VALIDATE_X86
+    [SAV_VALIDATE_IMPL_SSE41]  = { "sse4.1", ipv4_sse41,  ipv6_sse41 },
+    [SAV_VALIDATE_IMPL_AVX2]   = { "avx2",   ipv4_avx2,   ipv6_avx2 },
+#else
+    [SAV_VALIDATE_IMPL_SSE41]  = { "sse4.1", NULL, NULL },
+    [SAV_VALIDATE_IMPL_AVX2]   = { "avx2",   NULL, NULL },
+#endif
+};
+
+static sav_validate_impl_t active_impl = SAV_VALIDATE_IMPL_SCALAR;
+
+static gboolean impl_supported(sav_validate_impl_t impl)
+{
+    switch (impl) {
+        case SAV_VALIDATE_IMPL_SCALAR:
+            return TRUE;
+#ifdef SAV_VALIDATE_X86
+        case SAV_VALIDATE_IMPL_SSE41:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("sse4.1");
+        case SAV_VALIDATE_IMPL_AVX2:
+            __builtin_cpu_init();
+            return __builtin_cpu_supports("avx2");
+#endif
+        default:
+            return FALSE;
+    }
+}
+
+/* Pick the best supported implementation on first use */
+static sav_validate_impl_t resolve_impl(void)
+{
+    static gsize resolved = 0;
+
+    if (g_once_init_enter(&resolved)) {
+        if (impl_supported(SAV_VALIDATE_IMPL_AVX2)) {
+            active_impl = SAV_VALIDATE_IMPL_AVX2;
+        } else if (impl_supported(SAV_VALIDATE_IMPL_SSE41)) {
+            active_impl = SAV_VALIDATE_IMPL_SSE41;
+        }
+        g_once_init_leave(&resolved, 1);
+    }
+    return active_impl;
+}
+
+sav_validate_impl_t sav_validate_get_impl(void)
+{
+    return resolve_impl();
+}
+
+gboolean sav_validate_set_impl(sav_validate_impl_t impl)
+{
+    resolve_impl();
+    if (!impl_supported(impl)) {
+        return FALSE;
+    }
+    active_impl = impl;
+    return TRUE;
+}
+
+const char* sav_validate_impl_name(sav_validate_impl_t impl)
+{
+    if ((unsigned)impl >= G_N_ELEMENTS(impls)) {
+        return "unknown";
+    }
+    return impls[impl].name;
+}
+
+/* ---------------------------------------------------------------- API */
+
+uint32_t sav_validate_ipv4_mappings(
+    const sav_ipv4_mapping_t *mappings,
+    uint32_t                 count,
+    uint64_t                 *bad)
+{
+    memset(bad, 0, SAV_VALIDATE_BITMAP_WORDS(count) * sizeof(uint64_t));
+    if (count == 0) {
+        return 0;
+    }
+    return impls[resolve_impl()].ipv4(mappings, count, bad);
+}
+
+uint32_t sav_validate_ipv6_mappings(
+    const sav_ipv6_mapping_t *mappings,
+    uint32_t                 count,
+    uint64_t                 *bad)
+{
+    memset(bad, 0, SAV_VALIDATE_BITMAP_WORDS(count) * sizeof(uint64_t));
+    if (count == 0) {
+        return 0;
+    }
+    return impls[resolve_impl()].ipv6(mappings, count, bad);
+}
+
+uint32_t sav_validate_record_mappings(
+    const sav_parsed_record_t *record,
+    uint64_t                  *bad)
+{
+    const sav_sub_template_layout_t *layout = sav_sub_template_layout(record->sub_template_id);
+
+    if (!layout || !record->mappings.ipv4_mappings) {
+        memset(bad, 0, SAV_VALIDATE_BITMAP_WORDS(record->mapping_count) * sizeof(uint64_t));
+        return 0;
+    }
+    if (layout->family == 4) {
+        return sav_validate_ipv4_mappings(record->mappings.ipv4_mappings,
+                                          record->mapping_count, bad);
+    }
+    return sav_validate_ipv6_mappings(record->mappings.ipv6_mappings,
+                                      record->mapping_count, bad);
+}
+
+gboolean sav_validate_record_header(
+    const sav_parsed_record_t *record,
+    GError                    **err)
+{
+    if (!record) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP, "NULL record");
+        return FALSE;
+    }
+
+    /* Validate enum values */
+    if (!sav_validate_rule_type(record->rule_type)) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                    "Invalid rule_type: %u", record->rule_type);
+        return FALSE;
+    }
+
+    if (!sav_validate_target_type(record->target_type)) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                    "Invalid target_type: %u", record->target_type);
+        return FALSE;
+    }
+
+    if (!sav_validate_policy_action(record->policy_action)) {
+        g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                    "Invalid policy_action: %u", record->policy_action);
+        return FALSE;
+    }
+
+    /* Validate template ID matches target type */
+    uint16_t expected_tmpl = sav_get_template_id(record->rule_type, record->target_type);
+    if (record->sub_template_id != expected_tmpl &&
+        record->sub_template_id != expected_tmpl + 1) { /* Allow IPv4/IPv6 variance */
+        /* More flexible check */
+        gboolean valid_tmpl = (record->sub_template_id >= SAV_TMPL_IPV4_INTERFACE_PREFIX &&
+                               record->sub_template_id <= SAV_TMPL_IPV6_PREFIX_INTERFACE);
+        if (!valid_tmpl) {
+            g_set_error(err, FB_ERROR_DOMAIN, FB_ERROR_SETUP,
+                        "Invalid sub-template ID: %u", record->sub_template_id);
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
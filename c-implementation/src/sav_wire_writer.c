@@ -0,0 +1,134 @@
+/**
+ * @file sav_wire_writer.c
+ * @brief Direct encoder for SAV IPFIX messages
+ */
+
+#include <string.h>
+#include "sav_wire_writer.h"
+#include "sav_fast_decoder.h"
+#include "sav_layout.h"
+
+/* SubTemplateList semantic written by the exporter (allOf) */
+#define STL_SEMANTIC_ALL_OF 3
+
+/* Usable message size */
+static size_t writer_limit(const sav_wire_writer_t *w)
+{
+    return w->cap < SAV_IPFIX_MAX_MSG_LEN ? w->cap : SAV_IPFIX_MAX_MSG_LEN;
+}
+
+/* Close the open data set, if any */
+static void close_data_set(sav_wire_writer_t *w)
+{
+    if (w->set_off) {
+        sav_write_be16(w->buf + w->set_off + 2, (uint16_t)(w->len - w->set_off));
+        w->set_off = 0;
+    }
+}
+
+void sav_wire_writer_init(
+    sav_wire_writer_t *w,
+    uint8_t           *buf,
+    size_t            cap,
+    uint32_t          domain_id)
+{
+    memset(w, 0, sizeof(*w));
+    w->buf = buf;
+    w->cap = cap;
+    w->domain_id = domain_id;
+}
+
+void sav_wire_begin_message(sav_wire_writer_t *w, uint32_t export_time)
+{
+    /* Length and sequence number are filled in by sav_wire_finish_message() */
+    memset(w->buf, 0, SAV_IPFIX_MSG_HEADER_LEN);
+    sav_write_be16(w->buf, SAV_IPFIX_VERSION);
+    sav_write_be32(w->buf + 4, export_time);
+    sav_write_be32(w->buf + 12, w->domain_id);
+
+    w->len = SAV_IPFIX_MSG_HEADER_LEN;
+    w->set_off = 0;
+    w->msg_records = 0;
+}
+
+gboolean sav_wire_add_templates(sav_wire_writer_t *w)
+{
+    if (!w->len) {
+        return FALSE;
+    }
+
+    close_data_set(w);
+    size_t n = sav_fast_encode_template_set(w->buf + w->len, writer_limit(w) - w->len);
+    w->len += n;
+    return n != 0;
+}
+
+gboolean sav_wire_add_record(
+    sav_wire_writer_t         *w,
+    const sav_parsed_record_t *record)
+{
+    const sav_sub_template_layout_t *layout = sav_sub_template_layout(record->sub_template_id);
+    if (!layout) {
+        return FALSE;
+    }
+    size_t entry_len = layout->entry_size;
+
+    /* semantic(1) + template ID(2) + entries */
+    size_t stl_len = 3 + (size_t)record->mapping_count * entry_len;
+    size_t varlen_hdr = stl_len < 255 ? 1 : 3;
+    size_t need = 8 + 1 + 1 + varlen_hdr + stl_len + 1;
+    if (!w->set_off) {
+        need += SAV_IPFIX_SET_HEADER_LEN;
+    }
+    if (!w->len || stl_len > 0xFFFF || w->len + need > writer_limit(w)) {
+        return FALSE;
+    }
+
+    if (!w->set_off) {
+        w->set_off = w->len;
+        sav_write_be16(w->buf + w->len, SAV_MAIN_TEMPLATE_ID);
+        w->len += SAV_IPFIX_SET_HEADER_LEN;
+    }
+
+    uint8_t *p = w->buf + w->len;
+    sav_write_be64(p, record->timestamp_ms);
+    p[8] = record->rule_type;
+    p[9] = record->target_type;
+    p += 10;
+    if (varlen_hdr == 1) {
+        *p++ = (uint8_t)stl_len;
+    } else {
+        *p++ = 255;
+        sav_write_be16(p, (uint16_t)stl_len);
+        p += 2;
+    }
+    *p++ = STL_SEMANTIC_ALL_OF;
+    sav_write_be16(p, record->sub_template_id);
+    p += 2;
+
+    if (record->mapping_count) {
+        p = layout->encode_n(p, record->mappings.ipv4_mappings, record->mapping_count);
+    }
+
+    *p++ = record->policy_action;
+    w->len = (size_t)(p - w->buf);
+    w->msg_records++;
+    return TRUE;
+}
+
+size_t sav_wire_finish_message(sav_wire_writer_t *w)
+{
+    if (!w->len) {
+        return 0;
+    }
+
+    close_data_set(w);
+    sav_write_be16(w->buf + 2, (uint16_t)w->len);
+    sav_write_be32(w->buf + 8, w->sequence);
+    w->sequence += w->msg_records;
+
+    size_t len = w->len;
+    w->len = 0;
+    w->msg_records = 0;
+    return len;
+}
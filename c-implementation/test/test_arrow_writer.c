@@ -0,0 +1,186 @@
+/**
+ * @file test_arrow_writer.c
+ * @brief Arrow IPC stream framing and column contents
+ *
+ * Writes IPv4 and IPv6 records through sav_arrow_writer_t with a small
+ * batch size, then walks the stream with a minimal Flatbuffers reader:
+ * one Schema message, record batches of batch_rows rows (the last one
+ * partial), 8-byte aligned metadata and bodies, and the end-of-stream
+ * marker. The ingress_interface and prefix_v4 columns of every batch are
+ * decoded from the body and compared with the input.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include "sav_arrow.h"
+
+#define BATCH_ROWS    1000
+#define RECORDS       40
+#define PER_RECORD    97          /* 3880 rows -> batches of 1000, 1000, 1000, 880 */
+
+#define COL_INTERFACE 4
+#define COL_PREFIX_V4 5
+
+static uint32_t rd32(const uint8_t *p) { return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24; }
+static uint16_t rd16(const uint8_t *p) { return (uint16_t)(p[0] | p[1] << 8); }
+static uint64_t rd64(const uint8_t *p) { return rd32(p) | (uint64_t)rd32(p + 4) << 32; }
+
+/* Position of field `id` of the table at `table`, or 0 if absent */
+static size_t fb_field(const uint8_t *buf, size_t table, uint16_t id)
+{
+    size_t vt = table - (int32_t)rd32(buf + table);
+    if (4 + 2 * (size_t)id >= rd16(buf + vt)) return 0;
+    uint16_t off = rd16(buf + vt + 4 + 2 * id);
+    return off ? table + off : 0;
+}
+
+static size_t fb_deref(const uint8_t *buf, size_t slot)
+{
+    return slot + rd32(buf + slot);
+}
+
+/* Row r of the input */
+static void expected_row(uint32_t row, uint32_t *iface, uint32_t *v4, gboolean *is_v4)
+{
+    uint32_t rec = row / PER_RECORD, i = row % PER_RECORD;
+    *is_v4 = (rec % 2 == 0);
+    *iface = rec * 1000 + i;
+    *v4 = 0x0A000000u | (rec << 16) | i;
+}
+
+static int write_stream(FILE *fp)
+{
+    GError *err = NULL;
+    sav_arrow_writer_t *w = sav_arrow_writer_new(fp, BATCH_ROWS, &err);
+    sav_ipv4_mapping_t v4[PER_RECORD];
+    sav_ipv6_mapping_t v6[PER_RECORD];
+
+    for (uint32_t r = 0; w && r < RECORDS; r++) {
+        sav_parsed_record_t rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.timestamp_ms = 1700000000000ULL + r;
+        rec.mapping_count = PER_RECORD;
+        for (uint32_t i = 0; i < PER_RECORD; i++) {
+            uint32_t iface, prefix;
+            gboolean is_v4;
+            expected_row(r * PER_RECORD + i, &iface, &prefix, &is_v4);
+            v4[i].ingressInterface = iface;
+            v4[i].sourceIPv4Prefix = prefix;
+            v4[i].sourceIPv4PrefixLength = 24;
+            memset(&v6[i], 0, sizeof(v6[i]));
+            v6[i].ingressInterface = iface;
+            v6[i].sourceIPv6PrefixLength = 48;
+        }
+        if (r % 2 == 0) {
+            rec.sub_template_id = SAV_TMPL_IPV4_INTERFACE_PREFIX;
+            rec.mappings.ipv4_mappings = v4;
+        } else {
+            rec.sub_template_id = SAV_TMPL_IPV6_PREFIX_INTERFACE;
+            rec.mappings.ipv6_mappings = v6;
+        }
+        if (!sav_arrow_write_record(w, &rec, &err)) break;
+    }
+    if (!w || err || !sav_arrow_writer_finish(w, &err)) {
+        fprintf(stderr, "✗ writer: %s\n", err ? err->message : "sav_arrow_writer_new failed");
+        sav_arrow_writer_free(w);
+        return 1;
+    }
+    sav_arrow_writer_free(w);
+    return 0;
+}
+
+static int check_stream(const uint8_t *buf, size_t len)
+{
+    size_t off = 0;
+    uint32_t messages = 0, batches = 0, row = 0;
+
+    for (;;) {
+        if (off + 8 > len || rd32(buf + off) != 0xFFFFFFFFu || off % 8 != 0) {
+            fprintf(stderr, "✗ bad message prefix at %zu\n", off);
+            return 1;
+        }
+        uint32_t meta_len = rd32(buf + off + 4);
+        if (meta_len == 0) {
+            off += 8;
+            break;                          /* End-of-stream */
+        }
+        const uint8_t *meta = buf + off + 8;
+        size_t msg = fb_deref(meta, 0);
+        uint8_t header_type = meta[fb_field(meta, msg, 1)];
+        size_t header = fb_deref(meta, fb_field(meta, msg, 2));
+        size_t body_field = fb_field(meta, msg, 3);
+        uint64_t body_len = body_field ? rd64(meta + body_field) : 0;
+        const uint8_t *body = meta + meta_len;
+
+        if (meta_len % 8 != 0 || (messages == 0) != (header_type == 1)) {
+            fprintf(stderr, "✗ message %u: type %u, metadata %u bytes\n",
+                    messages, header_type, meta_len);
+            return 1;
+        }
+
+        if (header_type == 3) {
+            uint64_t rows = rd64(meta + fb_field(meta, header, 0));
+            size_t buffers = fb_deref(meta, fb_field(meta, header, 2));
+            uint32_t expect = (batches < 3) ? BATCH_ROWS : RECORDS * PER_RECORD - 3 * BATCH_ROWS;
+            if (rows != expect || rd32(meta + buffers) != 16) {
+                fprintf(stderr, "✗ batch %u: %lu rows\n", batches, (unsigned long)rows);
+                return 1;
+            }
+            /* Buffer structs: 8-byte aligned, {offset, length} */
+            const uint8_t *vals = meta + buffers + 4;
+            const uint8_t *iface = body + rd64(vals + 16 * (2 * COL_INTERFACE + 1));
+            const uint8_t *valid = body + rd64(vals + 16 * (2 * COL_PREFIX_V4));
+            const uint8_t *v4 = body + rd64(vals + 16 * (2 * COL_PREFIX_V4 + 1));
+            for (uint32_t i = 0; i < rows; i++, row++) {
+                uint32_t e_iface, e_v4, got_v4;
+                gboolean is_v4;
+                expected_row(row, &e_iface, &e_v4, &is_v4);
+                memcpy(&got_v4, v4 + 4 * i, 4);
+                if (rd32(iface + 4 * i) != e_iface ||
+                    ((valid[i / 8] >> (i % 8)) & 1) != (uint8_t)is_v4 ||
+                    (is_v4 && ntohl(got_v4) != e_v4)) {
+                    fprintf(stderr, "✗ row %u differs\n", row);
+                    return 1;
+                }
+            }
+            batches++;
+        }
+        off += 8 + meta_len + body_len;
+        messages++;
+    }
+
+    if (off != len || batches != 4 || row != RECORDS * PER_RECORD) {
+        fprintf(stderr, "✗ %u batches, %u rows, %zu of %zu bytes\n", batches, row, off, len);
+        return 1;
+    }
+    printf("[Stream] schema + %u record batches, %u rows, %zu bytes\n", batches, row, len);
+    return 0;
+}
+
+int main(void)
+{
+    printf("=== Arrow Writer Test ===\n\n");
+
+    FILE *fp = tmpfile();
+    if (!fp || write_stream(fp) != 0) {
+        fprintf(stderr, "\n❌ Arrow writer test failed\n");
+        return 1;
+    }
+
+    long size = ftell(fp);
+    uint8_t *buf = g_malloc((size_t)size);
+    rewind(fp);
+    size_t len = fread(buf, 1, (size_t)size, fp);
+    fclose(fp);
+
+    int rc = check_stream(buf, len);
+    g_free(buf);
+    if (rc) {
+        fprintf(stderr, "\n❌ Arrow writer test failed\n");
+        return 1;
+    }
+    printf("\n✅ Arrow IPC stream is well-formed\n");
+    return 0;
+}
@@ -0,0 +1,243 @@
+/**
+ * @file test_export_dual_stack.c
+ * @brief Mixed IPv4/IPv6 tables through one record context
+ *
+ * Adds interleaved IPv4 and IPv6 mappings to a single context and checks
+ * that sav_export_record() writes one record per sub-template (901 then
+ * 902), that an IPv6-only list does not drag an empty IPv4 record along,
+ * and that a mapping whose add function does not match the context's
+ * target type still lands in its own sub-template's list. The file is
+ * read back with sav_create_file_collector(), whose records are copied
+ * from the layout-aware record view, so every sub-template (including the
+ * 9-byte 903 entries) is decoded at its own stride and field order.
+ * Interfaces and IPv4 prefixes come back in host byte order.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include "sav_collector.h"
+#include "sav_exporter.h"
+
+#define IPFIX_FILE  "test_export_dual_stack.ipfix"
+#define MIXED       3000        /* IPv4 mappings of record 0; every third also IPv6 */
+
+/* Expected records in file order */
+typedef struct expected_record {
+    uint32_t  record;           /* sav_export_record() call (timestamp offset) */
+    uint16_t  tmpl_id;
+    uint32_t  mappings;
+} expected_record_t;
+
+static const expected_record_t expected[] = {
+    { 0, SAV_TMPL_IPV4_INTERFACE_PREFIX, MIXED },
+    { 0, SAV_TMPL_IPV6_INTERFACE_PREFIX, MIXED / 3 },
+    { 1, SAV_TMPL_IPV6_PREFIX_INTERFACE, 500 },
+    { 2, SAV_TMPL_IPV4_PREFIX_INTERFACE, 0 },
+    { 3, SAV_TMPL_IPV4_PREFIX_INTERFACE, 10 },
+};
+
+#define EXPECTED_COUNT (sizeof(expected) / sizeof(expected[0]))
+
+static void make_ipv6(uint32_t m, uint8_t *prefix)
+{
+    memset(prefix, 0, 16);
+    prefix[0] = 0x20;
+    prefix[1] = 0x01;
+    prefix[2] = 0x0d;
+    prefix[3] = 0xb8;
+    prefix[6] = (uint8_t)(m >> 8);
+    prefix[7] = (uint8_t)m;
+}
+
+/* Export the context as record r */
+static int export_one(sav_record_ctx_t *rctx, fBuf_t *fbuf, uint32_t r, uint8_t target)
+{
+    GError *err = NULL;
+    if (!sav_export_record(rctx, fbuf, 1700000000000ULL + r, SAV_RULE_TYPE_ALLOWLIST,
+                           target, SAV_POLICY_ACTION_DISCARD, &err)) {
+        fprintf(stderr, "✗ record %u: sav_export_record: %s\n", r, err->message);
+        return 1;
+    }
+    printf("[Export] record %u -> %u template-400 record(s)\n", r, rctx->records_exported);
+    return 0;
+}
+
+static int export_records(void)
+{
+    GError *err = NULL;
+    fbInfoModel_t *model = fbInfoModelAlloc();
+    sav_init_info_model(model);
+    fbSession_t *session = fbSessionAlloc(model);
+    uint8_t v6[16];
+    gboolean ok = TRUE;
+
+    if (!sav_add_templates(session, &err)) {
+        fprintf(stderr, "✗ sav_add_templates: %s\n", err->message);
+        return 1;
+    }
+    fBuf_t *fbuf = sav_create_file_exporter(model, session, IPFIX_FILE, &err);
+    if (!fbuf) {
+        fprintf(stderr, "✗ sav_create_file_exporter: %s\n", err->message);
+        return 1;
+    }
+
+    sav_record_ctx_t rctx;
+    if (!sav_record_ctx_init(&rctx, model, session, SAV_RULE_TYPE_ALLOWLIST,
+                             SAV_TARGET_TYPE_INTERFACE_BASED, &err)) {
+        fprintf(stderr, "✗ sav_record_ctx_init: %s\n", err->message);
+        return 1;
+    }
+
+    /* 0: dual-stack interface-based table in one pass */
+    for (uint32_t m = 0; m < MIXED && ok; m++) {
+        ok = sav_add_ipv4_interface_prefix(&rctx, 1 + m % 100, htonl(0x0A000000u | m), 32, &err);
+        if (ok && m % 3 == 0) {
+            make_ipv6(m / 3, v6);
+            ok = sav_add_ipv6_interface_prefix(&rctx, 1 + m % 100, v6, 64, &err);
+        }
+    }
+    if (!ok || export_one(&rctx, fbuf, 0, SAV_TARGET_TYPE_INTERFACE_BASED)) {
+        fprintf(stderr, "✗ record 0: %s\n", err ? err->message : "export failed");
+        return 1;
+    }
+
+    /* 1: IPv6-only prefix-based table */
+    ok = sav_record_ctx_reset(&rctx, SAV_RULE_TYPE_ALLOWLIST, SAV_TARGET_TYPE_PREFIX_BASED, &err);
+    for (uint32_t m = 0; m < 500 && ok; m++) {
+        make_ipv6(m, v6);
+        ok = sav_add_ipv6_prefix_interface(&rctx, v6, 48, 200 + m, &err);
+    }
+    if (!ok || export_one(&rctx, fbuf, 1, SAV_TARGET_TYPE_PREFIX_BASED)) {
+        fprintf(stderr, "✗ record 1: %s\n", err ? err->message : "export failed");
+        return 1;
+    }
+
+    /* 2: empty prefix-based list */
+    if (!sav_record_ctx_reset(&rctx, SAV_RULE_TYPE_ALLOWLIST, SAV_TARGET_TYPE_PREFIX_BASED, &err) ||
+        export_one(&rctx, fbuf, 2, SAV_TARGET_TYPE_PREFIX_BASED)) {
+        fprintf(stderr, "✗ record 2: %s\n", err ? err->message : "export failed");
+        return 1;
+    }
+
+    /* 3: prefix-to-interface entries on an interface-based context */
+    ok = sav_record_ctx_reset(&rctx, SAV_RULE_TYPE_ALLOWLIST, SAV_TARGET_TYPE_INTERFACE_BASED, &err);
+    for (uint32_t m = 0; m < 10 && ok; m++) {
+        ok = sav_add_ipv4_prefix_interface(&rctx, htonl(0xC0A80000u | m), 32, 300 + m, &err);
+    }
+    if (!ok || export_one(&rctx, fbuf, 3, SAV_TARGET_TYPE_PREFIX_BASED)) {
+        fprintf(stderr, "✗ record 3: %s\n", err ? err->message : "export failed");
+        return 1;
+    }
+
+    sav_record_ctx_cleanup(&rctx);
+    sav_close_exporter(fbuf);
+    fbInfoModelFree(model);
+    return 0;
+}
+
+/* Check mapping i of a record matching expected[e] (host byte order) */
+static int check_mapping(const expected_record_t *e, const sav_parsed_record_t *rec, uint32_t i)
+{
+    uint8_t v6[16];
+
+    switch (e->tmpl_id) {
+      case SAV_TMPL_IPV4_INTERFACE_PREFIX: {
+        const sav_ipv4_mapping_t *x = &rec->mappings.ipv4_mappings[i];
+        return x->ingressInterface != 1 + i % 100 ||
+               x->sourceIPv4Prefix != (0x0A000000u | i) ||
+               x->sourceIPv4PrefixLength != 32;
+      }
+      case SAV_TMPL_IPV6_INTERFACE_PREFIX: {
+        const sav_ipv6_mapping_t *x = &rec->mappings.ipv6_mappings[i];
+        make_ipv6(i, v6);
+        return x->ingressInterface != 1 + (i * 3) % 100 ||
+               memcmp(x->sourceIPv6Prefix, v6, 16) != 0 ||
+               x->sourceIPv6PrefixLength != 64;
+      }
+      case SAV_TMPL_IPV6_PREFIX_INTERFACE: {
+        const sav_ipv6_mapping_t *x = &rec->mappings.ipv6_mappings[i];
+        make_ipv6(i, v6);
+        return x->ingressInterface != 200 + i ||
+               memcmp(x->sourceIPv6Prefix, v6, 16) != 0 ||
+               x->sourceIPv6PrefixLength != 48;
+      }
+      default: {
+        const sav_ipv4_mapping_t *x = &rec->mappings.ipv4_mappings[i];
+        return x->ingressInterface != 300 + i ||
+               x->sourceIPv4Prefix != (0xC0A80000u | i) ||
+               x->sourceIPv4PrefixLength != 32;
+      }
+    }
+}
+
+static int collect_records(void)
+{
+    GError *err = NULL;
+    sav_collector_ctx_t *ctx = sav_create_file_collector(IPFIX_FILE, &err);
+    if (!ctx) {
+        fprintf(stderr, "✗ sav_create_file_collector: %s\n", err->message);
+        return 1;
+    }
+
+    sav_parsed_record_t rec;
+    uint32_t n = 0;
+    int rc = 0;
+
+    while (rc == 0 && sav_read_record(ctx, &rec, &err)) {
+        if (n >= EXPECTED_COUNT) {
+            fprintf(stderr, "✗ unexpected extra record\n");
+            rc = 1;
+        } else {
+            const expected_record_t *e = &expected[n];
+            printf("[Collect] record %u: template %u, %u mapping(s)\n",
+                   (unsigned)(rec.timestamp_ms - 1700000000000ULL),
+                   rec.sub_template_id, rec.mapping_count);
+            if (rec.timestamp_ms != 1700000000000ULL + e->record ||
+                rec.sub_template_id != e->tmpl_id || rec.mapping_count != e->mappings) {
+                fprintf(stderr, "✗ expected record %u: template %u, %u mapping(s)\n",
+                        e->record, e->tmpl_id, e->mappings);
+                rc = 1;
+            }
+            for (uint32_t i = 0; i < rec.mapping_count && rc == 0; i++) {
+                if (check_mapping(e, &rec, i)) {
+                    fprintf(stderr, "✗ record %u: mapping %u differs\n", e->record, i);
+                    rc = 1;
+                }
+            }
+        }
+        n++;
+        sav_free_parsed_record(&rec);
+    }
+    if (err) {
+        fprintf(stderr, "✗ sav_read_record: %s\n", err->message);
+        g_clear_error(&err);
+        rc = 1;
+    }
+    if (rc == 0 && n != EXPECTED_COUNT) {
+        fprintf(stderr, "✗ read %u records, expected %zu\n", n, EXPECTED_COUNT);
+        rc = 1;
+    }
+
+    sav_collector_ctx_destroy(ctx);
+    return rc;
+}
+
+int main(void)
+{
+    printf("=== Dual-Stack Export Test ===\n\n");
+
+    int rc = export_records();
+    if (rc == 0) {
+        rc = collect_records();
+    }
+    remove(IPFIX_FILE);
+
+    if (rc) {
+        fprintf(stderr, "\n❌ Dual-stack export failed\n");
+        return 1;
+    }
+    printf("\n✅ Each address family exported under its own sub-template\n");
+    return 0;
+}
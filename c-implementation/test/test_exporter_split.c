@@ -0,0 +1,255 @@
+/**
+ * @file test_exporter_split.c
+ * @brief Large-list export: buffer growth and multi-record splitting
+ *
+ * Exports lists far beyond the initial SubTemplateList capacity through
+ * sav_export_record(), once with the default record budget and once with
+ * an MTU-sized budget, and reads the file back through
+ * sav_read_record_view(). Every list must come back complete and in
+ * order, split into the expected number of template-400 records that each
+ * stay within the budget. IPv6 lists are added with sav_add_ipv6_*() to a
+ * context initialised for IPv4, so they are staged outside the primary
+ * list. The last cases repeat the large lists on the previous case's
+ * context after sav_record_ctx_reset(), so its SubTemplateList is reused
+ * across sub-templates and list sizes; they must produce the same records.
+ * Every export must leave its entries staged.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include "sav_collector.h"
+#include "sav_exporter.h"
+
+#define IPFIX_FILE   "test_exporter_split.ipfix"
+#define MTU_BUDGET   1400
+
+/* One exported list */
+typedef struct split_case {
+    uint8_t   target_type;
+    gboolean  ipv6;
+    uint32_t  entries;
+    size_t    msg_budget;            /* 0 = default */
+    gboolean  reuse;                 /* Reset the previous case's context */
+    uint32_t  records_expected;      /* Filled in while exporting */
+} split_case_t;
+
+static split_case_t cases[] = {
+    { SAV_TARGET_TYPE_INTERFACE_BASED, FALSE, 25000, 0,          FALSE, 0 },
+    { SAV_TARGET_TYPE_PREFIX_BASED,    FALSE, 1000,  MTU_BUDGET, FALSE, 0 },
+    { SAV_TARGET_TYPE_INTERFACE_BASED, TRUE,  5000,  MTU_BUDGET, FALSE, 0 },
+    { SAV_TARGET_TYPE_PREFIX_BASED,    TRUE,  3,     0,          FALSE, 0 },
+    { SAV_TARGET_TYPE_INTERFACE_BASED, FALSE, 25000, 0,          TRUE,  0 },
+    { SAV_TARGET_TYPE_INTERFACE_BASED, TRUE,  5000,  MTU_BUDGET, TRUE,  0 },
+};
+
+#define CASE_COUNT (sizeof(cases) / sizeof(cases[0]))
+
+/* Encoded size of one list entry of case c */
+static size_t case_entry_size(uint32_t c)
+{
+    return cases[c].ipv6 ? 21 : 9;
+}
+
+static void make_ipv6(uint32_t c, uint32_t m, uint8_t *prefix)
+{
+    memset(prefix, 0, 16);
+    prefix[0] = 0x20;
+    prefix[1] = 0x01;
+    prefix[4] = (uint8_t)c;
+    prefix[5] = (uint8_t)(m >> 16);
+    prefix[6] = (uint8_t)(m >> 8);
+    prefix[7] = (uint8_t)m;
+}
+
+static int export_cases(void)
+{
+    GError *err = NULL;
+    fbInfoModel_t *model = fbInfoModelAlloc();
+    sav_init_info_model(model);
+    fbSession_t *session = fbSessionAlloc(model);
+
+    if (!sav_add_templates(session, &err)) {
+        fprintf(stderr, "✗ sav_add_templates: %s\n", err->message);
+        return 1;
+    }
+    fBuf_t *fbuf = sav_create_file_exporter(model, session, IPFIX_FILE, &err);
+    if (!fbuf) {
+        fprintf(stderr, "✗ sav_create_file_exporter: %s\n", err->message);
+        return 1;
+    }
+
+    sav_record_ctx_t rctx;
+    gboolean have_ctx = FALSE;
+
+    for (uint32_t c = 0; c < CASE_COUNT; c++) {
+        split_case_t *tc = &cases[c];
+        uint8_t target = tc->target_type;
+        size_t budget = tc->msg_budget ? tc->msg_budget : SAV_DEFAULT_MSG_BUDGET;
+
+        if (have_ctx && !tc->reuse) {
+            sav_record_ctx_cleanup(&rctx);
+            have_ctx = FALSE;
+        }
+        if (have_ctx
+                ? !sav_record_ctx_reset(&rctx, SAV_RULE_TYPE_ALLOWLIST, target, &err)
+                : !sav_record_ctx_init(&rctx, model, session, SAV_RULE_TYPE_ALLOWLIST,
+                                       target, &err)) {
+            fprintf(stderr, "✗ case %u: record context: %s\n", c, err->message);
+            return 1;
+        }
+        have_ctx = TRUE;
+        if (!sav_record_ctx_set_msg_budget(&rctx, budget, &err)) {
+            fprintf(stderr, "✗ sav_record_ctx_set_msg_budget: %s\n", err->message);
+            return 1;
+        }
+
+        for (uint32_t m = 0; m < tc->entries; m++) {
+            uint8_t v6[16];
+            uint32_t v4 = htonl(0x0A000000u | (c << 20) | m);
+            gboolean ok;
+
+            make_ipv6(c, m, v6);
+            if (tc->ipv6) {
+                ok = (target == SAV_TARGET_TYPE_INTERFACE_BASED)
+                    ? sav_add_ipv6_interface_prefix(&rctx, 1 + m % 4000, v6, 64, &err)
+                    : sav_add_ipv6_prefix_interface(&rctx, v6, 64, 1 + m % 4000, &err);
+            } else {
+                ok = (target == SAV_TARGET_TYPE_INTERFACE_BASED)
+                    ? sav_add_ipv4_interface_prefix(&rctx, 1 + m % 4000, v4, 32, &err)
+                    : sav_add_ipv4_prefix_interface(&rctx, v4, 32, 1 + m % 4000, &err);
+            }
+            if (!ok) {
+                fprintf(stderr, "✗ case %u: add mapping %u: %s\n", c, m, err->message);
+                return 1;
+            }
+        }
+
+        if (!sav_export_record(&rctx, fbuf, 1700000000000ULL + c, SAV_RULE_TYPE_ALLOWLIST,
+                               target, SAV_POLICY_ACTION_PERMIT, &err)) {
+            fprintf(stderr, "✗ case %u: sav_export_record: %s\n", c, err->message);
+            return 1;
+        }
+
+        uint32_t per_record = (uint32_t)((budget - SAV_RECORD_FIXED_BYTES) / case_entry_size(c));
+        tc->records_expected = (tc->entries + per_record - 1) / per_record;
+        printf("[Export] case %u: %u %s entries -> %u record(s)%s\n", c, tc->entries,
+               tc->ipv6 ? "IPv6" : "IPv4", rctx.records_exported,
+               tc->reuse ? " (reused context)" : "");
+        if (rctx.records_exported != tc->records_expected) {
+            fprintf(stderr, "✗ case %u: expected %u records\n", c, tc->records_expected);
+            return 1;
+        }
+        uint32_t staged = rctx.entry_count;
+        for (uint16_t i = 0; i < SAV_SUB_TEMPLATE_COUNT; i++) {
+            staged += rctx.lanes[i].entry_count;
+        }
+        if (staged != tc->entries) {
+            fprintf(stderr, "✗ case %u: %u entries staged after export\n", c, staged);
+            return 1;
+        }
+    }
+    if (have_ctx) {
+        sav_record_ctx_cleanup(&rctx);
+    }
+
+    sav_close_exporter(fbuf);
+    fbInfoModelFree(model);
+    return 0;
+}
+
+/* Check entry i of a view against mapping m of case c (host byte order) */
+static int check_mapping(uint32_t c, const sav_record_view_t *view, uint32_t i, uint32_t m)
+{
+    if (cases[c].ipv6) {
+        sav_ipv6_mapping_t x;
+        uint8_t v6[16];
+        make_ipv6(c, m, v6);
+        return !sav_record_view_get_ipv6(view, i, &x) ||
+               x.ingressInterface != 1 + m % 4000 ||
+               memcmp(x.sourceIPv6Prefix, v6, 16) != 0 ||
+               x.sourceIPv6PrefixLength != 64;
+    }
+
+    sav_ipv4_mapping_t x;
+    return !sav_record_view_get_ipv4(view, i, &x) ||
+           x.ingressInterface != 1 + m % 4000 ||
+           x.sourceIPv4Prefix != (0x0A000000u | (c << 20) | m) ||
+           x.sourceIPv4PrefixLength != 32;
+}
+
+static int collect_cases(void)
+{
+    GError *err = NULL;
+    sav_collector_ctx_t *ctx = sav_create_file_collector(IPFIX_FILE, &err);
+    if (!ctx) {
+        fprintf(stderr, "✗ sav_create_file_collector: %s\n", err->message);
+        return 1;
+    }
+
+    uint32_t records[CASE_COUNT] = { 0 };
+    uint32_t mappings[CASE_COUNT] = { 0 };
+    sav_record_view_t view;
+    int rc = 0;
+
+    while (rc == 0 && sav_read_record_view(ctx, &view, &err)) {
+        uint32_t c = (uint32_t)(view.timestamp_ms - 1700000000000ULL);
+        if (c >= CASE_COUNT) {
+            fprintf(stderr, "✗ unexpected record timestamp %lu\n",
+                    (unsigned long)view.timestamp_ms);
+            rc = 1;
+            break;
+        }
+
+        size_t budget = cases[c].msg_budget ? cases[c].msg_budget : SAV_DEFAULT_MSG_BUDGET;
+        if (SAV_RECORD_FIXED_BYTES + view.mapping_count * case_entry_size(c) > budget) {
+            fprintf(stderr, "✗ case %u: record with %u entries exceeds %zu bytes\n",
+                    c, view.mapping_count, budget);
+            rc = 1;
+        }
+        for (uint32_t i = 0; i < view.mapping_count && rc == 0; i++) {
+            if (check_mapping(c, &view, i, mappings[c] + i)) {
+                fprintf(stderr, "✗ case %u: mapping %u differs\n", c, mappings[c] + i);
+                rc = 1;
+            }
+        }
+        records[c]++;
+        mappings[c] += view.mapping_count;
+    }
+    if (err) {
+        fprintf(stderr, "✗ sav_read_record_view: %s\n", err->message);
+        g_clear_error(&err);
+        rc = 1;
+    }
+
+    for (uint32_t c = 0; c < CASE_COUNT && rc == 0; c++) {
+        printf("[Collect] case %u: %u record(s), %u entries\n", c, records[c], mappings[c]);
+        if (records[c] != cases[c].records_expected || mappings[c] != cases[c].entries) {
+            fprintf(stderr, "✗ case %u: expected %u records with %u entries\n",
+                    c, cases[c].records_expected, cases[c].entries);
+            rc = 1;
+        }
+    }
+
+    sav_collector_ctx_destroy(ctx);
+    return rc;
+}
+
+int main(void)
+{
+    printf("=== Exporter Split Test ===\n\n");
+
+    int rc = export_cases();
+    if (rc == 0) {
+        rc = collect_cases();
+    }
+    remove(IPFIX_FILE);
+
+    if (rc) {
+        fprintf(stderr, "\n❌ Large-list export failed\n");
+        return 1;
+    }
+    printf("\n✅ Large lists exported and split correctly\n");
+    return 0;
+}
@@ -0,0 +1,279 @@
+/**
+ * @file test_fast_decoder.c
+ * @brief Differential test: native fast-path decoder vs. libfixbuf
+ *
+ * Usage: test_fast_decoder [ipfix_file ...]
+ *
+ * Without arguments a sample file with templates 901 and 903 and list
+ * sizes from 0 to SAV_MAX_LIST_ENTRIES is generated, plus a file that
+ * withdraws all templates between two data messages. Every file is read
+ * once with sav_create_file_collector() and once with
+ * sav_create_fast_file_collector(); records and mappings must match.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include "sav_collector.h"
+#include "sav_exporter.h"
+#include "sav_fast_decoder.h"
+#include "sav_wire_writer.h"
+
+#define IPFIX_FILE "test_fast_decoder.ipfix"
+#define WITHDRAW_FILE "test_fast_decoder_withdraw.ipfix"
+#define RECORD_COUNT 500
+
+/* Write a sample file through the exporter library */
+static int write_sample_file(const char *path)
+{
+    GError *err = NULL;
+    fbInfoModel_t *model = fbInfoModelAlloc();
+    sav_init_info_model(model);
+    fbSession_t *session = fbSessionAlloc(model);
+    
+    if (!sav_add_templates(session, &err)) {
+        fprintf(stderr, "✗ sav_add_templates: %s\n", err->message);
+        return 1;
+    }
+    
+    fBuf_t *fbuf = sav_create_file_exporter(model, session, path, &err);
+    if (!fbuf) {
+        fprintf(stderr, "✗ sav_create_file_exporter: %s\n", err->message);
+        return 1;
+    }
+    
+    /* One context for all records; reset switches rule and target */
+    sav_record_ctx_t rctx;
+    if (!sav_record_ctx_init(&rctx, model, session, 0, 0, &err)) {
+        fprintf(stderr, "✗ sav_record_ctx_init: %s\n", err->message);
+        return 1;
+    }
+    
+    for (uint32_t r = 0; r < RECORD_COUNT; r++) {
+        uint8_t rule = (uint8_t)(r % 2);
+        uint8_t target = (uint8_t)((r / 2) % 2);
+        uint32_t entries = (r * 7) % (SAV_MAX_LIST_ENTRIES + 1);
+        
+        if (!sav_record_ctx_reset(&rctx, rule, target, &err)) {
+            fprintf(stderr, "✗ sav_record_ctx_reset: %s\n", err->message);
+            return 1;
+        }
+        
+        for (uint32_t m = 0; m < entries; m++) {
+            uint32_t prefix = htonl(0xC0A80000u + (r << 8) + m);
+            uint8_t plen = (uint8_t)(8 + (m % 25));
+            gboolean ok = (target == SAV_TARGET_TYPE_INTERFACE_BASED)
+                ? sav_add_ipv4_interface_prefix(&rctx, 100 + m, prefix, plen, &err)
+                : sav_add_ipv4_prefix_interface(&rctx, prefix, plen, 100 + m, &err);
+            if (!ok) {
+                fprintf(stderr, "✗ add mapping: %s\n", err->message);
+                return 1;
+            }
+        }
+        
+        if (!sav_export_record(&rctx, fbuf, 1700000000000ULL + r, rule, target,
+                               (uint8_t)(r % 4), &err)) {
+            fprintf(stderr, "✗ sav_export_record: %s\n", err->message);
+            return 1;
+        }
+    }
+    sav_record_ctx_cleanup(&rctx);
+    
+    sav_close_exporter(fbuf);
+    fbInfoModelFree(model);
+    return 0;
+}
+
+/* Write one message of the withdraw file: templates, one data record or both */
+static void write_message(FILE *fp, sav_wire_writer_t *w, gboolean templates, uint32_t r)
+{
+    sav_ipv4_mapping_t m = { 100 + r, 0xC0A80000u + r, 32 };
+    sav_parsed_record_t rec = {
+        .timestamp_ms = 1700000000000ULL + r,
+        .rule_type = SAV_RULE_TYPE_ALLOWLIST,
+        .target_type = SAV_TARGET_TYPE_INTERFACE_BASED,
+        .policy_action = SAV_POLICY_ACTION_PERMIT,
+        .sub_template_id = SAV_TMPL_IPV4_INTERFACE_PREFIX,
+        .mapping_count = 1,
+        .mappings.ipv4_mappings = &m,
+    };
+    
+    sav_wire_begin_message(w, 1700000000u);
+    if (templates) {
+        sav_wire_add_templates(w);
+    }
+    sav_wire_add_record(w, &rec);
+    fwrite(w->buf, 1, sav_wire_finish_message(w), fp);
+}
+
+/*
+ * Write a file whose second message withdraws all templates (template ID 2
+ * in a template set, RFC 7011 section 8.1). Record 1, which follows before
+ * the templates are sent again, must be dropped by both paths; records 0,
+ * 2 and 3 are readable.
+ */
+static int write_withdraw_file(const char *path)
+{
+    uint8_t buf[1024];
+    sav_wire_writer_t w;
+    FILE *fp = fopen(path, "wb");
+    
+    if (!fp) {
+        fprintf(stderr, "✗ Cannot create %s\n", path);
+        return 1;
+    }
+    sav_wire_writer_init(&w, buf, sizeof(buf), 1);
+    
+    write_message(fp, &w, TRUE, 0);
+    
+    /* Header, then a template set holding the withdrawal record (2, 0) */
+    uint8_t msg[SAV_IPFIX_MSG_HEADER_LEN + 8] = { 0 };
+    sav_write_be16(msg, SAV_IPFIX_VERSION);
+    sav_write_be16(msg + 2, sizeof(msg));
+    sav_write_be32(msg + 4, 1700000000u);
+    sav_write_be32(msg + 8, w.sequence);
+    sav_write_be32(msg + 12, 1);
+    sav_write_be16(msg + 16, SAV_IPFIX_TEMPLATE_SET_ID);
+    sav_write_be16(msg + 18, 8);
+    sav_write_be16(msg + 20, SAV_IPFIX_TEMPLATE_SET_ID);
+    sav_write_be16(msg + 22, 0);
+    fwrite(msg, 1, sizeof(msg), fp);
+    
+    write_message(fp, &w, FALSE, 1);
+    write_message(fp, &w, TRUE, 2);
+    write_message(fp, &w, FALSE, 3);
+    fclose(fp);
+    return 0;
+}
+
+/* Compare two views field by field */
+static int compare_views(
+    uint64_t                 index,
+    const sav_record_view_t  *a,
+    const sav_record_view_t  *b)
+{
+    if (a->timestamp_ms != b->timestamp_ms || a->rule_type != b->rule_type ||
+        a->target_type != b->target_type || a->policy_action != b->policy_action ||
+        a->sub_template_id != b->sub_template_id ||
+        a->mapping_count != b->mapping_count) {
+        fprintf(stderr, "✗ Record #%lu: header mismatch\n", (unsigned long)index);
+        return 1;
+    }
+    
+    gboolean is_ipv4 = (a->sub_template_id == SAV_TMPL_IPV4_INTERFACE_PREFIX ||
+                        a->sub_template_id == SAV_TMPL_IPV4_PREFIX_INTERFACE);
+    
+    for (uint32_t i = 0; i < a->mapping_count; i++) {
+        if (is_ipv4) {
+            sav_ipv4_mapping_t ma, mb;
+            if (!sav_record_view_get_ipv4(a, i, &ma) || !sav_record_view_get_ipv4(b, i, &mb) ||
+                ma.ingressInterface != mb.ingressInterface ||
+                ma.sourceIPv4Prefix != mb.sourceIPv4Prefix ||
+                ma.sourceIPv4PrefixLength != mb.sourceIPv4PrefixLength) {
+                fprintf(stderr, "✗ Record #%lu: IPv4 mapping %u mismatch\n",
+                        (unsigned long)index, i);
+                return 1;
+            }
+        } else {
+            sav_ipv6_mapping_t ma, mb;
+            if (!sav_record_view_get_ipv6(a, i, &ma) || !sav_record_view_get_ipv6(b, i, &mb) ||
+                ma.ingressInterface != mb.ingressInterface ||
+                memcmp(ma.sourceIPv6Prefix, mb.sourceIPv6Prefix, 16) != 0 ||
+                ma.sourceIPv6PrefixLength != mb.sourceIPv6PrefixLength) {
+                fprintf(stderr, "✗ Record #%lu: IPv6 mapping %u mismatch\n",
+                        (unsigned long)index, i);
+                return 1;
+            }
+        }
+    }
+    
+    return 0;
+}
+
+/* Read a file through both paths and compare every record; the record
+ * count is stored in *records */
+static int diff_file(const char *path, uint64_t *records)
+{
+    GError *err = NULL;
+    sav_collector_ctx_t *ref = sav_create_file_collector(path, &err);
+    if (!ref) {
+        fprintf(stderr, "✗ %s: %s\n", path, err->message);
+        return 1;
+    }
+    sav_collector_ctx_t *fast = sav_create_fast_file_collector(path, &err);
+    if (!fast) {
+        fprintf(stderr, "✗ %s: %s\n", path, err->message);
+        return 1;
+    }
+    
+    sav_record_view_t a, b;
+    uint64_t count = 0;
+    int rc = 0;
+    
+    for (;;) {
+        GError *err_a = NULL, *err_b = NULL;
+        gboolean got_a = sav_read_record_view(ref, &a, &err_a);
+        gboolean got_b = sav_read_record_view(fast, &b, &err_b);
+        
+        if (got_a != got_b || (err_a == NULL) != (err_b == NULL)) {
+            fprintf(stderr, "✗ %s: paths diverge after %lu records (%s / %s)\n",
+                    path, (unsigned long)count,
+                    err_a ? err_a->message : (got_a ? "record" : "EOF"),
+                    err_b ? err_b->message : (got_b ? "record" : "EOF"));
+            rc = 1;
+        }
+        if (err_a) g_error_free(err_a);
+        if (err_b) g_error_free(err_b);
+        if (rc || !got_a || !got_b) break;
+        
+        if (compare_views(++count, &a, &b) != 0) {
+            rc = 1;
+            break;
+        }
+    }
+    
+    printf("[Diff] %s: %lu records, %lu native / %lu fallback messages\n",
+           path, (unsigned long)count,
+           (unsigned long)fast->fast->native_messages,
+           (unsigned long)fast->fast->fallback_messages);
+    
+    sav_collector_ctx_destroy(ref);
+    sav_collector_ctx_destroy(fast);
+    *records = count;
+    return rc;
+}
+
+int main(int argc, char **argv)
+{
+    uint64_t records;
+    int rc = 0;
+    
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++) {
+            rc |= diff_file(argv[i], &records);
+        }
+    } else {
+        if (write_sample_file(IPFIX_FILE) != 0 || write_withdraw_file(WITHDRAW_FILE) != 0) {
+            fprintf(stderr, "\n❌ Could not write the sample files\n");
+            return 1;
+        }
+        rc = diff_file(IPFIX_FILE, &records);
+        rc |= diff_file(WITHDRAW_FILE, &records);
+        if (rc == 0 && records != 3) {
+            fprintf(stderr, "✗ %s: %lu records, expected 3 (record 1 follows a "
+                    "withdrawal of all templates)\n", WITHDRAW_FILE, (unsigned long)records);
+            rc = 1;
+        }
+        remove(IPFIX_FILE);
+        remove(WITHDRAW_FILE);
+    }
+    
+    if (rc) {
+        fprintf(stderr, "\n❌ Fast decoder differs from libfixbuf\n");
+        return 1;
+    }
+    
+    printf("\n✅ Fast decoder matches libfixbuf\n");
+    return 0;
+}
@@ -0,0 +1,336 @@
+/**
+ * @file test_json_writer.c
+ * @brief Buffered JSON writer against the original fprintf() output
+ *
+ * Formats a set of records (IPv4, IPv6 edge-case addresses, empty lists,
+ * out-of-range enum values, one list larger than the writer buffer) with
+ * the original fprintf()/inet_ntop() code and with sav_json.h, and checks
+ * that pretty output is byte-identical and compact output equals pretty
+ * output with all whitespace removed. The address formatters are also
+ * compared with inet_ntop() directly.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include "sav_json.h"
+
+#define RANDOM_ADDRS  100000
+#define BIG_LIST      5000
+
+/* The fprintf()-based writer sav_export_record_json() used to be, reading
+ * the mappings in host byte order */
+static void legacy_export_json(const sav_parsed_record_t *record, FILE *output)
+{
+    fprintf(output, "{\n");
+    fprintf(output, "  \"timestamp_ms\": %lu,\n", (unsigned long)record->timestamp_ms);
+    fprintf(output, "  \"rule_type\": %u,\n", record->rule_type);
+    fprintf(output, "  \"rule_type_name\": \"%s\",\n", sav_rule_type_name(record->rule_type));
+    fprintf(output, "  \"target_type\": %u,\n", record->target_type);
+    fprintf(output, "  \"target_type_name\": \"%s\",\n", sav_target_type_name(record->target_type));
+    fprintf(output, "  \"policy_action\": %u,\n", record->policy_action);
+    fprintf(output, "  \"policy_action_name\": \"%s\",\n", sav_policy_action_name(record->policy_action));
+    fprintf(output, "  \"sub_template_id\": %u,\n", record->sub_template_id);
+    fprintf(output, "  \"mapping_count\": %u,\n", record->mapping_count);
+    fprintf(output, "  \"mappings\": [\n");
+
+    gboolean is_ipv4 = (record->sub_template_id == SAV_TMPL_IPV4_INTERFACE_PREFIX ||
+                        record->sub_template_id == SAV_TMPL_IPV4_PREFIX_INTERFACE);
+
+    for (uint32_t i = 0; i < record->mapping_count; i++) {
+        fprintf(output, "    {\n");
+        if (is_ipv4) {
+            sav_ipv4_mapping_t *m = &record->mappings.ipv4_mappings[i];
+            struct in_addr addr;
+            addr.s_addr = htonl(m->sourceIPv4Prefix);
+            char ip_str[INET_ADDRSTRLEN];
+            inet_ntop(AF_INET, &addr, ip_str, sizeof(ip_str));
+            fprintf(output, "      \"interface\": %u,\n", m->ingressInterface);
+            fprintf(output, "      \"prefix\": \"%s\",\n", ip_str);
+            fprintf(output, "      \"prefix_length\": %u\n", m->sourceIPv4PrefixLength);
+        } else {
+            sav_ipv6_mapping_t *m = &record->mappings.ipv6_mappings[i];
+            char ip_str[INET6_ADDRSTRLEN];
+            inet_ntop(AF_INET6, m->sourceIPv6Prefix, ip_str, sizeof(ip_str));
+            fprintf(output, "      \"interface\": %u,\n", m->ingressInterface);
+            fprintf(output, "      \"prefix\": \"%s\",\n", ip_str);
+            fprintf(output, "      \"prefix_length\": %u\n", m->sourceIPv6PrefixLength);
+        }
+        fprintf(output, "    }%s\n", (i < record->mapping_count - 1) ? "," : "");
+    }
+    fprintf(output, "  ]\n");
+    fprintf(output, "}\n");
+}
+
+/* Read a whole temporary file back */
+static char* slurp(FILE *fp, size_t *len)
+{
+    fflush(fp);
+    long size = ftell(fp);
+    char *data = g_malloc((size_t)size + 1);
+    rewind(fp);
+    *len = fread(data, 1, (size_t)size, fp);
+    data[*len] = '\0';
+    fclose(fp);
+    return data;
+}
+
+static char* strip_whitespace(const char *s, size_t *len)
+{
+    char *out = g_malloc(strlen(s) + 1);
+    size_t n = 0;
+    for (; *s; s++) {
+        if (*s != ' ' && *s != '\n') out[n++] = *s;
+    }
+    out[n] = '\0';
+    *len = n;
+    return out;
+}
+
+static uint32_t rng_state = 12345;
+
+static uint32_t rng(void)
+{
+    rng_state = rng_state * 1103515245u + 12345u;
+    return rng_state >> 8;
+}
+
+/* Random IPv6 address with runs of zero groups and IPv4 tails mixed in */
+static void random_ipv6(uint8_t *a)
+{
+    for (int w = 0; w < 8; w++) {
+        uint32_t r = rng();
+        uint16_t v = (r & 3) ? 0 : (uint16_t)(rng() >> (r & 0x0c));
+        a[2 * w] = (uint8_t)(v >> 8);
+        a[2 * w + 1] = (uint8_t)v;
+    }
+    if ((rng() & 7) == 0) {
+        memset(a, 0, 10);
+        a[10] = a[11] = (rng() & 1) ? 0xff : 0x00;
+    }
+}
+
+static int test_formatters(void)
+{
+    static const uint8_t edge6[][16] = {
+        { 0 },
+        { [15] = 1 },
+        { [15] = 2 },
+        { [0] = 0x20, [1] = 0x01, [2] = 0x0d, [3] = 0xb8, [15] = 1 },
+        { [10] = 0xff, [11] = 0xff, [12] = 192, [13] = 168, [14] = 1, [15] = 1 },
+        { [12] = 10, [15] = 1 },
+        { [0] = 0xfe, [1] = 0x80, [11] = 1 },
+        { [1] = 1, [5] = 1, [9] = 1, [13] = 1 },
+        { [1] = 1, [9] = 1 },
+        { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+          0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff },
+    };
+    char ref[INET6_ADDRSTRLEN];
+    char got[INET6_ADDRSTRLEN];
+    uint8_t a[16];
+
+    for (uint32_t i = 0; i < RANDOM_ADDRS + sizeof(edge6) / sizeof(edge6[0]); i++) {
+        if (i < sizeof(edge6) / sizeof(edge6[0])) {
+            memcpy(a, edge6[i], 16);
+        } else {
+            random_ipv6(a);
+        }
+        inet_ntop(AF_INET6, a, ref, sizeof(ref));
+        *sav_json_format_ipv6(got, a) = '\0';
+        if (strcmp(ref, got) != 0) {
+            fprintf(stderr, "✗ IPv6 %s formatted as %s\n", ref, got);
+            return 1;
+        }
+
+        uint32_t v4 = rng() ^ (rng() << 16);
+        inet_ntop(AF_INET, &v4, ref, sizeof(ref));
+        *sav_json_format_ipv4(got, (const uint8_t *)&v4) = '\0';
+        if (strcmp(ref, got) != 0) {
+            fprintf(stderr, "✗ IPv4 %s formatted as %s\n", ref, got);
+            return 1;
+        }
+    }
+
+    static const uint64_t ints[] = { 0, 9, 10, 99, 100, 255, 65535, 4294967295ULL,
+                                     1700000000000ULL, UINT64_MAX };
+    for (size_t i = 0; i < sizeof(ints) / sizeof(ints[0]); i++) {
+        snprintf(ref, sizeof(ref), "%llu", (unsigned long long)ints[i]);
+        *sav_json_format_u64(got, ints[i]) = '\0';
+        if (strcmp(ref, got) != 0) {
+            fprintf(stderr, "✗ %s formatted as %s\n", ref, got);
+            return 1;
+        }
+    }
+    printf("[Format] %u IPv4/IPv6 addresses match inet_ntop()\n", RANDOM_ADDRS);
+    return 0;
+}
+
+#define RECORD_COUNT 6
+
+static void build_records(sav_parsed_record_t *records)
+{
+    static const uint16_t tmpl[RECORD_COUNT] = {
+        SAV_TMPL_IPV4_INTERFACE_PREFIX, SAV_TMPL_IPV6_INTERFACE_PREFIX,
+        SAV_TMPL_IPV4_PREFIX_INTERFACE, SAV_TMPL_IPV6_PREFIX_INTERFACE,
+        SAV_TMPL_IPV4_INTERFACE_PREFIX, SAV_TMPL_IPV6_PREFIX_INTERFACE,
+    };
+    static const uint32_t counts[RECORD_COUNT] = { 3, 40, 0, 1, BIG_LIST, BIG_LIST };
+
+    for (uint32_t r = 0; r < RECORD_COUNT; r++) {
+        sav_parsed_record_t *rec = &records[r];
+        gboolean v4 = (tmpl[r] == SAV_TMPL_IPV4_INTERFACE_PREFIX ||
+                       tmpl[r] == SAV_TMPL_IPV4_PREFIX_INTERFACE);
+
+        rec->timestamp_ms = 1700000000000ULL + r * 977;
+        rec->rule_type = (uint8_t)(r == 3 ? 7 : r & 1);
+        rec->target_type = (uint8_t)(r == 2 ? 200 : (r >> 1) & 1);
+        rec->policy_action = (uint8_t)(r == 5 ? 255 : r & 3);
+        rec->sub_template_id = tmpl[r];
+        rec->mapping_count = counts[r];
+        rec->mappings.ipv4_mappings = NULL;
+
+        if (v4) {
+            sav_ipv4_mapping_t *m = g_new0(sav_ipv4_mapping_t, counts[r] ? counts[r] : 1);
+            for (uint32_t i = 0; i < counts[r]; i++) {
+                m[i].ingressInterface = rng();
+                m[i].sourceIPv4Prefix = rng() ^ (rng() << 16);
+                m[i].sourceIPv4PrefixLength = (uint8_t)(rng() % 33);
+            }
+            rec->mappings.ipv4_mappings = m;
+        } else {
+            sav_ipv6_mapping_t *m = g_new0(sav_ipv6_mapping_t, counts[r] ? counts[r] : 1);
+            for (uint32_t i = 0; i < counts[r]; i++) {
+                m[i].ingressInterface = rng() % 4096;
+                random_ipv6(m[i].sourceIPv6Prefix);
+                m[i].sourceIPv6PrefixLength = (uint8_t)(rng() % 129);
+            }
+            rec->mappings.ipv6_mappings = m;
+        }
+    }
+}
+
+/* How write_output() formats the records */
+typedef enum output_mode {
+    OUT_LEGACY_ARRAY,           /* sav_dump -j layout, fprintf() */
+    OUT_LEGACY_SINGLES,         /* One object after another, fprintf() */
+    OUT_PRETTY_ARRAY,           /* sav_json_writer_t, SAV_JSON_PRETTY */
+    OUT_COMPACT_ARRAY,          /* sav_json_writer_t, SAV_JSON_COMPACT */
+    OUT_SINGLES                 /* sav_export_record_json() */
+} output_mode_t;
+
+static char* write_output(const sav_parsed_record_t *records, output_mode_t mode, size_t *len)
+{
+    FILE *fp = tmpfile();
+    if (!fp) return NULL;
+
+    if (mode == OUT_LEGACY_ARRAY) {
+        fprintf(fp, "[\n");
+        for (uint32_t r = 0; r < RECORD_COUNT; r++) {
+            if (r) fprintf(fp, ",\n");
+            legacy_export_json(&records[r], fp);
+        }
+        fprintf(fp, "\n]\n");
+    } else if (mode == OUT_LEGACY_SINGLES || mode == OUT_SINGLES) {
+        for (uint32_t r = 0; r < RECORD_COUNT; r++) {
+            if (mode == OUT_SINGLES) {
+                sav_export_record_json(&records[r], fp);
+            } else {
+                legacy_export_json(&records[r], fp);
+            }
+        }
+    } else {
+        GError *err = NULL;
+        sav_json_writer_t writer;
+
+        /* Smallest buffer, so the big lists flush many times */
+        sav_json_writer_init(&writer, fp, mode == OUT_COMPACT_ARRAY ? SAV_JSON_COMPACT
+                                                                     : SAV_JSON_PRETTY, 1);
+        sav_json_begin_array(&writer);
+        for (uint32_t r = 0; r < RECORD_COUNT; r++) {
+            sav_json_write_record(&writer, &records[r]);
+        }
+        sav_json_end_array(&writer);
+        if (!sav_json_writer_flush(&writer, &err)) {
+            fprintf(stderr, "✗ sav_json_writer_flush: %s\n", err->message);
+            g_error_free(err);
+        }
+        sav_json_writer_destroy(&writer);
+    }
+    return slurp(fp, len);
+}
+
+static int same(const char *what, const char *ref, size_t ref_len,
+                const char *got, size_t got_len)
+{
+    if (ref_len == got_len && memcmp(ref, got, ref_len) == 0) {
+        return 1;
+    }
+    size_t i = 0;
+    while (i < ref_len && i < got_len && ref[i] == got[i]) i++;
+    fprintf(stderr, "✗ %s output differs at byte %zu of %zu\n", what, i, ref_len);
+    return 0;
+}
+
+static int test_records(void)
+{
+    sav_parsed_record_t records[RECORD_COUNT];
+    size_t ref_len, pretty_len, compact_len, ref1_len, singles_len;
+    size_t stripped_len, ref_stripped_len;
+    int rc = 0;
+
+    build_records(records);
+
+    char *ref = write_output(records, OUT_LEGACY_ARRAY, &ref_len);
+    char *pretty = write_output(records, OUT_PRETTY_ARRAY, &pretty_len);
+    char *compact = write_output(records, OUT_COMPACT_ARRAY, &compact_len);
+    char *ref1 = write_output(records, OUT_LEGACY_SINGLES, &ref1_len);
+    char *singles = write_output(records, OUT_SINGLES, &singles_len);
+    if (!ref || !pretty || !compact || !ref1 || !singles) {
+        fprintf(stderr, "✗ tmpfile() failed\n");
+        return 1;
+    }
+
+    if (same("pretty", ref, ref_len, pretty, pretty_len) &&
+        same("sav_export_record_json", ref1, ref1_len, singles, singles_len)) {
+        printf("[Pretty] %zu bytes, identical to the fprintf() output\n", pretty_len);
+    } else {
+        rc = 1;
+    }
+
+    /* One line, and the pretty output minus its whitespace */
+    char *stripped = strip_whitespace(compact, &stripped_len);
+    char *ref_stripped = strip_whitespace(ref, &ref_stripped_len);
+    if (compact[compact_len - 1] != '\n' || memchr(compact, '\n', compact_len - 1) ||
+        !same("compact", ref_stripped, ref_stripped_len, stripped, stripped_len)) {
+        fprintf(stderr, "✗ compact output is not the pretty output without whitespace\n");
+        rc = 1;
+    } else {
+        printf("[Compact] %zu bytes (pretty %zu)\n", compact_len, pretty_len);
+    }
+
+    g_free(ref);
+    g_free(pretty);
+    g_free(compact);
+    g_free(ref1);
+    g_free(singles);
+    g_free(stripped);
+    g_free(ref_stripped);
+    for (uint32_t r = 0; r < RECORD_COUNT; r++) {
+        sav_free_parsed_record(&records[r]);
+    }
+    return rc;
+}
+
+int main(void)
+{
+    printf("=== JSON Writer Test ===\n\n");
+
+    if (test_formatters() != 0 || test_records() != 0) {
+        fprintf(stderr, "\n❌ JSON writer test failed\n");
+        return 1;
+    }
+
+    printf("\n✅ Buffered JSON writer matches the original output\n");
+    return 0;
+}
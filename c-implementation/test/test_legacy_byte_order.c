@@ -0,0 +1,242 @@
+/**
+ * @file test_legacy_byte_order.c
+ * @brief Regression test: reading files of a pre-fix exporter
+ *
+ * Before mapping fields were kept in host byte order, the exporter wrote
+ * ingressInterface and sourceIPv4Prefix byte-swapped on little-endian
+ * hosts. This test writes such a legacy file next to a current one with
+ * the same content and checks that
+ *  - with sav_collector_set_legacy_byte_order() the legacy file reads back
+ *    the original values on the libfixbuf and the native fast path, and
+ *    its JSON output is byte-identical to that of the current file;
+ *  - without the option the swapped values are returned unchanged, so old
+ *    archives are never silently "fixed" twice.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sav_collector.h"
+#include "sav_wire_writer.h"
+
+#define CURRENT_FILE "test_legacy_current.ipfix"
+#define LEGACY_FILE  "test_legacy_old.ipfix"
+#define MAPPINGS     3
+
+static sav_ipv4_mapping_t ipv4_maps[MAPPINGS] = {
+    { 1,      0x0A000000u, 8 },
+    { 17,     0xC0A80100u, 24 },
+    { 70000,  0xAC100000u, 12 },
+};
+
+static sav_ipv6_mapping_t ipv6_maps[MAPPINGS] = {
+    { 2,      { 0x20, 0x01, 0x0d, 0xb8 }, 32 },
+    { 300,    { 0x20, 0x01, 0x0d, 0xb8, 0x00, 0x01 }, 48 },
+    { 123456, { 0xfe, 0x80 }, 10 },
+};
+
+/* The three records of both files: 901, 903 and 902 */
+static void build_records(sav_parsed_record_t records[3])
+{
+    static const uint16_t tmpl[3] = {
+        SAV_TMPL_IPV4_INTERFACE_PREFIX,
+        SAV_TMPL_IPV4_PREFIX_INTERFACE,
+        SAV_TMPL_IPV6_INTERFACE_PREFIX,
+    };
+
+    for (int r = 0; r < 3; r++) {
+        memset(&records[r], 0, sizeof(records[r]));
+        records[r].timestamp_ms = 1700000000000ULL + (uint64_t)r;
+        records[r].rule_type = SAV_RULE_TYPE_ALLOWLIST;
+        records[r].target_type = (tmpl[r] == SAV_TMPL_IPV4_PREFIX_INTERFACE)
+            ? SAV_TARGET_TYPE_PREFIX_BASED : SAV_TARGET_TYPE_INTERFACE_BASED;
+        records[r].policy_action = SAV_POLICY_ACTION_DISCARD;
+        records[r].sub_template_id = tmpl[r];
+        records[r].mapping_count = MAPPINGS;
+        if (tmpl[r] == SAV_TMPL_IPV6_INTERFACE_PREFIX) {
+            records[r].mappings.ipv6_mappings = ipv6_maps;
+        } else {
+            records[r].mappings.ipv4_mappings = ipv4_maps;
+        }
+    }
+}
+
+/* Write the records, byte-swapped the way the old exporter did if legacy */
+static int write_file(const char *path, gboolean legacy)
+{
+    sav_parsed_record_t records[3];
+    sav_ipv4_mapping_t v4[MAPPINGS];
+    sav_ipv6_mapping_t v6[MAPPINGS];
+    uint8_t buf[4096];
+    sav_wire_writer_t w;
+
+    build_records(records);
+    if (legacy) {
+        memcpy(v4, ipv4_maps, sizeof(v4));
+        memcpy(v6, ipv6_maps, sizeof(v6));
+        for (int i = 0; i < MAPPINGS; i++) {
+            v4[i].ingressInterface = GUINT32_SWAP_LE_BE(v4[i].ingressInterface);
+            v4[i].sourceIPv4Prefix = GUINT32_SWAP_LE_BE(v4[i].sourceIPv4Prefix);
+            v6[i].ingressInterface = GUINT32_SWAP_LE_BE(v6[i].ingressInterface);
+        }
+        records[0].mappings.ipv4_mappings = v4;
+        records[1].mappings.ipv4_mappings = v4;
+        records[2].mappings.ipv6_mappings = v6;
+    }
+
+    FILE *fp = fopen(path, "wb");
+    if (!fp) {
+        fprintf(stderr, "✗ Cannot create %s\n", path);
+        return 1;
+    }
+
+    sav_wire_writer_init(&w, buf, sizeof(buf), 1);
+    sav_wire_begin_message(&w, 1700000000u);
+    gboolean ok = sav_wire_add_templates(&w);
+    for (int r = 0; r < 3 && ok; r++) {
+        ok = sav_wire_add_record(&w, &records[r]);
+    }
+    size_t len = sav_wire_finish_message(&w);
+    if (!ok || fwrite(buf, 1, len, fp) != len) {
+        fprintf(stderr, "✗ Cannot write %s\n", path);
+        fclose(fp);
+        return 1;
+    }
+    fclose(fp);
+    return 0;
+}
+
+/*
+ * Read a file and compare every mapping with the originals, either as-is
+ * (expect_swapped FALSE) or byte-swapped. The JSON of all records is
+ * returned in *json (caller frees).
+ */
+static int read_file(
+    const char  *path,
+    gboolean    fast,
+    gboolean    legacy,
+    gboolean    expect_swapped,
+    char        **json)
+{
+    GError *err = NULL;
+    sav_collector_ctx_t *ctx = fast
+        ? sav_create_fast_file_collector(path, &err)
+        : sav_create_file_collector(path, &err);
+    if (!ctx) {
+        fprintf(stderr, "✗ %s: %s\n", path, err->message);
+        g_error_free(err);
+        return 1;
+    }
+    if (!sav_collector_set_legacy_byte_order(ctx, legacy, &err)) {
+        fprintf(stderr, "✗ sav_collector_set_legacy_byte_order: %s\n", err->message);
+        g_error_free(err);
+        sav_close_collector(ctx);
+        return 1;
+    }
+
+    size_t json_len = 0;
+    FILE *out = open_memstream(json, &json_len);
+    sav_parsed_record_t expected[3];
+    sav_parsed_record_t record;
+    int n = 0;
+    int rc = 0;
+
+    build_records(expected);
+    while (rc == 0 && sav_read_record(ctx, &record, &err)) {
+        if (n >= 3 || record.sub_template_id != expected[n].sub_template_id ||
+            record.mapping_count != MAPPINGS) {
+            fprintf(stderr, "✗ %s: unexpected record #%d\n", path, n);
+            rc = 1;
+        }
+        for (uint32_t i = 0; rc == 0 && i < MAPPINGS; i++) {
+            if (record.sub_template_id == SAV_TMPL_IPV6_INTERFACE_PREFIX) {
+                const sav_ipv6_mapping_t *m = &record.mappings.ipv6_mappings[i];
+                uint32_t ifc = expect_swapped
+                    ? GUINT32_SWAP_LE_BE(ipv6_maps[i].ingressInterface)
+                    : ipv6_maps[i].ingressInterface;
+                if (m->ingressInterface != ifc ||
+                    memcmp(m->sourceIPv6Prefix, ipv6_maps[i].sourceIPv6Prefix, 16) != 0 ||
+                    m->sourceIPv6PrefixLength != ipv6_maps[i].sourceIPv6PrefixLength) {
+                    rc = 1;
+                }
+            } else {
+                const sav_ipv4_mapping_t *m = &record.mappings.ipv4_mappings[i];
+                uint32_t ifc = ipv4_maps[i].ingressInterface;
+                uint32_t prefix = ipv4_maps[i].sourceIPv4Prefix;
+                if (expect_swapped) {
+                    ifc = GUINT32_SWAP_LE_BE(ifc);
+                    prefix = GUINT32_SWAP_LE_BE(prefix);
+                }
+                if (m->ingressInterface != ifc || m->sourceIPv4Prefix != prefix ||
+                    m->sourceIPv4PrefixLength != ipv4_maps[i].sourceIPv4PrefixLength) {
+                    rc = 1;
+                }
+            }
+            if (rc) {
+                fprintf(stderr, "✗ %s: record #%d mapping %u differs\n", path, n, i);
+            }
+        }
+        sav_export_record_json(&record, out);
+        sav_free_parsed_record(&record);
+        n++;
+    }
+    if (err) {
+        fprintf(stderr, "✗ %s: %s\n", path, err->message);
+        g_clear_error(&err);
+        rc = 1;
+    }
+    if (rc == 0 && n != 3) {
+        fprintf(stderr, "✗ %s: %d records, expected 3\n", path, n);
+        rc = 1;
+    }
+
+    fclose(out);
+    sav_close_collector(ctx);
+    return rc;
+}
+
+int main(void)
+{
+    int rc = 0;
+
+    printf("=== Legacy byte-order files ===\n\n");
+
+    if (write_file(CURRENT_FILE, FALSE) != 0 || write_file(LEGACY_FILE, TRUE) != 0) {
+        return 1;
+    }
+
+    for (int fast = 0; fast <= 1; fast++) {
+        const char *path_name = fast ? "fast path" : "libfixbuf";
+        char *current = NULL, *legacy = NULL, *raw = NULL;
+
+        int r = read_file(CURRENT_FILE, fast, FALSE, FALSE, &current);
+        r |= read_file(LEGACY_FILE, fast, TRUE, FALSE, &legacy);
+        r |= read_file(LEGACY_FILE, fast, FALSE, TRUE, &raw);
+        if (r == 0 && strcmp(current, legacy) != 0) {
+            fprintf(stderr, "✗ %s: JSON of the legacy file differs\n", path_name);
+            r = 1;
+        }
+        if (r == 0 && strcmp(current, raw) == 0) {
+            fprintf(stderr, "✗ %s: legacy file read without the option matches\n",
+                    path_name);
+            r = 1;
+        }
+        printf("[%s] %s\n", r ? "FAIL" : "OK", path_name);
+
+        free(current);
+        free(legacy);
+        free(raw);
+        rc |= r;
+    }
+
+    remove(CURRENT_FILE);
+    remove(LEGACY_FILE);
+
+    if (rc) {
+        printf("\n❌ Legacy byte-order test failed\n");
+        return 1;
+    }
+    printf("\n✅ Legacy files read back with the original values\n");
+    return 0;
+}
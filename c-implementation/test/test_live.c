@@ -0,0 +1,452 @@
+/**
+ * @file test_live.c
+ * @brief Published snapshots: checks against a full build, churn, reclamation
+ *
+ * Fills a sav_live_t with random nested IPv4 and IPv6 mappings of every
+ * length (so every partition level is used) and compares lookups and
+ * checks in all modes against sav_lpm4/sav_lpm6 tables built from the same
+ * rule table, after the first publish and after rounds of removals, new
+ * mappings and rule changes. Checks that a snapshot held by a reader
+ * outlives later publishes and is freed once released, and runs a lookup
+ * thread against a writer that moves a marker prefix to a new interface
+ * in every version: each snapshot must show the marker where its version
+ * says, never a mix.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include "sav_live.h"
+
+#define V4_ENTRIES   3000
+#define V6_ENTRIES   1500
+#define PROBES       20000
+#define ROUNDS       4
+#define VERSIONS     300
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do {                              \
+    if (!(cond)) {                                         \
+        fprintf(stderr, "✗ " __VA_ARGS__);                  \
+        fprintf(stderr, "\n");                             \
+        failures++;                                        \
+    }                                                      \
+} while (0)
+
+static const char *mode_names[] = { "strict", "feasible", "loose" };
+
+static sav_state_entry_t entries[V4_ENTRIES + V6_ENTRIES + ROUNDS * 500];
+static size_t n_entries = 0;
+
+static uint32_t rnd32(void)
+{
+    return ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+}
+
+static uint32_t rnd_iface(void)
+{
+    return rand() % 8 ? 1 + (uint32_t)(rand() % 200) : 70000 + (uint32_t)(rand() % 16) * 4096;
+}
+
+static void clear_host_bits(uint8_t *prefix, uint8_t len, int bytes)
+{
+    for (int i = 0; i < bytes; i++) {
+        int keep = (int)len - 8 * i;
+        prefix[i] &= keep >= 8 ? 0xFF : keep <= 0 ? 0 : (uint8_t)(0xFF << (8 - keep));
+    }
+}
+
+/* A new prefix, usually nested in (or equal to) an earlier one of its family */
+static void random_entry(sav_state_entry_t *e, uint8_t family)
+{
+    int bytes = family == 4 ? 4 : 16, bits = 8 * bytes;
+    const sav_state_entry_t *outer = NULL;
+
+    for (int tries = 0; n_entries && tries < 8 && !outer; tries++) {
+        const sav_state_entry_t *c = &entries[rand() % n_entries];
+        if (c->family == family && rand() % 3) outer = c;
+    }
+
+    memset(e, 0, sizeof(*e));
+    e->family = family;
+    if (outer) {
+        uint32_t len = outer->prefix_len + (uint32_t)(rand() % 20);
+        e->prefix_len = (uint8_t)MIN((uint32_t)bits, len);
+        memcpy(e->prefix, outer->prefix, 16);
+        for (int i = outer->prefix_len / 8; i < bytes; i++) e->prefix[i] |= (uint8_t)rand();
+    } else {
+        e->prefix_len = (uint8_t)(rand() % (bits + 1));
+        for (int i = 0; i < bytes; i++) e->prefix[i] = (uint8_t)rand();
+        /* Keep most IPv6 prefixes under a few /16s so partitions fill up */
+        if (family == 6 && rand() % 4) {
+            e->prefix[0] = 0x20;
+            e->prefix[1] = (uint8_t)(rand() % 3);
+        }
+    }
+    clear_host_bits(e->prefix, e->prefix_len, bytes);
+    e->interface = rnd_iface();
+    e->target_type = (uint8_t)(rand() % 2);
+    e->rule_type = rand() % 4 ? SAV_RULE_TYPE_ALLOWLIST : SAV_RULE_TYPE_BLOCKLIST;
+    e->policy_action = (uint8_t)(rand() % 4);
+    e->updated_ms = 1000;
+}
+
+static void add_entries(sav_live_t *live, size_t n4, size_t n6)
+{
+    for (size_t i = 0; i < n4 + n6; i++) {
+        sav_state_entry_t *e = &entries[n_entries];
+        random_entry(e, i < n4 ? 4 : 6);
+        if (sav_live_upsert(live, e)) {
+            n_entries++;
+            continue;
+        }
+        /* Same key as an earlier entry: that one now has the new value */
+        for (size_t j = 0; j < n_entries; j++) {
+            if (entries[j].family == e->family && entries[j].prefix_len == e->prefix_len &&
+                entries[j].interface == e->interface &&
+                entries[j].target_type == e->target_type &&
+                memcmp(entries[j].prefix, e->prefix, 16) == 0) {
+                entries[j] = *e;
+            }
+        }
+    }
+}
+
+/* Address inside a random entry's prefix (sometimes anywhere) */
+static void probe_addr(uint8_t family, uint8_t *addr)
+{
+    const sav_state_entry_t *e = &entries[rand() % n_entries];
+    int bytes = family == 4 ? 4 : 16;
+
+    for (int i = 0; i < bytes; i++) addr[i] = (uint8_t)rand();
+    if (e->family != family || rand() % 8 == 0) {
+        return;
+    }
+    for (int i = 0; i < bytes; i++) {
+        int keep = (int)e->prefix_len - 8 * i;
+        uint8_t mask = keep >= 8 ? 0xFF : keep <= 0 ? 0 : (uint8_t)(0xFF << (8 - keep));
+        addr[i] = (uint8_t)((e->prefix[i] & mask) | (addr[i] & ~mask));
+    }
+}
+
+static gboolean same_list(const uint32_t *a, uint32_t na, const uint32_t *b, uint32_t nb)
+{
+    return na == nb && (na == 0 || memcmp(a, b, na * sizeof(uint32_t)) == 0);
+}
+
+/* Lookups and checks of the current snapshot against full builds */
+static void compare_with_lpm(sav_live_t *live, sav_live_reader_t *reader, const char *label)
+{
+    sav_lpm4_t *lpm4 = sav_lpm4_new();
+    sav_lpm6_t *lpm6 = sav_lpm6_new();
+    GError *err = NULL;
+    int before = failures;
+
+    sav_lpm4_set_feasible(lpm4, TRUE);
+    sav_lpm6_set_feasible(lpm6, TRUE);
+    sav_lpm4_add_state(lpm4, sav_live_state(live));
+    sav_lpm6_add_state(lpm6, sav_live_state(live));
+    CHECK(sav_lpm4_build(lpm4, &err) && sav_lpm6_build(lpm6, &err), "%s: reference build", label);
+
+    const sav_live_snapshot_t *snap = sav_live_read_begin(reader);
+    for (uint32_t i = 0; i < PROBES && failures - before < 10; i++) {
+        uint8_t family = i % 2 ? 6 : 4;
+        uint8_t a[16];
+        uint32_t iface = rand() % 4 ? entries[rand() % n_entries].interface : rnd_iface();
+        uint32_t a4;
+        const sav_lpm_leaf_t *got, *want;
+
+        probe_addr(family, a);
+        memcpy(&a4, a, 4);
+        a4 = ntohl(a4);
+        got = family == 4 ? sav_live_lookup4(snap, a4) : sav_live_lookup6(snap, a);
+        want = family == 4 ? sav_lpm4_leaf(lpm4, sav_lpm4_lookup(lpm4, a4))
+                           : sav_lpm6_leaf(lpm6, sav_lpm6_lookup(lpm6, a));
+        CHECK(same_list(got->allow, got->n_allow, want->allow, want->n_allow) &&
+              same_list(got->block, got->n_block, want->block, want->n_block) &&
+              got->allow_action == want->allow_action && got->block_action == want->block_action,
+              "%s: IPv%u probe %u: leaf differs (%u/%u allow, %u/%u block)", label, family, i,
+              got->n_allow, want->n_allow, got->n_block, want->n_block);
+
+        for (int mode = SAV_URPF_STRICT; mode <= SAV_URPF_LOOSE; mode++) {
+            gboolean live_ok = family == 4 ? sav_live_check4(snap, a4, iface, (sav_urpf_mode_t)mode)
+                                           : sav_live_check6(snap, a, iface, (sav_urpf_mode_t)mode);
+            gboolean lpm_ok = family == 4 ? sav_lpm4_check(lpm4, a4, iface, (sav_urpf_mode_t)mode)
+                                          : sav_lpm6_check(lpm6, a, iface, (sav_urpf_mode_t)mode);
+            CHECK(live_ok == lpm_ok, "%s: IPv%u probe %u on %u %s: %d, full build %d", label,
+                  family, i, iface, mode_names[mode], live_ok, lpm_ok);
+        }
+    }
+    sav_live_read_end(reader);
+
+    sav_lpm4_free(lpm4);
+    sav_lpm6_free(lpm6);
+}
+
+static void test_churn(void)
+{
+    sav_live_t *live = sav_live_new();
+    sav_live_reader_t *reader = sav_live_reader_new(live);
+    sav_live_stats_t stats;
+
+    /* The empty snapshot answers before the first publish */
+    const sav_live_snapshot_t *snap = sav_live_read_begin(reader);
+    CHECK(sav_live_snapshot_version(snap) == 0, "empty version");
+    CHECK(sav_live_lookup4(snap, 0x0A000001u)->n_allow == 0, "empty lookup");
+    CHECK(!sav_live_check4(snap, 0x0A000001u, 1, SAV_URPF_LOOSE), "empty check");
+    sav_live_read_end(reader);
+
+    add_entries(live, V4_ENTRIES, V6_ENTRIES);
+    CHECK(sav_live_publish(live) == 1, "first publish is version 1");
+    CHECK(sav_live_publish(live) == 1, "publish without changes keeps the version");
+    sav_live_get_stats(live, &stats);
+    printf("[Churn] version %lu: %lu partitions, %u interfaces, %zu bytes\n",
+           (unsigned long)stats.version, (unsigned long)stats.partitions, stats.interfaces,
+           stats.memory_bytes);
+    compare_with_lpm(live, reader, "initial");
+
+    for (int round = 0; round < ROUNDS; round++) {
+        uint64_t rebuilt = stats.rebuilt;
+        uint64_t partitions = stats.partitions;
+
+        /* Remove, add and change a few hundred entries */
+        for (int k = 0; k < 200; k++) {
+            size_t i = (size_t)rand() % n_entries;
+            sav_live_remove(live, &entries[i]);
+            entries[i] = entries[--n_entries];
+        }
+        add_entries(live, 300, 200);
+        for (int k = 0; k < 200; k++) {
+            sav_state_entry_t *e = &entries[rand() % n_entries];
+            e->rule_type ^= 1;
+            sav_live_upsert(live, e);
+        }
+        sav_live_publish(live);
+        sav_live_get_stats(live, &stats);
+        printf("[Churn] round %d: version %lu, %lu of %lu partitions rebuilt\n", round,
+               (unsigned long)stats.version, (unsigned long)(stats.rebuilt - rebuilt),
+               (unsigned long)partitions);
+        CHECK(stats.rebuilt - rebuilt < partitions, "round %d rebuilt every partition", round);
+        compare_with_lpm(live, reader, "churn");
+    }
+
+    /* Refreshing entries without changing them rebuilds nothing */
+    for (size_t i = 0; i < n_entries; i++) {
+        entries[i].updated_ms++;
+        CHECK(!sav_live_upsert(live, &entries[i]), "refresh %zu added an entry", i);
+    }
+    uint64_t version = stats.version;
+    CHECK(sav_live_publish(live) == version, "refresh made a new version");
+
+    /* Removing everything leaves an empty table */
+    while (n_entries) {
+        CHECK(sav_live_remove(live, &entries[--n_entries]), "remove entry %zu", n_entries);
+    }
+    sav_live_publish(live);
+    sav_live_get_stats(live, &stats);
+    CHECK(stats.partitions == 0, "%lu partitions left", (unsigned long)stats.partitions);
+    CHECK(stats.retired == 0 && stats.reclaimed == stats.published,
+          "%lu snapshots retired, %lu reclaimed of %lu", (unsigned long)stats.retired,
+          (unsigned long)stats.reclaimed, (unsigned long)stats.published);
+
+    sav_live_reader_free(reader);
+    sav_live_free(live);
+}
+
+static void ipv4_entry(sav_state_entry_t *e, uint32_t prefix, uint8_t len, uint32_t iface)
+{
+    uint32_t be = htonl(prefix);
+    memset(e, 0, sizeof(*e));
+    e->family = 4;
+    e->prefix_len = len;
+    e->interface = iface;
+    e->rule_type = SAV_RULE_TYPE_ALLOWLIST;
+    memcpy(e->prefix, &be, 4);
+}
+
+static void test_held_snapshot(void)
+{
+    sav_live_t *live = sav_live_new();
+    sav_live_reader_t *holder = sav_live_reader_new(live);
+    sav_live_reader_t *other = sav_live_reader_new(live);
+    sav_state_entry_t e;
+    sav_live_stats_t stats;
+
+    ipv4_entry(&e, 0xC6336400u, 24, 7);         /* 198.51.100.0/24 on 7 */
+    sav_live_upsert(live, &e);
+    sav_live_publish(live);
+
+    const sav_live_snapshot_t *held = sav_live_read_begin(holder);
+    sav_live_remove(live, &e);
+    ipv4_entry(&e, 0xC6336400u, 24, 8);
+    sav_live_upsert(live, &e);
+    sav_live_publish(live);
+    ipv4_entry(&e, 0xC6336480u, 25, 9);
+    sav_live_upsert(live, &e);
+    sav_live_publish(live);
+
+    const sav_live_snapshot_t *now = sav_live_read_begin(other);
+    CHECK(sav_live_snapshot_version(held) == 1 && sav_live_snapshot_version(now) == 3,
+          "versions %lu and %lu", (unsigned long)sav_live_snapshot_version(held),
+          (unsigned long)sav_live_snapshot_version(now));
+    CHECK(sav_live_check4(held, 0xC6336481u, 7, SAV_URPF_STRICT), "held snapshot changed");
+    CHECK(!sav_live_check4(held, 0xC6336481u, 9, SAV_URPF_STRICT), "later mapping in held snapshot");
+    CHECK(sav_live_check4(now, 0xC6336481u, 9, SAV_URPF_STRICT), "/25 on 9 in current");
+    CHECK(sav_live_check4(now, 0xC6336481u, 8, SAV_URPF_FEASIBLE), "/24 on 8 feasible");
+    CHECK(!sav_live_check4(now, 0xC6336481u, 8, SAV_URPF_STRICT), "/24 on 8 strict");
+    CHECK(!sav_live_check4(now, 0xC6336401u, 7, SAV_URPF_STRICT), "old interface in current");
+    sav_live_read_end(other);
+
+    /* The empty snapshot went before the holder entered; versions 1 and 2 wait */
+    CHECK(sav_live_reclaim(live) == 2, "both replaced snapshots wait for the holder");
+    sav_live_read_end(holder);
+    CHECK(sav_live_reclaim(live) == 0, "released snapshots freed");
+    sav_live_get_stats(live, &stats);
+    CHECK(stats.readers == 2 && stats.reclaimed == 3, "%u readers, %lu reclaimed",
+          stats.readers, (unsigned long)stats.reclaimed);
+    printf("[Held] held version 1 across two publishes, freed on release\n");
+
+    sav_live_reader_free(holder);
+    sav_live_reader_free(other);
+    sav_live_free(live);
+}
+
+static void test_record(void)
+{
+    sav_live_t *live = sav_live_new();
+    sav_live_reader_t *reader = sav_live_reader_new(live);
+    sav_ipv4_mapping_t m[3];
+    sav_parsed_record_t rec;
+    sav_live_stats_t stats;
+    GError *err = NULL;
+
+    m[0].ingressInterface = 3;
+    m[0].sourceIPv4Prefix = 0xCB007100u;          /* 203.0.113.0/24 */
+    m[0].sourceIPv4PrefixLength = 24;
+    m[1] = m[0];
+    m[1].sourceIPv4Prefix |= 1;                    /* Host bits set: rejected */
+    m[2] = m[0];
+    m[2].ingressInterface = 4;
+
+    memset(&rec, 0, sizeof(rec));
+    rec.timestamp_ms = 5000;
+    rec.rule_type = SAV_RULE_TYPE_ALLOWLIST;
+    rec.target_type = SAV_TARGET_TYPE_INTERFACE_BASED;
+    rec.policy_action = SAV_POLICY_ACTION_PERMIT;
+    rec.sub_template_id = SAV_TMPL_IPV4_INTERFACE_PREFIX;
+    rec.mapping_count = 3;
+    rec.mappings.ipv4_mappings = m;
+    CHECK(sav_live_apply_record(live, &rec, &err), "apply record");
+    sav_live_publish(live);
+
+    const sav_live_snapshot_t *snap = sav_live_read_begin(reader);
+    CHECK(sav_live_check4(snap, 0xCB007105u, 3, SAV_URPF_STRICT), "record on 3");
+    CHECK(sav_live_check4(snap, 0xCB007105u, 4, SAV_URPF_STRICT), "record on 4");
+    CHECK(sav_live_lookup4(snap, 0xCB007105u)->n_allow == 2, "record leaf");
+    sav_live_read_end(reader);
+
+    sav_live_get_stats(live, &stats);
+    CHECK(stats.records == 1 && stats.rejected == 1, "%lu records, %lu rejected",
+          (unsigned long)stats.records, (unsigned long)stats.rejected);
+
+    sav_live_reader_free(reader);
+    sav_live_free(live);
+}
+
+/* ---------------------------------------------------------------- threads */
+
+#define MARKER 0xC0000200u                         /* 192.0.2.0/24 */
+
+typedef struct {
+    sav_live_t *live;
+    int        stop;
+    uint64_t   sections;
+    uint64_t   torn;
+} reader_ctx_t;
+
+static void *reader_main(void *data)
+{
+    reader_ctx_t *ctx = data;
+    sav_live_reader_t *reader = sav_live_reader_new(ctx->live);
+    uint64_t sections = 0, torn = 0;
+    uint32_t x = 0x9E3779B9u;
+
+    while (!__atomic_load_n(&ctx->stop, __ATOMIC_ACQUIRE)) {
+        const sav_live_snapshot_t *snap = sav_live_read_begin(reader);
+        uint32_t v = (uint32_t)sav_live_snapshot_version(snap);
+        if (v > 0) {
+            torn += !sav_live_check4(snap, MARKER | 1, v, SAV_URPF_STRICT);
+            torn += sav_live_check4(snap, MARKER | 1, v + 1, SAV_URPF_STRICT);
+            torn += v > 1 && sav_live_check4(snap, MARKER | 1, v - 1, SAV_URPF_STRICT);
+        }
+        for (int i = 0; i < 32; i++) {
+            x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+            sav_live_check4(snap, 0x0A000000u | (x & 0xFFFFFF), 1 + i, SAV_URPF_FEASIBLE);
+        }
+        sav_live_read_end(reader);
+        sections++;
+    }
+    sav_live_reader_free(reader);
+    __atomic_add_fetch(&ctx->sections, sections, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&ctx->torn, torn, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+static void test_threads(void)
+{
+    reader_ctx_t ctx = { sav_live_new(), 0, 0, 0 };
+    sav_state_entry_t e;
+    GThread *threads[2];
+
+    for (int t = 0; t < 2; t++) threads[t] = g_thread_new("live-reader", reader_main, &ctx);
+
+    for (uint32_t v = 1; v <= VERSIONS; v++) {
+        if (v > 1) {
+            ipv4_entry(&e, MARKER, 24, v - 1);
+            sav_live_remove(ctx.live, &e);
+        }
+        ipv4_entry(&e, MARKER, 24, v);
+        sav_live_upsert(ctx.live, &e);
+        /* Some churn elsewhere so that partitions are freed too */
+        for (int k = 0; k < 20; k++) {
+            ipv4_entry(&e, 0x0A000000u | (rnd32() & 0xFFFF00), 24, 1 + rand() % 32);
+            e.rule_type = (uint8_t)(rand() % 2);
+            sav_live_upsert(ctx.live, &e);
+        }
+        CHECK(sav_live_publish(ctx.live) == v, "publish %u", v);
+        if (v % 50 == 0) g_usleep(1000);
+    }
+
+    __atomic_store_n(&ctx.stop, 1, __ATOMIC_RELEASE);
+    for (int t = 0; t < 2; t++) g_thread_join(threads[t]);
+
+    sav_live_stats_t stats;
+    sav_live_reclaim(ctx.live);
+    sav_live_get_stats(ctx.live, &stats);
+    CHECK(ctx.torn == 0, "%lu inconsistent reads", (unsigned long)ctx.torn);
+    CHECK(stats.retired == 0, "%lu snapshots not reclaimed", (unsigned long)stats.retired);
+    printf("[Threads] %lu read sections over %u versions, %lu inconsistent, %lu reclaimed\n",
+           (unsigned long)ctx.sections, VERSIONS, (unsigned long)ctx.torn,
+           (unsigned long)stats.reclaimed);
+    sav_live_free(ctx.live);
+}
+
+int main(void)
+{
+    printf("=== SAV Live Snapshot Test ===\n\n");
+    srand(23);
+
+    test_churn();
+    test_held_snapshot();
+    test_record();
+    test_threads();
+
+    if (failures) {
+        fprintf(stderr, "\n❌ SAV live snapshot test failed (%d checks)\n", failures);
+        return 1;
+    }
+    printf("\n✅ Snapshots match full builds and are reclaimed once released\n");
+    return 0;
+}
@@ -0,0 +1,221 @@
+/**
+ * @file test_lpm4.c
+ * @brief IPv4 DIR-24-8 table against a linear longest-prefix match
+ *
+ * Adds random allowlist and blocklist mappings of every length from /0 to
+ * /32 (nested ones included), builds the table, and checks that single and
+ * batched lookups of random and boundary addresses return the leaf a
+ * linear scan over the mappings predicts. Rebuilds after more mappings
+ * and checks the lookups again.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sav_lpm.h"
+
+#define ROUTES   3000
+#define PROBES   200000
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do {                              \
+    if (!(cond)) {                                         \
+        fprintf(stderr, "✗ " __VA_ARGS__);                  \
+        fprintf(stderr, "\n");                             \
+        failures++;                                        \
+    }                                                      \
+} while (0)
+
+typedef struct {
+    uint32_t  prefix;
+    uint8_t   len;
+    uint32_t  iface;
+    uint8_t   rule;
+    uint8_t   action;
+} route_t;
+
+static route_t routes[3 * ROUTES + 16];
+static size_t n_routes = 0;
+
+static uint32_t mask(uint8_t len) { return len ? 0xFFFFFFFFu << (32 - len) : 0; }
+
+static uint32_t rnd32(void) { return ((uint32_t)rand() << 16) ^ (uint32_t)rand(); }
+
+static void add(sav_lpm4_t *lpm, uint32_t prefix, uint8_t len, uint32_t iface,
+                uint8_t rule, uint8_t action)
+{
+    route_t *r = &routes[n_routes++];
+    r->prefix = prefix & mask(len);
+    r->len = len;
+    r->iface = iface;
+    r->rule = rule;
+    r->action = action;
+    CHECK(sav_lpm4_add(lpm, prefix, len, iface, rule, action), "add /%u", len);
+}
+
+/* Does leaf list (n ascending entries) contain iface? */
+static int has(const uint32_t *list, uint32_t n, uint32_t iface)
+{
+    for (uint32_t i = 0; i < n; i++) {
+        if (list[i] == iface) return 1;
+    }
+    return 0;
+}
+
+/* Compare a leaf against the mappings of the longest prefix covering addr */
+static void check_addr(const sav_lpm4_t *lpm, uint32_t addr, uint32_t leaf_id)
+{
+    int best = -1;
+    for (size_t i = 0; i < n_routes; i++) {
+        if ((addr & mask(routes[i].len)) == routes[i].prefix && routes[i].len > best) {
+            best = routes[i].len;
+        }
+    }
+
+    const sav_lpm_leaf_t *leaf = sav_lpm4_leaf(lpm, leaf_id);
+    if (best < 0) {
+        CHECK(leaf_id == SAV_LPM_NO_MATCH && leaf->n_allow == 0 && leaf->n_block == 0,
+              "%08x: expected no match, got leaf %u", addr, leaf_id);
+        return;
+    }
+
+    uint32_t n_allow = 0, n_block = 0;
+    int allow_action = -1, block_action = -1;
+    uint32_t want = addr & mask((uint8_t)best);
+    for (size_t i = 0; i < n_routes; i++) {
+        const route_t *r = &routes[i];
+        if (r->len != best || r->prefix != want) continue;
+        if (r->rule == SAV_RULE_TYPE_BLOCKLIST) {
+            CHECK(has(leaf->block, leaf->n_block, r->iface), "%08x: iface %u not blocked", addr, r->iface);
+            block_action = MAX(block_action, r->action);
+        } else {
+            CHECK(has(leaf->allow, leaf->n_allow, r->iface), "%08x: iface %u not allowed", addr, r->iface);
+            allow_action = MAX(allow_action, r->action);
+        }
+    }
+    for (uint32_t i = 0; i < leaf->n_allow; i++) {
+        CHECK(i == 0 || leaf->allow[i - 1] < leaf->allow[i], "%08x: allow list not ascending", addr);
+        n_allow++;
+    }
+    for (uint32_t i = 0; i < leaf->n_block; i++) {
+        CHECK(i == 0 || leaf->block[i - 1] < leaf->block[i], "%08x: block list not ascending", addr);
+        n_block++;
+    }
+    CHECK(allow_action < 0 ? n_allow == 0 : leaf->allow_action == allow_action,
+          "%08x: allow action %u", addr, leaf->allow_action);
+    CHECK(block_action < 0 ? n_block == 0 : leaf->block_action == block_action,
+          "%08x: block action %u", addr, leaf->block_action);
+}
+
+static void add_random(sav_lpm4_t *lpm, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        uint8_t len;
+        uint32_t prefix;
+        int pick = rand() % 10;
+
+        if (pick < 5) {
+            len = (uint8_t)(8 + rand() % 17);          /* /8-/24 */
+            prefix = rnd32();
+        } else if (pick < 8 && n_routes > 0) {
+            /* Nest inside an earlier prefix, often past /24 */
+            const route_t *outer = &routes[rand() % n_routes];
+            uint32_t longer = outer->len + 1 + (uint32_t)(rand() % 10);
+            len = (uint8_t)MIN(32u, longer);
+            prefix = outer->prefix | (rnd32() & ~mask(outer->len));
+        } else {
+            len = (uint8_t)(rand() % 33);
+            prefix = rnd32();
+        }
+        /* Several interfaces per prefix now and then */
+        uint32_t ifaces = (rand() % 4 == 0) ? 3 : 1;
+        for (uint32_t k = 0; k < ifaces; k++) {
+            add(lpm, prefix, len, 1 + rand() % 16,
+                (uint8_t)(rand() % 2), (uint8_t)(rand() % 4));
+        }
+    }
+}
+
+static void check_all(const sav_lpm4_t *lpm)
+{
+    static uint32_t addrs[PROBES], leaves[PROBES];
+    size_t n = 0;
+
+    /* Boundaries of every prefix, then random addresses */
+    for (size_t i = 0; i < n_routes && n + 3 <= PROBES; i++) {
+        addrs[n++] = routes[i].prefix;
+        addrs[n++] = routes[i].prefix | ~mask(routes[i].len);
+        addrs[n++] = routes[i].prefix - 1;
+    }
+    while (n < PROBES) {
+        addrs[n++] = rnd32();
+    }
+
+    sav_lpm4_lookup_n(lpm, addrs, (uint32_t)n, leaves);
+    for (size_t i = 0; i < n; i++) {
+        uint32_t single = sav_lpm4_lookup(lpm, addrs[i]);
+        CHECK(single == leaves[i], "%08x: lookup_n %u, lookup %u", addrs[i], leaves[i], single);
+        if (i < 20000) check_addr(lpm, addrs[i], single);
+        if (failures > 20) return;
+    }
+}
+
+int main(void)
+{
+    sav_lpm4_t *lpm = sav_lpm4_new();
+    sav_lpm_stats_t stats;
+    GError *err = NULL;
+
+    printf("=== SAV IPv4 LPM Test ===\n\n");
+    srand(7);
+
+    /* An empty table matches nothing */
+    CHECK(sav_lpm4_build(lpm, &err), "empty build");
+    CHECK(sav_lpm4_lookup(lpm, 0x0A000001) == SAV_LPM_NO_MATCH, "empty table matched");
+
+    /* Invalid mappings are refused */
+    CHECK(!sav_lpm4_add(lpm, 0, 33, 1, SAV_RULE_TYPE_ALLOWLIST, 0), "/33 accepted");
+    CHECK(!sav_lpm4_add(lpm, 0, 8, 1, 7, 0), "rule type 7 accepted");
+
+    /* Hand-written nesting: /8 allow, /24 block inside it, /32 inside that */
+    add(lpm, 0x0A000000, 8, 1, SAV_RULE_TYPE_ALLOWLIST, SAV_POLICY_ACTION_PERMIT);
+    add(lpm, 0x0A000000, 8, 2, SAV_RULE_TYPE_ALLOWLIST, SAV_POLICY_ACTION_PERMIT);
+    add(lpm, 0x0A010200, 24, 3, SAV_RULE_TYPE_BLOCKLIST, SAV_POLICY_ACTION_DISCARD);
+    add(lpm, 0x0A010207, 32, 4, SAV_RULE_TYPE_ALLOWLIST, SAV_POLICY_ACTION_RATE_LIMIT);
+    CHECK(sav_lpm4_build(lpm, &err), "build");
+
+    const sav_lpm_leaf_t *leaf = sav_lpm4_leaf(lpm, sav_lpm4_lookup(lpm, 0x0A7F0001));
+    CHECK(leaf->n_allow == 2 && leaf->allow[0] == 1 && leaf->allow[1] == 2 && leaf->n_block == 0,
+          "10.127.0.1 should be allowed on 1 and 2");
+    leaf = sav_lpm4_leaf(lpm, sav_lpm4_lookup(lpm, 0x0A010206));
+    CHECK(leaf->n_block == 1 && leaf->block[0] == 3 && leaf->block_action == SAV_POLICY_ACTION_DISCARD,
+          "10.1.2.6 should be blocked on 3");
+    leaf = sav_lpm4_leaf(lpm, sav_lpm4_lookup(lpm, 0x0A010207));
+    CHECK(leaf->n_allow == 1 && leaf->allow[0] == 4 &&
+          leaf->allow_action == SAV_POLICY_ACTION_RATE_LIMIT, "10.1.2.7 should be allowed on 4");
+    CHECK(sav_lpm4_lookup(lpm, 0x0B000000) == SAV_LPM_NO_MATCH, "11.0.0.0 matched");
+
+    /* Random mappings, then more of them and a rebuild */
+    add_random(lpm, ROUTES / 2);
+    CHECK(sav_lpm4_build(lpm, &err), "random build");
+    check_all(lpm);
+
+    add_random(lpm, ROUTES / 2);
+    CHECK(sav_lpm4_build(lpm, &err), "rebuild");
+    check_all(lpm);
+
+    sav_lpm4_get_stats(lpm, &stats);
+    CHECK(stats.mappings == n_routes, "stats: %lu mappings", (unsigned long)stats.mappings);
+    printf("[LPM4] %lu mappings, %lu prefixes, %lu leaves, %lu groups, %.1f MB\n",
+           (unsigned long)stats.mappings, (unsigned long)stats.prefixes,
+           (unsigned long)stats.leaves, (unsigned long)stats.groups, stats.memory_bytes / 1e6);
+    sav_lpm4_free(lpm);
+
+    if (failures) {
+        fprintf(stderr, "\n❌ SAV IPv4 LPM test failed (%d checks)\n", failures);
+        return 1;
+    }
+    printf("\n✅ Lookups match a linear longest-prefix match\n");
+    return 0;
+}
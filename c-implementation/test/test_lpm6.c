@@ -0,0 +1,241 @@
+/**
+ * @file test_lpm6.c
+ * @brief IPv6 poptrie against a linear longest-prefix match
+ *
+ * Adds random allowlist and blocklist mappings from /0 to /128, many of
+ * them nested and clustered under a few /16s so that nodes fill up, then
+ * checks single and batched lookups of prefix boundaries and random
+ * addresses against a linear scan over the mappings. Rebuilds after more
+ * mappings, and feeds a record through sav_lpm6_add_record().
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sav_lpm.h"
+
+#define ROUTES   3000
+#define PROBES   30000
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do {                              \
+    if (!(cond)) {                                         \
+        fprintf(stderr, "✗ " __VA_ARGS__);                  \
+        fprintf(stderr, "\n");                             \
+        failures++;                                        \
+    }                                                      \
+} while (0)
+
+typedef struct {
+    uint8_t   prefix[16];
+    uint8_t   len;
+    uint32_t  iface;
+    uint8_t   rule;
+} route_t;
+
+static route_t routes[3 * ROUTES + 16];
+static size_t n_routes = 0;
+
+static void mask(uint8_t *a, uint8_t len)
+{
+    for (int i = 0; i < 16; i++) {
+        int bits = len - i * 8;
+        a[i] &= bits >= 8 ? 0xFF : bits <= 0 ? 0 : (uint8_t)(0xFF << (8 - bits));
+    }
+}
+
+static int covers(const route_t *r, const uint8_t *addr)
+{
+    uint8_t a[16];
+    memcpy(a, addr, 16);
+    mask(a, r->len);
+    return memcmp(a, r->prefix, 16) == 0;
+}
+
+static void rnd_addr(uint8_t *a)
+{
+    for (int i = 0; i < 16; i++) a[i] = (uint8_t)rand();
+    /* Mostly under a handful of /16s */
+    if (rand() % 4) {
+        a[0] = 0x20;
+        a[1] = (uint8_t)(rand() % 4);
+    }
+}
+
+static void add(sav_lpm6_t *lpm, const uint8_t *prefix, uint8_t len, uint32_t iface, uint8_t rule)
+{
+    route_t *r = &routes[n_routes++];
+    memcpy(r->prefix, prefix, 16);
+    mask(r->prefix, len);
+    r->len = len;
+    r->iface = iface;
+    r->rule = rule;
+    CHECK(sav_lpm6_add(lpm, prefix, len, iface, rule, SAV_POLICY_ACTION_DISCARD), "add /%u", len);
+}
+
+static void add_random(sav_lpm6_t *lpm, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        uint8_t prefix[16];
+        uint8_t len;
+        int pick = rand() % 10;
+
+        rnd_addr(prefix);
+        if (pick < 5) {
+            len = (uint8_t)(20 + rand() % 45);         /* /20-/64 */
+        } else if (pick < 8 && n_routes > 0) {
+            /* Nest inside an earlier prefix */
+            const route_t *outer = &routes[rand() % n_routes];
+            uint32_t longer = outer->len + 1 + (uint32_t)(rand() % 20);
+            len = (uint8_t)MIN(128u, longer);
+            uint8_t host[16];
+            memcpy(host, prefix, 16);
+            memcpy(prefix, outer->prefix, 16);
+            for (int k = 0; k < 16; k++) {
+                int bits = outer->len - k * 8;
+                uint8_t keep = bits >= 8 ? 0xFF : bits <= 0 ? 0 : (uint8_t)(0xFF << (8 - bits));
+                prefix[k] |= host[k] & (uint8_t)~keep;
+            }
+        } else {
+            len = (uint8_t)(rand() % 129);
+        }
+        uint32_t ifaces = (rand() % 4 == 0) ? 2 : 1;
+        for (uint32_t k = 0; k < ifaces; k++) {
+            add(lpm, prefix, len, 1 + rand() % 16, (uint8_t)(rand() % 2));
+        }
+    }
+}
+
+/* Compare a leaf against the mappings of the longest prefix covering addr */
+static void check_addr(const sav_lpm6_t *lpm, const uint8_t *addr, uint32_t leaf_id)
+{
+    int best = -1;
+    for (size_t i = 0; i < n_routes; i++) {
+        if (routes[i].len > best && covers(&routes[i], addr)) best = routes[i].len;
+    }
+
+    const sav_lpm_leaf_t *leaf = sav_lpm6_leaf(lpm, leaf_id);
+    uint32_t n_allow = 0, n_block = 0;
+    for (size_t i = 0; i < n_routes && best >= 0; i++) {
+        const route_t *r = &routes[i];
+        if (r->len != best || !covers(r, addr)) continue;
+        int found = 0;
+        if (r->rule == SAV_RULE_TYPE_BLOCKLIST) {
+            for (uint32_t k = 0; k < leaf->n_block; k++) found |= leaf->block[k] == r->iface;
+        } else {
+            for (uint32_t k = 0; k < leaf->n_allow; k++) found |= leaf->allow[k] == r->iface;
+        }
+        CHECK(found, "leaf %u lacks interface %u of a /%d", leaf_id, r->iface, best);
+        if (r->rule == SAV_RULE_TYPE_BLOCKLIST) n_block++; else n_allow++;
+    }
+    CHECK(best >= 0 || leaf_id == SAV_LPM_NO_MATCH, "expected no match, got leaf %u", leaf_id);
+    CHECK(leaf->n_allow <= n_allow && leaf->n_block <= n_block,
+          "leaf %u has extra interfaces (/%d)", leaf_id, best);
+}
+
+static void check_all(const sav_lpm6_t *lpm)
+{
+    static uint8_t addrs[PROBES * 16];
+    static uint32_t leaves[PROBES];
+    size_t n = 0;
+
+    /* First and last address of every prefix, then random ones */
+    for (size_t i = 0; i < n_routes && n + 2 <= PROBES; i++) {
+        uint8_t *a = &addrs[n++ * 16];
+        memcpy(a, routes[i].prefix, 16);
+        uint8_t *z = &addrs[n++ * 16];
+        memcpy(z, routes[i].prefix, 16);
+        for (int k = 0; k < 16; k++) {
+            int bits = routes[i].len - k * 8;
+            uint8_t keep = bits >= 8 ? 0xFF : bits <= 0 ? 0 : (uint8_t)(0xFF << (8 - bits));
+            z[k] |= (uint8_t)~keep;
+        }
+    }
+    while (n < PROBES) rnd_addr(&addrs[n++ * 16]);
+
+    /* An odd count exercises a partial final batch */
+    sav_lpm6_lookup_n(lpm, addrs, (uint32_t)n - 3, leaves);
+    for (size_t i = 0; i < n - 3; i++) {
+        uint32_t single = sav_lpm6_lookup(lpm, &addrs[i * 16]);
+        CHECK(single == leaves[i], "probe %zu: lookup_n %u, lookup %u", i, leaves[i], single);
+        if (i % 5 == 0) check_addr(lpm, &addrs[i * 16], single);
+        if (failures > 20) return;
+    }
+}
+
+int main(void)
+{
+    sav_lpm6_t *lpm = sav_lpm6_new();
+    sav_lpm_stats_t stats;
+    GError *err = NULL;
+    uint8_t p[16] = { 0 };
+
+    printf("=== SAV IPv6 LPM Test ===\n\n");
+    srand(11);
+
+    CHECK(sav_lpm6_build(lpm, &err), "empty build");
+    CHECK(sav_lpm6_lookup(lpm, p) == SAV_LPM_NO_MATCH, "empty table matched");
+    CHECK(!sav_lpm6_add(lpm, p, 129, 1, SAV_RULE_TYPE_ALLOWLIST, 0), "/129 accepted");
+
+    /* 2001:db8::/32 allow on 1, 2001:db8:1::/48 block on 2, one /128 inside */
+    p[0] = 0x20; p[1] = 0x01; p[2] = 0x0d; p[3] = 0xb8;
+    add(lpm, p, 32, 1, SAV_RULE_TYPE_ALLOWLIST);
+    p[5] = 0x01;
+    add(lpm, p, 48, 2, SAV_RULE_TYPE_BLOCKLIST);
+    p[15] = 0x09;
+    add(lpm, p, 128, 3, SAV_RULE_TYPE_ALLOWLIST);
+    CHECK(sav_lpm6_build(lpm, &err), "build");
+
+    const sav_lpm_leaf_t *leaf = sav_lpm6_leaf(lpm, sav_lpm6_lookup(lpm, p));
+    CHECK(leaf->n_allow == 1 && leaf->allow[0] == 3 && leaf->n_block == 0, "/128 leaf");
+    p[15] = 0x08;
+    leaf = sav_lpm6_leaf(lpm, sav_lpm6_lookup(lpm, p));
+    CHECK(leaf->n_block == 1 && leaf->block[0] == 2 && leaf->n_allow == 0, "/48 leaf");
+    p[5] = 0x02;
+    leaf = sav_lpm6_leaf(lpm, sav_lpm6_lookup(lpm, p));
+    CHECK(leaf->n_allow == 1 && leaf->allow[0] == 1, "/32 leaf");
+    p[3] = 0xb9;
+    CHECK(sav_lpm6_lookup(lpm, p) == SAV_LPM_NO_MATCH, "2001:db9:: matched");
+
+    add_random(lpm, ROUTES / 2);
+    CHECK(sav_lpm6_build(lpm, &err), "random build");
+    check_all(lpm);
+
+    add_random(lpm, ROUTES / 2);
+    CHECK(sav_lpm6_build(lpm, &err), "rebuild");
+    check_all(lpm);
+
+    /* Records: only the IPv6 templates are taken */
+    sav_ipv6_mapping_t m;
+    sav_parsed_record_t rec;
+    memset(&m, 0, sizeof(m));
+    memset(&rec, 0, sizeof(rec));
+    m.ingressInterface = 42;
+    m.sourceIPv6Prefix[0] = 0xfd;
+    m.sourceIPv6PrefixLength = 8;
+    rec.rule_type = SAV_RULE_TYPE_ALLOWLIST;
+    rec.sub_template_id = SAV_TMPL_IPV6_INTERFACE_PREFIX;
+    rec.mapping_count = 1;
+    rec.mappings.ipv6_mappings = &m;
+    CHECK(sav_lpm6_add_record(lpm, &rec) == 1, "IPv6 record");
+    rec.sub_template_id = SAV_TMPL_IPV4_INTERFACE_PREFIX;
+    CHECK(sav_lpm6_add_record(lpm, &rec) == 0, "IPv4 record taken");
+    CHECK(sav_lpm6_build(lpm, &err), "record build");
+    m.sourceIPv6Prefix[15] = 1;
+    leaf = sav_lpm6_leaf(lpm, sav_lpm6_lookup(lpm, m.sourceIPv6Prefix));
+    CHECK(leaf->n_allow >= 1 && leaf->allow[leaf->n_allow - 1] == 42, "fd00::/8 leaf");
+
+    sav_lpm6_get_stats(lpm, &stats);
+    printf("[LPM6] %lu mappings, %lu prefixes, %lu leaves, %lu nodes, %zu bytes\n",
+           (unsigned long)stats.mappings, (unsigned long)stats.prefixes,
+           (unsigned long)stats.leaves, (unsigned long)stats.groups, stats.memory_bytes);
+    sav_lpm6_free(lpm);
+
+    if (failures) {
+        fprintf(stderr, "\n❌ SAV IPv6 LPM test failed (%d checks)\n", failures);
+        return 1;
+    }
+    printf("\n✅ Lookups match a linear longest-prefix match\n");
+    return 0;
+}
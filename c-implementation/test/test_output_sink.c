@@ -0,0 +1,218 @@
+/**
+ * @file test_output_sink.c
+ * @brief NDJSON and binary output sinks
+ *
+ * Writes the same records (IPv4, IPv6, an empty list, a list larger than
+ * the sink buffers) through SAV_SINK_NDJSON and SAV_SINK_BINARY. Checks
+ * that NDJSON has one object per line equal to the compact JSON array
+ * elements, and reads the binary stream back field by field using only
+ * the layout documented in sav_sink.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include "sav_sink.h"
+
+#define RECORD_COUNT 5
+#define BIG_LIST     30000
+
+static const uint16_t tmpl[RECORD_COUNT] = {
+    SAV_TMPL_IPV4_INTERFACE_PREFIX, SAV_TMPL_IPV6_INTERFACE_PREFIX,
+    SAV_TMPL_IPV4_PREFIX_INTERFACE, SAV_TMPL_IPV6_PREFIX_INTERFACE,
+    SAV_TMPL_IPV4_INTERFACE_PREFIX,
+};
+static const uint32_t counts[RECORD_COUNT] = { 3, 7, 0, BIG_LIST, 1 };
+
+static void build_records(sav_parsed_record_t *records)
+{
+    for (uint32_t r = 0; r < RECORD_COUNT; r++) {
+        sav_parsed_record_t *rec = &records[r];
+        uint32_t n = counts[r];
+
+        memset(rec, 0, sizeof(*rec));
+        rec->timestamp_ms = 1700000000000ULL + r;
+        rec->rule_type = (uint8_t)(r & 1);
+        rec->target_type = (uint8_t)((r >> 1) & 1);
+        rec->policy_action = (uint8_t)(r & 3);
+        rec->sub_template_id = tmpl[r];
+        rec->mapping_count = n;
+
+        if (tmpl[r] == SAV_TMPL_IPV4_INTERFACE_PREFIX ||
+            tmpl[r] == SAV_TMPL_IPV4_PREFIX_INTERFACE) {
+            sav_ipv4_mapping_t *m = g_new0(sav_ipv4_mapping_t, n ? n : 1);
+            for (uint32_t i = 0; i < n; i++) {
+                m[i].ingressInterface = 1 + i % 48;
+                m[i].sourceIPv4Prefix = 0x0A000000u | (i << 8);
+                m[i].sourceIPv4PrefixLength = 24;
+            }
+            rec->mappings.ipv4_mappings = m;
+        } else {
+            sav_ipv6_mapping_t *m = g_new0(sav_ipv6_mapping_t, n ? n : 1);
+            for (uint32_t i = 0; i < n; i++) {
+                m[i].ingressInterface = 100 + i % 7;
+                m[i].sourceIPv6Prefix[0] = 0x20;
+                m[i].sourceIPv6Prefix[1] = 0x01;
+                m[i].sourceIPv6Prefix[6] = (uint8_t)(i >> 8);
+                m[i].sourceIPv6Prefix[7] = (uint8_t)i;
+                m[i].sourceIPv6PrefixLength = 64;
+            }
+            rec->mappings.ipv6_mappings = m;
+        }
+    }
+}
+
+/* Run every record through a sink and return the bytes written */
+static uint8_t* sink_output(const sav_parsed_record_t *records, sav_sink_format_t format,
+                            size_t *len)
+{
+    GError *err = NULL;
+    FILE *fp = tmpfile();
+    if (!fp) return NULL;
+
+    sav_sink_t *sink = sav_sink_new(fp, format, &err);
+    for (uint32_t r = 0; sink && r < RECORD_COUNT; r++) {
+        if (!sav_sink_write(sink, &records[r], &err)) break;
+    }
+    if (!sink || err || !sav_sink_finish(sink, &err)) {
+        fprintf(stderr, "✗ sink: %s\n", err ? err->message : "sav_sink_new failed");
+        sav_sink_free(sink);
+        fclose(fp);
+        return NULL;
+    }
+    sav_sink_free(sink);
+
+    long size = ftell(fp);
+    uint8_t *data = g_malloc((size_t)size + 1);
+    rewind(fp);
+    *len = fread(data, 1, (size_t)size, fp);
+    data[*len] = '\0';
+    fclose(fp);
+    return data;
+}
+
+static int test_ndjson(const sav_parsed_record_t *records)
+{
+    size_t nd_len = 0, arr_len = 0;
+    char *nd = (char *)sink_output(records, SAV_SINK_NDJSON, &nd_len);
+    char *arr = (char *)sink_output(records, SAV_SINK_JSON_COMPACT, &arr_len);
+    int rc = 1;
+
+    if (!nd || !arr) goto out;
+
+    /* The compact array is "[" + objects joined by "," + "]\n"; turning the
+     * NDJSON line breaks into commas must give back the same objects */
+    uint32_t lines = 0;
+    for (size_t i = 0; i < nd_len; i++) {
+        if (nd[i] == '\n') {
+            lines++;
+            nd[i] = (i + 1 < nd_len) ? ',' : '\0';
+        }
+    }
+    if (lines != RECORD_COUNT || nd[nd_len - 1] != '\0') {
+        fprintf(stderr, "✗ NDJSON: %u lines, expected %u\n", lines, RECORD_COUNT);
+        goto out;
+    }
+    if (arr_len != nd_len + 2 || memcmp(arr + 1, nd, nd_len - 1) != 0) {
+        fprintf(stderr, "✗ NDJSON objects differ from the compact array\n");
+        goto out;
+    }
+    printf("[NDJSON] %u lines, %zu bytes\n", lines, nd_len);
+    rc = 0;
+out:
+    g_free(nd);
+    g_free(arr);
+    return rc;
+}
+
+static uint16_t le16(const uint8_t *p) { return (uint16_t)(p[0] | p[1] << 8); }
+static uint32_t le32(const uint8_t *p) { return le16(p) | (uint32_t)le16(p + 2) << 16; }
+static uint64_t le64(const uint8_t *p) { return le32(p) | (uint64_t)le32(p + 4) << 32; }
+
+static int test_binary(const sav_parsed_record_t *records)
+{
+    size_t len = 0;
+    uint8_t *data = sink_output(records, SAV_SINK_BINARY, &len);
+    int rc = 1;
+
+    if (!data) return 1;
+    if (len < 8 || memcmp(data, SAV_BINARY_MAGIC, 4) != 0 ||
+        le16(data + 4) != SAV_BINARY_VERSION) {
+        fprintf(stderr, "✗ binary: bad stream header\n");
+        goto out;
+    }
+
+    size_t off = sizeof(sav_binary_stream_header_t);
+    uint32_t r = 0;
+    while (off < len) {
+        const uint8_t *h = data + off;
+        const sav_parsed_record_t *rec = &records[r];
+        uint32_t record_length = le32(h);
+        uint8_t family = h[9];
+        uint32_t count = le32(h + 12);
+
+        if (r >= RECORD_COUNT || off % 8 != 0 || off + 4 + record_length > len ||
+            le16(h + 4) != rec->sub_template_id || h[6] != rec->rule_type ||
+            h[7] != rec->target_type || h[8] != rec->policy_action ||
+            count != rec->mapping_count || le64(h + 16) != rec->timestamp_ms) {
+            fprintf(stderr, "✗ binary: record %u header mismatch\n", r);
+            goto out;
+        }
+
+        size_t entry = (family == 4) ? sizeof(sav_binary_ipv4_entry_t)
+                                     : sizeof(sav_binary_ipv6_entry_t);
+        const uint8_t *e = h + sizeof(sav_binary_record_header_t);
+        for (uint32_t i = 0; i < count; i++, e += entry) {
+            int ok;
+            if (family == 4) {
+                const sav_ipv4_mapping_t *m = &rec->mappings.ipv4_mappings[i];
+                uint32_t prefix;
+                memcpy(&prefix, e + 4, 4);
+                ok = le32(e) == m->ingressInterface && ntohl(prefix) == m->sourceIPv4Prefix &&
+                     e[8] == m->sourceIPv4PrefixLength;
+            } else {
+                const sav_ipv6_mapping_t *m = &rec->mappings.ipv6_mappings[i];
+                ok = family == 6 && le32(e) == m->ingressInterface &&
+                     memcmp(e + 4, m->sourceIPv6Prefix, 16) == 0 &&
+                     e[20] == m->sourceIPv6PrefixLength;
+            }
+            if (!ok) {
+                fprintf(stderr, "✗ binary: record %u mapping %u mismatch\n", r, i);
+                goto out;
+            }
+        }
+        off += 4 + record_length;
+        r++;
+    }
+    if (r != RECORD_COUNT || off != len) {
+        fprintf(stderr, "✗ binary: read %u records, expected %u\n", r, RECORD_COUNT);
+        goto out;
+    }
+    printf("[Binary] %u records, %zu bytes\n", r, len);
+    rc = 0;
+out:
+    g_free(data);
+    return rc;
+}
+
+int main(void)
+{
+    sav_parsed_record_t records[RECORD_COUNT];
+    int rc;
+
+    printf("=== Output Sink Test ===\n\n");
+
+    build_records(records);
+    rc = test_ndjson(records) || test_binary(records);
+    for (uint32_t r = 0; r < RECORD_COUNT; r++) {
+        sav_free_parsed_record(&records[r]);
+    }
+
+    if (rc) {
+        fprintf(stderr, "\n❌ Output sink test failed\n");
+        return 1;
+    }
+    printf("\n✅ NDJSON and binary sinks round-trip\n");
+    return 0;
+}
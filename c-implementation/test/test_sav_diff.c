@@ -0,0 +1,221 @@
+/**
+ * @file test_sav_diff.c
+ * @brief sav_diff on two small captures: changes reported and exit status
+ *
+ * Writes a "before" and an "after" capture that differ by one added, one
+ * removed and one changed mapping, plus a mapping whose only difference is
+ * its timestamp, and runs the sav_diff tool on them. The text and NDJSON
+ * output must list exactly those three changes, and the exit status must
+ * follow diff(1): 0 for identical tables, 1 for different ones, 2 on error.
+ *
+ * The tool is taken from $SAV_DIFF, by default build/bin/sav_diff
+ * (built by "make tools", which "make test" depends on).
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include "sav_collector.h"
+#include "sav_wire_writer.h"
+
+#define BEFORE_FILE "test_sav_diff_before.ipfix"
+#define AFTER_FILE  "test_sav_diff_after.ipfix"
+#define MISSING     "test_sav_diff_missing.ipfix"
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do {                              \
+    if (!(cond)) {                                         \
+        fprintf(stderr, "✗ " __VA_ARGS__);                  \
+        fprintf(stderr, "\n");                             \
+        failures++;                                        \
+    }                                                      \
+} while (0)
+
+static sav_parsed_record_t make_record(uint64_t ts, uint8_t rule, uint8_t target,
+                                       uint8_t action, uint16_t tmpl, uint32_t count)
+{
+    sav_parsed_record_t rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.timestamp_ms = ts;
+    rec.rule_type = rule;
+    rec.target_type = target;
+    rec.policy_action = action;
+    rec.sub_template_id = tmpl;
+    rec.mapping_count = count;
+    return rec;
+}
+
+/* Write the records of one capture in a single message */
+static int write_capture(const char *path, sav_parsed_record_t *records, int n)
+{
+    uint8_t buf[2048];
+    sav_wire_writer_t w;
+    FILE *fp = fopen(path, "wb");
+
+    if (!fp) {
+        fprintf(stderr, "✗ Cannot create %s\n", path);
+        return 1;
+    }
+    sav_wire_writer_init(&w, buf, sizeof(buf), 1);
+    sav_wire_begin_message(&w, 1700000000u);
+    gboolean ok = sav_wire_add_templates(&w);
+    for (int r = 0; r < n && ok; r++) {
+        ok = sav_wire_add_record(&w, &records[r]);
+    }
+    size_t len = sav_wire_finish_message(&w);
+    if (!ok || fwrite(buf, 1, len, fp) != len) {
+        fprintf(stderr, "✗ Cannot write %s\n", path);
+        fclose(fp);
+        return 1;
+    }
+    fclose(fp);
+    return 0;
+}
+
+/*
+ * before: 1 10.0.0.0/8 and 2 192.168.1.0/24 (allowlist, discard),
+ *         3 2001:db8::/32 (allowlist, discard)
+ * after:  1 10.0.0.0/8 again, later; 2 192.168.1.0/24 as blocklist;
+ *         4 172.16.0.0/12 prefix-based (allowlist, permit)
+ */
+static int write_captures(void)
+{
+    sav_ipv4_mapping_t before_v4[2] = {
+        { 1, 0x0A000000u, 8 },
+        { 2, 0xC0A80100u, 24 },
+    };
+    sav_ipv6_mapping_t before_v6[1] = {
+        { 3, { 0x20, 0x01, 0x0d, 0xb8 }, 32 },
+    };
+    sav_ipv4_mapping_t after_same[1] = { { 1, 0x0A000000u, 8 } };
+    sav_ipv4_mapping_t after_changed[1] = { { 2, 0xC0A80100u, 24 } };
+    sav_ipv4_mapping_t after_added[1] = { { 4, 0xAC100000u, 12 } };
+    sav_parsed_record_t before[2], after[3];
+
+    before[0] = make_record(1700000000000ULL, SAV_RULE_TYPE_ALLOWLIST,
+                            SAV_TARGET_TYPE_INTERFACE_BASED, SAV_POLICY_ACTION_DISCARD,
+                            SAV_TMPL_IPV4_INTERFACE_PREFIX, 2);
+    before[0].mappings.ipv4_mappings = before_v4;
+    before[1] = make_record(1700000000000ULL, SAV_RULE_TYPE_ALLOWLIST,
+                            SAV_TARGET_TYPE_INTERFACE_BASED, SAV_POLICY_ACTION_DISCARD,
+                            SAV_TMPL_IPV6_INTERFACE_PREFIX, 1);
+    before[1].mappings.ipv6_mappings = before_v6;
+
+    after[0] = make_record(1700000060000ULL, SAV_RULE_TYPE_ALLOWLIST,
+                           SAV_TARGET_TYPE_INTERFACE_BASED, SAV_POLICY_ACTION_DISCARD,
+                           SAV_TMPL_IPV4_INTERFACE_PREFIX, 1);
+    after[0].mappings.ipv4_mappings = after_same;
+    after[1] = make_record(1700000060000ULL, SAV_RULE_TYPE_BLOCKLIST,
+                           SAV_TARGET_TYPE_INTERFACE_BASED, SAV_POLICY_ACTION_DISCARD,
+                           SAV_TMPL_IPV4_INTERFACE_PREFIX, 1);
+    after[1].mappings.ipv4_mappings = after_changed;
+    after[2] = make_record(1700000060000ULL, SAV_RULE_TYPE_ALLOWLIST,
+                           SAV_TARGET_TYPE_PREFIX_BASED, SAV_POLICY_ACTION_PERMIT,
+                           SAV_TMPL_IPV4_PREFIX_INTERFACE, 1);
+    after[2].mappings.ipv4_mappings = after_added;
+
+    return write_capture(BEFORE_FILE, before, 2) || write_capture(AFTER_FILE, after, 3);
+}
+
+/* Run sav_diff; returns its exit status (-1 if it did not exit) and stdout in *out */
+static int run_diff(const char *tool, const char *args, GString *out)
+{
+    char *cmd = g_strdup_printf("%s %s", tool, args);
+    FILE *p = popen(cmd, "r");
+    char line[512];
+
+    g_string_truncate(out, 0);
+    if (!p) {
+        fprintf(stderr, "✗ Cannot run %s\n", cmd);
+        g_free(cmd);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), p)) {
+        g_string_append(out, line);
+    }
+    int status = pclose(p);
+    g_free(cmd);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+/* Number of lines of out that start with prefix */
+static int count_lines(const GString *out, const char *prefix)
+{
+    int n = 0;
+    size_t len = strlen(prefix);
+
+    for (const char *s = out->str; *s; ) {
+        if (strncmp(s, prefix, len) == 0) n++;
+        const char *nl = strchr(s, '\n');
+        if (!nl) break;
+        s = nl + 1;
+    }
+    return n;
+}
+
+int main(void)
+{
+    const char *tool = getenv("SAV_DIFF") ? getenv("SAV_DIFF") : "build/bin/sav_diff";
+    GString *out = g_string_new(NULL);
+    int rc;
+
+    printf("=== sav_diff ===\n\n");
+
+    if (write_captures() != 0) {
+        return 1;
+    }
+
+    /* Text: one line per change, timestamp-only updates left out */
+    rc = run_diff(tool, BEFORE_FILE " " AFTER_FILE, out);
+    CHECK(rc == 1, "different captures: exit status %d, expected 1", rc);
+    CHECK(strstr(out->str, "+ 4 172.16.0.0/12 prefix-based allowlist permit\n") != NULL,
+          "added mapping missing");
+    CHECK(strstr(out->str, "- 3 2001:db8::/32 interface-based allowlist discard\n") != NULL,
+          "removed mapping missing");
+    CHECK(strstr(out->str, "~ 2 192.168.1.0/24 interface-based allowlist discard -> "
+                           "blocklist discard\n") != NULL, "changed mapping missing");
+    CHECK(count_lines(out, "+ ") + count_lines(out, "- ") + count_lines(out, "~ ") == 3,
+          "unexpected changes reported");
+    CHECK(strstr(out->str, "1 added, 1 removed, 1 changed (3 mappings before, 3 after)")
+          != NULL, "summary missing");
+    printf("[Text] exit %d\n%s\n", rc, out->str);
+
+    /* NDJSON: the same three changes, nothing else */
+    rc = run_diff(tool, "-n " BEFORE_FILE " " AFTER_FILE, out);
+    CHECK(rc == 1, "NDJSON: exit status %d, expected 1", rc);
+    CHECK(count_lines(out, "{\"change\":\"added\",\"interface\":4,") == 1 &&
+          count_lines(out, "{\"change\":\"removed\",\"interface\":3,") == 1 &&
+          count_lines(out, "{\"change\":\"changed\",\"interface\":2,") == 1 &&
+          count_lines(out, "") == 3, "NDJSON output:\n%s", out->str);
+    CHECK(strstr(out->str, "\"old_rule_type_name\":\"allowlist\"") != NULL,
+          "NDJSON lacks the old value of the changed mapping");
+    printf("[NDJSON] exit %d, %d lines\n", rc, count_lines(out, ""));
+
+    /* Identical tables */
+    rc = run_diff(tool, "-s " BEFORE_FILE " " BEFORE_FILE, out);
+    CHECK(rc == 0, "same capture: exit status %d, expected 0", rc);
+    CHECK(strcmp(out->str, "0 added, 0 removed, 0 changed (3 mappings before, 3 after)\n")
+          == 0, "stats output: %s", out->str);
+    printf("[Same] exit %d: %s", rc, out->str);
+
+    /* Errors */
+    rc = run_diff(tool, BEFORE_FILE " " MISSING " 2>/dev/null", out);
+    CHECK(rc == 2, "missing input: exit status %d, expected 2", rc);
+    rc = run_diff(tool, BEFORE_FILE " 2>/dev/null", out);
+    CHECK(rc == 2, "one input: exit status %d, expected 2", rc);
+    printf("[Errors] missing input and usage error exit 2\n");
+
+    remove(BEFORE_FILE);
+    remove(AFTER_FILE);
+    g_string_free(out, TRUE);
+
+    if (failures) {
+        fprintf(stderr, "\n❌ sav_diff test failed (%d checks)\n", failures);
+        return 1;
+    }
+    printf("\n✅ sav_diff reports added, removed and changed mappings\n");
+    return 0;
+}
@@ -0,0 +1,337 @@
+/**
+ * @file test_snapshot.c
+ * @brief Snapshot files: round trip, queries in place, replacement, corruption
+ *
+ * Writes a table of random IPv4 and IPv6 entries to a snapshot, maps it
+ * and checks that every entry is found with its values, that each
+ * interface's entries are complete and ordered, and that loading the
+ * snapshot rebuilds the table. Replaces the file while it is open (the
+ * open map keeps the old snapshot), reads it from a second process, and
+ * checks that damaged files are rejected at open and that loading skips
+ * entries with an invalid family or prefix length. The file must get the
+ * permissions of the umask, not those of its temporary file.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <arpa/inet.h>
+#include "sav_snapshot.h"
+
+#define SNAPSHOT_FILE "test_snapshot.savs"
+#define DAMAGED_FILE  "test_snapshot_damaged.savs"
+#define V4_COUNT      20000
+#define V6_COUNT      3000
+#define INTERFACES    300
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do {                              \
+    if (!(cond)) {                                         \
+        fprintf(stderr, "✗ " __VA_ARGS__);                  \
+        fprintf(stderr, "\n");                             \
+        failures++;                                        \
+    }                                                      \
+} while (0)
+
+static void random_entry(sav_state_entry_t *e, uint8_t family)
+{
+    memset(e, 0, sizeof(*e));
+    e->family = family;
+    e->interface = 1 + (uint32_t)(rand() % INTERFACES) * 7;
+    e->target_type = (uint8_t)(rand() % 2);
+    e->rule_type = (uint8_t)(rand() % 2);
+    e->policy_action = (uint8_t)(rand() % 4);
+    e->updated_ms = 1700000000000ULL + (uint64_t)rand();
+    if (family == 4) {
+        uint32_t be = htonl(0x0A000000u | ((uint32_t)rand() & 0xFFFF) << 8);
+        e->prefix_len = 24;
+        memcpy(e->prefix, &be, 4);
+    } else {
+        e->prefix_len = 48;
+        e->prefix[0] = 0x20;
+        e->prefix[1] = 0x01;
+        for (int i = 2; i < 6; i++) e->prefix[i] = (uint8_t)rand();
+    }
+}
+
+static gboolean same_value(const sav_snapshot_entry_t *s, const sav_state_entry_t *e)
+{
+    sav_state_entry_t got;
+    sav_snapshot_entry_get(s, &got);
+    return memcmp(&got, e, sizeof(got)) == 0;
+}
+
+typedef struct {
+    const sav_snapshot_t *snap;
+    const sav_state_t    *state;
+    uint64_t             seen;
+    uint64_t             latest;
+} walk_ctx_t;
+
+static void check_found(const sav_state_entry_t *e, void *user)
+{
+    walk_ctx_t *ctx = user;
+    const sav_snapshot_entry_t *s = sav_snapshot_find(ctx->snap, e);
+
+    CHECK(s && same_value(s, e), "entry on %u not found or differs", e->interface);
+    ctx->seen++;
+    ctx->latest = MAX(ctx->latest, e->updated_ms);
+}
+
+static void check_loaded(const sav_state_entry_t *e, void *user)
+{
+    walk_ctx_t *ctx = user;
+    sav_state_entry_t got;
+
+    CHECK(sav_state_lookup(ctx->state, e, &got) && memcmp(&got, e, sizeof(got)) == 0,
+          "loaded entry on %u differs", e->interface);
+    ctx->seen++;
+}
+
+static void write_bytes(const char *path, const uint8_t *data, size_t len)
+{
+    FILE *fp = fopen(path, "wb");
+    if (fp) {
+        fwrite(data, 1, len, fp);
+        fclose(fp);
+    }
+}
+
+/* Open a damaged copy of the snapshot; returns whether it was rejected */
+static gboolean rejected(const uint8_t *data, size_t len, const char *what)
+{
+    GError *err = NULL;
+    write_bytes(DAMAGED_FILE, data, len);
+    sav_snapshot_t *snap = sav_snapshot_open(DAMAGED_FILE, &err);
+    if (snap) {
+        fprintf(stderr, "✗ %s accepted\n", what);
+        sav_snapshot_close(snap);
+        return FALSE;
+    }
+    printf("  %-22s -> %s\n", what, err->message);
+    g_clear_error(&err);
+    return TRUE;
+}
+
+static void test_damaged(const sav_snapshot_t *snap)
+{
+    uint8_t *copy = g_malloc(snap->len);
+    sav_snapshot_header_t *h = (sav_snapshot_header_t *)copy;
+    sav_snapshot_iface_t *dir = (sav_snapshot_iface_t *)(copy + snap->header->ifaces_offset);
+
+    printf("[Damaged]\n");
+    memcpy(copy, snap->base, snap->len);
+    h->magic = 0x12345678u;
+    CHECK(rejected(copy, snap->len, "bad magic"), "bad magic");
+
+    memcpy(copy, snap->base, snap->len);
+    h->magic = GUINT32_SWAP_LE_BE(SAV_SNAPSHOT_MAGIC);
+    CHECK(rejected(copy, snap->len, "other byte order"), "byte order");
+
+    memcpy(copy, snap->base, snap->len);
+    h->version = SAV_SNAPSHOT_VERSION + 1;
+    CHECK(rejected(copy, snap->len, "newer version"), "version");
+
+    memcpy(copy, snap->base, snap->len);
+    h->entry_size = sizeof(sav_snapshot_entry_t) + 8;
+    CHECK(rejected(copy, snap->len, "other entry layout"), "entry layout");
+
+    memcpy(copy, snap->base, snap->len);
+    CHECK(rejected(copy, snap->len - 1, "truncated"), "truncated");
+    CHECK(rejected(copy, sizeof(sav_snapshot_header_t) - 1, "header only in part"), "short");
+
+    h->n_entries = UINT64_MAX / 2;
+    CHECK(rejected(copy, snap->len, "huge entry count"), "entry count");
+
+    memcpy(copy, snap->base, snap->len);
+    dir[1].count++;
+    CHECK(rejected(copy, snap->len, "directory count"), "directory count");
+
+    memcpy(copy, snap->base, snap->len);
+    dir[2].interface = dir[1].interface;
+    CHECK(rejected(copy, snap->len, "directory order"), "directory order");
+
+    unlink(DAMAGED_FILE);
+    g_free(copy);
+}
+
+/* Entries the table could not hold are skipped by sav_snapshot_load() */
+static void test_bad_entries(const sav_snapshot_t *snap)
+{
+    GError *err = NULL;
+    uint8_t *copy = g_malloc(snap->len);
+    sav_snapshot_entry_t *entries = (sav_snapshot_entry_t *)(copy + snap->header->entries_offset);
+    uint64_t n = snap->header->n_entries;
+
+    memcpy(copy, snap->base, snap->len);
+    entries[0].family = 5;
+    entries[1].prefix_len = entries[1].family == 4 ? 33 : 129;
+    entries[n - 1].prefix_len = 200;
+    write_bytes(DAMAGED_FILE, copy, snap->len);
+
+    sav_snapshot_t *bad = sav_snapshot_open(DAMAGED_FILE, &err);
+    CHECK(bad, "damaged entries rejected at open: %s", err ? err->message : "");
+    g_clear_error(&err);
+    if (bad) {
+        sav_state_t *state = sav_state_new();
+        sav_state_stats_t stats;
+        uint64_t loaded = sav_snapshot_load(bad, state);
+        sav_state_get_stats(state, &stats);
+        CHECK(loaded == n - 3 && stats.ipv4_entries + stats.ipv6_entries == n - 3,
+              "%lu of %lu entries loaded, expected %lu", (unsigned long)loaded,
+              (unsigned long)n, (unsigned long)(n - 3));
+        printf("[Load] %lu of %lu entries loaded from a damaged snapshot\n",
+               (unsigned long)loaded, (unsigned long)n);
+        sav_state_free(state);
+        sav_snapshot_close(bad);
+    }
+
+    unlink(DAMAGED_FILE);
+    g_free(copy);
+}
+
+int main(void)
+{
+    sav_state_t *state = sav_state_new();
+    sav_state_entry_t e;
+    GError *err = NULL;
+
+    printf("=== SAV Snapshot File Test ===\n\n");
+    srand(24);
+    for (int i = 0; i < V4_COUNT + V6_COUNT; i++) {
+        random_entry(&e, i < V4_COUNT ? 4 : 6);
+        sav_state_upsert(state, &e);
+    }
+
+    sav_state_stats_t stats;
+    sav_state_get_stats(state, &stats);
+    uint64_t total = stats.ipv4_entries + stats.ipv6_entries;
+
+    CHECK(sav_snapshot_write(state, SNAPSHOT_FILE, 7, &err), "write: %s", err ? err->message : "");
+    struct stat st;
+    mode_t mask = umask(0);
+    umask(mask);
+    CHECK(stat(SNAPSHOT_FILE, &st) == 0 && (st.st_mode & 0777) == (0644 & ~mask),
+          "snapshot mode %03o, expected %03o", (unsigned)(st.st_mode & 0777),
+          (unsigned)(0644 & ~mask));
+    sav_snapshot_t *snap = sav_snapshot_open(SNAPSHOT_FILE, &err);
+    if (!snap) {
+        fprintf(stderr, "❌ Cannot open snapshot: %s\n", err ? err->message : "unknown");
+        return 1;
+    }
+
+    /* Every entry, in place */
+    walk_ctx_t ctx = { snap, NULL, 0, 0 };
+    sav_state_foreach(state, check_found, &ctx);
+    CHECK(sav_snapshot_count(snap) == total, "%lu entries stored, %lu in the table",
+          (unsigned long)sav_snapshot_count(snap), (unsigned long)total);
+    CHECK(sav_snapshot_generation(snap) == 7, "generation");
+    CHECK(sav_snapshot_updated_ms(snap) == ctx.latest, "updated_ms");
+    printf("[Round trip] %lu entries, %lu interfaces, %zu bytes\n",
+           (unsigned long)total, (unsigned long)snap->header->n_ifaces, snap->len);
+
+    /* Per interface: complete, in key order, IPv4 first */
+    uint64_t listed = 0;
+    for (uint32_t k = 0; k < INTERFACES; k++) {
+        uint32_t iface = 1 + k * 7;
+        size_t n;
+        const sav_snapshot_entry_t *list = sav_snapshot_interface(snap, iface, &n);
+        for (size_t i = 0; i < n; i++) {
+            CHECK(list[i].interface == iface, "interface %u lists an entry of %u",
+                  iface, list[i].interface);
+            if (i == 0) continue;
+            int order = list[i - 1].family != list[i].family ?
+                        list[i - 1].family - list[i].family :
+                        memcmp(list[i - 1].prefix, list[i].prefix, 16);
+            if (order == 0) {
+                order = list[i - 1].prefix_len != list[i].prefix_len ?
+                        list[i - 1].prefix_len - list[i].prefix_len :
+                        list[i - 1].target_type - list[i].target_type;
+            }
+            CHECK(order < 0, "interface %u out of order at %zu", iface, i);
+            /* sav_diff merges with the exported comparison; it must agree */
+            CHECK(sav_snapshot_entry_cmp(&list[i - 1], &list[i]) < 0 &&
+                  sav_snapshot_entry_cmp(&list[i], &list[i - 1]) > 0,
+                  "sav_snapshot_entry_cmp disagrees on interface %u at %zu", iface, i);
+        }
+        listed += n;
+    }
+    CHECK(listed == total, "interfaces list %lu entries", (unsigned long)listed);
+
+    size_t n;
+    CHECK(!sav_snapshot_interface(snap, 2, &n) && n == 0, "interface without entries");
+    random_entry(&e, 4);
+    e.prefix_len = 25;
+    CHECK(!sav_snapshot_find(snap, &e), "missing key found");
+
+    /* Loading rebuilds the table */
+    sav_state_t *loaded = sav_state_new();
+    CHECK(sav_snapshot_load(snap, loaded) == total, "load count");
+    walk_ctx_t lctx = { snap, loaded, 0, 0 };
+    sav_state_foreach(state, check_loaded, &lctx);
+    sav_state_get_stats(loaded, &stats);
+    CHECK(stats.ipv4_entries + stats.ipv6_entries == total, "loaded table size");
+    sav_state_free(loaded);
+    printf("[Load] %lu entries back in a table\n", (unsigned long)lctx.seen);
+
+    /* Another process maps the same file */
+    pid_t pid = fork();
+    if (pid == 0) {
+        sav_snapshot_t *other = sav_snapshot_open(SNAPSHOT_FILE, NULL);
+        walk_ctx_t octx = { other, NULL, 0, 0 };
+        int before = failures;
+        if (other) sav_state_foreach(state, check_found, &octx);
+        _exit(other && failures == before ? 0 : 1);
+    }
+    int status = 1;
+    waitpid(pid, &status, 0);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0, "second process");
+    printf("[Shared] second process found every entry\n");
+
+    /* Replace the file: the open map keeps generation 7 */
+    const sav_snapshot_entry_t *kept = &snap->entries[0];
+    sav_state_entry_t before;
+    sav_snapshot_entry_get(kept, &before);
+    e = before;
+    e.rule_type ^= 1;
+    e.updated_ms++;
+    sav_state_upsert(state, &e);
+    CHECK(sav_snapshot_write(state, SNAPSHOT_FILE, 8, &err), "rewrite");
+
+    sav_snapshot_t *next = sav_snapshot_open(SNAPSHOT_FILE, &err);
+    CHECK(next && sav_snapshot_generation(next) == 8, "new generation");
+    CHECK(next && same_value(sav_snapshot_find(next, &e), &e), "new value");
+    CHECK(sav_snapshot_generation(snap) == 7 && same_value(kept, &before), "old map changed");
+    printf("[Replace] generation 7 still mapped after generation 8 was written\n");
+
+    test_damaged(snap);
+    test_bad_entries(snap);
+    sav_snapshot_close(next);
+    sav_snapshot_close(snap);
+
+    /* Empty table */
+    sav_state_t *empty = sav_state_new();
+    CHECK(sav_snapshot_write(empty, SNAPSHOT_FILE, 0, &err), "write empty");
+    snap = sav_snapshot_open(SNAPSHOT_FILE, &err);
+    CHECK(snap && sav_snapshot_count(snap) == 0 && sav_snapshot_updated_ms(snap) == 0 &&
+          !sav_snapshot_find(snap, &e), "empty snapshot");
+    sav_snapshot_close(snap);
+    sav_state_free(empty);
+
+    CHECK(!sav_snapshot_open("no/such/snapshot.savs", &err), "missing file");
+    g_clear_error(&err);
+
+    unlink(SNAPSHOT_FILE);
+    sav_state_free(state);
+
+    if (failures) {
+        fprintf(stderr, "\n❌ SAV snapshot file test failed (%d checks)\n", failures);
+        return 1;
+    }
+    printf("\n✅ Snapshots round-trip and are queried in place\n");
+    return 0;
+}
@@ -0,0 +1,173 @@
+/**
+ * @file test_state.c
+ * @brief Live rule table: insert, replace, lookup, remove
+ *
+ * Applies IPv4 and IPv6 records to a sav_state_t and checks the resulting
+ * entries: invalid mappings are rejected, re-announced keys replace the
+ * rule and action, interface- and prefix-based rules stay apart, removing
+ * half of the entries leaves every other one reachable, and the walk
+ * visits exactly the live entries.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include "sav_state.h"
+
+#define V4_COUNT  5000
+#define V6_COUNT  300
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do {                              \
+    if (!(cond)) {                                         \
+        fprintf(stderr, "✗ " __VA_ARGS__);                  \
+        fprintf(stderr, "\n");                             \
+        failures++;                                        \
+    }                                                      \
+} while (0)
+
+static void ipv4_key(sav_state_entry_t *key, uint8_t target, uint32_t iface,
+                     uint32_t prefix, uint8_t len)
+{
+    uint32_t be = htonl(prefix);
+    memset(key, 0, sizeof(*key));
+    key->target_type = target;
+    key->family = 4;
+    key->interface = iface;
+    key->prefix_len = len;
+    memcpy(key->prefix, &be, 4);
+}
+
+static uint32_t v4_prefix(uint32_t i) { return 0x0A000000u | (i << 8); }
+
+static void count_entry(const sav_state_entry_t *entry, void *user)
+{
+    (void)entry;
+    (*(uint64_t *)user)++;
+}
+
+int main(void)
+{
+    static sav_ipv4_mapping_t v4[V4_COUNT];
+    static sav_ipv6_mapping_t v6[V6_COUNT];
+    sav_state_t *state = sav_state_new();
+    sav_state_stats_t stats;
+    sav_state_entry_t key, got;
+    sav_parsed_record_t rec;
+    GError *err = NULL;
+
+    printf("=== SAV State Test ===\n\n");
+
+    /* Allowlist, interface-based: V4_COUNT mappings, three of them invalid */
+    for (uint32_t i = 0; i < V4_COUNT; i++) {
+        v4[i].ingressInterface = 1 + i % 64;
+        v4[i].sourceIPv4Prefix = v4_prefix(i);
+        v4[i].sourceIPv4PrefixLength = 24;
+    }
+    v4[10].sourceIPv4PrefixLength = 33;
+    v4[20].sourceIPv4Prefix |= 1;
+    v4[30].sourceIPv4PrefixLength = 16;
+
+    memset(&rec, 0, sizeof(rec));
+    rec.timestamp_ms = 1000;
+    rec.rule_type = SAV_RULE_TYPE_ALLOWLIST;
+    rec.target_type = SAV_TARGET_TYPE_INTERFACE_BASED;
+    rec.policy_action = SAV_POLICY_ACTION_PERMIT;
+    rec.sub_template_id = SAV_TMPL_IPV4_INTERFACE_PREFIX;
+    rec.mapping_count = V4_COUNT;
+    rec.mappings.ipv4_mappings = v4;
+    CHECK(sav_state_apply_record(state, &rec, &err), "apply IPv4 record");
+
+    sav_state_get_stats(state, &stats);
+    CHECK(stats.inserts == V4_COUNT - 3 && stats.rejected == 3 && stats.ipv4_entries == V4_COUNT - 3,
+          "after first record: %lu inserts, %lu rejected",
+          (unsigned long)stats.inserts, (unsigned long)stats.rejected);
+
+    /* The first 1000 again as blocklist/discard: replaced, not added */
+    v4[10].sourceIPv4PrefixLength = 24;
+    v4[20].sourceIPv4Prefix = v4_prefix(20);
+    rec.timestamp_ms = 2000;
+    rec.rule_type = SAV_RULE_TYPE_BLOCKLIST;
+    rec.policy_action = SAV_POLICY_ACTION_DISCARD;
+    rec.mapping_count = 1000;
+    CHECK(sav_state_apply_record(state, &rec, &err), "apply replacing record");
+
+    sav_state_get_stats(state, &stats);
+    CHECK(stats.replaces == 997 && stats.ipv4_entries == V4_COUNT - 1,
+          "after replace: %lu replaces, %lu entries",
+          (unsigned long)stats.replaces, (unsigned long)stats.ipv4_entries);
+
+    ipv4_key(&key, SAV_TARGET_TYPE_INTERFACE_BASED, v4[500].ingressInterface, v4_prefix(500), 24);
+    CHECK(sav_state_lookup(state, &key, &got) && got.rule_type == SAV_RULE_TYPE_BLOCKLIST &&
+          got.policy_action == SAV_POLICY_ACTION_DISCARD && got.updated_ms == 2000 &&
+          memcmp(got.prefix, key.prefix, 16) == 0, "replaced entry");
+    ipv4_key(&key, SAV_TARGET_TYPE_INTERFACE_BASED, v4[4000].ingressInterface, v4_prefix(4000), 24);
+    CHECK(sav_state_lookup(state, &key, &got) && got.rule_type == SAV_RULE_TYPE_ALLOWLIST &&
+          got.updated_ms == 1000, "untouched entry");
+    key.interface++;
+    CHECK(!sav_state_lookup(state, &key, NULL), "other interface must miss");
+    key.interface--;
+    key.target_type = SAV_TARGET_TYPE_PREFIX_BASED;
+    CHECK(!sav_state_lookup(state, &key, NULL), "other target type must miss");
+
+    /* IPv6, prefix-based */
+    for (uint32_t i = 0; i < V6_COUNT; i++) {
+        memset(&v6[i], 0, sizeof(v6[i]));
+        v6[i].ingressInterface = 7;
+        v6[i].sourceIPv6Prefix[0] = 0x20;
+        v6[i].sourceIPv6Prefix[1] = 0x01;
+        v6[i].sourceIPv6Prefix[4] = (uint8_t)(i >> 8);
+        v6[i].sourceIPv6Prefix[5] = (uint8_t)i;
+        v6[i].sourceIPv6PrefixLength = 48;
+    }
+    rec.target_type = SAV_TARGET_TYPE_PREFIX_BASED;
+    rec.sub_template_id = SAV_TMPL_IPV6_PREFIX_INTERFACE;
+    rec.mapping_count = V6_COUNT;
+    rec.mappings.ipv6_mappings = v6;
+    CHECK(sav_state_apply_record(state, &rec, &err), "apply IPv6 record");
+
+    memset(&key, 0, sizeof(key));
+    key.target_type = SAV_TARGET_TYPE_PREFIX_BASED;
+    key.family = 6;
+    key.interface = 7;
+    key.prefix_len = 48;
+    memcpy(key.prefix, v6[123].sourceIPv6Prefix, 16);
+    CHECK(sav_state_lookup(state, &key, &got) && got.family == 6 &&
+          memcmp(got.prefix, key.prefix, 16) == 0, "IPv6 entry");
+
+    /* Remove every even IPv4 entry; all odd ones must still be found */
+    for (uint32_t i = 0; i < V4_COUNT; i += 2) {
+        ipv4_key(&key, SAV_TARGET_TYPE_INTERFACE_BASED, v4[i].ingressInterface, v4_prefix(i), 24);
+        CHECK(sav_state_remove(state, &key) == (i != 30), "remove %u", i);
+    }
+    for (uint32_t i = 0; i < V4_COUNT; i++) {
+        ipv4_key(&key, SAV_TARGET_TYPE_INTERFACE_BASED, v4[i].ingressInterface, v4_prefix(i), 24);
+        CHECK(sav_state_lookup(state, &key, NULL) == (i % 2 == 1), "lookup %u after removal", i);
+    }
+
+    uint64_t walked = 0;
+    sav_state_foreach(state, count_entry, &walked);
+    sav_state_get_stats(state, &stats);
+    CHECK(stats.ipv4_entries == V4_COUNT / 2 && stats.ipv6_entries == V6_COUNT &&
+          walked == stats.ipv4_entries + stats.ipv6_entries,
+          "walk: %lu entries", (unsigned long)walked);
+
+    /* Record-level errors are reported, not applied */
+    rec.rule_type = 9;
+    CHECK(!sav_state_apply_record(state, &rec, &err) && err != NULL, "invalid record accepted");
+    g_clear_error(&err);
+
+    printf("[State] %lu IPv4 + %lu IPv6 entries, %zu bytes\n",
+           (unsigned long)stats.ipv4_entries, (unsigned long)stats.ipv6_entries,
+           stats.memory_bytes);
+    sav_state_free(state);
+
+    if (failures) {
+        fprintf(stderr, "\n❌ SAV state test failed (%d checks)\n", failures);
+        return 1;
+    }
+    printf("\n✅ Insert, replace, lookup and remove behave\n");
+    return 0;
+}
@@ -0,0 +1,522 @@
+/**
+ * @file test_udp_collector.c
+ * @brief Loopback test for the UDP collector
+ *
+ * Sends records with all four sub-templates from one exporter to a
+ * sav_create_udp_collector() on 127.0.0.1, deliberately skipping one
+ * message. A second exporter sends data without templates. Checks that
+ * the received records match what was sent, that the skipped message is
+ * reported as a sequence gap, and that template state is not shared
+ * between exporters. A message with a record that cannot be decoded must
+ * still advance the expected sequence number, and exporters must expire
+ * after the template lifetime and respect the exporter limit. Finally
+ * several exporters send to a two-worker sav_create_udp_sharded_collector(),
+ * whose merged counters must add up.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "sav_collector.h"
+#include "sav_fast_decoder.h"
+#include "sav_wire_writer.h"
+
+#define RECORD_COUNT  60
+#define MAX_MSG_LEN   1400
+#define SKIPPED_MSG   3
+#define NO_SKIP       UINT32_MAX
+#define SHARD_WORKERS 2
+#define SHARD_SENDERS 4
+#define EXTRA_TMPL    999
+
+static sav_parsed_record_t records[RECORD_COUNT];
+static gboolean            delivered[RECORD_COUNT];
+
+/* Build a record cycling through templates 901-904 and list sizes 0-29 */
+static void make_record(uint32_t r, sav_parsed_record_t *rec)
+{
+    static const uint16_t tmpl[] = {
+        SAV_TMPL_IPV4_INTERFACE_PREFIX, SAV_TMPL_IPV6_INTERFACE_PREFIX,
+        SAV_TMPL_IPV4_PREFIX_INTERFACE, SAV_TMPL_IPV6_PREFIX_INTERFACE,
+    };
+
+    memset(rec, 0, sizeof(*rec));
+    rec->timestamp_ms = 1700000000000ULL + r;
+    rec->rule_type = (uint8_t)(r % 2);
+    rec->target_type = (uint8_t)((r / 2) % 2);
+    rec->policy_action = (uint8_t)(r % 4);
+    rec->sub_template_id = tmpl[r % 4];
+    rec->mapping_count = (r * 7) % 30;
+
+    if (rec->sub_template_id == SAV_TMPL_IPV4_INTERFACE_PREFIX ||
+        rec->sub_template_id == SAV_TMPL_IPV4_PREFIX_INTERFACE) {
+        rec->mappings.ipv4_mappings = g_new0(sav_ipv4_mapping_t, rec->mapping_count);
+        for (uint32_t m = 0; m < rec->mapping_count; m++) {
+            rec->mappings.ipv4_mappings[m].ingressInterface = 100 + m;
+            rec->mappings.ipv4_mappings[m].sourceIPv4Prefix = 0xC0A80000u + (r << 8) + m;
+            rec->mappings.ipv4_mappings[m].sourceIPv4PrefixLength = (uint8_t)(8 + m);
+        }
+    } else {
+        rec->mappings.ipv6_mappings = g_new0(sav_ipv6_mapping_t, rec->mapping_count);
+        for (uint32_t m = 0; m < rec->mapping_count; m++) {
+            sav_ipv6_mapping_t *v6 = &rec->mappings.ipv6_mappings[m];
+            v6->ingressInterface = 200 + m;
+            v6->sourceIPv6Prefix[0] = 0x20;
+            v6->sourceIPv6Prefix[1] = 0x01;
+            v6->sourceIPv6Prefix[2] = 0x0d;
+            v6->sourceIPv6Prefix[3] = 0xb8;
+            v6->sourceIPv6Prefix[6] = (uint8_t)r;
+            v6->sourceIPv6Prefix[7] = (uint8_t)m;
+            v6->sourceIPv6PrefixLength = (uint8_t)(32 + m);
+        }
+    }
+}
+
+static int open_sender(uint16_t port)
+{
+    struct sockaddr_in sin;
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_port = htons(port);
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&sin, sizeof(sin)) != 0) {
+        perror("sender socket");
+        exit(1);
+    }
+    return fd;
+}
+
+/* Send all records from one exporter, leaving out message skip_msg;
+ * returns the number of records in the message that was left out */
+static uint32_t send_records(int fd, uint32_t domain_id, uint32_t skip_msg)
+{
+    uint8_t buf[MAX_MSG_LEN];
+    sav_wire_writer_t w;
+    uint32_t msg_index = 0;
+    uint32_t skipped = 0;
+    uint32_t r = 0;
+
+    sav_wire_writer_init(&w, buf, sizeof(buf), domain_id);
+
+    while (r < RECORD_COUNT) {
+        uint32_t first = r;
+        sav_wire_begin_message(&w, 1700000000);
+        if (msg_index == 0 && !sav_wire_add_templates(&w)) {
+            fprintf(stderr, "✗ sav_wire_add_templates failed\n");
+            exit(1);
+        }
+        while (r < RECORD_COUNT && sav_wire_add_record(&w, &records[r])) {
+            r++;
+        }
+        if (r == first && msg_index > 0) {
+            fprintf(stderr, "✗ record %u does not fit into a message\n", r);
+            exit(1);
+        }
+
+        size_t len = sav_wire_finish_message(&w);
+        if (msg_index == skip_msg) {
+            skipped = r - first;
+        } else {
+            for (uint32_t i = first; i < r; i++) {
+                delivered[i] = TRUE;
+            }
+            if (send(fd, buf, len, 0) != (ssize_t)len) {
+                perror("send");
+                exit(1);
+            }
+        }
+        msg_index++;
+    }
+
+    return skipped;
+}
+
+/* Data for template 400 from an exporter that never sent the template */
+static void send_without_templates(int fd)
+{
+    uint8_t buf[MAX_MSG_LEN];
+    sav_wire_writer_t w;
+
+    sav_wire_writer_init(&w, buf, sizeof(buf), 2);
+    sav_wire_begin_message(&w, 1700000000);
+    sav_wire_add_record(&w, &records[1]);
+    size_t len = sav_wire_finish_message(&w);
+    if (send(fd, buf, len, 0) != (ssize_t)len) {
+        perror("send");
+        exit(1);
+    }
+}
+
+/* Send records [first, first + count) in one message; with corrupt set, the
+ * first record's list uses EXTRA_TMPL instead of 901 */
+static void send_message(int fd, sav_wire_writer_t *w, gboolean templates,
+                         uint32_t first, uint32_t count, gboolean corrupt)
+{
+    sav_wire_begin_message(w, 1700000000);
+    if (templates) {
+        sav_wire_add_templates(w);
+    }
+    for (uint32_t r = first; r < first + count; r++) {
+        if (!sav_wire_add_record(w, &records[r])) {
+            fprintf(stderr, "✗ record %u does not fit into a message\n", r);
+            exit(1);
+        }
+    }
+    size_t len = sav_wire_finish_message(w);
+
+    if (corrupt) {
+        /* Header, set header, time, rule, target, one-byte length, semantic */
+        uint8_t *stl = w->buf + SAV_IPFIX_MSG_HEADER_LEN + SAV_IPFIX_SET_HEADER_LEN + 11;
+        if (templates || stl[-1] == 255) {
+            fprintf(stderr, "✗ cannot corrupt this message\n");
+            exit(1);
+        }
+        sav_write_be16(stl + 1, EXTRA_TMPL);
+    }
+    if (send(fd, w->buf, len, 0) != (ssize_t)len) {
+        perror("send");
+        exit(1);
+    }
+}
+
+/* Define EXTRA_TMPL with the layout of 901 in a message without data;
+ * the collector does not decode lists of it */
+static void send_extra_template(int fd, const sav_wire_writer_t *w)
+{
+    static const uint16_t fields[3][2] = { { 10, 4 }, { 44, 4 }, { 9, 1 } };
+    uint8_t msg[SAV_IPFIX_MSG_HEADER_LEN + 8 + 12];
+
+    sav_write_be16(msg, SAV_IPFIX_VERSION);
+    sav_write_be16(msg + 2, sizeof(msg));
+    sav_write_be32(msg + 4, 1700000000);
+    sav_write_be32(msg + 8, w->sequence);
+    sav_write_be32(msg + 12, w->domain_id);
+    sav_write_be16(msg + 16, SAV_IPFIX_TEMPLATE_SET_ID);
+    sav_write_be16(msg + 18, 8 + 12);
+    sav_write_be16(msg + 20, EXTRA_TMPL);
+    sav_write_be16(msg + 22, 3);
+    for (int i = 0; i < 3; i++) {
+        sav_write_be16(msg + 24 + 4 * i, fields[i][0]);
+        sav_write_be16(msg + 26 + 4 * i, fields[i][1]);
+    }
+    if (send(fd, msg, sizeof(msg), 0) != (ssize_t)sizeof(msg)) {
+        perror("send");
+        exit(1);
+    }
+}
+
+/* Read until the receive timeout; returns the records, errors in *errors */
+static uint32_t drain(sav_collector_ctx_t *ctx, uint32_t *errors)
+{
+    GError *err = NULL;
+    sav_record_view_t view;
+    uint32_t n = 0;
+
+    *errors = 0;
+    for (;;) {
+        if (sav_read_record_view(ctx, &view, &err)) {
+            n++;
+            continue;
+        }
+        if (g_error_matches(err, FB_ERROR_DOMAIN, FB_ERROR_NLREAD)) {
+            g_clear_error(&err);
+            return n;
+        }
+        (*errors)++;
+        g_clear_error(&err);
+    }
+}
+
+/* A record that fails to decode (its list uses a template the collector does
+ * not know) still counts towards the sequence number */
+static uint32_t test_sequence_accounting(void)
+{
+    GError *err = NULL;
+    uint8_t buf[MAX_MSG_LEN];
+    sav_wire_writer_t w;
+    sav_udp_stats_t stats;
+    uint32_t errors;
+    uint32_t failures = 0;
+
+    sav_collector_ctx_t *ctx = sav_create_udp_collector("127.0.0.1", 0, 300, &err);
+    if (!ctx) {
+        fprintf(stderr, "✗ sav_create_udp_collector: %s\n", err->message);
+        g_clear_error(&err);
+        return 1;
+    }
+    int fd = open_sender(sav_udp_collector_get_port(ctx));
+
+    /* Records 12-14 use IPv4 and IPv6 lists short enough for a one-byte length */
+    sav_wire_writer_init(&w, buf, sizeof(buf), 5);
+    send_message(fd, &w, TRUE, 12, 3, FALSE);
+    send_extra_template(fd, &w);
+    send_message(fd, &w, FALSE, 12, 3, TRUE);
+    send_message(fd, &w, FALSE, 12, 3, FALSE);
+
+    uint32_t n = drain(ctx, &errors);
+    sav_udp_collector_get_stats(ctx, &stats);
+    printf("Sequence:        %u records, %u errors, %lu gaps after an undecodable record\n",
+           n, errors, (unsigned long)stats.sequence_gaps);
+
+    /* The error ends the second datagram; its records are not lost ones */
+    if (n != 6 || errors != 1) {
+        fprintf(stderr, "✗ sequence: expected 6 records and one error\n");
+        failures++;
+    }
+    if (stats.sequence_gaps != 0 || stats.lost_records != 0) {
+        fprintf(stderr, "✗ sequence: undecodable record reported as a gap\n");
+        failures++;
+    }
+
+    close(fd);
+    sav_collector_ctx_destroy(ctx);
+    return failures;
+}
+
+/* Exporters expire after the template lifetime; the table has a limit */
+static uint32_t test_exporter_limits(void)
+{
+    GError *err = NULL;
+    uint8_t buf_a[MAX_MSG_LEN], buf_b[MAX_MSG_LEN];
+    sav_wire_writer_t wa, wb;
+    sav_udp_stats_t stats;
+    uint32_t errors;
+    uint32_t failures = 0;
+
+    sav_collector_ctx_t *ctx = sav_create_udp_collector("127.0.0.1", 0, 300, &err);
+    if (!ctx || !sav_udp_collector_set_exporter_limits(ctx, 1, 1, &err)) {
+        fprintf(stderr, "✗ UDP collector setup: %s\n", err->message);
+        g_clear_error(&err);
+        if (ctx) sav_collector_ctx_destroy(ctx);
+        return 1;
+    }
+    uint16_t port = sav_udp_collector_get_port(ctx);
+    int fd_a = open_sender(port);
+    int fd_b = open_sender(port);
+    sav_wire_writer_init(&wa, buf_a, sizeof(buf_a), 1);
+    sav_wire_writer_init(&wb, buf_b, sizeof(buf_b), 1);
+
+    /* A fills the table of one; B is turned away while A is alive */
+    send_message(fd_a, &wa, TRUE, 0, 1, FALSE);
+    uint32_t n_a = drain(ctx, &errors);
+    send_message(fd_b, &wb, TRUE, 0, 1, FALSE);
+    uint32_t n_full = drain(ctx, &errors);
+    uint32_t errors_full = errors;
+
+    /* Once A has been silent for longer than the lifetime, B gets its slot */
+    g_usleep(2 * G_USEC_PER_SEC);
+    send_message(fd_b, &wb, TRUE, 1, 1, FALSE);
+    uint32_t n_b = drain(ctx, &errors);
+
+    sav_udp_collector_get_stats(ctx, &stats);
+    printf("Exporter limits: %u/%u/%u records, %lu expired, %lu dropped at the limit\n",
+           n_a, n_full, n_b, (unsigned long)stats.expired_exporters,
+           (unsigned long)stats.table_full_drops);
+
+    if (n_a != 1 || n_full != 0 || errors_full != 1 || n_b != 1) {
+        fprintf(stderr, "✗ limits: expected 1/0/1 records and one rejected datagram\n");
+        failures++;
+    }
+    if (stats.expired_exporters != 1 || stats.table_full_drops != 1 || stats.exporters != 2) {
+        fprintf(stderr, "✗ limits: expected one expired exporter and one drop\n");
+        failures++;
+    }
+
+    close(fd_a);
+    close(fd_b);
+    sav_collector_ctx_destroy(ctx);
+    return failures;
+}
+
+static gboolean count_record(const sav_record_view_t *view, uint32_t worker, gpointer user_data)
+{
+    uint64_t *per_worker = user_data;
+    (void)view;
+    per_worker[worker]++;
+    return TRUE;
+}
+
+/* Several exporters against a sharded collector */
+static uint32_t test_sharded(void)
+{
+    GError *err = NULL;
+    uint32_t failures = 0;
+
+    sav_collector_ctx_t *ctx = sav_create_udp_sharded_collector(
+        "127.0.0.1", 0, SHARD_WORKERS, 300, &err);
+    if (!ctx) {
+        fprintf(stderr, "✗ sav_create_udp_sharded_collector: %s\n", err->message);
+        g_clear_error(&err);
+        return 1;
+    }
+
+    uint16_t port = sav_udp_collector_get_port(ctx);
+    for (uint32_t i = 0; i < SHARD_SENDERS; i++) {
+        int fd = open_sender(port);
+        send_records(fd, 10 + i, NO_SKIP);
+        close(fd);
+    }
+
+    uint64_t per_worker[SHARD_WORKERS] = { 0 };
+    if (!sav_udp_collector_run(ctx, count_record, per_worker, &err)) {
+        fprintf(stderr, "✗ sav_udp_collector_run: %s\n", err->message);
+        g_clear_error(&err);
+        failures++;
+    }
+
+    uint64_t delivered_total = 0;
+    for (uint32_t i = 0; i < SHARD_WORKERS; i++) {
+        delivered_total += per_worker[i];
+    }
+
+    uint64_t records_read = 0, parse_errors = 0;
+    sav_udp_stats_t stats;
+    sav_collector_get_stats(ctx, &records_read, &parse_errors);
+    sav_udp_collector_get_stats(ctx, &stats);
+
+    printf("Sharded:         %lu records from %u exporters on %u workers\n",
+           (unsigned long)records_read, stats.exporters, SHARD_WORKERS);
+
+    if (records_read != (uint64_t)SHARD_SENDERS * RECORD_COUNT ||
+        delivered_total != records_read || parse_errors != 0) {
+        fprintf(stderr, "✗ sharded: expected %u records, read %lu, delivered %lu\n",
+                SHARD_SENDERS * RECORD_COUNT, (unsigned long)records_read,
+                (unsigned long)delivered_total);
+        failures++;
+    }
+    if (stats.exporters != SHARD_SENDERS || stats.sequence_gaps != 0) {
+        fprintf(stderr, "✗ sharded: expected %u exporters and no gaps\n", SHARD_SENDERS);
+        failures++;
+    }
+
+    sav_collector_ctx_destroy(ctx);
+    return failures;
+}
+
+static int compare_record(const sav_parsed_record_t *a, const sav_parsed_record_t *b)
+{
+    if (a->timestamp_ms != b->timestamp_ms || a->rule_type != b->rule_type ||
+        a->target_type != b->target_type || a->policy_action != b->policy_action ||
+        a->sub_template_id != b->sub_template_id || a->mapping_count != b->mapping_count) {
+        return 1;
+    }
+
+    for (uint32_t m = 0; m < a->mapping_count; m++) {
+        if (a->sub_template_id == SAV_TMPL_IPV4_INTERFACE_PREFIX ||
+            a->sub_template_id == SAV_TMPL_IPV4_PREFIX_INTERFACE) {
+            const sav_ipv4_mapping_t *x = &a->mappings.ipv4_mappings[m];
+            const sav_ipv4_mapping_t *y = &b->mappings.ipv4_mappings[m];
+            if (x->ingressInterface != y->ingressInterface ||
+                x->sourceIPv4Prefix != y->sourceIPv4Prefix ||
+                x->sourceIPv4PrefixLength != y->sourceIPv4PrefixLength) {
+                return 1;
+            }
+        } else {
+            const sav_ipv6_mapping_t *x = &a->mappings.ipv6_mappings[m];
+            const sav_ipv6_mapping_t *y = &b->mappings.ipv6_mappings[m];
+            if (x->ingressInterface != y->ingressInterface ||
+                memcmp(x->sourceIPv6Prefix, y->sourceIPv6Prefix, 16) != 0 ||
+                x->sourceIPv6PrefixLength != y->sourceIPv6PrefixLength) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(void)
+{
+    GError *err = NULL;
+
+    printf("=== UDP Collector Test ===\n\n");
+
+    sav_collector_ctx_t *ctx = sav_create_udp_collector("127.0.0.1", 0, 500, &err);
+    if (!ctx) {
+        fprintf(stderr, "✗ sav_create_udp_collector: %s\n", err->message);
+        return 1;
+    }
+    uint16_t port = sav_udp_collector_get_port(ctx);
+    printf("Collector listening on 127.0.0.1:%u\n", port);
+
+    for (uint32_t r = 0; r < RECORD_COUNT; r++) {
+        make_record(r, &records[r]);
+    }
+
+    int fd1 = open_sender(port);
+    int fd2 = open_sender(port);
+    uint32_t skipped = send_records(fd1, 1, SKIPPED_MSG);
+    send_without_templates(fd2);
+
+    /* Read until the receive timeout */
+    uint32_t expected = 0;
+    uint32_t failures = 0;
+    sav_parsed_record_t rec;
+
+    while (sav_read_record(ctx, &rec, &err)) {
+        while (expected < RECORD_COUNT && !delivered[expected]) {
+            expected++;
+        }
+        if (expected == RECORD_COUNT || compare_record(&rec, &records[expected]) != 0) {
+            fprintf(stderr, "✗ record %u differs from what was sent\n", expected);
+            failures++;
+        }
+        expected++;
+        sav_free_parsed_record(&rec);
+    }
+    if (!g_error_matches(err, FB_ERROR_DOMAIN, FB_ERROR_NLREAD)) {
+        fprintf(stderr, "✗ read ended with: %s\n", err ? err->message : "no error");
+        failures++;
+    }
+    g_clear_error(&err);
+
+    uint64_t records_read = 0, parse_errors = 0;
+    sav_udp_stats_t stats;
+    sav_collector_get_stats(ctx, &records_read, &parse_errors);
+    sav_udp_collector_get_stats(ctx, &stats);
+
+    printf("Records read:    %lu (%u sent)\n", (unsigned long)records_read,
+           RECORD_COUNT - skipped);
+    printf("Datagrams:       %lu\n", (unsigned long)stats.datagrams);
+    printf("Exporters:       %u\n", stats.exporters);
+    printf("Sequence gaps:   %lu (%lu records lost)\n",
+           (unsigned long)stats.sequence_gaps, (unsigned long)stats.lost_records);
+    printf("Socket drops:    %lu\n", (unsigned long)stats.socket_drops);
+
+    if (records_read != RECORD_COUNT - skipped || parse_errors != 0) {
+        fprintf(stderr, "✗ expected %u records and no parse errors\n", RECORD_COUNT - skipped);
+        failures++;
+    }
+    if (stats.sequence_gaps != 1 || stats.lost_records != skipped) {
+        fprintf(stderr, "✗ expected one gap of %u records\n", skipped);
+        failures++;
+    }
+    if (stats.exporters != 2) {
+        fprintf(stderr, "✗ expected 2 exporters\n");
+        failures++;
+    }
+
+    close(fd1);
+    close(fd2);
+    sav_collector_ctx_destroy(ctx);
+
+    failures += test_sequence_accounting();
+    failures += test_exporter_limits();
+    failures += test_sharded();
+
+    for (uint32_t r = 0; r < RECORD_COUNT; r++) {
+        sav_free_parsed_record(&records[r]);
+    }
+
+    if (failures) {
+        fprintf(stderr, "\n✗ %u check(s) failed\n", failures);
+        return 1;
+    }
+    printf("\n✓ UDP collector test passed\n");
+    return 0;
+}
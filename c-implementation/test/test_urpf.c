@@ -0,0 +1,223 @@
+/**
+ * @file test_urpf.c
+ * @brief Strict, feasible and loose uRPF checks against a linear reference
+ *
+ * Adds random nested IPv4 mappings over a few thousand interfaces, some of
+ * them with large ifIndex values, and checks every mode for random source
+ * addresses and interfaces (known and unknown) against a scan over all
+ * mappings. Checks a small IPv6 table by hand, with feasible checks
+ * disabled and enabled, and check_n against check.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sav_lpm.h"
+
+#define ROUTES   4000
+#define PROBES   20000
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do {                              \
+    if (!(cond)) {                                         \
+        fprintf(stderr, "✗ " __VA_ARGS__);                  \
+        fprintf(stderr, "\n");                             \
+        failures++;                                        \
+    }                                                      \
+} while (0)
+
+typedef struct {
+    uint32_t  prefix;
+    uint8_t   len;
+    uint32_t  iface;
+    uint8_t   rule;
+} route_t;
+
+static route_t routes[ROUTES];
+static size_t n_routes = 0;
+
+static const char *mode_names[] = { "strict", "feasible", "loose" };
+
+static uint32_t mask4(uint8_t len)
+{
+    return len ? 0xFFFFFFFFu << (32 - len) : 0;
+}
+
+static uint32_t rnd32(void)
+{
+    return ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+}
+
+/* Mostly dense ifIndex values, some far apart */
+static uint32_t rnd_iface(void)
+{
+    return rand() % 8 ? 1 + (uint32_t)(rand() % 3000) : 1000000 + (uint32_t)(rand() % 64) * 4096;
+}
+
+static gboolean reference(uint32_t addr, uint32_t iface, sav_urpf_mode_t mode)
+{
+    int best = -1;
+    gboolean allow = FALSE, block = FALSE, feasible = FALSE, any = FALSE;
+
+    for (size_t i = 0; i < n_routes; i++) {
+        const route_t *r = &routes[i];
+        if ((addr & mask4(r->len)) == r->prefix && r->len > best) best = r->len;
+    }
+    for (size_t i = 0; i < n_routes; i++) {
+        const route_t *r = &routes[i];
+        if ((addr & mask4(r->len)) != r->prefix) continue;
+        if (r->rule == SAV_RULE_TYPE_ALLOWLIST) {
+            any = TRUE;
+            feasible |= r->iface == iface;
+            allow |= r->len == best && r->iface == iface;
+        } else {
+            block |= r->len == best && r->iface == iface;
+        }
+    }
+    if (block) return FALSE;
+    return mode == SAV_URPF_STRICT ? allow : mode == SAV_URPF_FEASIBLE ? feasible : any;
+}
+
+static void test_ipv4(void)
+{
+    sav_lpm4_t *lpm = sav_lpm4_new();
+    sav_lpm_stats_t stats;
+    GError *err = NULL;
+
+    sav_lpm4_set_feasible(lpm, TRUE);
+    for (size_t i = 0; i < ROUTES; i++) {
+        route_t *r = &routes[n_routes];
+        if (i > 0 && rand() % 2) {
+            /* Nest inside an earlier prefix, or repeat it on another interface */
+            const route_t *outer = &routes[rand() % n_routes];
+            uint32_t longer = outer->len + (uint32_t)(rand() % 9);
+            r->len = (uint8_t)MIN(32u, longer);
+            r->prefix = (outer->prefix | (rnd32() & ~mask4(outer->len))) & mask4(r->len);
+        } else {
+            r->len = (uint8_t)(8 + rand() % 17);
+            r->prefix = (0x0A000000u | (rnd32() & 0x00FFFFFFu)) & mask4(r->len);
+        }
+        r->iface = rnd_iface();
+        r->rule = rand() % 4 ? SAV_RULE_TYPE_ALLOWLIST : SAV_RULE_TYPE_BLOCKLIST;
+        CHECK(sav_lpm4_add(lpm, r->prefix, r->len, r->iface, r->rule, SAV_POLICY_ACTION_DISCARD),
+              "add /%u", r->len);
+        n_routes++;
+    }
+    CHECK(sav_lpm4_build(lpm, &err), "build");
+
+    static uint32_t addrs[PROBES], ifaces[PROBES];
+    static uint8_t valid[PROBES];
+    for (uint32_t i = 0; i < PROBES; i++) {
+        const route_t *r = &routes[rand() % n_routes];
+        addrs[i] = rand() % 8 ? r->prefix | (rnd32() & ~mask4(r->len)) : rnd32();
+        /* Usually an interface of a mapping, sometimes one nothing names */
+        ifaces[i] = rand() % 8 ? routes[rand() % n_routes].iface : 5000 + (uint32_t)(rand() % 100);
+        if (rand() % 3 == 0) ifaces[i] = r->iface;
+    }
+
+    for (int mode = SAV_URPF_STRICT; mode <= SAV_URPF_LOOSE; mode++) {
+        uint32_t n_valid = 0;
+        sav_lpm4_check_n(lpm, addrs, ifaces, PROBES - 7, (sav_urpf_mode_t)mode, valid);
+        for (uint32_t i = 0; i < PROBES - 7 && failures < 20; i++) {
+            gboolean single = sav_lpm4_check(lpm, addrs[i], ifaces[i], (sav_urpf_mode_t)mode);
+            CHECK(single == valid[i], "%s probe %u: check_n %u, check %d",
+                  mode_names[mode], i, valid[i], single);
+            if (i % 4 == 0) {
+                gboolean expect = reference(addrs[i], ifaces[i], (sav_urpf_mode_t)mode);
+                CHECK(single == expect, "%s: 0x%08x on %u is %d, expected %d",
+                      mode_names[mode], addrs[i], ifaces[i], single, expect);
+            }
+            n_valid += valid[i];
+        }
+        printf("[IPv4] %-8s %u of %u valid\n", mode_names[mode], n_valid, PROBES - 7);
+    }
+
+    sav_lpm4_get_stats(lpm, &stats);
+    printf("[IPv4] %lu prefixes, %lu leaves, %lu interfaces, %zu bytes\n",
+           (unsigned long)stats.prefixes, (unsigned long)stats.leaves,
+           (unsigned long)stats.interfaces, stats.memory_bytes);
+    sav_lpm4_free(lpm);
+}
+
+static void test_ipv6(void)
+{
+    sav_lpm6_t *lpm = sav_lpm6_new();
+    GError *err = NULL;
+    uint8_t p[16] = { 0x20, 0x01, 0x0d, 0xb8 };
+
+    /* Before any mapping nothing is valid, not even loosely */
+    CHECK(sav_lpm6_build(lpm, &err), "empty build");
+    CHECK(!sav_lpm6_check(lpm, p, 1, SAV_URPF_LOOSE), "empty table: loose valid");
+
+    /* 2001:db8::/32 allow on 1 and 5000; 2001:db8:1::/48 allow on 2, block on 5000 */
+    sav_lpm6_add(lpm, p, 32, 1, SAV_RULE_TYPE_ALLOWLIST, SAV_POLICY_ACTION_PERMIT);
+    sav_lpm6_add(lpm, p, 32, 5000, SAV_RULE_TYPE_ALLOWLIST, SAV_POLICY_ACTION_PERMIT);
+    p[5] = 0x01;
+    sav_lpm6_add(lpm, p, 48, 2, SAV_RULE_TYPE_ALLOWLIST, SAV_POLICY_ACTION_PERMIT);
+    sav_lpm6_add(lpm, p, 48, 5000, SAV_RULE_TYPE_BLOCKLIST, SAV_POLICY_ACTION_DISCARD);
+    CHECK(sav_lpm6_build(lpm, &err), "build");
+
+    p[15] = 0x07;
+    CHECK(sav_lpm6_check(lpm, p, 2, SAV_URPF_STRICT), "/48 strict on 2");
+    CHECK(!sav_lpm6_check(lpm, p, 1, SAV_URPF_STRICT), "/48 strict on 1");
+    CHECK(sav_lpm6_check(lpm, p, 3, SAV_URPF_LOOSE), "/48 loose on 3");
+    CHECK(!sav_lpm6_check(lpm, p, 5000, SAV_URPF_LOOSE), "/48 blocked 5000 loose");
+    p[5] = 0x02;
+    CHECK(sav_lpm6_check(lpm, p, 5000, SAV_URPF_STRICT), "/32 strict on 5000");
+    p[3] = 0xb9;
+    CHECK(!sav_lpm6_check(lpm, p, 1, SAV_URPF_LOOSE), "2001:db9:: loose");
+
+    /* Without feasible checks the /48 only knows its own interfaces */
+    p[3] = 0xb8;
+    p[5] = 0x01;
+    CHECK(!sav_lpm6_check(lpm, p, 1, SAV_URPF_FEASIBLE), "/48 feasible on 1 while disabled");
+    CHECK(sav_lpm6_check(lpm, p, 2, SAV_URPF_FEASIBLE), "/48 feasible on 2 while disabled");
+    CHECK(sav_lpm6_check(lpm, p, 3, SAV_URPF_LOOSE), "/48 loose on 3 while disabled");
+    sav_lpm6_set_feasible(lpm, TRUE);
+    CHECK(sav_lpm6_build(lpm, &err), "feasible build");
+    CHECK(sav_lpm6_check(lpm, p, 1, SAV_URPF_FEASIBLE), "/48 feasible on 1");
+    CHECK(!sav_lpm6_check(lpm, p, 3, SAV_URPF_FEASIBLE), "/48 feasible on 3");
+    CHECK(!sav_lpm6_check(lpm, p, 5000, SAV_URPF_FEASIBLE), "/48 blocked 5000 feasible");
+    p[5] = 0x02;
+    CHECK(!sav_lpm6_check(lpm, p, 2, SAV_URPF_FEASIBLE), "/32 feasible on 2");
+
+    /* check_n against check over addresses around the prefixes */
+    static uint8_t addrs[PROBES * 16];
+    static uint32_t ifaces[PROBES];
+    static uint8_t valid[PROBES];
+    for (uint32_t i = 0; i < PROBES; i++) {
+        uint8_t *a = &addrs[(size_t)i * 16];
+        for (int k = 0; k < 16; k++) a[k] = (uint8_t)rand();
+        a[0] = 0x20; a[1] = 0x01; a[2] = 0x0d; a[3] = 0xb8 + (rand() % 4 == 0);
+        a[4] = 0;
+        a[5] = (uint8_t)(rand() % 3);
+        ifaces[i] = (uint32_t[]){ 1, 2, 3, 5000 }[rand() % 4];
+    }
+    for (int mode = SAV_URPF_STRICT; mode <= SAV_URPF_LOOSE; mode++) {
+        sav_lpm6_check_n(lpm, addrs, ifaces, PROBES - 5, (sav_urpf_mode_t)mode, valid);
+        for (uint32_t i = 0; i < PROBES - 5 && failures < 20; i++) {
+            gboolean single = sav_lpm6_check(lpm, &addrs[(size_t)i * 16], ifaces[i],
+                                             (sav_urpf_mode_t)mode);
+            CHECK(single == valid[i], "IPv6 %s probe %u: check_n %u, check %d",
+                  mode_names[mode], i, valid[i], single);
+        }
+    }
+    sav_lpm6_free(lpm);
+}
+
+int main(void)
+{
+    printf("=== SAV uRPF Check Test ===\n\n");
+    srand(23);
+
+    test_ipv4();
+    test_ipv6();
+
+    if (failures) {
+        fprintf(stderr, "\n❌ SAV uRPF test failed (%d checks)\n", failures);
+        return 1;
+    }
+    printf("\n✅ Checks match a linear scan in all modes\n");
+    return 0;
+}
@@ -0,0 +1,285 @@
+/**
+ * @file sav_diff.c
+ * @brief Compare the SAV rule tables of two IPFIX captures
+ *
+ * Usage: sav_diff [options] <before> <after>
+ * Options:
+ *   -n, --ndjson   One JSON object per change
+ *   -s, --stats    Show only the counts
+ *   -t, --threads  Decode with N threads
+ *   -d, --tmpdir   Directory for the intermediate snapshots
+ *   -h, --help     Show this help
+ *
+ * Each capture is decoded and applied to a rule table as a collector
+ * would (later mappings replace earlier ones with the same key), and the
+ * table is written to a snapshot file (see sav_snapshot.h), which holds
+ * its entries sorted by interface and key; the table is freed before the
+ * next capture is decoded. The two snapshots are then mapped and walked
+ * once, side by side, reporting mappings only in the first (removed),
+ * only in the second (added) and in both with another rule type or
+ * policy action (changed). At most one table is in memory at a time and
+ * the merge itself reads the maps sequentially, so the page cache can
+ * drop what it has passed. Snapshot files may be given instead of
+ * captures.
+ *
+ * Exit status: 0 if the tables are the same, 1 if they differ, 2 on error.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <arpa/inet.h>
+#include "sav_collector.h"
+#include "sav_snapshot.h"
+
+/* Records decoded per sav_read_batch() call */
+#define SAV_DIFF_BATCH_SIZE 256
+
+typedef enum {
+    DIFF_TEXT,
+    DIFF_NDJSON,
+    DIFF_STATS
+} diff_format_t;
+
+static void print_usage(const char *prog_name)
+{
+    printf("Usage: %s [options] <before> <after>\n\n", prog_name);
+    printf("Compares the rule tables of two SAV IPFIX files (or snapshot files).\n\n");
+    printf("Options:\n");
+    printf("  -n, --ndjson      One JSON object per change\n");
+    printf("  -s, --stats       Show only the counts\n");
+    printf("  -t, --threads N   Decode each file with N threads\n");
+    printf("  -d, --tmpdir DIR  Directory for the intermediate snapshots\n");
+    printf("                    (default: %s)\n", g_get_tmp_dir());
+    printf("  -h, --help        Show this help\n\n");
+    printf("Output lines: '+' added, '-' removed, '~' changed (old -> new).\n");
+    printf("Mappings whose only change is observationTimeMilliseconds are the same.\n\n");
+    printf("Examples:\n");
+    printf("  %s before.ipfix after.ipfix\n", prog_name);
+    printf("  %s -n before.ipfix after.ipfix > changes.ndjson\n", prog_name);
+    printf("  %s -s -t 8 before.ipfix after.ipfix\n\n", prog_name);
+}
+
+/* Snapshot files start with the magic in host byte order */
+static gboolean is_snapshot(const char *path)
+{
+    uint32_t magic = 0;
+    FILE *fp = fopen(path, "rb");
+
+    if (!fp) {
+        return FALSE;
+    }
+    gboolean found = fread(&magic, sizeof(magic), 1, fp) == 1 && magic == SAV_SNAPSHOT_MAGIC;
+    fclose(fp);
+    return found;
+}
+
+/* Apply every record of an IPFIX file to state */
+static gboolean decode_file(const char *path, uint32_t threads, sav_state_t *state,
+                            GError **err)
+{
+    sav_collector_ctx_t *collector = (threads > 1)
+        ? sav_create_parallel_file_collector(path, threads, err)
+        : sav_create_file_collector(path, err);
+    if (!collector) {
+        return FALSE;
+    }
+
+    sav_parsed_record_t batch[SAV_DIFF_BATCH_SIZE];
+    sav_arena_t arena;
+    uint32_t n;
+
+    sav_arena_init(&arena, 0);
+    while ((n = sav_read_batch(collector, batch, SAV_DIFF_BATCH_SIZE, &arena, err)) > 0) {
+        for (uint32_t i = 0; i < n; i++) {
+            sav_state_apply_record(state, &batch[i], NULL);
+        }
+        sav_arena_reset(&arena);
+    }
+    sav_arena_destroy(&arena);
+    sav_close_collector(collector);
+
+    if (*err && (*err)->code != FB_ERROR_EOF) {
+        return FALSE;
+    }
+    g_clear_error(err);
+    return TRUE;
+}
+
+/*
+ * Sorted entries of one input: the snapshot itself, or the table decoded
+ * from the capture written to tmp_path
+ */
+static sav_snapshot_t* open_input(const char *path, uint32_t threads, const char *tmp_path,
+                                  GError **err)
+{
+    if (is_snapshot(path)) {
+        return sav_snapshot_open(path, err);
+    }
+
+    sav_state_t *state = sav_state_new();
+    sav_state_stats_t stats;
+    gboolean ok = decode_file(path, threads, state, err) &&
+                  sav_snapshot_write(state, tmp_path, 0, err);
+
+    sav_state_get_stats(state, &stats);
+    if (ok && stats.rejected) {
+        fprintf(stderr, "⚠ %s: %lu invalid mappings skipped\n", path,
+                (unsigned long)stats.rejected);
+    }
+    sav_state_free(state);
+    return ok ? sav_snapshot_open(tmp_path, err) : NULL;
+}
+
+/* One change; old is NULL for added, cur is NULL for removed */
+static void print_change(diff_format_t format, const sav_snapshot_entry_t *old,
+                         const sav_snapshot_entry_t *cur)
+{
+    const sav_snapshot_entry_t *e = cur ? cur : old;
+    char addr[INET6_ADDRSTRLEN];
+
+    inet_ntop(e->family == 4 ? AF_INET : AF_INET6, e->prefix, addr, sizeof(addr));
+    if (format == DIFF_NDJSON) {
+        printf("{\"change\":\"%s\",\"interface\":%u,\"prefix\":\"%s\",\"prefix_length\":%u",
+               !old ? "added" : !cur ? "removed" : "changed", e->interface, addr, e->prefix_len);
+        printf(",\"target_type_name\":\"%s\",\"rule_type_name\":\"%s\",\"policy_action_name\":\"%s\"",
+               sav_target_type_name(e->target_type), sav_rule_type_name(e->rule_type),
+               sav_policy_action_name(e->policy_action));
+        if (old && cur) {
+            printf(",\"old_rule_type_name\":\"%s\",\"old_policy_action_name\":\"%s\"",
+                   sav_rule_type_name(old->rule_type), sav_policy_action_name(old->policy_action));
+        }
+        printf("}\n");
+        return;
+    }
+
+    printf("%c %u %s/%u %s ", !old ? '+' : !cur ? '-' : '~', e->interface, addr,
+           e->prefix_len, sav_target_type_name(e->target_type));
+    if (old && cur) {
+        printf("%s %s -> ", sav_rule_type_name(old->rule_type),
+               sav_policy_action_name(old->policy_action));
+    }
+    printf("%s %s\n", sav_rule_type_name(e->rule_type), sav_policy_action_name(e->policy_action));
+}
+
+int main(int argc, char *argv[])
+{
+    diff_format_t format = DIFF_TEXT;
+    uint32_t threads = 1;
+    const char *tmpdir = g_get_tmp_dir();
+
+    static struct option long_options[] = {
+        {"ndjson",  no_argument,       0, 'n'},
+        {"stats",   no_argument,       0, 's'},
+        {"threads", required_argument, 0, 't'},
+        {"tmpdir",  required_argument, 0, 'd'},
+        {"help",    no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "nst:d:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'n':
+                format = DIFF_NDJSON;
+                break;
+            case 's':
+                format = DIFF_STATS;
+                break;
+            case 't':
+                threads = (uint32_t)strtoul(optarg, NULL, 10);
+                if (threads == 0) {
+                    fprintf(stderr, "ERROR: Invalid thread count: %s\n", optarg);
+                    return 2;
+                }
+                break;
+            case 'd':
+                tmpdir = optarg;
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 2;
+        }
+    }
+
+    if (argc - optind != 2) {
+        fprintf(stderr, "ERROR: Two input files required\n\n");
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    /* Private directory for the intermediate snapshots */
+    GError *err = NULL;
+    char *work = g_build_filename(tmpdir, "sav_diff-XXXXXX", NULL);
+    if (!g_mkdtemp(work)) {
+        fprintf(stderr, "ERROR: Cannot create a directory in %s\n", tmpdir);
+        g_free(work);
+        return 2;
+    }
+    char *tmp_paths[2] = {
+        g_build_filename(work, "before.savs", NULL),
+        g_build_filename(work, "after.savs", NULL)
+    };
+
+    sav_snapshot_t *snaps[2] = { NULL, NULL };
+    int rc = 2;
+    for (int side = 0; side < 2; side++) {
+        snaps[side] = open_input(argv[optind + side], threads, tmp_paths[side], &err);
+        if (!snaps[side]) {
+            fprintf(stderr, "ERROR: %s: %s\n", argv[optind + side],
+                    err ? err->message : "Unknown error");
+            g_clear_error(&err);
+            goto done;
+        }
+        madvise((void *)snaps[side]->base, snaps[side]->len, MADV_SEQUENTIAL);
+    }
+
+    /* One merge pass over both sorted lists */
+    const sav_snapshot_entry_t *a = snaps[0]->entries, *b = snaps[1]->entries;
+    uint64_t na = sav_snapshot_count(snaps[0]), nb = sav_snapshot_count(snaps[1]);
+    uint64_t i = 0, j = 0, added = 0, removed = 0, changed = 0;
+
+    while (i < na || j < nb) {
+        int c = (i == na) ? 1 : (j == nb) ? -1 : sav_snapshot_entry_cmp(&a[i], &b[j]);
+        if (c < 0) {
+            removed++;
+            if (format != DIFF_STATS) print_change(format, &a[i], NULL);
+            i++;
+        } else if (c > 0) {
+            added++;
+            if (format != DIFF_STATS) print_change(format, NULL, &b[j]);
+            j++;
+        } else {
+            if (a[i].rule_type != b[j].rule_type || a[i].policy_action != b[j].policy_action) {
+                changed++;
+                if (format != DIFF_STATS) print_change(format, &a[i], &b[j]);
+            }
+            i++;
+            j++;
+        }
+    }
+
+    if (format != DIFF_NDJSON) {
+        printf("%s%lu added, %lu removed, %lu changed (%lu mappings before, %lu after)\n",
+               format == DIFF_STATS ? "" : "\n", (unsigned long)added, (unsigned long)removed,
+               (unsigned long)changed, (unsigned long)na, (unsigned long)nb);
+    }
+    rc = (added || removed || changed) ? 1 : 0;
+
+done:
+    for (int side = 0; side < 2; side++) {
+        sav_snapshot_close(snaps[side]);
+        unlink(tmp_paths[side]);
+        g_free(tmp_paths[side]);
+    }
+    rmdir(work);
+    g_free(work);
+    return rc;
+}
@@ -5,7 +5,12 @@
  * Usage: sav_dump [options] <ipfix_file>
  * Options:
  *   -j, --json     Output in JSON format
+ *   -c, --compact  Compact JSON (implies --json)
+ *   -n, --ndjson   One compact JSON object per line
+ *   -b, --binary   Length-prefixed binary records (see sav_sink.h)
  *   -v, --verbose  Verbose output with validation
+ *   -t, --threads  Decode with N threads
+ *   -L, --legacy-byte-order  Read files of a pre-fix exporter
  *   -h, --help     Show this help
  */
 
@@ -14,42 +19,122 @@
 #include <string.h>
 #include <getopt.h>
 #include "sav_collector.h"
+#include "sav_sink.h"
+#include "sav_validate.h"
+
+/* Records decoded per sav_read_batch() call */
+#define SAV_DUMP_BATCH_SIZE 256
+
+/* Bad mapping indices listed per record by -v */
+#define SAV_DUMP_MAX_BAD_SHOWN 16
 
 static void print_usage(const char *prog_name)
 {
     printf("Usage: %s [options] <ipfix_file>\n\n", prog_name);
     printf("Options:\n");
     printf("  -j, --json      Output in JSON format\n");
+    printf("  -c, --compact   Compact JSON without whitespace (implies -j)\n");
+    printf("  -n, --ndjson    One compact JSON object per line\n");
+    printf("  -b, --binary    Length-prefixed binary records for ingest\n");
     printf("  -v, --verbose   Verbose output with validation\n");
     printf("  -s, --stats     Show only statistics\n");
+    printf("  -t, --threads N Decode the file with N threads\n");
+    printf("  -L, --legacy-byte-order\n");
+    printf("                  Read a file written by an exporter that byte-swapped\n");
+    printf("                  ingressInterface and IPv4 prefixes\n");
     printf("  -h, --help      Show this help\n\n");
     printf("Examples:\n");
     printf("  %s data.ipfix               # Dump in text format\n", prog_name);
     printf("  %s -j data.ipfix            # Dump in JSON format\n", prog_name);
+    printf("  %s -c data.ipfix            # Dump in compact JSON format\n", prog_name);
+    printf("  %s -n data.ipfix | split -l 100000   # Stream NDJSON\n", prog_name);
+    printf("  %s -b data.ipfix > data.savb   # Binary dump\n", prog_name);
     printf("  %s -v data.ipfix            # Dump with validation\n", prog_name);
-    printf("  %s -s data.ipfix            # Show only statistics\n\n", prog_name);
+    printf("  %s -s data.ipfix            # Show only statistics\n", prog_name);
+    printf("  %s -t 8 -s data.ipfix       # Statistics using 8 decoder threads\n\n", prog_name);
+}
+
+/*
+ * Validate one record for -v: record-level fields first, then all
+ * mappings at once. bad/bad_words is a bitmap reused across records.
+ */
+static void validate_record(
+    const sav_parsed_record_t *record,
+    uint64_t                  **bad,
+    size_t                    *bad_words,
+    int                       text)
+{
+    GError *val_err = NULL;
+    
+    if (!sav_validate_record_header(record, &val_err)) {
+        fprintf(stderr, "⚠ Validation failed: %s\n",
+                val_err ? val_err->message : "Unknown error");
+        if (val_err) g_error_free(val_err);
+        return;
+    }
+    
+    size_t words = SAV_VALIDATE_BITMAP_WORDS(record->mapping_count);
+    if (words > *bad_words || *bad == NULL) {
+        *bad_words = words ? words : 1;
+        *bad = g_renew(uint64_t, *bad, *bad_words);
+    }
+    
+    uint32_t n_bad = sav_validate_record_mappings(record, *bad);
+    if (n_bad == 0) {
+        if (text) {
+            printf("✓ Validation passed\n\n");
+        }
+        return;
+    }
+    
+    fprintf(stderr, "⚠ Validation failed: %u of %u mappings invalid (length or host bits) at",
+            n_bad, record->mapping_count);
+    uint32_t shown = 0;
+    for (size_t w = 0; w < words && shown < SAV_DUMP_MAX_BAD_SHOWN; w++) {
+        for (uint64_t bits = (*bad)[w]; bits && shown < SAV_DUMP_MAX_BAD_SHOWN; bits &= bits - 1) {
+            fprintf(stderr, " %lu", (unsigned long)(w * 64 + (size_t)__builtin_ctzll(bits)));
+            shown++;
+        }
+    }
+    fprintf(stderr, "%s\n", n_bad > shown ? " ..." : "");
 }
 
 int main(int argc, char **argv)
 {
-    int json_format = 0;
+    sav_sink_format_t format = SAV_SINK_TEXT;
     int verbose = 0;
     int stats_only = 0;
+    uint32_t threads = 1;
+    int legacy_order = 0;
     
     /* Parse options */
     static struct option long_options[] = {
         {"json",    no_argument, 0, 'j'},
+        {"compact", no_argument, 0, 'c'},
+        {"ndjson",  no_argument, 0, 'n'},
+        {"binary",  no_argument, 0, 'b'},
         {"verbose", no_argument, 0, 'v'},
         {"stats",   no_argument, 0, 's'},
+        {"threads", required_argument, 0, 't'},
+        {"legacy-byte-order", no_argument, 0, 'L'},
         {"help",    no_argument, 0, 'h'},
         {0, 0, 0, 0}
     };
     
     int opt;
-    while ((opt = getopt_long(argc, argv, "jvsh", long_options, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "jcnbvst:Lh", long_options, NULL)) != -1) {
         switch (opt) {
             case 'j':
-                json_format = 1;
+                format = SAV_SINK_JSON;
+                break;
+            case 'c':
+                format = SAV_SINK_JSON_COMPACT;
+                break;
+            case 'n':
+                format = SAV_SINK_NDJSON;
+                break;
+            case 'b':
+                format = SAV_SINK_BINARY;
                 break;
             case 'v':
                 verbose = 1;
@@ -57,6 +142,16 @@ int main(int argc, char **argv)
             case 's':
                 stats_only = 1;
                 break;
+            case 't':
+                threads = (uint32_t)strtoul(optarg, NULL, 10);
+                if (threads == 0) {
+                    fprintf(stderr, "ERROR: Invalid thread count: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'L':
+                legacy_order = 1;
+                break;
             case 'h':
                 print_usage(argv[0]);
                 return 0;
@@ -77,60 +172,79 @@ int main(int argc, char **argv)
     GError *err = NULL;
     
     /* Create collector */
-    sav_collector_ctx_t *collector = sav_create_file_collector(input_file, &err);
+    sav_collector_ctx_t *collector = (threads > 1)
+        ? sav_create_parallel_file_collector(input_file, threads, &err)
+        : sav_create_file_collector(input_file, &err);
     if (!collector) {
         fprintf(stderr, "ERROR: Failed to open %s: %s\n", 
                 input_file, err ? err->message : "Unknown error");
         if (err) g_error_free(err);
         return 1;
     }
+    if (legacy_order && !sav_collector_set_legacy_byte_order(collector, TRUE, &err)) {
+        fprintf(stderr, "ERROR: %s\n", err->message);
+        g_error_free(err);
+        sav_close_collector(collector);
+        return 1;
+    }
     
-    /* JSON array start */
-    if (json_format && !stats_only) {
-        printf("[\n");
+    /* All record output goes through one sink */
+    sav_sink_t *sink = NULL;
+    if (!stats_only) {
+        sink = sav_sink_new(stdout, format, &err);
+        if (!sink) {
+            fprintf(stderr, "ERROR: %s\n", err->message);
+            g_error_free(err);
+            sav_close_collector(collector);
+            return 1;
+        }
     }
     
-    /* Read and process records */
-    sav_parsed_record_t record;
-    uint32_t count = 0;
-    int first_record = 1;
+    /* Read and process records in arena-backed batches */
+    sav_parsed_record_t batch[SAV_DUMP_BATCH_SIZE];
+    sav_arena_t arena;
+    uint32_t n;
+    int write_failed = 0;
+    uint64_t *bad = NULL;
+    size_t bad_words = 0;
     
-    while (sav_read_record(collector, &record, &err)) {
-        count++;
-        
-        if (!stats_only) {
-            if (json_format) {
-                if (!first_record) printf(",\n");
-                sav_export_record_json(&record, stdout);
-                first_record = 0;
-            } else {
-                printf("=== Record #%u ===\n", count);
-                sav_print_record(&record, stdout);
+    sav_arena_init(&arena, 0);
+    
+    while ((n = sav_read_batch(collector, batch, SAV_DUMP_BATCH_SIZE, &arena, &err)) > 0) {
+        for (uint32_t i = 0; i < n && !stats_only && !write_failed; i++) {
+            sav_parsed_record_t *record = &batch[i];
+            GError *out_err = NULL;
+            
+            if (!sav_sink_write(sink, record, &out_err)) {
+                fprintf(stderr, "ERROR: %s\n", out_err->message);
+                g_error_free(out_err);
+                write_failed = 1;
+                break;
             }
             
             /* Validate if verbose */
             if (verbose) {
-                if (!sav_validate_record(&record, &err)) {
-                    fprintf(stderr, "⚠ Validation failed: %s\n",
-                            err ? err->message : "Unknown error");
-                    if (err) {
-                        g_error_free(err);
-                        err = NULL;
-                    }
-                } else {
-                    if (!json_format) {
-                        printf("✓ Validation passed\n\n");
-                    }
-                }
+                validate_record(record, &bad, &bad_words, format == SAV_SINK_TEXT);
             }
         }
         
-        sav_free_parsed_record(&record);
+        /* Release the whole batch at once */
+        sav_arena_reset(&arena);
+        if (err || write_failed) break;
     }
     
-    /* JSON array end */
-    if (json_format && !stats_only) {
-        printf("\n]\n");
+    sav_arena_destroy(&arena);
+    g_free(bad);
+    
+    /* Stream trailer (JSON array end) */
+    if (sink) {
+        GError *out_err = NULL;
+        if (!write_failed && !sav_sink_finish(sink, &out_err)) {
+            fprintf(stderr, "ERROR: %s\n", out_err->message);
+            g_error_free(out_err);
+            write_failed = 1;
+        }
+        sav_sink_free(sink);
     }
     
     /* Check for read errors */
@@ -146,7 +260,7 @@ int main(int argc, char **argv)
     sav_collector_get_stats(collector, &records_read, &parse_errors);
     
     if (stats_only || verbose) {
-        if (!json_format || stats_only) {
+        if (format == SAV_SINK_TEXT || stats_only) {
             printf("\n=== Statistics ===\n");
             printf("File: %s\n", input_file);
             printf("Records read: %lu\n", (unsigned long)records_read);
@@ -162,5 +276,5 @@ int main(int argc, char **argv)
     /* Clean up */
     sav_close_collector(collector);
     
-    return (records_read > 0) ? 0 : 1;
+    return (records_read > 0 && !write_failed) ? 0 : 1;
 }
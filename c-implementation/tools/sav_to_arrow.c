@@ -0,0 +1,160 @@
+/**
+ * @file sav_to_arrow.c
+ * @brief Convert SAV IPFIX mappings to an Arrow IPC stream
+ *
+ * Usage: sav_to_arrow [options] <ipfix_file> [output.arrows]
+ * Options:
+ *   -r, --batch-rows N  Rows per record batch
+ *   -t, --threads N     Decode with N threads
+ *   -h, --help          Show this help
+ *
+ * Writes one row per mapping (see sav_arrow.h for the schema) to the
+ * output file, or to stdout when it is omitted or "-".
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include "sav_collector.h"
+#include "sav_arrow.h"
+
+/* Records decoded per sav_read_batch() call */
+#define SAV_TO_ARROW_BATCH_SIZE 256
+
+static void print_usage(const char *prog_name)
+{
+    printf("Usage: %s [options] <ipfix_file> [output.arrows]\n\n", prog_name);
+    printf("Options:\n");
+    printf("  -r, --batch-rows N  Rows per Arrow record batch (default %u)\n",
+           SAV_ARROW_DEFAULT_BATCH_ROWS);
+    printf("  -t, --threads N     Decode the file with N threads\n");
+    printf("  -h, --help          Show this help\n\n");
+    printf("Examples:\n");
+    printf("  %s data.ipfix data.arrows\n", prog_name);
+    printf("  %s -r 1000000 data.ipfix - | python3 load.py\n\n", prog_name);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t batch_rows = 0;
+    uint32_t threads = 1;
+
+    static struct option long_options[] = {
+        {"batch-rows", required_argument, 0, 'r'},
+        {"threads",    required_argument, 0, 't'},
+        {"help",       no_argument,       0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "r:t:h", long_options, NULL)) != -1) {
+        switch (opt) {
+            case 'r':
+                batch_rows = (uint32_t)strtoul(optarg, NULL, 10);
+                if (batch_rows == 0) {
+                    fprintf(stderr, "ERROR: Invalid batch size: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 't':
+                threads = (uint32_t)strtoul(optarg, NULL, 10);
+                if (threads == 0) {
+                    fprintf(stderr, "ERROR: Invalid thread count: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'h':
+                print_usage(argv[0]);
+                return 0;
+            default:
+                print_usage(argv[0]);
+                return 1;
+        }
+    }
+
+    if (optind >= argc) {
+        fprintf(stderr, "ERROR: No input file specified\n\n");
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    const char *input_file = argv[optind];
+    const char *output_file = (optind + 1 < argc) ? argv[optind + 1] : "-";
+    GError *err = NULL;
+
+    sav_collector_ctx_t *collector = (threads > 1)
+        ? sav_create_parallel_file_collector(input_file, threads, &err)
+        : sav_create_file_collector(input_file, &err);
+    if (!collector) {
+        fprintf(stderr, "ERROR: Failed to open %s: %s\n",
+                input_file, err ? err->message : "Unknown error");
+        if (err) g_error_free(err);
+        return 1;
+    }
+
+    FILE *out = strcmp(output_file, "-") == 0 ? stdout : fopen(output_file, "wb");
+    if (!out) {
+        perror(output_file);
+        sav_close_collector(collector);
+        return 1;
+    }
+
+    sav_arrow_writer_t *writer = sav_arrow_writer_new(out, batch_rows, &err);
+    sav_parsed_record_t batch[SAV_TO_ARROW_BATCH_SIZE];
+    sav_arena_t arena;
+    uint32_t n;
+    int failed = (writer == NULL);
+
+    sav_arena_init(&arena, 0);
+
+    while (!failed &&
+           (n = sav_read_batch(collector, batch, SAV_TO_ARROW_BATCH_SIZE, &arena, &err)) > 0) {
+        for (uint32_t i = 0; i < n && !failed; i++) {
+            GError *out_err = NULL;
+            if (!sav_arrow_write_record(writer, &batch[i], &out_err)) {
+                fprintf(stderr, "ERROR: %s\n", out_err->message);
+                g_error_free(out_err);
+                failed = 1;
+            }
+        }
+        sav_arena_reset(&arena);
+        if (err) break;
+    }
+
+    sav_arena_destroy(&arena);
+
+    /* Read errors other than EOF still leave a valid, truncated stream */
+    if (err && err->code != FB_ERROR_EOF) {
+        fprintf(stderr, "ERROR: %s\n", err->message);
+        failed = 1;
+    }
+    if (err) g_error_free(err);
+    err = NULL;
+
+    if (writer) {
+        if (!sav_arrow_writer_finish(writer, &err)) {
+            fprintf(stderr, "ERROR: %s\n", err->message);
+            g_error_free(err);
+            failed = 1;
+        }
+
+        uint64_t rows, batches;
+        sav_arrow_writer_get_stats(writer, &rows, &batches);
+        fprintf(stderr, "Wrote %lu rows in %lu record batches to %s\n",
+                (unsigned long)rows, (unsigned long)batches,
+                out == stdout ? "stdout" : output_file);
+        sav_arrow_writer_free(writer);
+    }
+
+    if (out != stdout && fclose(out) != 0) {
+        perror(output_file);
+        failed = 1;
+    } else if (out == stdout && fflush(stdout) != 0) {
+        perror("stdout");
+        failed = 1;
+    }
+
+    sav_close_collector(collector);
+    return failed ? 1 : 0;
+}